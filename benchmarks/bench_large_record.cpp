@@ -0,0 +1,106 @@
+/**
+ * @file bench_large_record.cpp
+ * @brief Measures storeData() and retrieveData() throughput of one large record, as a
+ * single GCM pass and as a segmented record with a growing number of workers.
+ *
+ * Each configuration stores the record with Durability::None (so the flush does not hide
+ * the encryption) and reads it back warm, a few times, and prints the best MB/s of each.
+ * "single" disables segmenting; "seg/N" segments with N workers.
+ *
+ * Usage: bench_large_record [record_mib] [segment_kib] [max_workers] [directory]
+ */
+#include "storage/SecureStore.h"
+#include "utils/FileUtil.h"
+#include "utils/Logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <sstream>
+
+#include <unistd.h> // For getpid
+
+using namespace SecureStorage;
+
+namespace {
+
+constexpr int RUNS = 3;
+
+double millisSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Best store and retrieve time of RUNS runs, in ms; false on failure.
+bool measure(Storage::SecureStore& store, const std::vector<unsigned char>& data, double& storeMs, double& readMs) {
+    std::vector<unsigned char> out;
+    storeMs = readMs = 1e300;
+    for (int run = 0; run < RUNS; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        if (store.storeData("large_record", data, Storage::Durability::None) != Error::Errc::Success) {
+            std::fprintf(stderr, "storeData failed\n");
+            return false;
+        }
+        storeMs = std::min(storeMs, millisSince(start));
+        start = std::chrono::steady_clock::now();
+        if (store.retrieveData("large_record", out) != Error::Errc::Success || out != data) {
+            std::fprintf(stderr, "retrieveData failed\n");
+            return false;
+        }
+        readMs = std::min(readMs, millisSince(start));
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    long recordMib = argc > 1 ? std::atol(argv[1]) : 64;
+    long segmentKib = argc > 2 ? std::atol(argv[2]) : 1024;
+    long maxWorkers = argc > 3 ? std::atol(argv[3]) : 8;
+    std::ostringstream dir;
+    dir << (argc > 4 ? argv[4] : ".") << "/bench_large_record_" << getpid();
+    recordMib = std::max(recordMib, 1L);
+    segmentKib = std::max(segmentKib, 1L);
+    maxWorkers = std::max(maxWorkers, 1L);
+
+    Utils::Logger::getInstance().setLogLevel(Utils::LogLevel::ERROR);
+    const std::string root = dir.str() + "/";
+    Storage::SecureStore store(root, "BenchSerial");
+    if (!store.isInitialized()) {
+        std::fprintf(stderr, "Failed to initialize SecureStore at %s\n", root.c_str());
+        return 1;
+    }
+    std::vector<unsigned char> data(static_cast<size_t>(recordMib) * 1024 * 1024);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<unsigned char>(i * 131);
+    }
+    const double mb = static_cast<double>(data.size()) / (1024.0 * 1024.0);
+
+    std::printf("One record of %ld MiB, segments of %ld KiB, in %s\n", recordMib, segmentKib, root.c_str());
+    std::printf("%-8s %12s %12s %12s %12s\n", "mode", "store ms", "store MB/s", "read ms", "read MB/s");
+    bool ok = true;
+    for (long workers = 0; workers <= maxWorkers && ok; workers = workers == 0 ? 1 : workers * 2) {
+        Storage::SegmentOptions options;
+        options.threshold = workers == 0 ? 0 : 1;
+        options.segmentSize = static_cast<size_t>(segmentKib) * 1024;
+        options.workers = static_cast<unsigned>(workers);
+        store.setSegmentOptions(options);
+        double storeMs = 0;
+        double readMs = 0;
+        ok = measure(store, data, storeMs, readMs);
+        std::string mode = workers == 0 ? "single" : "seg/" + std::to_string(workers);
+        std::printf("%-8s %12.2f %12.1f %12.2f %12.1f\n", mode.c_str(), storeMs, 1000.0 * mb / storeMs,
+                    readMs, 1000.0 * mb / readMs);
+    }
+
+    std::vector<std::string> files;
+    Utils::FileUtil::listDirectory(root, files);
+    for (const std::string& file : files) {
+        std::remove((root + file).c_str());
+    }
+    std::remove(dir.str().c_str());
+    return ok ? 0 : 1;
+}
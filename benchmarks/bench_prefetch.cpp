@@ -0,0 +1,138 @@
+/**
+ * @file bench_prefetch.cpp
+ * @brief Measures boot-time reads of a set of ids, serially and after SecureStore::prefetch().
+ *
+ * Stores the ids, then for each mode drops their files from the page cache
+ * (POSIX_FADV_DONTNEED; the files are clean after storeData) and opens a new
+ * SecureStore, as a restarting service would:
+ *   - serial:   retrieveData() for every id, one after the other.
+ *   - prefetch: prefetch() of all ids, then retrieveData() for every id.
+ * Reports the time to have read every id once and the plaintext cache counters.
+ *
+ * Usage: bench_prefetch [id_count] [record_size_bytes] [worker_threads] [directory]
+ */
+#include "storage/SecureStore.h"
+#include "utils/FileUtil.h"
+#include "utils/Logger.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <sstream>
+
+#include <fcntl.h>  // For posix_fadvise
+#include <unistd.h> // For getpid, close
+
+using namespace SecureStorage;
+
+namespace {
+
+double millisSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void dropFromPageCache(const std::string& root, const std::vector<std::string>& ids) {
+    for (const std::string& id : ids) {
+        int fd = open((root + id + Storage::DATA_FILE_EXTENSION).c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) {
+#ifdef POSIX_FADV_DONTNEED
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+            close(fd);
+        }
+    }
+}
+
+bool readAll(Storage::SecureStore& store, const std::vector<std::string>& ids) {
+    std::vector<unsigned char> out;
+    for (const std::string& id : ids) {
+        if (store.retrieveData(id, out) != Error::Errc::Success) {
+            std::fprintf(stderr, "Failed to read %s\n", id.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    long idCount = argc > 1 ? std::atol(argv[1]) : 256;
+    long recordSize = argc > 2 ? std::atol(argv[2]) : 4096;
+    unsigned workers = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 0;
+    std::ostringstream dir;
+    dir << (argc > 4 ? argv[4] : ".") << "/bench_prefetch_" << getpid();
+    if (idCount <= 0) {
+        idCount = 1;
+    }
+    if (recordSize <= 0) {
+        recordSize = 1;
+    }
+
+    Utils::Logger::getInstance().setLogLevel(Utils::LogLevel::ERROR);
+    const std::string root = dir.str() + "/";
+    std::vector<std::string> ids;
+    {
+        Storage::SecureStore store(root, "BenchSerial");
+        if (!store.isInitialized()) {
+            std::fprintf(stderr, "Failed to initialize SecureStore at %s\n", root.c_str());
+            return 1;
+        }
+        std::vector<unsigned char> data(static_cast<size_t>(recordSize), 0x5a);
+        for (long i = 0; i < idCount; ++i) {
+            ids.push_back("boot_" + std::to_string(i));
+            if (store.storeData(ids.back(), data) != Error::Errc::Success) {
+                std::fprintf(stderr, "Failed to store %s\n", ids.back().c_str());
+                return 1;
+            }
+        }
+    }
+
+    std::printf("Boot reads, %ld ids of %ld bytes, in %s\n", idCount, recordSize, root.c_str());
+    std::printf("%-9s %12s %12s %12s %10s %10s %8s\n", "mode", "prefetch ms", "reads ms", "total ms",
+                "hits", "pf hits", "workers");
+    bool ok = true;
+
+    dropFromPageCache(root, ids);
+    {
+        auto start = std::chrono::steady_clock::now();
+        Storage::SecureStore store(root, "BenchSerial");
+        double open_ms = millisSince(start);
+        start = std::chrono::steady_clock::now();
+        ok = readAll(store, ids) && ok;
+        double reads_ms = millisSince(start);
+        std::printf("%-9s %12.2f %12.2f %12.2f %10d %10d %8d\n", "serial", 0.0, reads_ms, open_ms + reads_ms, 0, 0, 1);
+    }
+
+    dropFromPageCache(root, ids);
+    {
+        auto start = std::chrono::steady_clock::now();
+        Storage::SecureStore store(root, "BenchSerial");
+        double open_ms = millisSince(start);
+        store.enablePlaintextCache(static_cast<size_t>(idCount) * static_cast<size_t>(recordSize));
+        Storage::PrefetchReport report;
+        start = std::chrono::steady_clock::now();
+        ok = store.prefetch(ids, report, workers) == Error::Errc::Success && ok;
+        double prefetch_ms = millisSince(start);
+        start = std::chrono::steady_clock::now();
+        ok = readAll(store, ids) && ok;
+        double reads_ms = millisSince(start);
+        Storage::PlaintextCacheStats stats = store.getPlaintextCacheStats();
+        std::printf("%-9s %12.2f %12.2f %12.2f %10llu %10llu %8u\n", "prefetch", prefetch_ms, reads_ms,
+                    open_ms + prefetch_ms + reads_ms, static_cast<unsigned long long>(stats.hits),
+                    static_cast<unsigned long long>(stats.prefetchHits), report.workerThreads);
+        if (stats.prefetchedEntries > 0) {
+            std::printf("prefetch hit rate: %.1f%%\n", 100.0 * stats.prefetchHits / stats.prefetchedEntries);
+        }
+    }
+
+    std::vector<std::string> files;
+    Utils::FileUtil::listDirectory(root, files);
+    for (const std::string& file : files) {
+        std::remove((root + file).c_str());
+    }
+    std::remove(dir.str().c_str());
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+/**
+ * @file bench_retrieve_many.cpp
+ * @brief Measures reading a set of ids with a serial retrieveData() loop and with retrieveMany().
+ *
+ * Stores the ids, then for each mode drops their files from the page cache
+ * (POSIX_FADV_DONTNEED; the files are clean after storeData) and reads every id once:
+ *   - serial: retrieveData() for every id, one after the other.
+ *   - many:   one retrieveMany() call with all ids, in a shuffled order.
+ * Each mode runs cold (after the drop) and warm (immediately again), as the disk and the
+ * decryption dominate respectively.
+ *
+ * Usage: bench_retrieve_many [id_count] [record_size_bytes] [worker_threads] [directory]
+ */
+#include "storage/SecureStore.h"
+#include "utils/FileUtil.h"
+#include "utils/Logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <sstream>
+
+#include <fcntl.h>  // For posix_fadvise
+#include <unistd.h> // For getpid, close
+
+using namespace SecureStorage;
+
+namespace {
+
+double millisSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void dropFromPageCache(const std::string& root, const std::vector<std::string>& ids) {
+    for (const std::string& id : ids) {
+        int fd = open((root + id + Storage::DATA_FILE_EXTENSION).c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) {
+#ifdef POSIX_FADV_DONTNEED
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+            close(fd);
+        }
+    }
+}
+
+bool readSerial(Storage::SecureStore& store, const std::vector<std::string>& ids) {
+    std::vector<unsigned char> out;
+    for (const std::string& id : ids) {
+        if (store.retrieveData(id, out) != Error::Errc::Success) {
+            std::fprintf(stderr, "Failed to read %s\n", id.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool readMany(Storage::SecureStore& store, const std::vector<std::string>& ids, unsigned workers) {
+    std::vector<Storage::RetrieveResult> results;
+    if (store.retrieveMany(ids, results, workers) != Error::Errc::Success) {
+        std::fprintf(stderr, "retrieveMany failed\n");
+        return false;
+    }
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (results[i].status != Error::Errc::Success) {
+            std::fprintf(stderr, "Failed to read %s\n", ids[i].c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    long idCount = argc > 1 ? std::atol(argv[1]) : 300;
+    long recordSize = argc > 2 ? std::atol(argv[2]) : 1024;
+    unsigned workers = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 0;
+    std::ostringstream dir;
+    dir << (argc > 4 ? argv[4] : ".") << "/bench_retrieve_many_" << getpid();
+    if (idCount <= 0) {
+        idCount = 1;
+    }
+    if (recordSize <= 0) {
+        recordSize = 1;
+    }
+
+    Utils::Logger::getInstance().setLogLevel(Utils::LogLevel::ERROR);
+    const std::string root = dir.str() + "/";
+    Storage::SecureStore store(root, "BenchSerial");
+    if (!store.isInitialized()) {
+        std::fprintf(stderr, "Failed to initialize SecureStore at %s\n", root.c_str());
+        return 1;
+    }
+    std::vector<std::string> ids;
+    std::vector<unsigned char> data(static_cast<size_t>(recordSize), 0x5a);
+    for (long i = 0; i < idCount; ++i) {
+        ids.push_back("setting_" + std::to_string(i));
+        if (store.storeData(ids.back(), data, Storage::Durability::None) != Error::Errc::Success) {
+            std::fprintf(stderr, "Failed to store %s\n", ids.back().c_str());
+            return 1;
+        }
+    }
+    store.syncDeferred();
+    sync(); // Clean pages, so the drop below really evicts them
+    // Callers ask in their own order, not in creation order.
+    std::vector<std::string> request = ids;
+    std::shuffle(request.begin(), request.end(), std::mt19937(42));
+
+    std::printf("Batched reads, %ld ids of %ld bytes, in %s\n", idCount, recordSize, root.c_str());
+    std::printf("%-8s %12s %12s %12s\n", "mode", "cold ms", "warm ms", "us/id warm");
+    bool ok = true;
+    for (int mode = 0; mode < 2; ++mode) {
+        double ms[2];
+        for (int pass = 0; pass < 2; ++pass) {
+            if (pass == 0) {
+                dropFromPageCache(root, ids);
+            }
+            auto start = std::chrono::steady_clock::now();
+            ok = (mode == 0 ? readSerial(store, request) : readMany(store, request, workers)) && ok;
+            ms[pass] = millisSince(start);
+        }
+        std::printf("%-8s %12.2f %12.2f %12.2f\n", mode == 0 ? "serial" : "many", ms[0], ms[1],
+                    1000.0 * ms[1] / static_cast<double>(idCount));
+    }
+
+    std::vector<std::string> files;
+    Utils::FileUtil::listDirectory(root, files);
+    for (const std::string& file : files) {
+        std::remove((root + file).c_str());
+    }
+    std::remove(dir.str().c_str());
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+/**
+ * @file bench_store_io.cpp
+ * @brief Measures the file system cost of SecureStore::storeData.
+ *
+ * For each staging strategy (anonymous O_TMPFILE file vs named `<id>.enc.tmp` file) it
+ * reports system calls, fsync/fdatasync calls and wall time per store, separately for
+ * first writes of new ids and for overwrites of an existing id.
+ *
+ * Usage: bench_store_io [iterations] [record_size_bytes] [directory]
+ */
+#include "storage/SecureStore.h"
+#include "utils/FileUtil.h"
+#include "utils/Logger.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <sstream>
+
+#include <unistd.h> // For getpid
+
+using namespace SecureStorage;
+
+namespace {
+
+struct Result {
+    double syscallsPerStore;
+    double fsyncsPerStore;
+    double microsPerStore;
+};
+
+Result runPhase(Storage::SecureStore& store, const std::string& idPrefix, bool sameId,
+                int iterations, const std::vector<unsigned char>& payload) {
+    Utils::FileIoStats before = store.getIoStats();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        std::ostringstream id;
+        id << idPrefix;
+        if (!sameId) {
+            id << "_" << i;
+        }
+        if (store.storeData(id.str(), payload) != Error::Errc::Success) {
+            std::fprintf(stderr, "storeData failed for '%s'\n", id.str().c_str());
+            std::exit(1);
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    Utils::FileIoStats after = store.getIoStats();
+
+    Result r;
+    r.syscallsPerStore = static_cast<double>(after.syscalls - before.syscalls) / iterations;
+    r.fsyncsPerStore = static_cast<double>(after.fsyncs - before.fsyncs) / iterations;
+    r.microsPerStore = std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+    return r;
+}
+
+void printRow(const char* strategy, const char* phase, const Result& r) {
+    std::printf("%-10s %-10s %12.2f %10.2f %12.1f\n", strategy, phase, r.syscallsPerStore, r.fsyncsPerStore, r.microsPerStore);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 200;
+    size_t recordSize = argc > 2 ? static_cast<size_t>(std::atol(argv[2])) : 256;
+    std::ostringstream dir;
+    dir << (argc > 3 ? argv[3] : ".") << "/bench_store_io_" << getpid();
+    if (iterations <= 0) {
+        iterations = 1;
+    }
+
+    Utils::Logger::getInstance().setLogLevel(Utils::LogLevel::ERROR);
+    std::vector<unsigned char> payload(recordSize, 0x5a);
+
+    std::printf("storeData cost, %d iterations, %zu-byte records, in %s\n", iterations, recordSize, dir.str().c_str());
+    std::printf("%-10s %-10s %12s %10s %12s\n", "strategy", "phase", "syscalls/op", "fsyncs/op", "us/op");
+
+    const bool strategies[] = { true, false };
+    for (bool anonymous : strategies) {
+        std::string root = dir.str() + (anonymous ? "/anonymous" : "/named");
+        Storage::SecureStore store(root, "BenchSerial");
+        if (!store.isInitialized()) {
+            std::fprintf(stderr, "Failed to initialize SecureStore at %s\n", root.c_str());
+            return 1;
+        }
+        store.setAnonymousTempFilesEnabled(anonymous);
+        const char* name = anonymous ? "O_TMPFILE" : "named-tmp";
+        printRow(name, "new-id", runPhase(store, "new", false, iterations, payload));
+        printRow(name, "overwrite", runPhase(store, "hot", true, iterations, payload));
+
+        std::vector<std::string> files;
+        Utils::FileUtil::listDirectory(root, files);
+        for (const std::string& file : files) {
+            std::remove((root + "/" + file).c_str());
+        }
+        std::remove(root.c_str());
+    }
+    std::remove(dir.str().c_str());
+    return 0;
+}
@@ -1,39 +1,94 @@
 #include "SecureStorageManager.h" // Public API header
 #include "storage/SecureStore.h" // Definition of SecureStore
+#include "storage/WriteBackBuffer.h" // Write-back mode
 #include "utils/Logger.h"        // For SS_LOG macros
+#include "utils/SecureWipe.h"    // For Utils::secureWipe
 #include "file_watcher/FileWatcher.h" // FileWatcher definition
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+
 namespace SecureStorage {
 
 // PImpl (Pointer to Implementation) class
 class SecureStorageManager::SecureStorageManagerImpl {
 public:
+    enum class InitState { Pending, Ready, Failed };
+
     std::unique_ptr<Storage::SecureStore> secureStoreInstance;
     std::unique_ptr<FileWatcher::FileWatcher> fileWatcherInstance; // Future addition
-    bool isManagerInitialized;
+    // Set once by enableWriteBack() and published through writeBackBuffer, which callers
+    // on any thread load without a lock; it only goes away with the manager.
+    std::mutex writeBackMutex;
+    std::unique_ptr<Storage::WriteBackBuffer> writeBackOwner;
+    std::atomic<Storage::WriteBackBuffer*> writeBackBuffer; // Set in write-back mode; fronts secureStoreInstance
     bool isFileWatcherActive;
+    InitOptions initOptions;
+    InitTimings initTimings;
+    // Written last by initialize(); everything above is only read once this is not Pending.
+    std::atomic<InitState> initState;
+    std::promise<Error::Errc> readyPromise;
+    std::shared_future<Error::Errc> readyFuture;
+    std::thread initThread; // Runs initialize() in InitMode::Asynchronous
 
-    // Constructor initializes the SecureStore and integrates FileWatcher
+    // Constructor initializes the SecureStore and integrates FileWatcher, or starts a thread that does
     SecureStorageManagerImpl(
         const std::string& rootStoragePath, 
         const std::string& deviceSerialNumber,
-        FileWatcher::EventCallback fileWatcherCallback = nullptr // Optional callback for file watcher events
+        FileWatcher::EventCallback fileWatcherCallback, // Optional callback for file watcher events
+        const InitOptions& options
     )
         : secureStoreInstance(nullptr),
           fileWatcherInstance(nullptr),
-          isManagerInitialized(false),
-          isFileWatcherActive(false) {  
-        
+          writeBackBuffer(nullptr),
+          isFileWatcherActive(false),
+          initOptions(options),
+          initState(InitState::Pending),
+          readyFuture(readyPromise.get_future().share()) {
+        auto start = std::chrono::steady_clock::now();
+        if (initOptions.mode == InitMode::Asynchronous) {
+            SS_LOG_INFO("SecureStorageManagerImpl: Starting asynchronous initialization.");
+            initThread = std::thread(&SecureStorageManagerImpl::initialize, this,
+                                     rootStoragePath, deviceSerialNumber, fileWatcherCallback, start);
+        } else {
+            initialize(rootStoragePath, deviceSerialNumber, fileWatcherCallback, start);
+        }
+    }
+
+    InitState state() const {
+        return initState.load(std::memory_order_acquire);
+    }
+
+    Storage::WriteBackBuffer* writeBack() const {
+        return writeBackBuffer.load(std::memory_order_acquire);
+    }
+
+    // Versions and history only exist on disk, so a buffered write of the id is committed
+    // before they are read; otherwise the newest version would be missing.
+    Error::Errc flushBufferedWrite(const std::string& data_id) {
+        Storage::WriteBackBuffer* write_back = writeBack();
+        return write_back ? write_back->flush(data_id) : Error::Errc::Success;
+    }
+
+    void initialize(const std::string& rootStoragePath, const std::string& deviceSerialNumber,
+                    FileWatcher::EventCallback fileWatcherCallback, std::chrono::steady_clock::time_point start) {
         SS_LOG_INFO("SecureStorageManagerImpl: Initializing with root path: '" << rootStoragePath
                     << "' and device serial: '" << (deviceSerialNumber.empty() ? "EMPTY" : "PRESENT") << "'");
 
         secureStoreInstance = std::unique_ptr<Storage::SecureStore>(
-            new Storage::SecureStore(rootStoragePath, deviceSerialNumber)
+            new Storage::SecureStore(rootStoragePath, deviceSerialNumber, Storage::RecoveryOptions(),
+                                    initOptions.keyCache)
         );
+        Storage::StoreInitTimings store_timings = secureStoreInstance->getInitTimings();
+        initTimings.directorySetup = store_timings.directorySetup;
+        initTimings.recovery = store_timings.recovery;
+        initTimings.cryptoSetup = store_timings.cryptoSetup;
+        initTimings.keyDerivation = store_timings.keyDerivation;
 
         if (secureStoreInstance && secureStoreInstance->isInitialized()) {
-            isManagerInitialized = true;
             SS_LOG_INFO("SecureStorageManagerImpl: SecureStore component initialized successfully.");
+            auto watcher_start = std::chrono::steady_clock::now();
 
             // Initialize and start the FileWatcher
             fileWatcherInstance = std::unique_ptr<FileWatcher::FileWatcher>(
@@ -58,21 +113,63 @@ public:
             } else {
                  SS_LOG_ERROR("SecureStorageManagerImpl: Failed to create FileWatcher instance.");
             }
+            initTimings.fileWatcher = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - watcher_start);
 
         } else {
             SS_LOG_ERROR("SecureStorageManagerImpl: SecureStore component failed to initialize. File watcher will not be started.");
             secureStoreInstance.reset(); 
         }
+
+        initTimings.total = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        SS_LOG_INFO("SecureStorageManagerImpl: Initialization took " << initTimings.total.count() << " us (directories "
+                    << initTimings.directorySetup.count() << ", recovery " << initTimings.recovery.count()
+                    << ", crypto " << initTimings.cryptoSetup.count() << ", key " << initTimings.keyDerivation.count()
+                    << ", watcher " << initTimings.fileWatcher.count() << ").");
+        bool ok = static_cast<bool>(secureStoreInstance);
+        if (ok && initOptions.plaintextCacheBytes > 0) {
+            // Before Ready: readers must never see the cache pointer change.
+            secureStoreInstance->enablePlaintextCache(initOptions.plaintextCacheBytes);
+        }
+        if (ok) {
+            secureStoreInstance->setHistoryDepth(initOptions.historyDepth);
+            secureStoreInstance->setSegmentOptions(initOptions.largeRecords);
+        }
+        if (ok && initOptions.negativeLookupFilter) {
+            // Also before Ready; a refusal (incomplete index) only costs the speed-up.
+            secureStoreInstance->enableNegativeLookupFilter();
+        }
+        initState.store(ok ? InitState::Ready : InitState::Failed, std::memory_order_release);
+        readyPromise.set_value(ok ? Error::Errc::Success : Error::Errc::NotInitialized);
+
+        if (ok && initOptions.prefetchHotSet) {
+            // After Ready: reads racing the warm-up just miss and go to disk.
+            Storage::PrefetchReport report;
+            secureStoreInstance->prefetch(secureStoreInstance->getHotSet(), report);
+        }
     }
 
     ~SecureStorageManagerImpl() {
         SS_LOG_INFO("SecureStorageManagerImpl shutting down...");
+        // Let a background initialization finish; it owns the members torn down below.
+        if (initThread.joinable()) {
+            initThread.join();
+        }
         if (fileWatcherInstance) {
             SS_LOG_DEBUG("SecureStorageManagerImpl: Stopping FileWatcher...");
             fileWatcherInstance->stop();
             fileWatcherInstance.reset(); // Explicitly reset after stopping
             SS_LOG_DEBUG("SecureStorageManagerImpl: FileWatcher stopped and reset.");
         }
+        // Commit buffered writes while the SecureStore is still alive.
+        if (writeBackOwner) {
+            writeBackBuffer.store(nullptr, std::memory_order_release);
+            writeBackOwner.reset();
+            SS_LOG_DEBUG("SecureStorageManagerImpl: WriteBackBuffer flushed and reset.");
+        }
+        if (secureStoreInstance) {
+            secureStoreInstance->saveHotSet();
+        }
         // unique_ptr will handle deletion of secureStoreInstance if not already null
         if (secureStoreInstance) {
             secureStoreInstance.reset();
@@ -88,7 +185,14 @@ SecureStorageManager::SecureStorageManager(
     const std::string& rootStoragePath,
     const std::string& deviceSerialNumber,
     FileWatcher::EventCallback fileWatcherCallback = nullptr
-) : m_impl(new SecureStorageManagerImpl(rootStoragePath, deviceSerialNumber, fileWatcherCallback)) {}
+) : m_impl(new SecureStorageManagerImpl(rootStoragePath, deviceSerialNumber, fileWatcherCallback, InitOptions())) {}
+
+SecureStorageManager::SecureStorageManager(
+    const std::string& rootStoragePath,
+    const std::string& deviceSerialNumber,
+    FileWatcher::EventCallback fileWatcherCallback,
+    const InitOptions& initOptions
+) : m_impl(new SecureStorageManagerImpl(rootStoragePath, deviceSerialNumber, fileWatcherCallback, initOptions)) {}
 
 SecureStorageManager::~SecureStorageManager() = default; // Needed for std::unique_ptr<PImpl>
 
@@ -103,54 +207,422 @@ bool SecureStorageManager::isInitialized() const {
     if (!m_impl) return false;
     // Manager is considered initialized if the core SecureStore is initialized.
     // Watcher status is secondary for the overall manager readiness for storage operations.
-    return m_impl->isManagerInitialized;
+    return m_impl->state() == SecureStorageManagerImpl::InitState::Ready;
+}
+
+std::shared_future<Error::Errc> SecureStorageManager::getReadyFuture() const {
+    if (!m_impl) return std::shared_future<Error::Errc>();
+    return m_impl->readyFuture;
+}
+
+InitTimings SecureStorageManager::getInitTimings() const {
+    if (!m_impl || m_impl->state() == SecureStorageManagerImpl::InitState::Pending) {
+        return InitTimings();
+    }
+    return m_impl->initTimings;
+}
+
+Error::Errc SecureStorageManager::checkReady(const char* operation) const {
+    if (m_impl && m_impl->state() == SecureStorageManagerImpl::InitState::Pending) {
+        if (m_impl->initOptions.whileInitializing == NotReadyPolicy::FailFast) {
+            SS_LOG_DEBUG("SecureStorageManager::" << operation << " called while initialization is still running.");
+            return Error::Errc::NotReady;
+        }
+        m_impl->readyFuture.wait();
+    }
+    if (!isInitialized()) {
+        SS_LOG_ERROR("SecureStorageManager::" << operation << " called but manager is not initialized.");
+        return Error::Errc::NotInitialized;
+    }
+    return Error::Errc::Success;
 }
 
 bool SecureStorageManager::isFileWatcherActive() const {
-    if (!m_impl) return false;
+    if (!isInitialized()) return false;
     return m_impl->isFileWatcherActive;
 }
 
 Error::Errc SecureStorageManager::storeData(const std::string& data_id, const std::vector<unsigned char>& plain_data) {
-    if (!isInitialized()) {
-        SS_LOG_ERROR("SecureStorageManager::storeData called but manager is not initialized.");
-        return Error::Errc::NotInitialized;
+    Error::Errc ready_err = checkReady("storeData");
+    if (ready_err != Error::Errc::Success) {
+        return ready_err;
+    }
+    if (Storage::WriteBackBuffer* write_back = m_impl->writeBack()) {
+        return write_back->storeData(data_id, plain_data);
     }
     return m_impl->secureStoreInstance->storeData(data_id, plain_data);
 }
 
-Error::Errc SecureStorageManager::retrieveData(const std::string& data_id, std::vector<unsigned char>& out_plain_data) {
+Error::Errc SecureStorageManager::storeData(const std::string& data_id, const std::vector<unsigned char>& plain_data,
+                                            Storage::Durability durability) {
+    Error::Errc ready_err = checkReady("storeData");
+    if (ready_err != Error::Errc::Success) {
+        return ready_err;
+    }
+    if (Storage::WriteBackBuffer* write_back = m_impl->writeBack()) {
+        return write_back->storeData(data_id, plain_data, durability);
+    }
+    return m_impl->secureStoreInstance->storeData(data_id, plain_data, durability);
+}
+
+Error::Errc SecureStorageManager::storeData(const std::string& data_id, std::vector<unsigned char>&& plain_data) {
+    Error::Errc ready_err = checkReady("storeData");
+    if (ready_err != Error::Errc::Success) {
+        Utils::secureWipe(plain_data); // Left as a successful call would leave it
+        return ready_err;
+    }
+    if (Storage::WriteBackBuffer* write_back = m_impl->writeBack()) {
+        return write_back->storeData(data_id, std::move(plain_data),
+                                                  m_impl->secureStoreInstance->getDefaultDurability());
+    }
+    return m_impl->secureStoreInstance->storeData(data_id, std::move(plain_data));
+}
+
+Error::Errc SecureStorageManager::storeData(const std::string& data_id, std::vector<unsigned char>&& plain_data,
+                                            Storage::Durability durability) {
+    Error::Errc ready_err = checkReady("storeData");
+    if (ready_err != Error::Errc::Success) {
+        Utils::secureWipe(plain_data); // Left as a successful call would leave it
+        return ready_err;
+    }
+    if (Storage::WriteBackBuffer* write_back = m_impl->writeBack()) {
+        return write_back->storeData(data_id, std::move(plain_data), durability);
+    }
+    return m_impl->secureStoreInstance->storeData(data_id, std::move(plain_data), durability);
+}
+
+size_t SecureStorageManager::recordOverhead(size_t plaintextSize) const {
+    if (!isInitialized()) {
+        return 0;
+    }
+    return m_impl->secureStoreInstance->recordOverhead(plaintextSize);
+}
+
+Error::Errc SecureStorageManager::storeData(const std::string& data_id, const unsigned char* data, size_t size) {
+    Error::Errc ready_err = checkReady("storeData");
+    if (ready_err != Error::Errc::Success) {
+        return ready_err;
+    }
+    if (Storage::WriteBackBuffer* write_back = m_impl->writeBack()) {
+        return write_back->storeData(data_id, data, size,
+                                                  m_impl->secureStoreInstance->getDefaultDurability());
+    }
+    return m_impl->secureStoreInstance->storeData(data_id, data, size);
+}
+
+Error::Errc SecureStorageManager::storeData(const std::string& data_id, const unsigned char* data, size_t size,
+                                            Storage::Durability durability) {
+    Error::Errc ready_err = checkReady("storeData");
+    if (ready_err != Error::Errc::Success) {
+        return ready_err;
+    }
+    if (Storage::WriteBackBuffer* write_back = m_impl->writeBack()) {
+        return write_back->storeData(data_id, data, size, durability);
+    }
+    return m_impl->secureStoreInstance->storeData(data_id, data, size, durability);
+}
+
+Error::Errc SecureStorageManager::setDefaultDurability(Storage::Durability durability) {
+    Error::Errc ready_err = checkReady("setDefaultDurability");
+    if (ready_err != Error::Errc::Success) {
+        return ready_err;
+    }
+    m_impl->secureStoreInstance->setDefaultDurability(durability);
+    return Error::Errc::Success;
+}
+
+Error::Errc SecureStorageManager::setCipherAlgorithm(Crypto::CipherAlgorithm algorithm) {
+    Error::Errc ready_err = checkReady("setCipherAlgorithm");
+    if (ready_err != Error::Errc::Success) {
+        return ready_err;
+    }
+    m_impl->secureStoreInstance->setCipherAlgorithm(algorithm);
+    return Error::Errc::Success;
+}
+
+Crypto::CipherAlgorithm SecureStorageManager::getCipherAlgorithm() const {
     if (!isInitialized()) {
-        SS_LOG_ERROR("SecureStorageManager::retrieveData called but manager is not initialized.");
+        return Crypto::CipherAlgorithm::Aes256Gcm;
+    }
+    return m_impl->secureStoreInstance->getCipherAlgorithm();
+}
+
+Error::Errc SecureStorageManager::retrieveData(const std::string& data_id, std::vector<unsigned char>& out_plain_data) {
+    Error::Errc ready_err = checkReady("retrieveData");
+    if (ready_err != Error::Errc::Success) {
         out_plain_data.clear();
-        return Error::Errc::NotInitialized;
+        return ready_err;
+    }
+    if (Storage::WriteBackBuffer* write_back = m_impl->writeBack()) {
+        return write_back->retrieveData(data_id, out_plain_data);
     }
     return m_impl->secureStoreInstance->retrieveData(data_id, out_plain_data);
 }
 
+Error::Errc SecureStorageManager::retrieveData(const std::string& data_id, unsigned char* buffer, size_t capacity,
+                                               size_t& out_size) {
+    Error::Errc ready_err = checkReady("retrieveData");
+    if (ready_err != Error::Errc::Success) {
+        out_size = 0;
+        return ready_err;
+    }
+    if (Storage::WriteBackBuffer* write_back = m_impl->writeBack()) {
+        return write_back->retrieveData(data_id, buffer, capacity, out_size);
+    }
+    return m_impl->secureStoreInstance->retrieveData(data_id, buffer, capacity, out_size);
+}
+
+Error::Errc SecureStorageManager::retrieveData(const std::string& data_id, Utils::SecureBytes& out_plain_data) {
+    // Through the caller-buffer overload, so the write-back buffer is honored as well.
+    out_plain_data.resize(out_plain_data.capacity());
+    size_t size = 0;
+    Error::Errc err = retrieveData(data_id, out_plain_data.data(), out_plain_data.size(), size);
+    while (err == Error::Errc::BufferTooSmall) {
+        out_plain_data.resize(size);
+        err = retrieveData(data_id, out_plain_data.data(), out_plain_data.size(), size);
+    }
+    if (err != Error::Errc::Success) {
+        Utils::secureWipe(out_plain_data);
+        return err;
+    }
+    out_plain_data.resize(size);
+    return err;
+}
+
+Error::Errc SecureStorageManager::retrieveMany(const std::vector<std::string>& data_ids,
+                                               std::vector<Storage::RetrieveResult>& results) {
+    Error::Errc ready_err = checkReady("retrieveMany");
+    if (ready_err != Error::Errc::Success) {
+        results.clear();
+        return ready_err;
+    }
+    if (Storage::WriteBackBuffer* write_back = m_impl->writeBack()) {
+        return write_back->retrieveMany(data_ids, results);
+    }
+    return m_impl->secureStoreInstance->retrieveMany(data_ids, results);
+}
+
+Error::Errc SecureStorageManager::retrieveData(const std::string& data_id, uint32_t version,
+                                               std::vector<unsigned char>& out_plain_data) {
+    Error::Errc ready_err = checkReady("retrieveData");
+    if (ready_err != Error::Errc::Success) {
+        out_plain_data.clear();
+        return ready_err;
+    }
+    Error::Errc flush_err = m_impl->flushBufferedWrite(data_id);
+    if (flush_err != Error::Errc::Success) {
+        out_plain_data.clear();
+        return flush_err;
+    }
+    return m_impl->secureStoreInstance->retrieveData(data_id, version, out_plain_data);
+}
+
+Error::Errc SecureStorageManager::retrieveAsOf(const std::string& data_id, std::chrono::system_clock::time_point asOf,
+                                               std::vector<unsigned char>& out_plain_data) {
+    Error::Errc ready_err = checkReady("retrieveAsOf");
+    if (ready_err != Error::Errc::Success) {
+        out_plain_data.clear();
+        return ready_err;
+    }
+    Error::Errc flush_err = m_impl->flushBufferedWrite(data_id);
+    if (flush_err != Error::Errc::Success) {
+        out_plain_data.clear();
+        return flush_err;
+    }
+    return m_impl->secureStoreInstance->retrieveAsOf(data_id, asOf, out_plain_data);
+}
+
+Error::Errc SecureStorageManager::listVersions(const std::string& data_id, std::vector<Storage::VersionInfo>& out_versions) {
+    Error::Errc ready_err = checkReady("listVersions");
+    if (ready_err != Error::Errc::Success) {
+        out_versions.clear();
+        return ready_err;
+    }
+    Error::Errc flush_err = m_impl->flushBufferedWrite(data_id);
+    if (flush_err != Error::Errc::Success) {
+        out_versions.clear();
+        return flush_err;
+    }
+    return m_impl->secureStoreInstance->listVersions(data_id, out_versions);
+}
+
+Storage::Transaction SecureStorageManager::beginTransaction() {
+    Error::Errc ready_err = checkReady("beginTransaction");
+    if (ready_err != Error::Errc::Success) {
+        return Storage::Transaction([ready_err](std::vector<Storage::TransactionOp>&) { return ready_err; });
+    }
+    return m_impl->secureStoreInstance->beginTransaction([this]() {
+        Storage::WriteBackBuffer* write_back = m_impl->writeBack();
+        if (!write_back) {
+            return Error::Errc::Success;
+        }
+        // Buffered writes of the same ids are older; they must not land after the transaction.
+        return write_back->flush();
+    });
+}
+
 Error::Errc SecureStorageManager::deleteData(const std::string& data_id) {
-    if (!isInitialized()) {
-        SS_LOG_ERROR("SecureStorageManager::deleteData called but manager is not initialized.");
-        return Error::Errc::NotInitialized;
+    Error::Errc ready_err = checkReady("deleteData");
+    if (ready_err != Error::Errc::Success) {
+        return ready_err;
+    }
+    if (Storage::WriteBackBuffer* write_back = m_impl->writeBack()) {
+        return write_back->deleteData(data_id);
     }
     return m_impl->secureStoreInstance->deleteData(data_id);
 }
 
 bool SecureStorageManager::dataExists(const std::string& data_id) const {
-    if (!isInitialized()) {
-        // SS_LOG_DEBUG("SecureStorageManager::dataExists called but manager is not initialized."); // Can be noisy
+    if (checkReady("dataExists") != Error::Errc::Success) {
         return false;
     }
+    if (Storage::WriteBackBuffer* write_back = m_impl->writeBack()) {
+        return write_back->dataExists(data_id);
+    }
     return m_impl->secureStoreInstance->dataExists(data_id);
 }
 
 Error::Errc SecureStorageManager::listDataIds(std::vector<std::string>& out_data_ids) const {
-    if (!isInitialized()) {
-        SS_LOG_ERROR("SecureStorageManager::listDataIds called but manager is not initialized.");
+    Error::Errc ready_err = checkReady("listDataIds");
+    if (ready_err != Error::Errc::Success) {
         out_data_ids.clear();
-        return Error::Errc::NotInitialized;
+        return ready_err;
+    }
+    if (Storage::WriteBackBuffer* write_back = m_impl->writeBack()) {
+        return write_back->listDataIds(out_data_ids);
     }
     return m_impl->secureStoreInstance->listDataIds(out_data_ids);
 }
 
-} // namespace SecureStorage
\ No newline at end of file
+Error::Errc SecureStorageManager::enableSharedReadCache() {
+    Error::Errc ready_err = checkReady("enableSharedReadCache");
+    if (ready_err != Error::Errc::Success) {
+        return ready_err;
+    }
+    return m_impl->secureStoreInstance->enableSharedReadCache();
+}
+
+Error::Errc SecureStorageManager::enableWriteBack(const Storage::WriteBackOptions& options) {
+    Error::Errc ready_err = checkReady("enableWriteBack");
+    if (ready_err != Error::Errc::Success) {
+        return ready_err;
+    }
+    std::lock_guard<std::mutex> lock(m_impl->writeBackMutex);
+    if (m_impl->writeBack()) {
+        SS_LOG_WARN("SecureStorageManager::enableWriteBack: Write-back mode is already enabled.");
+        return Error::Errc::OperationFailed;
+    }
+    m_impl->writeBackOwner = std::unique_ptr<Storage::WriteBackBuffer>(
+        new Storage::WriteBackBuffer(*m_impl->secureStoreInstance, options)
+    );
+    m_impl->writeBackBuffer.store(m_impl->writeBackOwner.get(), std::memory_order_release);
+    return Error::Errc::Success;
+}
+
+Error::Errc SecureStorageManager::flush() {
+    Error::Errc ready_err = checkReady("flush");
+    if (ready_err != Error::Errc::Success) {
+        return ready_err;
+    }
+    if (Storage::WriteBackBuffer* write_back = m_impl->writeBack()) {
+        Error::Errc err = write_back->flush();
+        if (err != Error::Errc::Success) {
+            return err;
+        }
+    }
+    // Repairs that stay queued are retried in the background, and the hot set is only a
+    // prefetch hint, so neither fails the flush.
+    Error::Errc txn_err = m_impl->secureStoreInstance->applyTransactions();
+    if (txn_err != Error::Errc::Success) {
+        return txn_err;
+    }
+    m_impl->secureStoreInstance->runPendingRepairs();
+    m_impl->secureStoreInstance->saveHotSet();
+    return m_impl->secureStoreInstance->syncDeferred();
+}
+
+Storage::WriteBackStats SecureStorageManager::getWriteBackStats() const {
+    Storage::WriteBackBuffer* write_back = isInitialized() ? m_impl->writeBack() : nullptr;
+    if (!write_back) {
+        return Storage::WriteBackStats();
+    }
+    return write_back->getStats();
+}
+
+Error::Errc SecureStorageManager::enablePlaintextCache(size_t maxBytes) {
+    Error::Errc ready_err = checkReady("enablePlaintextCache");
+    if (ready_err != Error::Errc::Success) {
+        return ready_err;
+    }
+    return m_impl->secureStoreInstance->enablePlaintextCache(maxBytes);
+}
+
+Error::Errc SecureStorageManager::prefetch(const std::vector<std::string>& data_ids) {
+    Storage::PrefetchReport report;
+    return prefetch(data_ids, report);
+}
+
+Error::Errc SecureStorageManager::prefetch(const std::vector<std::string>& data_ids, Storage::PrefetchReport& report) {
+    Error::Errc ready_err = checkReady("prefetch");
+    if (ready_err != Error::Errc::Success) {
+        report = Storage::PrefetchReport();
+        return ready_err;
+    }
+    // Prefetch only reads; it bypasses the write-back buffer, whose commits invalidate
+    // cache entries (and the cache rejects entries whose file has changed anyway).
+    return m_impl->secureStoreInstance->prefetch(data_ids, report);
+}
+
+Error::Errc SecureStorageManager::prefetchHotSet(Storage::PrefetchReport& report) {
+    Error::Errc ready_err = checkReady("prefetchHotSet");
+    if (ready_err != Error::Errc::Success) {
+        report = Storage::PrefetchReport();
+        return ready_err;
+    }
+    return m_impl->secureStoreInstance->prefetch(m_impl->secureStoreInstance->getHotSet(), report);
+}
+
+Storage::PlaintextCacheStats SecureStorageManager::getPlaintextCacheStats() const {
+    if (!isInitialized()) {
+        return Storage::PlaintextCacheStats();
+    }
+    return m_impl->secureStoreInstance->getPlaintextCacheStats();
+}
+
+Error::Errc SecureStorageManager::enableScrubber(const Storage::ScrubOptions& options) {
+    Error::Errc ready_err = checkReady("enableScrubber");
+    if (ready_err != Error::Errc::Success) {
+        return ready_err;
+    }
+    return m_impl->secureStoreInstance->startScrubber(options);
+}
+
+Storage::ScrubStats SecureStorageManager::getScrubStats() const {
+    if (!isInitialized()) {
+        return Storage::ScrubStats();
+    }
+    return m_impl->secureStoreInstance->getScrubStats();
+}
+
+Storage::RepairStats SecureStorageManager::getRepairStats() const {
+    if (!isInitialized()) {
+        return Storage::RepairStats();
+    }
+    return m_impl->secureStoreInstance->getRepairStats();
+}
+
+Storage::NegativeLookupStats SecureStorageManager::getNegativeLookupStats() const {
+    if (!isInitialized()) {
+        return Storage::NegativeLookupStats();
+    }
+    return m_impl->secureStoreInstance->getNegativeLookupStats();
+}
+
+Storage::TransactionStats SecureStorageManager::getTransactionStats() const {
+    if (!isInitialized()) {
+        return Storage::TransactionStats();
+    }
+    return m_impl->secureStoreInstance->getTransactionStats();
+}
+
+} // namespace SecureStorage
@@ -2,10 +2,24 @@
 #define SECURE_STORAGE_H
 
 #include "utils/Error.h" // For SecureStorage::Error::Errc
+#include "utils/SecureArena.h" // For Utils::SecureBytes
+#include "crypto/KeyProvider.h" // For Crypto::KeyCacheOptions
 #include "file_watcher/FileWatcher.h" // For FileWatcher::EventCallback
+#include "storage/WriteBackBuffer.h" // For Storage::WriteBackOptions, Storage::WriteBackStats
+#include "storage/PlaintextCache.h" // For Storage::PlaintextCacheStats, Storage::PrefetchReport
+#include "storage/Scrubber.h" // For Storage::ScrubOptions, Storage::ScrubStats
+#include "storage/RepairQueue.h" // For Storage::RepairStats
+#include "storage/NegativeLookupFilter.h" // For Storage::NegativeLookupStats
+#include "storage/RecordHistory.h" // For Storage::VersionInfo
+#include "storage/RetrieveResult.h" // For Storage::RetrieveResult
+#include "storage/SegmentedRecord.h" // For Storage::SegmentOptions
+#include "storage/Transaction.h" // For Storage::Transaction
+#include "storage/TransactionLog.h" // For Storage::TransactionStats
 #include <string>
 #include <vector>
 #include <memory> // For std::unique_ptr
+#include <chrono>
+#include <future> // For std::shared_future
 
 /**
  * @mainpage SecureStorage Library Documentation
@@ -21,12 +35,14 @@
  * encryption and supports resilience against power key cycles.
  *
  * @section features_sec Key Features
- * - **Strong Encryption:** Utilizes AES-256-GCM for authenticated encryption, providing both confidentiality and data integrity.
+ * - **Strong Encryption:** Utilizes AES-256-GCM or ChaCha20-Poly1305, whichever is faster on the device, for authenticated encryption, providing both confidentiality and data integrity.
  * - **Device-Specific Keys:** Derives unique encryption keys for each device using its serial number via HKDF (HMAC-based Key Derivation Function). Keys are not stored directly.
  * - **Secure Data Storage:** Manages encrypted data items within a specified root storage path.
  * - **Atomic Operations:** Employs atomic file write strategies (write-to-temp then rename) to prevent data corruption during power loss or unexpected shutdowns.
  * - **Backup Strategy:** Maintains backup copies of encrypted data files for enhanced data resilience.
+ * - **Durability Levels:** Each write can trade power-loss safety for latency, from page cache only to fsync of file and directory.
  * - **File Watcher:** Continuously monitors encrypted files for unintended modifications and logs these operations.
+ * - **Asynchronous Start-up:** Initialization can run in the background so boot-critical callers are not blocked.
  * - **Cross-Platform Design:** Built with C++11 for cross-compilability on target Linux-based systems.
  * - **Error Handling:** Provides clear error reporting via `SecureStorage::Error::Errc` and `std::error_code`.
  * - **Low Footprint:** Designed to be mindful of memory and CPU usage.
@@ -101,6 +117,64 @@ namespace Storage {
 // Forward declare FileWatcher if it were to be part of SecureStorageManager
 // namespace Watcher { class FileWatcher; }
 
+/**
+ * @enum InitMode
+ * @brief Where SecureStorageManager runs its initialization.
+ */
+enum class InitMode {
+    Synchronous,  ///< In the constructor (the default)
+    Asynchronous  ///< On a background thread; the constructor returns immediately
+};
+
+/**
+ * @enum NotReadyPolicy
+ * @brief What operations do while asynchronous initialization is still running.
+ */
+enum class NotReadyPolicy {
+    Wait,     ///< Block until initialization finishes, then proceed or fail with NotInitialized
+    FailFast  ///< Return Error::Errc::NotReady immediately
+};
+
+/**
+ * @struct InitOptions
+ * @brief Initialization settings of SecureStorageManager.
+ */
+struct InitOptions {
+    InitMode mode = InitMode::Synchronous;
+    NotReadyPolicy whileInitializing = NotReadyPolicy::Wait;
+    /// Budget of the plaintext cache in bytes; 0 leaves the cache disabled.
+    size_t plaintextCacheBytes = 0;
+    /// Once ready, prefetch the ids the previous run read most (needs plaintextCacheBytes).
+    /// Runs on the initialization thread, so operations are not held up by it.
+    bool prefetchHotSet = false;
+    /// Answer lookups of ids that were never stored from memory (see
+    /// Storage::NegativeLookupFilter). Only for roots this manager is the sole writer of.
+    bool negativeLookupFilter = false;
+    /// Old versions kept per id by every write (see Storage::SecureStore::setHistoryDepth());
+    /// 0 keeps none.
+    unsigned historyDepth = 0;
+    /// Which records are split into segments encrypted on several threads (see
+    /// Storage::SecureStore::setSegmentOptions()).
+    Storage::SegmentOptions largeRecords;
+    /// Kernel keyring that caches the master key across processes (see
+    /// Crypto::KeyProvider::setKeyCache()); KeyCacheKeyring::None derives it every start.
+    Crypto::KeyCacheOptions keyCache;
+};
+
+/**
+ * @struct InitTimings
+ * @brief How long each phase of SecureStorageManager initialization took.
+ * Phases that did not run (because an earlier one failed) are zero.
+ */
+struct InitTimings {
+    std::chrono::microseconds directorySetup = std::chrono::microseconds(0); ///< Creating and opening the storage root
+    std::chrono::microseconds recovery = std::chrono::microseconds(0);       ///< Startup recovery of the root
+    std::chrono::microseconds cryptoSetup = std::chrono::microseconds(0);    ///< KeyProvider and Encryptor (DRBG seeding)
+    std::chrono::microseconds keyDerivation = std::chrono::microseconds(0);  ///< HKDF of the master key
+    std::chrono::microseconds fileWatcher = std::chrono::microseconds(0);    ///< Starting the watcher thread and adding the watch
+    std::chrono::microseconds total = std::chrono::microseconds(0);          ///< From the constructor call to ready
+};
+
 /**
  * @class SecureStorageManager
  * @brief Main public interface for the SecureStorage library.
@@ -131,6 +205,26 @@ public:
         const std::string& keyFilePath,
         FileWatcher::EventCallback callback); // MODIFIED: Was 'int pollingIntervalMs'
 
+    /**
+     * @brief Constructs the SecureStorageManager with explicit initialization settings.
+     *
+     * With InitMode::Asynchronous the constructor only starts a background thread that
+     * creates the storage root, seeds the DRBG, derives the key and starts the file watcher.
+     * Until that finishes, isInitialized() returns false and operations either wait or
+     * return Error::Errc::NotReady, depending on `initOptions.whileInitializing`.
+     * getReadyFuture() signals completion.
+     *
+     * @param rootStoragePath The file system path where encrypted data will be stored.
+     * @param deviceSerialNumber A unique identifier for the device, used in key derivation.
+     * @param fileWatcherCallback An optional callback for file watcher events.
+     * @param initOptions Where to initialize and how operations behave until then.
+     */
+    SecureStorageManager(
+        const std::string& rootStoragePath,
+        const std::string& deviceSerialNumber,
+        FileWatcher::EventCallback fileWatcherCallback,
+        const InitOptions& initOptions);
+
     /**
      * @brief Destructor. Cleans up resources.
      */
@@ -150,10 +244,28 @@ public:
      * Initialization involves setting up the storage path and deriving necessary
      * cryptographic keys. Operations should only be attempted if this returns true.
      *
+     * Never blocks: while asynchronous initialization is running this returns false.
+     *
      * @return true if the manager is properly initialized and ready for use, false otherwise.
      */
     bool isInitialized() const;
 
+    /**
+     * @brief Returns a future that becomes ready when initialization has finished.
+     *
+     * Its value is Error::Errc::Success if the manager is usable, or the error that made
+     * initialization fail. In synchronous mode it is ready when the constructor returns.
+     *
+     * @return The readiness future; invalid for a moved-from manager.
+     */
+    std::shared_future<Error::Errc> getReadyFuture() const;
+
+    /**
+     * @brief Returns how long each initialization phase took.
+     * @return The timings; all zero until initialization has finished.
+     */
+    InitTimings getInitTimings() const;
+
     /**
      * @brief Securely stores a piece of data.
      *
@@ -166,11 +278,112 @@ public:
      * @param plain_data A vector of bytes representing the data to be stored.
      * @return Error::Errc::Success on successful storage.
      * @return Error::Errc::NotInitialized if the manager is not initialized.
+     * @return Error::Errc::NotReady if asynchronous initialization is still running and the
+     * manager was configured with NotReadyPolicy::FailFast (applies to all operations).
      * @return Error::Errc::InvalidArgument if `data_id` is invalid.
      * @return Other error codes for encryption or file system failures.
      */
     Error::Errc storeData(const std::string& data_id, const std::vector<unsigned char>& plain_data);
 
+    /**
+     * @brief Securely stores a piece of data with an explicit durability level.
+     *
+     * Cache-like data that can be rebuilt can skip flushes (Storage::Durability::None or
+     * Deferred); critical data can insist on Storage::Durability::Full. In write-back mode
+     * the level applies when the write is committed.
+     *
+     * @param data_id A unique string identifier for the data item.
+     * @param plain_data A vector of bytes representing the data to be stored.
+     * @param durability What the write must survive once it reaches the store.
+     * @return The same codes as storeData(const std::string&, const std::vector<unsigned char>&).
+     */
+    Error::Errc storeData(const std::string& data_id, const std::vector<unsigned char>& plain_data,
+                          Storage::Durability durability);
+
+    /**
+     * @brief Securely stores data, encrypting it inside the buffer that is moved in.
+     *
+     * Peak memory stays near the record's size instead of twice that, and with
+     * recordOverhead() bytes of spare capacity the write allocates nothing for the record.
+     * On return plain_data is zeroed and empty but keeps its capacity for reuse. In
+     * write-back mode the buffer is kept as the pending write instead of being copied.
+     *
+     * @param data_id A unique string identifier for the data item.
+     * @param plain_data The bytes to store; used as the encryption buffer.
+     * @return The same codes as storeData(const std::string&, const std::vector<unsigned char>&).
+     */
+    Error::Errc storeData(const std::string& data_id, std::vector<unsigned char>&& plain_data);
+
+    /**
+     * @brief Securely stores data in the buffer that is moved in, with an explicit durability level.
+     *
+     * @param data_id A unique string identifier for the data item.
+     * @param plain_data The bytes to store; used as the encryption buffer.
+     * @param durability What the write must survive once it reaches the store.
+     * @return The same codes as storeData(const std::string&, const std::vector<unsigned char>&).
+     */
+    Error::Errc storeData(const std::string& data_id, std::vector<unsigned char>&& plain_data,
+                          Storage::Durability durability);
+
+    /**
+     * @brief Returns the spare capacity a buffer needs for storeData(const std::string&,
+     * std::vector<unsigned char>&&) to encrypt a plaintext without allocating.
+     * @param plaintextSize Number of plaintext bytes.
+     * @return The record overhead in bytes; 0 if the manager is not initialized.
+     */
+    size_t recordOverhead(size_t plaintextSize) const;
+
+    /**
+     * @brief Securely stores data held in caller memory.
+     *
+     * For data that lives in a std::string, an arena or a mapped file: it is encrypted
+     * from where it is, without a copy into a vector first.
+     *
+     * @param data_id A unique string identifier for the data item.
+     * @param data Pointer to the bytes to store (may be null if size is 0).
+     * @param size Number of bytes at data.
+     * @return The same codes as storeData(const std::string&, const std::vector<unsigned char>&).
+     */
+    Error::Errc storeData(const std::string& data_id, const unsigned char* data, size_t size);
+
+    /**
+     * @brief Securely stores data held in caller memory with an explicit durability level.
+     *
+     * @param data_id A unique string identifier for the data item.
+     * @param data Pointer to the bytes to store (may be null if size is 0).
+     * @param size Number of bytes at data.
+     * @param durability What the write must survive once it reaches the store.
+     * @return The same codes as storeData(const std::string&, const std::vector<unsigned char>&).
+     */
+    Error::Errc storeData(const std::string& data_id, const unsigned char* data, size_t size,
+                          Storage::Durability durability);
+
+    /**
+     * @brief Sets the durability of storeData() calls that do not pass one.
+     *
+     * Must be called before the manager is shared between threads.
+     *
+     * @param durability The new default; Storage::Durability::Full initially.
+     * @return Error::Errc::Success, or Error::Errc::NotInitialized if the manager is not initialized.
+     */
+    Error::Errc setDefaultDurability(Storage::Durability durability);
+
+    /**
+     * @brief Sets the cipher of the records written from now on, overriding the one the
+     * startup self-benchmark chose. Records are read with the cipher they were written
+     * with, whichever that is.
+     *
+     * @param algorithm The cipher.
+     * @return Error::Errc::Success, or Error::Errc::NotInitialized if the manager is not initialized.
+     */
+    Error::Errc setCipherAlgorithm(Crypto::CipherAlgorithm algorithm);
+
+    /**
+     * @brief Returns the cipher of the records written from now on.
+     * @return The cipher; AES-256-GCM if the manager is not initialized.
+     */
+    Crypto::CipherAlgorithm getCipherAlgorithm() const;
+
     /**
      * @brief Retrieves securely stored data.
      *
@@ -190,6 +403,112 @@ public:
      */
     Error::Errc retrieveData(const std::string& data_id, std::vector<unsigned char>& out_plain_data);
 
+    /**
+     * @brief Retrieves securely stored data into caller memory.
+     *
+     * The data is decrypted straight into buffer. If it does not fit, nothing is decrypted
+     * and Error::Errc::BufferTooSmall is returned with out_size set to the size needed, so
+     * a null buffer with a capacity of 0 queries the size.
+     *
+     * @param data_id The unique identifier of the data to retrieve.
+     * @param[out] buffer Receives the decrypted data; may be null if capacity is 0.
+     * @param capacity Number of bytes available at buffer.
+     * @param[out] out_size The size of the data on success and on BufferTooSmall, else 0.
+     * @return Error::Errc::Success on successful retrieval and decryption.
+     * @return Error::Errc::BufferTooSmall if the data is larger than capacity.
+     * @return Otherwise the same codes as retrieveData(const std::string&, std::vector<unsigned char>&).
+     */
+    Error::Errc retrieveData(const std::string& data_id, unsigned char* buffer, size_t capacity, size_t& out_size);
+
+    /**
+     * @brief Retrieves securely stored data into locked, zeroize-on-free memory.
+     *
+     * The data is decrypted straight into out_plain_data, which lives in the secure arena
+     * (see Utils::SecureArena), so it is not swapped out and is wiped when the buffer is freed.
+     *
+     * @param data_id The unique identifier of the data to retrieve.
+     * @param[out] out_plain_data Receives the decrypted data; emptied on failure.
+     * @return The same codes as retrieveData(const std::string&, std::vector<unsigned char>&).
+     */
+    Error::Errc retrieveData(const std::string& data_id, Utils::SecureBytes& out_plain_data);
+
+    /**
+     * @brief Retrieves several items of securely stored data in one call.
+     *
+     * Much faster than calling retrieveData() in a loop for more than a few ids: the
+     * files are read in on-disk order with the reads issued together, and decrypted on
+     * all cores (see Storage::SecureStore::retrieveMany()).
+     *
+     * @param data_ids The unique identifiers of the data to retrieve.
+     * @param[out] results One result per entry of data_ids, in the same order; each holds
+     * the Error::Errc retrieveData() would have returned for that id, and the data on success.
+     * @return Error::Errc::Success if the ids were looked up (check each result).
+     * @return Error::Errc::NotInitialized if the manager is not initialized.
+     */
+    Error::Errc retrieveMany(const std::vector<std::string>& data_ids, std::vector<Storage::RetrieveResult>& results);
+
+    /**
+     * @brief Retrieves an earlier version of securely stored data.
+     *
+     * Versions are kept when InitOptions::historyDepth is set; listVersions() tells which
+     * exist. With write-back enabled, a buffered write of the id is committed first, so
+     * it is the current version here as well.
+     *
+     * @param data_id The unique identifier of the data.
+     * @param version The version number, as listed by listVersions().
+     * @param[out] out_plain_data Receives the data of that version.
+     * @return Error::Errc::Success on success.
+     * @return Error::Errc::NotInitialized if the manager is not initialized.
+     * @return Error::Errc::DataNotFound if the id or that version does not exist.
+     * @return Other error codes for decryption or file system failures.
+     */
+    Error::Errc retrieveData(const std::string& data_id, uint32_t version, std::vector<unsigned char>& out_plain_data);
+
+    /**
+     * @brief Retrieves the version of securely stored data that was current at a point in time.
+     * @param data_id The unique identifier of the data.
+     * @param asOf The point in time.
+     * @param[out] out_plain_data Receives the data.
+     * @return As retrieveData(const std::string&, uint32_t, std::vector<unsigned char>&).
+     */
+    Error::Errc retrieveAsOf(const std::string& data_id, std::chrono::system_clock::time_point asOf,
+                             std::vector<unsigned char>& out_plain_data);
+
+    /**
+     * @brief Lists the versions of securely stored data that can be read back.
+     * @param data_id The unique identifier of the data.
+     * @param[out] out_versions Receives the versions, the current one first.
+     * @return Error::Errc::Success on success, Error::Errc::DataNotFound if the id does not
+     * exist, or another error code.
+     */
+    Error::Errc listVersions(const std::string& data_id, std::vector<Storage::VersionInfo>& out_versions);
+
+    /**
+     * @brief Starts a transaction: puts and deletes of several ids that take effect together.
+     *
+     * Storage::Transaction::commit() writes all changes as one encrypted write-ahead log
+     * record with a single flush; the data files are updated afterwards in the background,
+     * and after a crash when the manager is next initialized. Reads through this manager
+     * return either none or all of a transaction's changes. That holds only for this
+     * manager: other processes (or other managers) on the same root see the ids change one
+     * by one while the data files are updated, and all-or-none only across a crash, when
+     * the log is redone. Ids that other processes must read consistently belong in one
+     * record. With write-back enabled, the
+     * commit first flushes the buffered writes, so it is ordered after them.
+     *
+     * @code
+     * Storage::Transaction txn = manager.beginTransaction();
+     * txn.put("net_config", net);
+     * txn.put("net_secret", secret);
+     * txn.remove("net_legacy");
+     * Error::Errc err = txn.commit();
+     * @endcode
+     *
+     * @return The empty transaction; it must not outlive the manager. If the manager is
+     * not ready, its commit() returns the error the other operations would.
+     */
+    Storage::Transaction beginTransaction();
+
     /**
      * @brief Deletes securely stored data.
      *
@@ -234,12 +553,160 @@ public:
      */
     bool isFileWatcherActive() const;
 
+    /**
+     * @brief Enables the cross-process shared read cache for this storage root.
+     *
+     * Processes that open the same root share one memory segment of encrypted records,
+     * so hot ids are served without file I/O. Entries are still authenticated on every
+     * read. See Storage::SecureStore::enableSharedReadCache().
+     *
+     * @return Error::Errc::Success if the cache is enabled.
+     * @return Error::Errc::NotInitialized if the manager is not initialized.
+     * @return Error::Errc::OperationFailed if the shared segment could not be created or mapped.
+     */
+    Error::Errc enableSharedReadCache();
+
+    /**
+     * @brief Switches the manager to write-back mode.
+     *
+     * storeData() and deleteData() then return as soon as the write is buffered in memory,
+     * and a background thread commits the latest value of each dirty id in groups. A write
+     * reaches disk at most `options.maxDirtyAge` after it was made (earlier when the id or
+     * byte limits are hit), which bounds what a crash can lose per id. Reads, existence
+     * checks and listings see buffered writes immediately; reads of versions commit the
+     * id's buffered write first. See Storage::WriteBackBuffer.
+     *
+     * May be called while other threads use the manager; their calls switch to the buffer
+     * once it is published.
+     *
+     * @param options Durability window and size limits of the buffer.
+     * @return Error::Errc::Success if write-back mode is enabled.
+     * @return Error::Errc::NotInitialized if the manager is not initialized.
+     * @return Error::Errc::OperationFailed if write-back mode is already enabled.
+     */
+    Error::Errc enableWriteBack(const Storage::WriteBackOptions& options = Storage::WriteBackOptions());
+
+    /**
+     * @brief Commits all buffered writes to disk before returning.
+     * Also applies committed transactions to the data files, flushes writes stored with
+     * Storage::Durability::Deferred, attempts queued backup
+     * restores, and saves the hot set.
+     * @return Error::Errc::Success if nothing is left buffered or unflushed.
+     * @return Error::Errc::NotInitialized if the manager is not initialized.
+     * @return The first commit error otherwise; failed ids stay buffered and are retried.
+     */
+    Error::Errc flush();
+
+    /**
+     * @brief Returns write-back activity counters.
+     * @return The counters; all zero outside write-back mode.
+     */
+    Storage::WriteBackStats getWriteBackStats() const;
+
+    /**
+     * @brief Enables the in-process cache of decrypted records.
+     *
+     * Reads of cached ids cost one stat of the record file, which detects changes made by
+     * other processes. See Storage::SecureStore::enablePlaintextCache(). Must be called
+     * before the manager is shared between threads; InitOptions::plaintextCacheBytes
+     * enables it during initialization instead.
+     *
+     * @param maxBytes Budget for the cached plaintext.
+     * @return Error::Errc::Success if the cache is enabled.
+     * @return Error::Errc::NotInitialized if the manager is not initialized.
+     */
+    Error::Errc enablePlaintextCache(size_t maxBytes = Storage::PLAINTEXT_CACHE_DEFAULT_MAX_BYTES);
+
+    /**
+     * @brief Reads and decrypts the given ids in parallel into the plaintext cache, so
+     * that later retrieveData() calls for them are memory hits.
+     * See Storage::SecureStore::prefetch().
+     *
+     * @param data_ids The ids to load.
+     * @return Error::Errc::Success if the prefetch ran; ids that could not be loaded are
+     * simply read from disk later.
+     * @return Error::Errc::NotInitialized if the manager is not initialized.
+     * @return Error::Errc::OperationFailed if the plaintext cache is not enabled.
+     */
+    Error::Errc prefetch(const std::vector<std::string>& data_ids);
+
+    /**
+     * @brief Like prefetch(const std::vector<std::string>&), and reports what was loaded.
+     * @param data_ids The ids to load.
+     * @param[out] report What was loaded, skipped and failed.
+     * @return As prefetch(const std::vector<std::string>&).
+     */
+    Error::Errc prefetch(const std::vector<std::string>& data_ids, Storage::PrefetchReport& report);
+
+    /**
+     * @brief Prefetches the hot set: the ids read most often, learned across runs.
+     * The hot set is saved by flush() and when the manager is destroyed.
+     * @param[out] report What was loaded, skipped and failed.
+     * @return As prefetch(const std::vector<std::string>&).
+     */
+    Error::Errc prefetchHotSet(Storage::PrefetchReport& report);
+
+    /**
+     * @brief Returns the plaintext cache counters, including the prefetch hit rate.
+     * @return The counters; all zero if the cache is not enabled.
+     */
+    Storage::PlaintextCacheStats getPlaintextCacheStats() const;
+
+    /**
+     * @brief Starts the background integrity scrubber.
+     *
+     * A low-priority thread periodically authenticates the main and backup file of every
+     * record and rewrites a damaged copy from the intact one, so corruption is repaired
+     * before a read runs into it. Its reads are limited to `options.bytesPerSecond`.
+     * See Storage::Scrubber. Must be called before the manager is shared between threads.
+     *
+     * @param options Read budget, thread priority and schedule.
+     * @return Error::Errc::Success if the scrubber is running.
+     * @return Error::Errc::NotInitialized if the manager is not initialized.
+     * @return Error::Errc::OperationFailed if it is already running.
+     */
+    Error::Errc enableScrubber(const Storage::ScrubOptions& options = Storage::ScrubOptions());
+
+    /**
+     * @brief Returns the scrubber's progress, repairs and unrecoverable ids.
+     * @return The counters; all zero if the scrubber is not running.
+     */
+    Storage::ScrubStats getScrubStats() const;
+
+    /**
+     * @brief Returns the counters of the background repair queue, which restores main
+     * files from their backups after reads had to fall back to the backup.
+     * @return The counters, including the number of pending repairs.
+     */
+    Storage::RepairStats getRepairStats() const;
+
+    /**
+     * @brief Returns the counters of the negative-lookup filter enabled by
+     * InitOptions::negativeLookupFilter, including its observed false-positive rate.
+     * @return The counters; all zero if the filter is not enabled.
+     */
+    Storage::NegativeLookupStats getNegativeLookupStats() const;
+
+    /**
+     * @brief Returns the transaction counters: committed, redone after a crash, applied,
+     * and still pending.
+     * @return The counters; all zero if the manager is not initialized.
+     */
+    Storage::TransactionStats getTransactionStats() const;
+
 private:
     // Using PImpl to hide SecureStore and other potential future members
     // like FileWatcher, and to keep this public header clean.
     class SecureStorageManagerImpl;
     std::unique_ptr<SecureStorageManagerImpl> m_impl;
 
+    /**
+     * @brief Gate of every operation: applies the NotReadyPolicy while initialization runs.
+     * @param operation Name of the calling method, for the log.
+     * @return Error::Errc::Success if the manager is usable, otherwise NotReady or NotInitialized.
+     */
+    Error::Errc checkReady(const char* operation) const;
+
     // Member variable declaration (around line 98)
     // This line should now compile correctly after adding the include for FileWatcher
     FileWatcher::EventCallback fileWatcherCallback = nullptr; // Optional callback for file watcher events
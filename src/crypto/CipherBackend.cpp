@@ -0,0 +1,129 @@
+#include "CipherBackend.h"
+#include "Logger.h"      // For SS_LOG_ macros
+#include "SecureWipe.h"  // For Utils::secureWipe
+#include "ScratchPool.h" // For Utils::ScratchBuffer
+#include <mbedtls/gcm.h>
+#include <mbedtls/chachapoly.h>
+#include <mbedtls/error.h>   // For mbedtls_strerror
+#include <cerrno>            // For errno
+
+#ifndef _WIN32
+#include <unistd.h>          // For pread
+#endif
+
+namespace SecureStorage {
+namespace Crypto {
+
+namespace {
+
+// One AEAD pass of the given cipher, with a context of its own so that calls may run
+// concurrently. Encrypting writes tag_out; decrypting checks tag_in.
+Error::Errc runAead(CipherAlgorithm algorithm, bool encrypt, const unsigned char* key,
+                    const unsigned char* iv, const unsigned char* aad, size_t aad_size,
+                    const unsigned char* input, size_t size, unsigned char* output,
+                    unsigned char* tag_out, const unsigned char* tag_in) {
+    const unsigned char* aad_ptr = aad_size == 0 ? nullptr : aad;
+    int ret = 0;
+    bool key_failed = false;
+    bool auth_failed = false;
+    const char* step = "setkey";
+    if (algorithm == CipherAlgorithm::ChaCha20Poly1305) {
+        mbedtls_chachapoly_context ctx;
+        mbedtls_chachapoly_init(&ctx);
+        ret = mbedtls_chachapoly_setkey(&ctx, key);
+        key_failed = ret != 0;
+        if (ret == 0) {
+            step = encrypt ? "encrypt_and_tag" : "auth_decrypt";
+            ret = encrypt ? mbedtls_chachapoly_encrypt_and_tag(&ctx, size, iv, aad_ptr, aad_size, input, output, tag_out)
+                          : mbedtls_chachapoly_auth_decrypt(&ctx, size, iv, aad_ptr, aad_size, tag_in, input, output);
+            auth_failed = ret == MBEDTLS_ERR_CHACHAPOLY_AUTH_FAILED;
+        }
+        mbedtls_chachapoly_free(&ctx); // Also wipes the key
+    } else {
+        mbedtls_gcm_context ctx;
+        mbedtls_gcm_init(&ctx);
+        ret = mbedtls_gcm_setkey(&ctx, MBEDTLS_CIPHER_ID_AES, key, AES_GCM_KEY_SIZE_BYTES * 8);
+        key_failed = ret != 0;
+        if (ret == 0) {
+            step = encrypt ? "crypt_and_tag" : "auth_decrypt";
+            ret = encrypt ? mbedtls_gcm_crypt_and_tag(&ctx, MBEDTLS_GCM_ENCRYPT, size, iv, AES_GCM_IV_SIZE_BYTES,
+                                                      aad_ptr, aad_size, input, output, AES_GCM_TAG_SIZE_BYTES, tag_out)
+                          : mbedtls_gcm_auth_decrypt(&ctx, size, iv, AES_GCM_IV_SIZE_BYTES, aad_ptr, aad_size,
+                                                     tag_in, AES_GCM_TAG_SIZE_BYTES, input, output);
+            auth_failed = ret == MBEDTLS_ERR_GCM_AUTH_FAILED;
+        }
+        mbedtls_gcm_free(&ctx); // Also wipes the expanded key
+    }
+
+    if (ret == 0) {
+        return Error::Errc::Success;
+    }
+    if (auth_failed) {
+        // Both ciphers zero the output themselves when the tag does not match.
+        SS_LOG_WARN(Encryptor::algorithmName(algorithm) << " authentication failed during decryption (tag mismatch or tampered data).");
+        return Error::Errc::AuthenticationFailed;
+    }
+    char error_buf[100];
+    mbedtls_strerror(ret, error_buf, sizeof(error_buf));
+    SS_LOG_ERROR(Encryptor::algorithmName(algorithm) << " " << step << " failed: " << error_buf);
+    if (key_failed) {
+        return Error::Errc::CryptoLibraryError;
+    }
+    return encrypt ? Error::Errc::EncryptionFailed : Error::Errc::DecryptionFailed;
+}
+
+class SoftwareCipherBackend : public CipherBackend {
+public:
+    CipherBackendKind kind() const override { return CipherBackendKind::Software; }
+
+    bool supports(CipherAlgorithm, size_t, size_t) const override { return true; }
+
+    Error::Errc seal(CipherAlgorithm algorithm, const unsigned char* key, const unsigned char* iv,
+                     const unsigned char* aad, size_t aadSize, const unsigned char* input, size_t size,
+                     unsigned char* output, unsigned char* tag) override {
+        return runAead(algorithm, true, key, iv, aad, aadSize, input, size, output, tag, nullptr);
+    }
+
+    Error::Errc open(CipherAlgorithm algorithm, const unsigned char* key, const unsigned char* iv,
+                     const unsigned char* aad, size_t aadSize, const unsigned char* input, size_t size,
+                     const unsigned char* tag, unsigned char* output) override {
+        return runAead(algorithm, false, key, iv, aad, aadSize, input, size, output, nullptr, tag);
+    }
+};
+
+} // namespace
+
+Error::Errc CipherBackend::openFile(CipherAlgorithm algorithm, const unsigned char* key, const unsigned char* iv,
+                                    const unsigned char* aad, size_t aadSize, int fd, int64_t offset, size_t size,
+                                    unsigned char* output) {
+#ifndef _WIN32
+    // Ciphertext is not secret, but the pooled buffer is wiped on release either way.
+    Utils::ScratchBuffer scratch;
+    std::vector<unsigned char>& input = scratch.get();
+    input.resize(size + AES_GCM_TAG_SIZE_BYTES);
+    size_t done = 0;
+    while (done < input.size()) {
+        ssize_t n = pread(fd, input.data() + done, input.size() - done, static_cast<off_t>(offset + done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            SS_LOG_ERROR("CipherBackend: Failed to read " << input.size() << " bytes of ciphertext at offset " << offset << ".");
+            return Error::Errc::FileReadFailed;
+        }
+        done += static_cast<size_t>(n);
+    }
+    return open(algorithm, key, iv, aad, aadSize, size == 0 ? nullptr : input.data(), size,
+                input.data() + size, output);
+#else
+    (void)algorithm; (void)key; (void)iv; (void)aad; (void)aadSize; (void)fd; (void)offset; (void)size; (void)output;
+    return Error::Errc::OperationFailed;
+#endif
+}
+
+std::unique_ptr<CipherBackend> makeSoftwareCipherBackend() {
+    return std::unique_ptr<CipherBackend>(new SoftwareCipherBackend());
+}
+
+} // namespace Crypto
+} // namespace SecureStorage
@@ -0,0 +1,99 @@
+#ifndef SS_CIPHER_BACKEND_H
+#define SS_CIPHER_BACKEND_H
+
+// Internal to ss_crypto: the engines behind Encryptor. Not installed.
+
+#include "Error.h"
+#include "Encryptor.h" // For CipherAlgorithm and the key/IV/tag sizes
+#include <memory>      // For std::unique_ptr
+#include <cstddef>     // For size_t
+#include <cstdint>     // For int64_t
+
+namespace SecureStorage {
+namespace Crypto {
+
+// Messages at least this large are fed to the kernel with vmsplice()/splice() instead of
+// being copied by sendmsg(); below it the extra pipe costs more than the copy.
+constexpr size_t KERNEL_CIPHER_SPLICE_THRESHOLD = 64 * 1024;
+
+/**
+ * @class CipherBackend
+ * @brief One AEAD engine: seals and opens a single message in one call.
+ *
+ * Every call stands alone (no state is kept between messages apart from what a backend
+ * caches for the key), so calls may run concurrently. Keys are AES_GCM_KEY_SIZE_BYTES long,
+ * IVs AES_GCM_IV_SIZE_BYTES and tags AES_GCM_TAG_SIZE_BYTES; Encryptor checks this.
+ *
+ * A backend that cannot run a call (e.g. the kernel refused a socket) returns an error
+ * other than AuthenticationFailed without having produced output; Encryptor then repeats
+ * the call in software.
+ */
+class CipherBackend {
+public:
+    virtual ~CipherBackend() = default;
+
+    /**
+     * @brief Identifies the backend.
+     * @return The backend's kind.
+     */
+    virtual CipherBackendKind kind() const = 0;
+
+    /**
+     * @brief Whether this backend can take a message.
+     * @param algorithm The cipher.
+     * @param aadSize Bytes of additional authenticated data.
+     * @param size Bytes of plaintext or ciphertext.
+     * @return true if seal() and open() accept it.
+     */
+    virtual bool supports(CipherAlgorithm algorithm, size_t aadSize, size_t size) const = 0;
+
+    /**
+     * @brief Encrypts size bytes and computes the tag. input and output may be equal.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    virtual Error::Errc seal(CipherAlgorithm algorithm, const unsigned char* key, const unsigned char* iv,
+                             const unsigned char* aad, size_t aadSize, const unsigned char* input, size_t size,
+                             unsigned char* output, unsigned char* tag) = 0;
+
+    /**
+     * @brief Decrypts size bytes and checks the tag; output is zeroed if it does not match.
+     * @return SecureStorage::Error::Errc::Success on success,
+     * Errc::AuthenticationFailed if the tag does not match, or another error code on failure.
+     */
+    virtual Error::Errc open(CipherAlgorithm algorithm, const unsigned char* key, const unsigned char* iv,
+                             const unsigned char* aad, size_t aadSize, const unsigned char* input, size_t size,
+                             const unsigned char* tag, unsigned char* output) = 0;
+
+    /**
+     * @brief open() with the ciphertext and the tag behind it read from a file.
+     *
+     * The default reads them into a scratch buffer; the kernel backend splices them from
+     * the file into the cipher, so they are never copied to user space.
+     *
+     * @param fd File to read; its file offset is not used or changed.
+     * @param offset Position of the ciphertext in the file.
+     * @param size Bytes of ciphertext; AES_GCM_TAG_SIZE_BYTES of tag follow them.
+     * @return As open(), or Errc::FileReadFailed if the file ends early.
+     */
+    virtual Error::Errc openFile(CipherAlgorithm algorithm, const unsigned char* key, const unsigned char* iv,
+                                 const unsigned char* aad, size_t aadSize, int fd, int64_t offset, size_t size,
+                                 unsigned char* output);
+};
+
+/**
+ * @brief Creates the mbedtls backend, which supports every CipherAlgorithm.
+ * @return The backend (never null).
+ */
+std::unique_ptr<CipherBackend> makeSoftwareCipherBackend();
+
+/**
+ * @brief Creates the Linux kernel crypto API (AF_ALG) backend for AES-256-GCM.
+ * @return The backend, or null if the kernel offers no gcm(aes) over AF_ALG (or on other
+ * systems).
+ */
+std::unique_ptr<CipherBackend> makeKernelCipherBackend();
+
+} // namespace Crypto
+} // namespace SecureStorage
+
+#endif // SS_CIPHER_BACKEND_H
@@ -1,10 +1,22 @@
 #include "Encryptor.h"
 #include "Logger.h"   // For SS_LOG_ macros (using SFS_LOG for now)
-#include <mbedtls/gcm.h>
+#include "SecureWipe.h" // For Utils::secureWipe
+#include "SecureArena.h" // For Utils::SecureArena
+#include "ScratchPool.h" // For Utils::ScratchBuffer
+#include "CipherBackend.h"
 #include <mbedtls/ctr_drbg.h>
 #include <mbedtls/entropy.h>
 #include <mbedtls/error.h>   // For mbedtls_strerror
 #include <cstring>           // For memcpy, memset
+#include <algorithm>         // For std::min
+#include <chrono>
+#include <atomic>
+#include <mutex>             // For std::call_once, std::mutex
+
+#ifndef _WIN32
+#include <unistd.h>          // For pread
+#include <cerrno>            // For errno
+#endif
 
 namespace SecureStorage {
 namespace Crypto {
@@ -12,13 +24,26 @@ namespace Crypto {
 // Definition of the PImpl class for Encryptor
 class Encryptor::Impl {
 public:
-    mbedtls_gcm_context gcm_ctx;
+    // The DRBG state determines every IV and is as sensitive as a key, so the contexts
+    // live in the secure arena: locked in RAM and zeroized when freed.
+    static void* operator new(size_t size) { return Utils::SecureArena::instance().allocate(size); }
+    static void operator delete(void* block, size_t size) { Utils::SecureArena::instance().deallocate(block, size); }
+
     mbedtls_ctr_drbg_context drbg_ctx;
     mbedtls_entropy_context entropy_ctx;
     bool initialized;
-
-    Impl(const std::string& personalizationData) : initialized(false) {
-        mbedtls_gcm_init(&gcm_ctx);
+    // mbedtls is built without MBEDTLS_THREADING_C; two threads drawing from drbg_ctx at
+    // once could be handed the same IV.
+    std::mutex drbgMutex;
+
+    // AEAD engines. The kernel one is probed on first use, since that costs a few system calls.
+    std::unique_ptr<CipherBackend> software;
+    std::unique_ptr<CipherBackend> kernel;
+    std::once_flag kernelProbed;
+    std::atomic<CipherBackendKind> active;
+
+    Impl(const std::string& personalizationData)
+        : initialized(false), software(makeSoftwareCipherBackend()), active(CipherBackendKind::Software) {
         mbedtls_ctr_drbg_init(&drbg_ctx);
         mbedtls_entropy_init(&entropy_ctx);
 
@@ -42,11 +67,52 @@ public:
     }
 
     ~Impl() {
-        mbedtls_gcm_free(&gcm_ctx);
         mbedtls_ctr_drbg_free(&drbg_ctx);
         mbedtls_entropy_free(&entropy_ctx);
         SS_LOG_DEBUG("Encryptor Impl cleaned up Mbed TLS contexts.");
     }
+
+    CipherBackend* kernelBackend() {
+        std::call_once(kernelProbed, [this]() { kernel = makeKernelCipherBackend(); });
+        return kernel.get();
+    }
+
+    // The backend for one message: the active one if it takes the message, else software.
+    CipherBackend& backendFor(CipherAlgorithm algorithm, size_t aadSize, size_t size) {
+        if (active.load(std::memory_order_relaxed) == CipherBackendKind::Kernel &&
+            kernel->supports(algorithm, aadSize, size)) {
+            return *kernel;
+        }
+        return *software;
+    }
+
+    // Only a verdict on the data itself is final; any other failure of the kernel is
+    // retried in software, which produces the same bytes.
+    static bool isFinal(Error::Errc err) {
+        return err == Error::Errc::Success || err == Error::Errc::AuthenticationFailed;
+    }
+
+    Error::Errc seal(CipherAlgorithm algorithm, const unsigned char* key, const unsigned char* iv,
+                     const unsigned char* aad, size_t aadSize, const unsigned char* input, size_t size,
+                     unsigned char* output, unsigned char* tag) {
+        CipherBackend& backend = backendFor(algorithm, aadSize, size);
+        Error::Errc err = backend.seal(algorithm, key, iv, aad, aadSize, input, size, output, tag);
+        if (!isFinal(err) && &backend != software.get()) {
+            err = software->seal(algorithm, key, iv, aad, aadSize, input, size, output, tag);
+        }
+        return err;
+    }
+
+    Error::Errc open(CipherAlgorithm algorithm, const unsigned char* key, const unsigned char* iv,
+                     const unsigned char* aad, size_t aadSize, const unsigned char* input, size_t size,
+                     const unsigned char* tag, unsigned char* output) {
+        CipherBackend& backend = backendFor(algorithm, aadSize, size);
+        Error::Errc err = backend.open(algorithm, key, iv, aad, aadSize, input, size, tag, output);
+        if (!isFinal(err) && &backend != software.get()) {
+            err = software->open(algorithm, key, iv, aad, aadSize, input, size, tag, output);
+        }
+        return err;
+    }
 };
 
 Encryptor::Encryptor(const std::string& personalizationData)
@@ -72,12 +138,27 @@ Encryptor& Encryptor::operator=(Encryptor&& other) noexcept {
 }
 
 Error::Errc Encryptor::generateIv(std::vector<unsigned char>& iv) {
+    iv.resize(AES_GCM_IV_SIZE_BYTES);
+    Error::Errc err = generateIv(iv.data());
+    if (err != Error::Errc::Success) {
+        iv.clear();
+    }
+    return err;
+}
+
+Error::Errc Encryptor::generateIv(unsigned char* iv) {
     if (!m_impl || !m_impl->initialized) {
         SS_LOG_ERROR("RNG not initialized for IV generation.");
         return Error::Errc::NotInitialized;
     }
-    iv.resize(AES_GCM_IV_SIZE_BYTES);
-    int ret = mbedtls_ctr_drbg_random(&m_impl->drbg_ctx, iv.data(), iv.size());
+    if (iv == nullptr) {
+        return Error::Errc::InvalidArgument;
+    }
+    int ret;
+    {
+        std::lock_guard<std::mutex> lock(m_impl->drbgMutex);
+        ret = mbedtls_ctr_drbg_random(&m_impl->drbg_ctx, iv, AES_GCM_IV_SIZE_BYTES);
+    }
     if (ret != 0) {
         char error_buf[100];
         mbedtls_strerror(ret, error_buf, sizeof(error_buf));
@@ -91,135 +172,437 @@ Error::Errc Encryptor::encrypt(
     const std::vector<unsigned char>& plaintext,
     const std::vector<unsigned char>& key,
     std::vector<unsigned char>& outputBuffer,
-    const std::vector<unsigned char>& aad) {
+    const std::vector<unsigned char>& aad,
+    CipherAlgorithm algorithm) {
+
+    outputBuffer.resize(encryptedSize(plaintext.size()));
+    size_t output_size = 0;
+    Error::Errc err = encrypt(plaintext.data(), plaintext.size(), key.data(), key.size(),
+                              outputBuffer.data(), outputBuffer.size(), output_size,
+                              aad.data(), aad.size(), algorithm);
+    if (err != Error::Errc::Success) {
+        outputBuffer.clear(); // Clear output on failure
+    }
+    return err;
+}
 
+Error::Errc Encryptor::encrypt(
+    const unsigned char* plaintext,
+    size_t plaintextSize,
+    const unsigned char* key,
+    size_t keySize,
+    unsigned char* output,
+    size_t outputCapacity,
+    size_t& outputSize,
+    const unsigned char* aad,
+    size_t aadSize,
+    CipherAlgorithm algorithm) {
+
+    outputSize = encryptedSize(plaintextSize);
     if (!m_impl || !m_impl->initialized) {
         SS_LOG_ERROR("Encryptor not properly initialized.");
         return Error::Errc::NotInitialized;
     }
-    if (key.size() != AES_GCM_KEY_SIZE_BYTES) {
-        SS_LOG_ERROR("Invalid key size for AES-256-GCM. Expected "
-                     << AES_GCM_KEY_SIZE_BYTES << " bytes, got " << key.size());
+    if (key == nullptr || keySize != AES_GCM_KEY_SIZE_BYTES) {
+        SS_LOG_ERROR("Invalid key size for " << algorithmName(algorithm) << ". Expected "
+                     << AES_GCM_KEY_SIZE_BYTES << " bytes, got " << keySize);
         return Error::Errc::InvalidKey;
     }
+    if ((plaintextSize > 0 && plaintext == nullptr) || (aadSize > 0 && aad == nullptr)) {
+        return Error::Errc::InvalidArgument;
+    }
+    if (output == nullptr || outputCapacity < outputSize) {
+        SS_LOG_DEBUG("Encryption output buffer holds " << outputCapacity << " bytes, needs " << outputSize);
+        return Error::Errc::BufferTooSmall;
+    }
 
-    std::vector<unsigned char> iv;
-    Error::Errc iv_err = generateIv(iv);
-    if (iv_err != Error::Errc::Success) {
-        return iv_err;
+    // Output layout: IV + Ciphertext + Tag. Ciphertext length is same as plaintext for both ciphers.
+    unsigned char* iv_ptr = output;
+    unsigned char* ciphertext_ptr = output + AES_GCM_IV_SIZE_BYTES;
+    unsigned char* tag_ptr = output + AES_GCM_IV_SIZE_BYTES + plaintextSize;
+
+    Error::Errc err = generateIv(iv_ptr);
+    if (err != Error::Errc::Success) {
+        return err;
     }
 
-    // Prepare output buffer: IV + Ciphertext + Tag
-    // Ciphertext length is same as plaintext for GCM.
-    outputBuffer.resize(AES_GCM_IV_SIZE_BYTES + plaintext.size() + AES_GCM_TAG_SIZE_BYTES);
+    err = m_impl->seal(algorithm, key, iv_ptr, aad, aadSize,
+                       plaintextSize == 0 ? nullptr : plaintext, plaintextSize, ciphertext_ptr, tag_ptr);
+    if (err != Error::Errc::Success) {
+        std::memset(output, 0, outputSize); // No partial ciphertext on failure
+        return err;
+    }
 
-    // Pointers to different parts of the outputBuffer
-    unsigned char* iv_ptr = outputBuffer.data();
-    unsigned char* ciphertext_ptr = outputBuffer.data() + AES_GCM_IV_SIZE_BYTES;
-    unsigned char* tag_ptr = outputBuffer.data() + AES_GCM_IV_SIZE_BYTES + plaintext.size();
+    SS_LOG_DEBUG("Encryption successful. Output size: " << outputSize);
+    return Error::Errc::Success;
+}
 
-    // Copy IV to the beginning of the output buffer
-    std::memcpy(iv_ptr, iv.data(), AES_GCM_IV_SIZE_BYTES);
+Error::Errc Encryptor::encryptInPlace(
+    unsigned char* buffer,
+    size_t plaintextSize,
+    const unsigned char* key,
+    size_t keySize,
+    const unsigned char* aad,
+    size_t aadSize,
+    CipherAlgorithm algorithm) {
 
-    int ret = mbedtls_gcm_setkey(&m_impl->gcm_ctx, MBEDTLS_CIPHER_ID_AES, key.data(), key.size() * 8);
-    if (ret != 0) {
-        char error_buf[100];
-        mbedtls_strerror(ret, error_buf, sizeof(error_buf));
-        SS_LOG_ERROR("mbedtls_gcm_setkey failed: " << error_buf);
-        return Error::Errc::CryptoLibraryError;
+    if (buffer == nullptr) {
+        return Error::Errc::InvalidArgument;
     }
+    // Both ciphers process input and output at the same address, so the plaintext is
+    // overwritten by its ciphertext.
+    size_t output_size = 0;
+    Error::Errc err = encrypt(buffer + AES_GCM_IV_SIZE_BYTES, plaintextSize, key, keySize, buffer,
+                              encryptedSize(plaintextSize), output_size, aad, aadSize, algorithm);
+    if (err != Error::Errc::Success) {
+        Utils::secureWipe(buffer, encryptedSize(plaintextSize));
+    }
+    return err;
+}
 
-    // Perform encryption and generate tag
-    ret = mbedtls_gcm_crypt_and_tag(
-        &m_impl->gcm_ctx,
-        MBEDTLS_GCM_ENCRYPT,
-        plaintext.size(),
-        iv.data(), iv.size(),
-        aad.empty() ? nullptr : aad.data(), aad.size(),
-        plaintext.empty() ? nullptr : plaintext.data(), ciphertext_ptr, // Output ciphertext
-        AES_GCM_TAG_SIZE_BYTES, tag_ptr // Output tag
-    );
+Error::Errc Encryptor::decrypt(
+    const std::vector<unsigned char>& inputBuffer,
+    const std::vector<unsigned char>& key,
+    std::vector<unsigned char>& plaintext,
+    const std::vector<unsigned char>& aad,
+    CipherAlgorithm algorithm) {
+    return decrypt(inputBuffer.data(), inputBuffer.size(), key, plaintext, aad, algorithm);
+}
 
-    mbedtls_gcm_free(&m_impl->gcm_ctx); // Important to free and re-init if using context for multiple operations
-    mbedtls_gcm_init(&m_impl->gcm_ctx); // Re-initialize for next operation (or manage state carefully)
+Error::Errc Encryptor::decrypt(
+    const unsigned char* inputData,
+    size_t inputSize,
+    const std::vector<unsigned char>& key,
+    std::vector<unsigned char>& plaintext,
+    const std::vector<unsigned char>& aad,
+    CipherAlgorithm algorithm) {
+
+    plaintext.resize(decryptedSize(inputSize));
+    size_t plaintext_size = 0;
+    Error::Errc err = decrypt(inputData, inputSize, key.data(), key.size(),
+                              plaintext.data(), plaintext.size(), plaintext_size,
+                              aad.data(), aad.size(), algorithm);
+    if (err != Error::Errc::Success) {
+        plaintext.clear(); // Clear output on failure
+    }
+    return err;
+}
 
+Error::Errc Encryptor::decrypt(
+    const unsigned char* inputData,
+    size_t inputSize,
+    const unsigned char* key,
+    size_t keySize,
+    unsigned char* output,
+    size_t outputCapacity,
+    size_t& outputSize,
+    const unsigned char* aad,
+    size_t aadSize,
+    CipherAlgorithm algorithm) {
+
+    outputSize = decryptedSize(inputSize);
+    if (!m_impl || !m_impl->initialized) {
+        SS_LOG_ERROR("Encryptor not properly initialized.");
+        return Error::Errc::NotInitialized;
+    }
+    if (key == nullptr || keySize != AES_GCM_KEY_SIZE_BYTES) {
+        SS_LOG_ERROR("Invalid key size for " << algorithmName(algorithm) << " decryption. Expected "
+                     << AES_GCM_KEY_SIZE_BYTES << " bytes, got " << keySize);
+        return Error::Errc::InvalidKey;
+    }
+    if (inputData == nullptr || inputSize < AES_GCM_IV_SIZE_BYTES + AES_GCM_TAG_SIZE_BYTES) {
+        SS_LOG_ERROR("Input buffer too small for IV and Tag. Size: " << inputSize);
+        return Error::Errc::InvalidArgument;
+    }
+    if (aadSize > 0 && aad == nullptr) {
+        return Error::Errc::InvalidArgument;
+    }
+    if (outputSize > 0 && (output == nullptr || outputCapacity < outputSize)) {
+        SS_LOG_DEBUG("Decryption output buffer holds " << outputCapacity << " bytes, needs " << outputSize);
+        return Error::Errc::BufferTooSmall;
+    }
 
-    if (ret != 0) {
-        char error_buf[100];
-        mbedtls_strerror(ret, error_buf, sizeof(error_buf));
-        SS_LOG_ERROR("mbedtls_gcm_crypt_and_tag (encrypt) failed: " << error_buf);
-        outputBuffer.clear(); // Clear output on failure
-        return Error::Errc::EncryptionFailed;
+    const unsigned char* iv_ptr = inputData;
+    const unsigned char* ciphertext_ptr = inputData + AES_GCM_IV_SIZE_BYTES;
+    const unsigned char* tag_ptr = inputData + AES_GCM_IV_SIZE_BYTES + outputSize;
+
+    // Decryption needs no DRBG, so it uses its own context and is safe to call concurrently.
+    Error::Errc err = m_impl->open(algorithm, key, iv_ptr, aad, aadSize, ciphertext_ptr, outputSize, tag_ptr,
+                                   outputSize == 0 ? nullptr : output);
+    if (err != Error::Errc::Success) {
+        return err;
     }
 
-    SS_LOG_DEBUG("Encryption successful. Output size: " << outputBuffer.size());
+    SS_LOG_DEBUG("Decryption successful. Plaintext size: " << outputSize);
     return Error::Errc::Success;
 }
 
-Error::Errc Encryptor::decrypt(
-    const std::vector<unsigned char>& inputBuffer,
+Error::Errc Encryptor::decryptFromFile(
+    int fd,
+    int64_t offset,
+    size_t inputSize,
+    const unsigned char* key,
+    size_t keySize,
+    unsigned char* output,
+    size_t outputCapacity,
+    size_t& outputSize,
+    const unsigned char* aad,
+    size_t aadSize,
+    CipherAlgorithm algorithm) {
+
+    outputSize = decryptedSize(inputSize);
+    if (!m_impl || !m_impl->initialized) {
+        SS_LOG_ERROR("Encryptor not properly initialized.");
+        return Error::Errc::NotInitialized;
+    }
+    if (key == nullptr || keySize != AES_GCM_KEY_SIZE_BYTES) {
+        SS_LOG_ERROR("Invalid key size for " << algorithmName(algorithm) << " decryption. Expected "
+                     << AES_GCM_KEY_SIZE_BYTES << " bytes, got " << keySize);
+        return Error::Errc::InvalidKey;
+    }
+    if (fd < 0 || offset < 0 || inputSize < AES_GCM_IV_SIZE_BYTES + AES_GCM_TAG_SIZE_BYTES) {
+        SS_LOG_ERROR("Invalid file range for decryption. Size: " << inputSize);
+        return Error::Errc::InvalidArgument;
+    }
+    if (aadSize > 0 && aad == nullptr) {
+        return Error::Errc::InvalidArgument;
+    }
+    if (outputSize > 0 && (output == nullptr || outputCapacity < outputSize)) {
+        SS_LOG_DEBUG("Decryption output buffer holds " << outputCapacity << " bytes, needs " << outputSize);
+        return Error::Errc::BufferTooSmall;
+    }
+#ifndef _WIN32
+    unsigned char iv[AES_GCM_IV_SIZE_BYTES];
+    size_t done = 0;
+    while (done < sizeof(iv)) {
+        ssize_t n = pread(fd, iv + done, sizeof(iv) - done, static_cast<off_t>(offset + done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            SS_LOG_ERROR("Failed to read the IV at offset " << offset << ".");
+            return Error::Errc::FileReadFailed;
+        }
+        done += static_cast<size_t>(n);
+    }
+
+    CipherBackend& backend = m_impl->backendFor(algorithm, aadSize, outputSize);
+    const int64_t ciphertext_offset = offset + static_cast<int64_t>(AES_GCM_IV_SIZE_BYTES);
+    Error::Errc err = backend.openFile(algorithm, key, iv, aad, aadSize, fd, ciphertext_offset, outputSize,
+                                       outputSize == 0 ? nullptr : output);
+    if (!Impl::isFinal(err) && err != Error::Errc::FileReadFailed && &backend != m_impl->software.get()) {
+        err = m_impl->software->openFile(algorithm, key, iv, aad, aadSize, fd, ciphertext_offset, outputSize,
+                                         outputSize == 0 ? nullptr : output);
+    }
+    return err;
+#else
+    (void)fd; (void)offset; (void)aad; (void)aadSize; (void)output;
+    return Error::Errc::OperationFailed;
+#endif
+}
+
+size_t Encryptor::encryptedSize(size_t plaintextSize) {
+    return AES_GCM_IV_SIZE_BYTES + plaintextSize + AES_GCM_TAG_SIZE_BYTES;
+}
+
+size_t Encryptor::decryptedSize(size_t inputSize) {
+    return inputSize < AES_GCM_IV_SIZE_BYTES + AES_GCM_TAG_SIZE_BYTES
+               ? 0 : inputSize - AES_GCM_IV_SIZE_BYTES - AES_GCM_TAG_SIZE_BYTES;
+}
+
+Error::Errc Encryptor::encryptDetached(
+    const unsigned char* plaintext,
+    size_t size,
     const std::vector<unsigned char>& key,
-    std::vector<unsigned char>& plaintext,
-    const std::vector<unsigned char>& aad) {
+    const unsigned char* iv,
+    const std::vector<unsigned char>& aad,
+    unsigned char* ciphertext,
+    unsigned char* tag,
+    CipherAlgorithm algorithm) {
+    return encryptDetached(plaintext, size, key.data(), key.size(), iv, aad, ciphertext, tag, algorithm);
+}
+
+Error::Errc Encryptor::encryptDetached(
+    const unsigned char* plaintext,
+    size_t size,
+    const unsigned char* key,
+    size_t keySize,
+    const unsigned char* iv,
+    const std::vector<unsigned char>& aad,
+    unsigned char* ciphertext,
+    unsigned char* tag,
+    CipherAlgorithm algorithm) {
 
     if (!m_impl || !m_impl->initialized) {
         SS_LOG_ERROR("Encryptor not properly initialized.");
         return Error::Errc::NotInitialized;
     }
-    if (key.size() != AES_GCM_KEY_SIZE_BYTES) {
-        SS_LOG_ERROR("Invalid key size for AES-256-GCM decryption. Expected "
-                     << AES_GCM_KEY_SIZE_BYTES << " bytes, got " << key.size());
+    if (key == nullptr || keySize != AES_GCM_KEY_SIZE_BYTES) {
+        SS_LOG_ERROR("Invalid key size for " << algorithmName(algorithm) << ". Expected "
+                     << AES_GCM_KEY_SIZE_BYTES << " bytes, got " << keySize);
         return Error::Errc::InvalidKey;
     }
-    if (inputBuffer.size() < AES_GCM_IV_SIZE_BYTES + AES_GCM_TAG_SIZE_BYTES) {
-        SS_LOG_ERROR("Input buffer too small for IV and Tag. Size: " << inputBuffer.size());
+    if (iv == nullptr || tag == nullptr || (size > 0 && (plaintext == nullptr || ciphertext == nullptr))) {
         return Error::Errc::InvalidArgument;
     }
+    // Per-call context, as in decrypt(), so segments can be encrypted concurrently.
+    return m_impl->seal(algorithm, key, iv, aad.data(), aad.size(), plaintext, size, ciphertext, tag);
+}
 
-    const unsigned char* iv_ptr = inputBuffer.data();
-    const unsigned char* ciphertext_ptr = inputBuffer.data() + AES_GCM_IV_SIZE_BYTES;
-    size_t ciphertext_len = inputBuffer.size() - AES_GCM_IV_SIZE_BYTES - AES_GCM_TAG_SIZE_BYTES;
-    const unsigned char* tag_ptr = inputBuffer.data() + AES_GCM_IV_SIZE_BYTES + ciphertext_len;
+Error::Errc Encryptor::decryptDetached(
+    const unsigned char* ciphertext,
+    size_t size,
+    const std::vector<unsigned char>& key,
+    const unsigned char* iv,
+    const std::vector<unsigned char>& aad,
+    const unsigned char* tag,
+    unsigned char* plaintext,
+    CipherAlgorithm algorithm) {
+    return decryptDetached(ciphertext, size, key.data(), key.size(), iv, aad, tag, plaintext, algorithm);
+}
 
-    plaintext.resize(ciphertext_len);
+Error::Errc Encryptor::decryptDetached(
+    const unsigned char* ciphertext,
+    size_t size,
+    const unsigned char* key,
+    size_t keySize,
+    const unsigned char* iv,
+    const std::vector<unsigned char>& aad,
+    const unsigned char* tag,
+    unsigned char* plaintext,
+    CipherAlgorithm algorithm) {
 
-    int ret = mbedtls_gcm_setkey(&m_impl->gcm_ctx, MBEDTLS_CIPHER_ID_AES, key.data(), key.size() * 8);
-    if (ret != 0) {
-        char error_buf[100];
-        mbedtls_strerror(ret, error_buf, sizeof(error_buf));
-        SS_LOG_ERROR("mbedtls_gcm_setkey failed (decrypt): " << error_buf);
-        return Error::Errc::CryptoLibraryError;
+    if (!m_impl || !m_impl->initialized) {
+        SS_LOG_ERROR("Encryptor not properly initialized.");
+        return Error::Errc::NotInitialized;
     }
+    if (key == nullptr || keySize != AES_GCM_KEY_SIZE_BYTES) {
+        SS_LOG_ERROR("Invalid key size for " << algorithmName(algorithm) << " decryption. Expected "
+                     << AES_GCM_KEY_SIZE_BYTES << " bytes, got " << keySize);
+        return Error::Errc::InvalidKey;
+    }
+    if (iv == nullptr || tag == nullptr || (size > 0 && (plaintext == nullptr || ciphertext == nullptr))) {
+        return Error::Errc::InvalidArgument;
+    }
+    return m_impl->open(algorithm, key, iv, aad.data(), aad.size(), ciphertext, size, tag, plaintext);
+}
 
-    // Perform decryption and authentication
-    ret = mbedtls_gcm_auth_decrypt(
-        &m_impl->gcm_ctx,
-        ciphertext_len,
-        iv_ptr, AES_GCM_IV_SIZE_BYTES,
-        aad.empty() ? nullptr : aad.data(), aad.size(),
-        tag_ptr, AES_GCM_TAG_SIZE_BYTES,
-        ciphertext_ptr, plaintext.empty() && ciphertext_len == 0 ? nullptr : plaintext.data() // Output plaintext
-    );
-    
-    mbedtls_gcm_free(&m_impl->gcm_ctx); // Important to free and re-init if using context for multiple operations
-    mbedtls_gcm_init(&m_impl->gcm_ctx); // Re-initialize for next operation
-
-    if (ret != 0) {
-        plaintext.clear(); // Clear output on failure
-        if (ret == MBEDTLS_ERR_GCM_AUTH_FAILED) {
-            SS_LOG_WARN("GCM authentication failed during decryption (tag mismatch or tampered data).");
-            return Error::Errc::AuthenticationFailed;
-        } else {
-            char error_buf[100];
-            mbedtls_strerror(ret, error_buf, sizeof(error_buf));
-            SS_LOG_ERROR("mbedtls_gcm_auth_decrypt failed: " << error_buf);
-            return Error::Errc::DecryptionFailed;
+CipherAlgorithm Encryptor::selectFastestAlgorithm(size_t sampleBytes) {
+    const CipherAlgorithm candidates[] = {CipherAlgorithm::Aes256Gcm, CipherAlgorithm::ChaCha20Poly1305};
+    constexpr int ROUNDS = 3;
+    // Throwaway key and IV: nothing encrypted here is kept.
+    const std::vector<unsigned char> key(AES_GCM_KEY_SIZE_BYTES, 0x5a);
+    const unsigned char iv[AES_GCM_IV_SIZE_BYTES] = {0};
+    std::vector<unsigned char> input(sampleBytes, 0xa5);
+    std::vector<unsigned char> output(sampleBytes);
+    unsigned char tag[AES_GCM_TAG_SIZE_BYTES];
+
+    CipherAlgorithm fastest = CipherAlgorithm::Aes256Gcm;
+    std::chrono::nanoseconds fastest_time = std::chrono::nanoseconds::max();
+    for (CipherAlgorithm algorithm : candidates) {
+        std::chrono::nanoseconds best = std::chrono::nanoseconds::max();
+        for (int round = 0; round < ROUNDS; ++round) {
+            auto start = std::chrono::steady_clock::now();
+            if (encryptDetached(input.data(), input.size(), key, iv, {}, output.data(), tag, algorithm) != Error::Errc::Success) {
+                SS_LOG_WARN("Cipher self-benchmark of " << algorithmName(algorithm) << " failed; keeping AES-256-GCM.");
+                return CipherAlgorithm::Aes256Gcm;
+            }
+            best = std::min(best, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start));
+        }
+        SS_LOG_DEBUG("Cipher self-benchmark: " << algorithmName(algorithm) << " encrypted " << sampleBytes
+                     << " bytes in " << best.count() << " ns.");
+        if (best < fastest_time) { // Strictly faster, so the earlier (AES-256-GCM) wins ties
+            fastest = algorithm;
+            fastest_time = best;
         }
     }
+    return fastest;
+}
+
+const char* Encryptor::algorithmName(CipherAlgorithm algorithm) {
+    return algorithm == CipherAlgorithm::ChaCha20Poly1305 ? "ChaCha20-Poly1305" : "AES-256-GCM";
+}
 
-    SS_LOG_DEBUG("Decryption successful. Plaintext size: " << plaintext.size());
+Error::Errc Encryptor::setCipherBackend(CipherBackendKind backend) {
+    if (!m_impl) {
+        return Error::Errc::NotInitialized;
+    }
+    if (backend == CipherBackendKind::Kernel && m_impl->kernelBackend() == nullptr) {
+        SS_LOG_WARN("The kernel crypto API offers no gcm(aes) here; keeping " << backendName(getCipherBackend()) << ".");
+        return Error::Errc::OperationFailed;
+    }
+    m_impl->active.store(backend, std::memory_order_relaxed);
     return Error::Errc::Success;
 }
 
+CipherBackendKind Encryptor::getCipherBackend() const {
+    return m_impl ? m_impl->active.load(std::memory_order_relaxed) : CipherBackendKind::Software;
+}
+
+bool Encryptor::isKernelBackendAvailable() {
+    return m_impl && m_impl->kernelBackend() != nullptr;
+}
+
+CipherBackendKind Encryptor::selectFastestBackend(size_t sampleBytes) {
+    if (!m_impl) {
+        return CipherBackendKind::Software;
+    }
+    m_impl->active.store(CipherBackendKind::Software, std::memory_order_relaxed);
+    CipherBackend* kernel = m_impl->kernelBackend();
+    if (kernel == nullptr || !kernel->supports(CipherAlgorithm::Aes256Gcm, 0, sampleBytes)) {
+        return CipherBackendKind::Software;
+    }
+    CipherBackend* software = m_impl->software.get();
+    constexpr int ROUNDS = 3;
+    // Throwaway key, IV and AAD: nothing encrypted here is kept.
+    const unsigned char key[AES_GCM_KEY_SIZE_BYTES] = {0x5a};
+    const unsigned char iv[AES_GCM_IV_SIZE_BYTES] = {0};
+    const unsigned char aad[16] = {0x3c};
+    std::vector<unsigned char> input(sampleBytes, 0xa5);
+    std::vector<unsigned char> expected(sampleBytes), output(sampleBytes);
+    unsigned char expected_tag[AES_GCM_TAG_SIZE_BYTES], tag[AES_GCM_TAG_SIZE_BYTES];
+
+    // A driver is only used if it produces mbedtls' bytes exactly, both ways.
+    if (software->seal(CipherAlgorithm::Aes256Gcm, key, iv, aad, sizeof(aad), input.data(), sampleBytes,
+                       expected.data(), expected_tag) != Error::Errc::Success ||
+        kernel->seal(CipherAlgorithm::Aes256Gcm, key, iv, aad, sizeof(aad), input.data(), sampleBytes,
+                     output.data(), tag) != Error::Errc::Success ||
+        output != expected || std::memcmp(tag, expected_tag, sizeof(tag)) != 0 ||
+        kernel->open(CipherAlgorithm::Aes256Gcm, key, iv, aad, sizeof(aad), expected.data(), sampleBytes,
+                     expected_tag, output.data()) != Error::Errc::Success ||
+        output != input) {
+        SS_LOG_WARN("Kernel gcm(aes) does not match the software implementation; keeping software.");
+        return CipherBackendKind::Software;
+    }
+
+    CipherBackend* const candidates[] = {software, kernel};
+    CipherBackendKind fastest = CipherBackendKind::Software;
+    std::chrono::nanoseconds fastest_time = std::chrono::nanoseconds::max();
+    for (CipherBackend* backend : candidates) {
+        std::chrono::nanoseconds best = std::chrono::nanoseconds::max();
+        for (int round = 0; round < ROUNDS; ++round) {
+            auto start = std::chrono::steady_clock::now();
+            if (backend->seal(CipherAlgorithm::Aes256Gcm, key, iv, aad, sizeof(aad), input.data(), sampleBytes,
+                              output.data(), tag) != Error::Errc::Success) {
+                SS_LOG_WARN("Cipher backend benchmark of " << backendName(backend->kind()) << " failed; keeping software.");
+                return CipherBackendKind::Software;
+            }
+            best = std::min(best, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start));
+        }
+        SS_LOG_DEBUG("Cipher backend benchmark: " << backendName(backend->kind()) << " encrypted " << sampleBytes
+                     << " bytes in " << best.count() << " ns.");
+        if (best < fastest_time) { // Strictly faster, so software wins ties
+            fastest = backend->kind();
+            fastest_time = best;
+        }
+    }
+    m_impl->active.store(fastest, std::memory_order_relaxed);
+    return fastest;
+}
+
+const char* Encryptor::backendName(CipherBackendKind backend) {
+    return backend == CipherBackendKind::Kernel ? "kernel crypto API" : "mbedtls";
+}
+
 } // namespace Crypto
-} // namespace SecureStorage
\ No newline at end of file
+} // namespace SecureStorage
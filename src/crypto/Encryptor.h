@@ -5,34 +5,59 @@
 #include <vector>
 #include <string>
 #include <memory> // For std::unique_ptr
+#include <cstdint> // For int64_t
 
 // Forward declare Mbed TLS types to keep them out of this public header
-struct mbedtls_gcm_context;
 struct mbedtls_ctr_drbg_context;
 struct mbedtls_entropy_context;
 
 namespace SecureStorage {
 namespace Crypto {
 
-// Standard AES-GCM constants
+// Standard AES-GCM constants. ChaCha20-Poly1305 uses the same key, nonce and tag sizes.
 constexpr size_t AES_GCM_KEY_SIZE_BYTES = 32; // 256 bits
 constexpr size_t AES_GCM_IV_SIZE_BYTES = 12;  // 96 bits is optimal for GCM
 constexpr size_t AES_GCM_TAG_SIZE_BYTES = 16; // 128 bits tag
 
+// Plaintext bytes each algorithm encrypts per round in selectFastestAlgorithm().
+constexpr size_t CIPHER_BENCHMARK_SAMPLE_BYTES = 16 * 1024;
+
+/**
+ * @enum CipherAlgorithm
+ * @brief The AEAD ciphers an Encryptor can use.
+ */
+enum class CipherAlgorithm {
+    Aes256Gcm,       ///< AES-256 in Galois/Counter Mode; fastest on cores with AES instructions
+    ChaCha20Poly1305 ///< ChaCha20-Poly1305 (RFC 8439); fastest on cores without them
+};
+
+/**
+ * @enum CipherBackendKind
+ * @brief The engines an Encryptor can run AES-256-GCM on. ChaCha20-Poly1305 always runs in software.
+ */
+enum class CipherBackendKind {
+    Software, ///< mbedtls in user space
+    Kernel    ///< The Linux kernel crypto API (AF_ALG gcm(aes)), e.g. a SoC's crypto engine
+};
+
 /**
  * @class Encryptor
- * @brief Provides AES-256-GCM encryption and decryption services.
+ * @brief Provides AES-256-GCM and ChaCha20-Poly1305 encryption and decryption services.
  *
- * This class handles authenticated encryption using AES in Galois/Counter Mode (GCM).
- * It manages Mbed TLS contexts for GCM operations and random IV generation.
- * Each encryption operation generates a unique IV. The output format is:
+ * This class handles authenticated encryption with one of the CipherAlgorithm ciphers,
+ * AES-256-GCM unless a call asks for another one. It manages random IV generation.
+ * Each encryption operation generates a unique IV. The output format is the same for
+ * both ciphers, which do not record which of them was used:
  * [IV (12 bytes)] + [Ciphertext] + [Authentication Tag (16 bytes)]
+ *
+ * encrypt() and decrypt() may be called from several threads at once; IV generation
+ * draws from one DRBG under a mutex, so concurrent calls never share an IV.
  */
 class Encryptor {
 public:
     /**
      * @brief Constructs an Encryptor instance.
-     * Initializes contexts for AES-GCM and random number generation.
+     * Initializes the contexts for random number generation.
      * @param personalizationData A string used to seed the random number generator.
      * This should ideally be unique per application/device instance.
      * "SecureStorageEncryptor" can be a default.
@@ -57,13 +82,15 @@ public:
      * It will be resized appropriately.
      * @param aad Optional Additional Authenticated Data (AAD). This data is authenticated
      * but not encrypted. Default is empty.
+     * @param algorithm The cipher to use. Default is AES-256-GCM.
      * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
      */
     Error::Errc encrypt(
         const std::vector<unsigned char>& plaintext,
         const std::vector<unsigned char>& key,
         std::vector<unsigned char>& outputBuffer,
-        const std::vector<unsigned char>& aad = {});
+        const std::vector<unsigned char>& aad = {},
+        CipherAlgorithm algorithm = CipherAlgorithm::Aes256Gcm);
 
     /**
      * @brief Decrypts data previously encrypted with AES-256-GCM.
@@ -76,27 +103,348 @@ public:
      * It will be resized appropriately.
      * @param aad Optional Additional Authenticated Data (AAD) that was used during encryption.
      * Must match the AAD used during encryption. Default is empty.
+     * @param algorithm The cipher the data was encrypted with. Default is AES-256-GCM.
      * @return SecureStorage::Error::Errc::Success on success.
-     * SecureStorage::Error::Errc::AuthenticationFailed if GCM tag mismatch or data tampered.
+     * SecureStorage::Error::Errc::AuthenticationFailed if the tag does not match or the data was tampered with.
      * Other error codes on different failures.
      */
     Error::Errc decrypt(
         const std::vector<unsigned char>& inputBuffer,
         const std::vector<unsigned char>& key,
         std::vector<unsigned char>& plaintext,
-        const std::vector<unsigned char>& aad = {});
+        const std::vector<unsigned char>& aad = {},
+        CipherAlgorithm algorithm = CipherAlgorithm::Aes256Gcm);
 
-private:
-    // PImpl idiom to hide Mbed TLS context details
-    class Impl;
-    std::unique_ptr<Impl> m_impl;
+    /**
+     * @brief Decrypts a [IV] + [Ciphertext] + [Tag] blob held in caller memory.
+     *
+     * Same as the vector overload, but lets callers decrypt a sub-range of a larger
+     * buffer (e.g. the body of a record that starts with a header) without copying it.
+     *
+     * @param inputData Pointer to the IV, ciphertext and GCM tag.
+     * @param inputSize Number of bytes at inputData.
+     * @param key The 256-bit (32-byte) encryption key.
+     * @param[out] plaintext Vector to store the decrypted data.
+     * @param aad Optional Additional Authenticated Data that was used during encryption.
+     * @param algorithm The cipher the data was encrypted with. Default is AES-256-GCM.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc decrypt(
+        const unsigned char* inputData,
+        size_t inputSize,
+        const std::vector<unsigned char>& key,
+        std::vector<unsigned char>& plaintext,
+        const std::vector<unsigned char>& aad = {},
+        CipherAlgorithm algorithm = CipherAlgorithm::Aes256Gcm);
+
+    /**
+     * @brief Encrypts a buffer held in caller memory into a caller-provided buffer.
+     *
+     * Same output format as the vector overload, for callers whose plaintext, key or
+     * output lives in a std::string, an arena or a mapped file and should not be copied
+     * into vectors first. Query the needed capacity with encryptedSize().
+     *
+     * @param plaintext Pointer to the data to encrypt (may be null if plaintextSize is 0).
+     * @param plaintextSize Number of bytes at plaintext.
+     * @param key Pointer to the 256-bit (32-byte) encryption key.
+     * @param keySize Number of bytes at key; must be AES_GCM_KEY_SIZE_BYTES.
+     * @param[out] output Receives [IV] + [Ciphertext] + [Tag]. Must not overlap plaintext,
+     * except that plaintext may start at output + AES_GCM_IV_SIZE_BYTES (see encryptInPlace()).
+     * @param outputCapacity Number of bytes available at output.
+     * @param[out] outputSize Set to encryptedSize(plaintextSize) on success and on
+     * Errc::BufferTooSmall, so a caller can retry with a large enough buffer.
+     * @param aad Optional Additional Authenticated Data (may be null if aadSize is 0).
+     * @param aadSize Number of bytes at aad.
+     * @param algorithm The cipher to use. Default is AES-256-GCM.
+     * @return SecureStorage::Error::Errc::Success on success,
+     * SecureStorage::Error::Errc::BufferTooSmall if outputCapacity is too small,
+     * or another error code on failure.
+     */
+    Error::Errc encrypt(
+        const unsigned char* plaintext,
+        size_t plaintextSize,
+        const unsigned char* key,
+        size_t keySize,
+        unsigned char* output,
+        size_t outputCapacity,
+        size_t& outputSize,
+        const unsigned char* aad = nullptr,
+        size_t aadSize = 0,
+        CipherAlgorithm algorithm = CipherAlgorithm::Aes256Gcm);
+
+    /**
+     * @brief Encrypts a buffer in place, without a second buffer for the output.
+     *
+     * buffer holds encryptedSize(plaintextSize) bytes with the plaintext starting at offset
+     * AES_GCM_IV_SIZE_BYTES. On success it holds [IV] + [Ciphertext] + [Tag], as encrypt()
+     * would produce; on failure it is zeroed, plaintext included.
+     *
+     * @param[in,out] buffer The buffer, as described above.
+     * @param plaintextSize Number of plaintext bytes at buffer + AES_GCM_IV_SIZE_BYTES.
+     * @param key Pointer to the 256-bit (32-byte) encryption key.
+     * @param keySize Number of bytes at key; must be AES_GCM_KEY_SIZE_BYTES.
+     * @param aad Optional Additional Authenticated Data (may be null if aadSize is 0).
+     * @param aadSize Number of bytes at aad.
+     * @param algorithm The cipher to use. Default is AES-256-GCM.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc encryptInPlace(
+        unsigned char* buffer,
+        size_t plaintextSize,
+        const unsigned char* key,
+        size_t keySize,
+        const unsigned char* aad = nullptr,
+        size_t aadSize = 0,
+        CipherAlgorithm algorithm = CipherAlgorithm::Aes256Gcm);
+
+    /**
+     * @brief Decrypts a [IV] + [Ciphertext] + [Tag] blob into a caller-provided buffer.
+     *
+     * Query the needed capacity with decryptedSize().
+     *
+     * @param inputData Pointer to the IV, ciphertext and GCM tag.
+     * @param inputSize Number of bytes at inputData.
+     * @param key Pointer to the 256-bit (32-byte) encryption key.
+     * @param keySize Number of bytes at key; must be AES_GCM_KEY_SIZE_BYTES.
+     * @param[out] output Receives the plaintext; zeroed if authentication fails.
+     * @param outputCapacity Number of bytes available at output.
+     * @param[out] outputSize Set to decryptedSize(inputSize) on success and on
+     * Errc::BufferTooSmall.
+     * @param aad Optional Additional Authenticated Data that was used during encryption.
+     * @param aadSize Number of bytes at aad.
+     * @param algorithm The cipher the data was encrypted with. Default is AES-256-GCM.
+     * @return SecureStorage::Error::Errc::Success on success,
+     * SecureStorage::Error::Errc::BufferTooSmall if outputCapacity is too small,
+     * SecureStorage::Error::Errc::AuthenticationFailed if the tag does not match,
+     * or another error code on failure.
+     */
+    Error::Errc decrypt(
+        const unsigned char* inputData,
+        size_t inputSize,
+        const unsigned char* key,
+        size_t keySize,
+        unsigned char* output,
+        size_t outputCapacity,
+        size_t& outputSize,
+        const unsigned char* aad = nullptr,
+        size_t aadSize = 0,
+        CipherAlgorithm algorithm = CipherAlgorithm::Aes256Gcm);
+
+    /**
+     * @brief Returns the size of encrypt()'s output for a plaintext of the given size.
+     * @param plaintextSize Number of plaintext bytes.
+     * @return plaintextSize plus the IV and tag sizes.
+     */
+    static size_t encryptedSize(size_t plaintextSize);
+
+    /**
+     * @brief Returns the size of decrypt()'s output for an input of the given size.
+     * @param inputSize Number of bytes of [IV] + [Ciphertext] + [Tag].
+     * @return The plaintext size, or 0 if inputSize cannot hold an IV and a tag.
+     */
+    static size_t decryptedSize(size_t inputSize);
 
     /**
      * @brief Generates a random Initialization Vector (IV).
+     * For callers that derive the IVs of several encryptDetached() calls from one random
+     * value. Safe to call concurrently with encrypt().
      * @param[out] iv Vector to store the generated IV. It will be sized to AES_GCM_IV_SIZE_BYTES.
      * @return SecureStorage::Error::Errc::Success on success, or an error code.
      */
     Error::Errc generateIv(std::vector<unsigned char>& iv);
+
+    /**
+     * @brief Generates a random Initialization Vector (IV) into caller memory.
+     * @param[out] iv Pointer to AES_GCM_IV_SIZE_BYTES bytes to fill.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code.
+     */
+    Error::Errc generateIv(unsigned char* iv);
+
+    /**
+     * @brief Encrypts a buffer with a caller-chosen IV, writing ciphertext and tag separately.
+     *
+     * Uses its own GCM context and no DRBG, so it may be called from several threads at
+     * once. The caller must never use the same IV twice under one key.
+     *
+     * @param plaintext Pointer to the data to encrypt (may be null if size is 0).
+     * @param size Number of bytes at plaintext.
+     * @param key The 256-bit (32-byte) encryption key.
+     * @param iv Pointer to AES_GCM_IV_SIZE_BYTES bytes of IV.
+     * @param aad Additional Authenticated Data.
+     * @param[out] ciphertext Receives size bytes of ciphertext.
+     * @param[out] tag Receives AES_GCM_TAG_SIZE_BYTES bytes of tag.
+     * @param algorithm The cipher to use. Default is AES-256-GCM.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc encryptDetached(
+        const unsigned char* plaintext,
+        size_t size,
+        const std::vector<unsigned char>& key,
+        const unsigned char* iv,
+        const std::vector<unsigned char>& aad,
+        unsigned char* ciphertext,
+        unsigned char* tag,
+        CipherAlgorithm algorithm = CipherAlgorithm::Aes256Gcm);
+
+    /**
+     * @brief encryptDetached() with the key in caller memory, e.g. a Utils::SecureBytes.
+     * @param key Pointer to the 256-bit (32-byte) encryption key.
+     * @param keySize Number of bytes at key.
+     */
+    Error::Errc encryptDetached(
+        const unsigned char* plaintext,
+        size_t size,
+        const unsigned char* key,
+        size_t keySize,
+        const unsigned char* iv,
+        const std::vector<unsigned char>& aad,
+        unsigned char* ciphertext,
+        unsigned char* tag,
+        CipherAlgorithm algorithm = CipherAlgorithm::Aes256Gcm);
+
+    /**
+     * @brief Decrypts and authenticates the output of encryptDetached().
+     * May be called from several threads at once.
+     *
+     * @param ciphertext Pointer to the ciphertext (may be null if size is 0).
+     * @param size Number of bytes at ciphertext.
+     * @param key The 256-bit (32-byte) encryption key.
+     * @param iv Pointer to the AES_GCM_IV_SIZE_BYTES bytes of IV used to encrypt.
+     * @param aad The Additional Authenticated Data used to encrypt.
+     * @param tag Pointer to the AES_GCM_TAG_SIZE_BYTES bytes of tag.
+     * @param[out] plaintext Receives size bytes of plaintext; wiped if authentication fails.
+     * @param algorithm The cipher the data was encrypted with. Default is AES-256-GCM.
+     * @return SecureStorage::Error::Errc::Success on success,
+     * SecureStorage::Error::Errc::AuthenticationFailed if the tag does not match,
+     * or another error code on failure.
+     */
+    Error::Errc decryptDetached(
+        const unsigned char* ciphertext,
+        size_t size,
+        const std::vector<unsigned char>& key,
+        const unsigned char* iv,
+        const std::vector<unsigned char>& aad,
+        const unsigned char* tag,
+        unsigned char* plaintext,
+        CipherAlgorithm algorithm = CipherAlgorithm::Aes256Gcm);
+
+    /**
+     * @brief decryptDetached() with the key in caller memory, e.g. a Utils::SecureBytes.
+     * @param key Pointer to the 256-bit (32-byte) encryption key.
+     * @param keySize Number of bytes at key.
+     */
+    Error::Errc decryptDetached(
+        const unsigned char* ciphertext,
+        size_t size,
+        const unsigned char* key,
+        size_t keySize,
+        const unsigned char* iv,
+        const std::vector<unsigned char>& aad,
+        const unsigned char* tag,
+        unsigned char* plaintext,
+        CipherAlgorithm algorithm = CipherAlgorithm::Aes256Gcm);
+
+    /**
+     * @brief Times every CipherAlgorithm on this machine and returns the fastest.
+     *
+     * Each cipher encrypts sampleBytes a few times under a throwaway key; the best round
+     * counts. AES-256-GCM wins ties. Takes well under a millisecond on cores with AES
+     * instructions and a few milliseconds on small cores without them.
+     *
+     * @param sampleBytes Plaintext bytes per round.
+     * @return The fastest cipher; AES-256-GCM if the measurement fails.
+     */
+    CipherAlgorithm selectFastestAlgorithm(size_t sampleBytes = CIPHER_BENCHMARK_SAMPLE_BYTES);
+
+    /**
+     * @brief Decrypts a record body [IV][Ciphertext][Tag] straight from a file.
+     *
+     * With the kernel backend the ciphertext is spliced from the file into the kernel's
+     * cipher and only the plaintext reaches user memory; otherwise it is read into a pooled
+     * buffer and decrypted as by decrypt(). May be called from several threads at once.
+     *
+     * @param fd File to read; its file offset is not used or changed.
+     * @param offset Position of the IV in the file.
+     * @param inputSize Bytes of IV, ciphertext and tag.
+     * @param key Pointer to the 256-bit (32-byte) encryption key.
+     * @param keySize Number of bytes at key.
+     * @param[out] output Receives the plaintext; wiped if authentication fails.
+     * @param outputCapacity Number of bytes available at output.
+     * @param[out] outputSize Set to the plaintext size, also when the buffer is too small.
+     * @param aad Pointer to the Additional Authenticated Data (may be null if aadSize is 0).
+     * @param aadSize Number of bytes at aad.
+     * @param algorithm The cipher the data was encrypted with. Default is AES-256-GCM.
+     * @return SecureStorage::Error::Errc::Success on success,
+     * SecureStorage::Error::Errc::AuthenticationFailed if the tag does not match,
+     * Errc::FileReadFailed if the file is shorter than inputSize, Errc::BufferTooSmall if
+     * outputCapacity is too small, or another error code on failure.
+     */
+    Error::Errc decryptFromFile(
+        int fd,
+        int64_t offset,
+        size_t inputSize,
+        const unsigned char* key,
+        size_t keySize,
+        unsigned char* output,
+        size_t outputCapacity,
+        size_t& outputSize,
+        const unsigned char* aad,
+        size_t aadSize,
+        CipherAlgorithm algorithm = CipherAlgorithm::Aes256Gcm);
+
+    /**
+     * @brief Chooses the engine AES-256-GCM runs on.
+     *
+     * Messages the kernel backend cannot take (larger than its socket buffer allows), and
+     * calls it fails for any reason but a tag mismatch, run in software instead.
+     *
+     * @param backend The engine.
+     * @return SecureStorage::Error::Errc::Success on success, or Errc::OperationFailed if
+     * the kernel offers no gcm(aes) (the backend is then unchanged).
+     */
+    Error::Errc setCipherBackend(CipherBackendKind backend);
+
+    /**
+     * @brief Returns the engine AES-256-GCM runs on.
+     * @return The backend; CipherBackendKind::Software unless one was set or selected.
+     */
+    CipherBackendKind getCipherBackend() const;
+
+    /**
+     * @brief Whether the kernel crypto API offers gcm(aes) here.
+     * @return true if setCipherBackend(CipherBackendKind::Kernel) would succeed.
+     */
+    bool isKernelBackendAvailable();
+
+    /**
+     * @brief Times AES-256-GCM on every available backend and switches to the fastest.
+     *
+     * The kernel backend is only considered if it produces the same ciphertext and tag as
+     * mbedtls for a sample, and opens mbedtls' output. Software wins ties.
+     *
+     * @param sampleBytes Plaintext bytes per round.
+     * @return The backend now in use.
+     */
+    CipherBackendKind selectFastestBackend(size_t sampleBytes = CIPHER_BENCHMARK_SAMPLE_BYTES);
+
+    /**
+     * @brief Returns a printable name of a backend.
+     * @param backend The backend.
+     * @return "mbedtls" or "kernel crypto API".
+     */
+    static const char* backendName(CipherBackendKind backend);
+
+    /**
+     * @brief Returns a printable name of a cipher.
+     * @param algorithm The cipher.
+     * @return "AES-256-GCM" or "ChaCha20-Poly1305".
+     */
+    static const char* algorithmName(CipherAlgorithm algorithm);
+
+private:
+    // PImpl idiom to hide Mbed TLS context details
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
 };
 
 } // namespace Crypto
@@ -0,0 +1,400 @@
+#include "CipherBackend.h"
+#include "Logger.h"      // For SS_LOG_ macros
+#include "SecureWipe.h"  // For Utils::secureWipe
+#include "SecureArena.h" // For Utils::SecureBytes
+#include "ScratchPool.h" // For Utils::ScratchBuffer
+
+#ifdef __linux__
+#include <linux/if_alg.h> // For sockaddr_alg, af_alg_iv, ALG_*
+#include <sys/socket.h>
+#include <sys/uio.h>      // For iovec, vmsplice
+#include <fcntl.h>        // For splice, pipe2, SPLICE_F_*
+#include <unistd.h>       // For close, sysconf
+#include <cerrno>
+#include <cstring>        // For memcpy, strerror
+#include <memory>       // For std::shared_ptr
+#include <mutex>
+#endif
+
+namespace SecureStorage {
+namespace Crypto {
+
+#ifdef __linux__
+
+#ifndef SOL_ALG
+#define SOL_ALG 279
+#endif
+
+namespace {
+
+// Send buffer asked for on sockets that carry large messages. The kernel caps it at twice
+// net.core.wmem_max; messages that still do not fit are left to the software backend.
+constexpr int KERNEL_CIPHER_SNDBUF_REQUEST = 16 * 1024 * 1024;
+
+// Closes a descriptor when it goes out of scope.
+class ScopedFd {
+public:
+    explicit ScopedFd(int fd = -1) : m_fd(fd) {}
+    ~ScopedFd() {
+        if (m_fd >= 0) {
+            close(m_fd);
+        }
+    }
+    int get() const { return m_fd; }
+    int release() {
+        int fd = m_fd;
+        m_fd = -1;
+        return fd;
+    }
+    void reset(int fd) {
+        if (m_fd >= 0) {
+            close(m_fd);
+        }
+        m_fd = fd;
+    }
+
+private:
+    ScopedFd(const ScopedFd&) = delete;
+    ScopedFd& operator=(const ScopedFd&) = delete;
+
+    int m_fd;
+};
+
+// One piece of a message passed through the pipe: memory (data) or a file range (fd).
+struct SpliceSource {
+    const unsigned char* data;
+    int fd;
+    int64_t offset;
+    size_t size;
+};
+
+// Opens a gcm(aes) transform socket keyed with key, or returns -1.
+int openTransform(const unsigned char* key) {
+    ScopedFd tfm(socket(AF_ALG, SOCK_SEQPACKET | SOCK_CLOEXEC, 0));
+    if (tfm.get() < 0) {
+        return -1;
+    }
+    sockaddr_alg address;
+    std::memset(&address, 0, sizeof(address));
+    address.salg_family = AF_ALG;
+    std::strncpy(reinterpret_cast<char*>(address.salg_type), "aead", sizeof(address.salg_type) - 1);
+    std::strncpy(reinterpret_cast<char*>(address.salg_name), "gcm(aes)", sizeof(address.salg_name) - 1);
+    if (bind(tfm.get(), reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        setsockopt(tfm.get(), SOL_ALG, ALG_SET_KEY, key, AES_GCM_KEY_SIZE_BYTES) != 0 ||
+        setsockopt(tfm.get(), SOL_ALG, ALG_SET_AEAD_AUTHSIZE, nullptr, AES_GCM_TAG_SIZE_BYTES) != 0) {
+        return -1;
+    }
+    return tfm.release();
+}
+
+// Bytes of message an operation socket takes before send() would block: the kernel
+// wants a free page for every write.
+size_t messageLimit(int op) {
+    int sndbuf = 0;
+    socklen_t length = sizeof(sndbuf);
+    if (getsockopt(op, SOL_SOCKET, SO_SNDBUF, &sndbuf, &length) != 0 || sndbuf <= 0) {
+        return 0;
+    }
+    const long page_size = sysconf(_SC_PAGESIZE);
+    const size_t page = page_size > 0 ? static_cast<size_t>(page_size) : 4096;
+    const size_t usable = static_cast<size_t>(sndbuf) / page * page;
+    return usable > 2 * page ? usable - 2 * page : 0;
+}
+
+// Moves the sources into the operation socket through a pipe: vmsplice() maps memory into
+// the pipe, splice() moves file pages into it, and splice() hands the pipe pages on to
+// the cipher. Nothing is copied in user space. Never blocks on the socket.
+bool spliceToSocket(int op, const SpliceSource* sources, size_t count) {
+    int pipe_fds[2];
+    if (pipe2(pipe_fds, O_CLOEXEC) != 0) {
+        return false;
+    }
+    ScopedFd pipe_read(pipe_fds[0]), pipe_write(pipe_fds[1]);
+    for (size_t i = 0; i < count; ++i) {
+        const SpliceSource& source = sources[i];
+        size_t done = 0;
+        while (done < source.size) {
+            ssize_t queued;
+            if (source.data != nullptr) {
+                iovec chunk;
+                chunk.iov_base = const_cast<unsigned char*>(source.data + done);
+                chunk.iov_len = source.size - done;
+                queued = vmsplice(pipe_write.get(), &chunk, 1, 0);
+            } else {
+                loff_t offset = static_cast<loff_t>(source.offset + done);
+                queued = splice(source.fd, &offset, pipe_write.get(), nullptr, source.size - done, SPLICE_F_MORE);
+            }
+            if (queued < 0 && errno == EINTR) {
+                continue;
+            }
+            if (queued <= 0) {
+                return false; // A read error, or the file ended early
+            }
+            done += static_cast<size_t>(queued);
+            const bool last = i + 1 == count && done == source.size;
+            while (queued > 0) {
+                ssize_t moved = splice(pipe_read.get(), nullptr, op, nullptr, static_cast<size_t>(queued),
+                                       SPLICE_F_NONBLOCK | (last ? 0 : SPLICE_F_MORE));
+                if (moved < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (moved <= 0) {
+                    return false; // EAGAIN: the message outgrew the socket's buffer
+                }
+                queued -= moved;
+            }
+        }
+    }
+    return true;
+}
+
+class KernelCipherBackend : public CipherBackend {
+public:
+    KernelCipherBackend(int probeTfm, size_t defaultLimit, size_t raisedLimit)
+        : m_probeTfm(probeTfm), m_defaultLimit(defaultLimit), m_raisedLimit(raisedLimit) {}
+
+    ~KernelCipherBackend() override {
+        close(m_probeTfm);
+    }
+
+    CipherBackendKind kind() const override { return CipherBackendKind::Kernel; }
+
+    bool supports(CipherAlgorithm algorithm, size_t aadSize, size_t size) const override {
+        return algorithm == CipherAlgorithm::Aes256Gcm && aadSize + size + AES_GCM_TAG_SIZE_BYTES <= m_raisedLimit;
+    }
+
+    Error::Errc seal(CipherAlgorithm algorithm, const unsigned char* key, const unsigned char* iv,
+                     const unsigned char* aad, size_t aadSize, const unsigned char* input, size_t size,
+                     unsigned char* output, unsigned char* tag) override {
+        (void)algorithm;
+        // The pages of a vmsplice()d buffer are read by the cipher while it writes the
+        // output; when both are the same buffer, hand the kernel a copy instead.
+        const bool overlaps = size > 0 && input < output + size && output < input + size;
+        SpliceSource source = {input, -1, 0, size};
+        return run(true, key, iv, aad, aadSize, &source, size > 0 ? 1 : 0, size, !overlaps, output, tag);
+    }
+
+    Error::Errc open(CipherAlgorithm algorithm, const unsigned char* key, const unsigned char* iv,
+                     const unsigned char* aad, size_t aadSize, const unsigned char* input, size_t size,
+                     const unsigned char* tag, unsigned char* output) override {
+        (void)algorithm;
+        const bool overlaps = size > 0 && input < output + size && output < input + size;
+        SpliceSource sources[2] = {{input, -1, 0, size}, {tag, -1, 0, AES_GCM_TAG_SIZE_BYTES}};
+        return run(false, key, iv, aad, aadSize, size > 0 ? sources : sources + 1, size > 0 ? 2 : 1, size,
+                   !overlaps, output, nullptr);
+    }
+
+    Error::Errc openFile(CipherAlgorithm algorithm, const unsigned char* key, const unsigned char* iv,
+                         const unsigned char* aad, size_t aadSize, int fd, int64_t offset, size_t size,
+                         unsigned char* output) override {
+        SpliceSource source = {nullptr, fd, offset, size + AES_GCM_TAG_SIZE_BYTES};
+        Error::Errc err = run(false, key, iv, aad, aadSize, &source, 1, size, true, output, nullptr);
+        if (err != Error::Errc::Success && err != Error::Errc::AuthenticationFailed) {
+            // A short file or a refused socket; reading the file the ordinary way tells them apart.
+            return CipherBackend::openFile(algorithm, key, iv, aad, aadSize, fd, offset, size, output);
+        }
+        return err;
+    }
+
+private:
+    // A transform socket and the key it was set up with.
+    struct KeyedTransform {
+        ScopedFd fd;
+        Utils::SecureBytes key;
+    };
+
+    // Returns a transform socket keyed with key, or nullptr. The transform of the most
+    // recent key is kept for later calls, so the store's master key replaces the throwaway
+    // key of the startup benchmark once and is then set up no more. Keys are never changed
+    // on a socket; a replaced transform stays open while callers still hold it.
+    std::shared_ptr<KeyedTransform> transformFor(const unsigned char* key) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_transform) {
+                unsigned char difference = 0;
+                for (size_t i = 0; i < AES_GCM_KEY_SIZE_BYTES; ++i) {
+                    difference |= static_cast<unsigned char>(m_transform->key[i] ^ key[i]);
+                }
+                if (difference == 0) {
+                    return m_transform;
+                }
+            }
+        }
+        std::shared_ptr<KeyedTransform> fresh(new KeyedTransform());
+        fresh->fd.reset(openTransform(key));
+        if (fresh->fd.get() < 0) {
+            return nullptr;
+        }
+        fresh->key.assign(key, key + AES_GCM_KEY_SIZE_BYTES);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_transform = fresh;
+        return fresh;
+    }
+
+    // One AEAD request. The kernel takes [AAD][input] (plus the tag when decrypting) and
+    // returns [AAD][output] (plus the tag when encrypting).
+    Error::Errc run(bool encrypt, const unsigned char* key, const unsigned char* iv, const unsigned char* aad,
+                    size_t aadSize, const SpliceSource* sources, size_t count, size_t size, bool maySplice,
+                    unsigned char* output, unsigned char* tagOut) {
+        const std::shared_ptr<KeyedTransform> tfm = transformFor(key);
+        if (!tfm) {
+            SS_LOG_DEBUG("KernelCipherBackend: Failed to key gcm(aes): " << strerror(errno));
+            return Error::Errc::CryptoLibraryError;
+        }
+        ScopedFd op(accept4(tfm->fd.get(), nullptr, nullptr, SOCK_CLOEXEC));
+        if (op.get() < 0) {
+            return Error::Errc::CryptoLibraryError;
+        }
+        const size_t message_size = aadSize + size + AES_GCM_TAG_SIZE_BYTES;
+        if (message_size > m_defaultLimit) {
+            int request = KERNEL_CIPHER_SNDBUF_REQUEST;
+            setsockopt(op.get(), SOL_SOCKET, SO_SNDBUF, &request, sizeof(request));
+        }
+
+        // Control data: operation, IV and AAD length.
+        union {
+            char buffer[CMSG_SPACE(sizeof(uint32_t)) * 2 + CMSG_SPACE(sizeof(af_alg_iv) + AES_GCM_IV_SIZE_BYTES)];
+            cmsghdr align;
+        } control;
+        std::memset(&control, 0, sizeof(control));
+        msghdr message;
+        std::memset(&message, 0, sizeof(message));
+        message.msg_control = control.buffer;
+        message.msg_controllen = sizeof(control.buffer);
+
+        cmsghdr* header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_ALG;
+        header->cmsg_type = ALG_SET_OP;
+        header->cmsg_len = CMSG_LEN(sizeof(uint32_t));
+        const uint32_t operation = encrypt ? ALG_OP_ENCRYPT : ALG_OP_DECRYPT;
+        std::memcpy(CMSG_DATA(header), &operation, sizeof(operation));
+
+        header = CMSG_NXTHDR(&message, header);
+        header->cmsg_level = SOL_ALG;
+        header->cmsg_type = ALG_SET_IV;
+        header->cmsg_len = CMSG_LEN(sizeof(af_alg_iv) + AES_GCM_IV_SIZE_BYTES);
+        af_alg_iv* iv_data = reinterpret_cast<af_alg_iv*>(CMSG_DATA(header));
+        iv_data->ivlen = AES_GCM_IV_SIZE_BYTES;
+        std::memcpy(iv_data->iv, iv, AES_GCM_IV_SIZE_BYTES);
+
+        header = CMSG_NXTHDR(&message, header);
+        header->cmsg_level = SOL_ALG;
+        header->cmsg_type = ALG_SET_AEAD_ASSOCLEN;
+        header->cmsg_len = CMSG_LEN(sizeof(uint32_t));
+        const uint32_t assoc_length = static_cast<uint32_t>(aadSize);
+        std::memcpy(CMSG_DATA(header), &assoc_length, sizeof(assoc_length));
+
+        // Small messages are copied in with the control data; large ones and files follow
+        // through a pipe.
+        const bool from_file = count > 0 && sources[0].data == nullptr;
+        const bool splicing = from_file || (maySplice && size >= KERNEL_CIPHER_SPLICE_THRESHOLD);
+        iovec parts[3];
+        size_t part_count = 0;
+        size_t sent_size = 0;
+        if (aadSize > 0) {
+            parts[part_count].iov_base = const_cast<unsigned char*>(aad);
+            parts[part_count++].iov_len = aadSize;
+            sent_size += aadSize;
+        }
+        if (!splicing) {
+            for (size_t i = 0; i < count; ++i) {
+                parts[part_count].iov_base = const_cast<unsigned char*>(sources[i].data);
+                parts[part_count++].iov_len = sources[i].size;
+                sent_size += sources[i].size;
+            }
+        }
+        message.msg_iov = parts;
+        message.msg_iovlen = part_count;
+        ssize_t sent = sendmsg(op.get(), &message, MSG_DONTWAIT | (splicing ? MSG_MORE : 0));
+        if (sent < 0 || static_cast<size_t>(sent) != sent_size) {
+            SS_LOG_DEBUG("KernelCipherBackend: sendmsg failed: " << (sent < 0 ? strerror(errno) : "short write"));
+            return Error::Errc::CryptoLibraryError;
+        }
+        if (splicing && !spliceToSocket(op.get(), sources, count)) {
+            SS_LOG_DEBUG("KernelCipherBackend: splice failed: " << strerror(errno));
+            return Error::Errc::CryptoLibraryError;
+        }
+
+        // The kernel echoes the AAD in front of the result.
+        Utils::ScratchBuffer aad_scratch;
+        std::vector<unsigned char>& aad_echo = aad_scratch.get();
+        aad_echo.resize(aadSize);
+        iovec results[3];
+        size_t result_count = 0;
+        if (aadSize > 0) {
+            results[result_count].iov_base = aad_echo.data();
+            results[result_count++].iov_len = aadSize;
+        }
+        if (size > 0) {
+            results[result_count].iov_base = output;
+            results[result_count++].iov_len = size;
+        }
+        if (encrypt) {
+            results[result_count].iov_base = tagOut;
+            results[result_count++].iov_len = AES_GCM_TAG_SIZE_BYTES;
+        }
+        msghdr reply;
+        std::memset(&reply, 0, sizeof(reply));
+        reply.msg_iov = results;
+        reply.msg_iovlen = result_count;
+        ssize_t received;
+        do {
+            received = recvmsg(op.get(), &reply, 0);
+        } while (received < 0 && errno == EINTR);
+        const size_t expected = aadSize + size + (encrypt ? AES_GCM_TAG_SIZE_BYTES : 0);
+        if (received < 0 && errno == EBADMSG) {
+            Utils::secureWipe(output, size);
+            SS_LOG_WARN("AES-256-GCM authentication failed during decryption (tag mismatch or tampered data).");
+            return Error::Errc::AuthenticationFailed;
+        }
+        if (received < 0 || static_cast<size_t>(received) != expected) {
+            Utils::secureWipe(output, size);
+            SS_LOG_DEBUG("KernelCipherBackend: recvmsg failed: " << (received < 0 ? strerror(errno) : "short read"));
+            return Error::Errc::CryptoLibraryError;
+        }
+        return Error::Errc::Success;
+    }
+
+    const int m_probeTfm;      ///< Kept open so the gcm(aes) module stays loaded
+    std::shared_ptr<KeyedTransform> m_transform; ///< Of the most recent key; nullptr before the first call
+    std::mutex m_mutex;                          ///< Protects m_transform
+    const size_t m_defaultLimit; ///< Largest message an operation socket takes as accepted
+    const size_t m_raisedLimit;  ///< Largest message after asking for KERNEL_CIPHER_SNDBUF_REQUEST
+};
+
+} // namespace
+
+std::unique_ptr<CipherBackend> makeKernelCipherBackend() {
+    // Probe with a throwaway key: gcm(aes) must exist and take a 256-bit key, and the
+    // socket limits tell which messages can be sent without blocking.
+    const unsigned char probe_key[AES_GCM_KEY_SIZE_BYTES] = {0};
+    ScopedFd tfm(openTransform(probe_key));
+    if (tfm.get() < 0) {
+        SS_LOG_DEBUG("KernelCipherBackend: AF_ALG gcm(aes) unavailable: " << strerror(errno));
+        return nullptr;
+    }
+    ScopedFd op(accept4(tfm.get(), nullptr, nullptr, SOCK_CLOEXEC));
+    if (op.get() < 0) {
+        return nullptr;
+    }
+    const size_t default_limit = messageLimit(op.get());
+    int request = KERNEL_CIPHER_SNDBUF_REQUEST;
+    setsockopt(op.get(), SOL_SOCKET, SO_SNDBUF, &request, sizeof(request));
+    const size_t raised_limit = messageLimit(op.get());
+    if (raised_limit == 0) {
+        return nullptr;
+    }
+    SS_LOG_DEBUG("KernelCipherBackend: AF_ALG gcm(aes) available for messages up to " << raised_limit << " bytes.");
+    return std::unique_ptr<CipherBackend>(new KernelCipherBackend(tfm.release(), default_limit, raised_limit));
+}
+
+#else
+
+std::unique_ptr<CipherBackend> makeKernelCipherBackend() {
+    return nullptr;
+}
+
+#endif
+
+} // namespace Crypto
+} // namespace SecureStorage
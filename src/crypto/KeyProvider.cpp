@@ -1,23 +1,84 @@
 #include "KeyProvider.h"
 #include "Logger.h" // For SS_LOG_ERROR, SS_LOG_DEBUG (adjust to SS_LOG_*)
+#include "FileUtil.h" // For the key check file
 #include <mbedtls/hkdf.h>
 #include <mbedtls/md.h>      // For mbedtls_md_info_from_type
 #include <mbedtls/error.h>   // For mbedtls_strerror
 #include <memory>            // For std::unique_ptr
+#include <atomic>
+#include <cstdio>            // For snprintf
+
+#ifdef __linux__
+#include <linux/keyctl.h>    // For KEYCTL_*, KEY_SPEC_*
+#include <sys/syscall.h>     // For SYS_add_key, SYS_keyctl
+#include <unistd.h>          // For syscall
+#include <cerrno>            // For errno
+#include <cstring>           // For strerror
+#endif
 
 namespace SecureStorage {
 namespace Crypto {
 
+namespace {
+
+// Bytes of the keyed hash that name a cached key in the keyring.
+constexpr size_t KEY_CACHE_TAG_BYTES = 16;
+constexpr char KEY_CACHE_DESCRIPTION_PREFIX[] = "secure_storage:";
+// HMAC'd under a key to give its check value.
+constexpr char KEY_CHECK_CONSTANT[] = "SecureStorage-KeyCheck-V1";
+
+#ifdef __linux__
+// Possessor may view, read, search and set the timeout; nobody else gets anything.
+// Possessing the keyring is what grants access, so this narrows nothing for processes
+// that share the keyring, but a key with other permissions was not added by us.
+constexpr unsigned long KEY_CACHE_PERMISSIONS = 0x01000000 | 0x02000000 | 0x08000000 | 0x20000000;
+
+long keyringId(KeyCacheKeyring keyring) {
+    return keyring == KeyCacheKeyring::User ? KEY_SPEC_USER_KEYRING : KEY_SPEC_SESSION_KEYRING;
+}
+
+// A search or read that failed because the key is not (or no longer) there.
+bool isKeyMissing(int error) {
+    return error == ENOKEY || error == EKEYEXPIRED || error == EKEYREVOKED;
+}
+
+// Whether a key found under our description is one we added: a "user" key of this user
+// with exactly KEY_CACHE_PERMISSIONS. KEYCTL_DESCRIBE gives "type;uid;gid;perm;description".
+bool isOwnCachedKey(long key, const std::string& description) {
+    char buffer[256];
+    long length = syscall(SYS_keyctl, KEYCTL_DESCRIBE, key, buffer, sizeof(buffer));
+    if (length <= 0 || static_cast<size_t>(length) > sizeof(buffer)) {
+        return false;
+    }
+    std::string text(buffer, strnlen(buffer, static_cast<size_t>(length)));
+    char expected[64];
+    std::snprintf(expected, sizeof(expected), "user;%u;", static_cast<unsigned>(geteuid()));
+    if (text.compare(0, std::strlen(expected), expected) != 0) {
+        return false;
+    }
+    size_t gid_end = text.find(';', std::strlen(expected));
+    if (gid_end == std::string::npos) {
+        return false;
+    }
+    std::snprintf(expected, sizeof(expected), "%08lx;", KEY_CACHE_PERMISSIONS);
+    return text.compare(gid_end + 1, std::string::npos, expected + description) == 0;
+}
+#endif
+
+} // namespace
+
 // Definition of the PImpl class
 class KeyProvider::Impl {
 public:
-    // Mbed TLS contexts or other private members can go here if needed.
-    // For HKDF, mbedtls_hkdf itself doesn't require a persistent context object
-    // between calls if all parameters are passed each time.
-    // However, if we were using HMAC directly, we might store an mbedtls_md_context_t.
-    // For now, Impl is empty as mbedtls_hkdf is stateless given its inputs.
-    Impl() = default;
-    ~Impl() = default; // Ensure proper cleanup if contexts were added
+    // HKDF itself is stateless given its inputs; Impl only holds the keyring cache.
+    Impl() : hits(0), misses(0), unavailable(0), rejected(0) {}
+    ~Impl() = default;
+
+    KeyCacheOptions cacheOptions;
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> unavailable;
+    std::atomic<uint64_t> rejected;
 };
 
 KeyProvider::KeyProvider(std::string deviceSerialNumber, std::string salt, std::string info)
@@ -60,6 +121,213 @@ KeyProvider& KeyProvider::operator=(KeyProvider&& other) noexcept {
 
 
 Error::Errc KeyProvider::getEncryptionKey(std::vector<unsigned char>& outputKey, size_t keyLengthBytes) const {
+    outputKey.resize(keyLengthBytes);
+    Error::Errc err = obtainKey(outputKey.data(), keyLengthBytes);
+    if (err != Error::Errc::Success) {
+        outputKey.clear(); // obtainKey() already wiped any partial key
+    }
+    return err;
+}
+
+Error::Errc KeyProvider::getEncryptionKey(Utils::SecureBytes& outputKey, size_t keyLengthBytes) const {
+    outputKey.resize(keyLengthBytes);
+    Error::Errc err = obtainKey(outputKey.data(), keyLengthBytes);
+    if (err != Error::Errc::Success) {
+        outputKey.clear(); // obtainKey() already wiped any partial key
+    }
+    return err;
+}
+
+void KeyProvider::setKeyCache(const KeyCacheOptions& options) {
+    if (!m_impl) {
+        return;
+    }
+#ifndef __linux__
+    if (options.keyring != KeyCacheKeyring::None) {
+        SS_LOG_WARN("KeyProvider: Kernel keyring cache is only available on Linux; keys will be derived.");
+    }
+#endif
+    m_impl->cacheOptions = options;
+}
+
+KeyCacheStats KeyProvider::getKeyCacheStats() const {
+    KeyCacheStats stats;
+    if (m_impl) {
+        stats.hits = m_impl->hits.load();
+        stats.misses = m_impl->misses.load();
+        stats.unavailable = m_impl->unavailable.load();
+        stats.rejected = m_impl->rejected.load();
+    }
+    return stats;
+}
+
+bool KeyProvider::cacheDescription(size_t keyLengthBytes, std::string& description) const {
+    const mbedtls_md_info_t* md_info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    if (md_info == nullptr) {
+        return false;
+    }
+    // Keyed with the salt, so the description neither reveals the serial number nor lets
+    // another application guess which of its keys it is.
+    std::string message;
+    message.reserve(m_info.size() + m_deviceSerialNumber.size() + 24);
+    message.append(m_info).push_back('\0');
+    message.append(m_deviceSerialNumber).push_back('\0');
+    message.append(std::to_string(keyLengthBytes));
+
+    unsigned char digest[32];
+    int ret = mbedtls_md_hmac(md_info,
+                              reinterpret_cast<const unsigned char*>(m_salt.data()), m_salt.size(),
+                              reinterpret_cast<const unsigned char*>(message.data()), message.size(),
+                              digest);
+    Utils::secureWipe(reinterpret_cast<unsigned char*>(&message[0]), message.size());
+    if (ret != 0) {
+        return false;
+    }
+    description = KEY_CACHE_DESCRIPTION_PREFIX;
+    char hex[3];
+    for (size_t i = 0; i < KEY_CACHE_TAG_BYTES; ++i) {
+        std::snprintf(hex, sizeof(hex), "%02x", digest[i]);
+        description.append(hex, 2);
+    }
+    return true;
+}
+
+Error::Errc KeyProvider::removeCachedKey(size_t keyLengthBytes) const {
+    if (!m_impl || m_impl->cacheOptions.keyring == KeyCacheKeyring::None) {
+        return Error::Errc::OperationFailed;
+    }
+#ifdef __linux__
+    std::string description;
+    if (!cacheDescription(keyLengthBytes, description)) {
+        return Error::Errc::OperationFailed;
+    }
+    long key = syscall(SYS_keyctl, KEYCTL_SEARCH, keyringId(m_impl->cacheOptions.keyring),
+                       "user", description.c_str(), 0);
+    if (key < 0) {
+        return isKeyMissing(errno) ? Error::Errc::DataNotFound : Error::Errc::OperationFailed;
+    }
+    if (syscall(SYS_keyctl, KEYCTL_INVALIDATE, key) != 0) {
+        SS_LOG_WARN("KeyProvider: Failed to remove cached key: " << strerror(errno));
+        return Error::Errc::OperationFailed;
+    }
+    return Error::Errc::Success;
+#else
+    (void)keyLengthBytes;
+    return Error::Errc::OperationFailed;
+#endif
+}
+
+Error::Errc KeyProvider::obtainKey(unsigned char* outputKey, size_t keyLengthBytes) const {
+    if (!m_impl || m_impl->cacheOptions.keyring == KeyCacheKeyring::None ||
+        m_deviceSerialNumber.empty() || keyLengthBytes == 0) {
+        return deriveKey(outputKey, keyLengthBytes);
+    }
+#ifdef __linux__
+    std::string description;
+    if (!cacheDescription(keyLengthBytes, description)) {
+        ++m_impl->unavailable;
+        return deriveKey(outputKey, keyLengthBytes);
+    }
+    const long keyring = keyringId(m_impl->cacheOptions.keyring);
+
+    long key = syscall(SYS_keyctl, KEYCTL_SEARCH, keyring, "user", description.c_str(), 0);
+    if (key >= 0) {
+        bool own = isOwnCachedKey(key, description);
+        long length = own ? syscall(SYS_keyctl, KEYCTL_READ, key, outputKey, keyLengthBytes) : 0;
+        if (length < 0 && !isKeyMissing(errno)) {
+            ++m_impl->unavailable;
+            SS_LOG_DEBUG("KeyProvider: Failed to read cached key: " << strerror(errno));
+            return deriveKey(outputKey, keyLengthBytes);
+        }
+        if (length == static_cast<long>(keyLengthBytes) && matchesKeyCheck(outputKey, keyLengthBytes)) {
+            ++m_impl->hits;
+            SS_LOG_DEBUG("KeyProvider: Read " << keyLengthBytes << "-byte key from the kernel keyring.");
+            return Error::Errc::Success;
+        }
+        Utils::secureWipe(outputKey, keyLengthBytes);
+        if (length >= 0) {
+            // Planted by another process sharing the keyring, or stale; never use it. Our
+            // keys have no write permission, so add_key() below could not update it in place.
+            ++m_impl->rejected;
+            SS_LOG_WARN("KeyProvider: Ignoring a cached key that does not match this provider's key.");
+            syscall(SYS_keyctl, KEYCTL_UNLINK, key, keyring);
+        }
+    } else if (!isKeyMissing(errno)) {
+        ++m_impl->unavailable;
+        SS_LOG_DEBUG("KeyProvider: Kernel keyring unavailable: " << strerror(errno));
+        return deriveKey(outputKey, keyLengthBytes);
+    }
+
+    ++m_impl->misses;
+    Error::Errc err = deriveKey(outputKey, keyLengthBytes);
+    if (err != Error::Errc::Success) {
+        return err;
+    }
+    storeKeyCheck(outputKey, keyLengthBytes);
+    key = syscall(SYS_add_key, "user", description.c_str(), outputKey, keyLengthBytes, keyring);
+    if (key < 0) {
+        ++m_impl->unavailable;
+        SS_LOG_DEBUG("KeyProvider: Failed to cache key in the kernel keyring: " << strerror(errno));
+        return Error::Errc::Success;
+    }
+    if (syscall(SYS_keyctl, KEYCTL_SETPERM, key, KEY_CACHE_PERMISSIONS) != 0) {
+        // Leave no key behind with the kernel's default (broader) permissions.
+        syscall(SYS_keyctl, KEYCTL_INVALIDATE, key);
+        ++m_impl->unavailable;
+        SS_LOG_DEBUG("KeyProvider: Failed to restrict cached key: " << strerror(errno));
+        return Error::Errc::Success;
+    }
+    const long long timeout = m_impl->cacheOptions.timeout.count();
+    if (timeout > 0) {
+        syscall(SYS_keyctl, KEYCTL_SET_TIMEOUT, key, static_cast<unsigned long>(timeout));
+    }
+    return Error::Errc::Success;
+#else
+    return deriveKey(outputKey, keyLengthBytes);
+#endif
+}
+
+bool KeyProvider::keyCheckValue(const unsigned char* key, size_t keyLengthBytes, std::vector<unsigned char>& check) {
+    const mbedtls_md_info_t* md_info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    if (md_info == nullptr) {
+        return false;
+    }
+    check.resize(32);
+    return mbedtls_md_hmac(md_info, key, keyLengthBytes,
+                           reinterpret_cast<const unsigned char*>(KEY_CHECK_CONSTANT), sizeof(KEY_CHECK_CONSTANT) - 1,
+                           check.data()) == 0;
+}
+
+bool KeyProvider::matchesKeyCheck(const unsigned char* key, size_t keyLengthBytes) const {
+    if (m_impl->cacheOptions.checkFile.empty()) {
+        return true;
+    }
+    std::vector<unsigned char> stored;
+    std::vector<unsigned char> expected;
+    if (Utils::FileUtil::readFile(m_impl->cacheOptions.checkFile, stored) != Error::Errc::Success ||
+        !keyCheckValue(key, keyLengthBytes, expected) || stored.size() != expected.size()) {
+        return false;
+    }
+    unsigned char diff = 0;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        diff |= static_cast<unsigned char>(stored[i] ^ expected[i]);
+    }
+    return diff == 0;
+}
+
+void KeyProvider::storeKeyCheck(const unsigned char* key, size_t keyLengthBytes) const {
+    if (m_impl->cacheOptions.checkFile.empty() || matchesKeyCheck(key, keyLengthBytes)) {
+        return;
+    }
+    std::vector<unsigned char> check;
+    if (!keyCheckValue(key, keyLengthBytes, check) ||
+        Utils::FileUtil::atomicWriteFile(m_impl->cacheOptions.checkFile, check) != Error::Errc::Success) {
+        // The next cached read then fails the check and derives the key; slower, not wrong.
+        SS_LOG_WARN("KeyProvider: Failed to write the key check file '" << m_impl->cacheOptions.checkFile << "'.");
+    }
+}
+
+Error::Errc KeyProvider::deriveKey(unsigned char* outputKey, size_t keyLengthBytes) const {
     if (m_deviceSerialNumber.empty()) {
         SS_LOG_ERROR("Cannot derive key: Device serial number is empty.");
         return Error::Errc::InvalidArgument;
@@ -75,8 +343,6 @@ Error::Errc KeyProvider::getEncryptionKey(std::vector<unsigned char>& outputKey,
         return Error::Errc::CryptoLibraryError;
     }
 
-    outputKey.resize(keyLengthBytes);
-
     // IKM: Input Keying Material (device serial number)
     const unsigned char* ikm = reinterpret_cast<const unsigned char*>(m_deviceSerialNumber.data());
     size_t ikm_len = m_deviceSerialNumber.length();
@@ -98,14 +364,14 @@ Error::Errc KeyProvider::getEncryptionKey(std::vector<unsigned char>& outputKey,
         salt_ptr, salt_len,
         ikm, ikm_len,
         info_ptr, info_len,
-        outputKey.data(), keyLengthBytes
+        outputKey, keyLengthBytes
     );
 
     if (ret != 0) {
         char error_buf[100];
         mbedtls_strerror(ret, error_buf, sizeof(error_buf));
         SS_LOG_ERROR("Mbed TLS HKDF failed: " << error_buf << " (Code: " << ret << ")");
-        outputKey.clear(); // Ensure no partial key is exposed on failure
+        Utils::secureWipe(outputKey, keyLengthBytes); // Ensure no partial key is exposed on failure
         return Error::Errc::KeyDerivationFailed;
     }
 
@@ -2,10 +2,13 @@
 #define SS_KEY_PROVIDER_H
 
 #include "Error.h" // For SecureStorage::Error::Errc
+#include "SecureArena.h" // For Utils::SecureBytes
 #include <string>
 #include <vector>
 #include <cstddef> // For size_t
 #include <memory> // For std::unique_ptr
+#include <chrono>
+#include <cstdint> // For uint64_t
 
 // Forward declare Mbed TLS types to avoid including Mbed TLS headers in our public header
 // if they are only used in the .cpp. However, for key derivation, some contexts might be needed.
@@ -23,6 +26,43 @@ namespace Crypto {
 const std::string HKDF_SALT_DEFAULT = "DefaultSecureStorageAppSalt-V1"; // Example Salt
 const std::string HKDF_INFO_DEFAULT = "SecureStorage-AES-256-GCM-Key-V1"; // Example Info
 
+/**
+ * @enum KeyCacheKeyring
+ * @brief Which Linux kernel keyring caches derived keys between processes.
+ */
+enum class KeyCacheKeyring {
+    None,    ///< No cache: every getEncryptionKey() call derives the key
+    Session, ///< The session keyring: shared by the processes of one login session
+    User     ///< The user keyring: readable by all processes of the user, until it expires
+};
+
+/**
+ * @struct KeyCacheOptions
+ * @brief Settings of KeyProvider's kernel keyring cache.
+ */
+struct KeyCacheOptions {
+    KeyCacheKeyring keyring = KeyCacheKeyring::None;
+    /// The kernel drops a cached key this long after it was added; 0 keeps it until the
+    /// keyring goes away.
+    std::chrono::seconds timeout = std::chrono::seconds(3600);
+    /// File holding a check value of the key (an HMAC of a constant under it), written
+    /// when the key is derived. A cached key whose check value does not match is ignored
+    /// and the key derived instead. Empty: cached keys are only checked for their owner
+    /// and permissions.
+    std::string checkFile;
+};
+
+/**
+ * @struct KeyCacheStats
+ * @brief Counters of KeyProvider's kernel keyring cache.
+ */
+struct KeyCacheStats {
+    uint64_t hits = 0;        ///< Keys read from the keyring instead of derived
+    uint64_t misses = 0;      ///< Keys derived and then added to the keyring
+    uint64_t unavailable = 0; ///< Keyring calls that failed (no keyring support, seccomp, quota)
+    uint64_t rejected = 0;    ///< Cached keys ignored for their owner, permissions or check value
+};
+
 /**
  * @class KeyProvider
  * @brief Derives cryptographic keys using HKDF based on a device serial number.
@@ -63,7 +103,100 @@ public:
      */
     Error::Errc getEncryptionKey(std::vector<unsigned char>& outputKey, size_t keyLengthBytes) const;
 
+    /**
+     * @brief Derives an encryption key into locked, zeroize-on-free memory.
+     * @see getEncryptionKey(std::vector<unsigned char>&, size_t) const
+     *
+     * @param[out] outputKey A secure buffer to store the derived key. It will be resized appropriately.
+     * @param keyLengthBytes The desired length of the key in bytes (e.g., 32 for AES-256).
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc getEncryptionKey(Utils::SecureBytes& outputKey, size_t keyLengthBytes) const;
+
+    /**
+     * @brief Caches derived keys in a Linux kernel keyring.
+     *
+     * A cached key is read with a few keyctl() calls instead of being derived. It lives
+     * in kernel memory, which is never swapped. Any process that possesses the keyring
+     * can read it: for KeyCacheKeyring::User that is every process of the user, for
+     * KeyCacheKeyring::Session every process of the login session. The cache therefore
+     * does not protect the key from other processes of the user; use KeyCacheKeyring::None
+     * where that matters. Its description is a keyed hash of the salt, info, serial number
+     * and length, so it does not reveal the serial number.
+     *
+     * Since any such process can also plant a key under that description, a cached key is
+     * only used if it belongs to this user, carries exactly the permissions this class sets,
+     * and matches the check value in KeyCacheOptions::checkFile (if set); otherwise it is
+     * replaced by the derived key. Where no keyring is available (non-Linux, a seccomp
+     * filter, the key quota), keys are derived as without a cache.
+     *
+     * Not thread-safe with getEncryptionKey(); configure the provider before using it.
+     * @param options The keyring to use and the lifetime of cached keys.
+     */
+    void setKeyCache(const KeyCacheOptions& options);
+
+    /**
+     * @brief Removes this provider's cached key of a given length from the keyring, e.g.
+     * before the serial number of a device is retired.
+     * @param keyLengthBytes Length of the cached key.
+     * @return SecureStorage::Error::Errc::Success if a key was removed,
+     * Errc::DataNotFound if none was cached, or Errc::OperationFailed if no keyring is
+     * configured or available.
+     */
+    Error::Errc removeCachedKey(size_t keyLengthBytes) const;
+
+    /**
+     * @brief Returns the counters of the keyring cache.
+     * @return A snapshot of the counters; all zero if no keyring is configured.
+     */
+    KeyCacheStats getKeyCacheStats() const;
+
 private:
+    /**
+     * @brief Runs HKDF into caller memory; both getEncryptionKey() overloads use it.
+     * @param[out] outputKey Pointer to keyLengthBytes bytes; wiped on failure.
+     * @param keyLengthBytes The desired length of the key in bytes.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc deriveKey(unsigned char* outputKey, size_t keyLengthBytes) const;
+
+    /**
+     * @brief Reads the key from the keyring cache or derives (and caches) it.
+     * @param[out] outputKey Pointer to keyLengthBytes bytes; wiped on failure.
+     * @param keyLengthBytes The desired length of the key in bytes.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc obtainKey(unsigned char* outputKey, size_t keyLengthBytes) const;
+
+    /**
+     * @brief Builds the keyring description of the cached key of a given length.
+     * @param keyLengthBytes Length of the key.
+     * @param[out] description Receives the description.
+     * @return true on success, false if hashing failed.
+     */
+    bool cacheDescription(size_t keyLengthBytes, std::string& description) const;
+
+    /**
+     * @brief Computes the check value of a key: an HMAC-SHA256 of a constant under it.
+     * @param key Pointer to keyLengthBytes bytes of key.
+     * @param keyLengthBytes Length of the key.
+     * @param[out] check Receives the check value.
+     * @return true on success, false if hashing failed.
+     */
+    static bool keyCheckValue(const unsigned char* key, size_t keyLengthBytes, std::vector<unsigned char>& check);
+
+    /**
+     * @brief Tells whether a key matches the check value in the configured check file.
+     * @return true if no check file is configured or the check value matches.
+     */
+    bool matchesKeyCheck(const unsigned char* key, size_t keyLengthBytes) const;
+
+    /**
+     * @brief Writes the check value of a freshly derived key to the check file, if one is
+     * configured and does not already hold it.
+     */
+    void storeKeyCheck(const unsigned char* key, size_t keyLengthBytes) const;
+
     // Using PImpl pattern to hide Mbed TLS details and improve compilation times
     // and to manage Mbed TLS context lifetimes properly.
     class Impl;
@@ -0,0 +1,100 @@
+#include "DeferredSync.h"
+#include "DirFileUtil.h"
+#include "Logger.h" // For SS_LOG_ macros
+
+namespace SecureStorage {
+namespace Storage {
+
+DeferredSync::DeferredSync(Utils::DirFileUtil& directory, std::chrono::milliseconds interval)
+    : m_directory(directory),
+      m_interval(interval),
+      m_pending(false),
+      m_stopping(false),
+      m_flushes(0) {
+}
+
+DeferredSync::~DeferredSync() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    Error::Errc err = flush();
+    if (err != Error::Errc::Success) {
+        SS_LOG_ERROR("DeferredSync: Final flush failed with error " << static_cast<int>(err) << ".");
+    }
+}
+
+void DeferredSync::markPending() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_stopping) {
+        return; // The destructor's final flush covers it
+    }
+    if (!m_thread.joinable()) {
+        m_thread = std::thread(&DeferredSync::syncLoop, this);
+    }
+    if (!m_pending) {
+        m_pending = true;
+        m_cv.notify_one(); // Starts a new interval
+    }
+}
+
+Error::Errc DeferredSync::flush() {
+    std::lock_guard<std::mutex> flush_lock(m_flushMutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_pending) {
+            return Error::Errc::Success;
+        }
+        // Cleared before the flush: writes marked from now on are not necessarily covered
+        // by it and keep the flag set for the next round.
+        m_pending = false;
+    }
+    Error::Errc err = m_directory.syncFilesystem();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (err != Error::Errc::Success) {
+        m_pending = true;
+        return err;
+    }
+    m_flushes++;
+    return Error::Errc::Success;
+}
+
+void DeferredSync::setInterval(std::chrono::milliseconds interval) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_interval = interval;
+}
+
+uint64_t DeferredSync::flushCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_flushes;
+}
+
+void DeferredSync::syncLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping) {
+        m_cv.wait(lock, [this] { return m_stopping || m_pending; });
+        if (m_stopping) {
+            break;
+        }
+        // The interval starts with the first pending write; later ones ride along.
+        m_cv.wait_for(lock, m_interval, [this] { return m_stopping || !m_pending; });
+        if (m_stopping || !m_pending) {
+            continue; // Stopping (the destructor flushes) or flushed explicitly meanwhile
+        }
+        lock.unlock();
+        Error::Errc err = flush();
+        lock.lock();
+        if (err != Error::Errc::Success) {
+            SS_LOG_ERROR("DeferredSync: Periodic flush failed with error " << static_cast<int>(err) << ", retrying next interval.");
+            m_cv.wait_for(lock, m_interval, [this] { return m_stopping; });
+        }
+    }
+}
+
+} // namespace Storage
+} // namespace SecureStorage
@@ -0,0 +1,86 @@
+#ifndef SS_DEFERRED_SYNC_H
+#define SS_DEFERRED_SYNC_H
+
+#include "Error.h"
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint> // For uint64_t
+
+namespace SecureStorage {
+namespace Utils {
+class DirFileUtil; // Forward declare
+}
+namespace Storage {
+
+/**
+ * @class DeferredSync
+ * @brief Coalesces the flushes of Durability::Deferred writes into a periodic syncfs.
+ *
+ * Writers call markPending() after an unsynced write. A background thread, started on the
+ * first such call, flushes the filesystem once per interval while writes are pending, so
+ * any number of deferred writes within an interval cost one flush.
+ */
+class DeferredSync {
+public:
+    /**
+     * @param directory Directory whose filesystem is flushed. Must outlive this object.
+     * @param interval Longest time a deferred write stays unflushed.
+     */
+    DeferredSync(Utils::DirFileUtil& directory, std::chrono::milliseconds interval);
+
+    /**
+     * @brief Flushes pending writes and stops the background thread.
+     */
+    ~DeferredSync();
+
+    DeferredSync(const DeferredSync&) = delete;
+    DeferredSync& operator=(const DeferredSync&) = delete;
+    DeferredSync(DeferredSync&&) = delete;
+    DeferredSync& operator=(DeferredSync&&) = delete;
+
+    /**
+     * @brief Records that an unsynced write happened; it will be flushed within the interval.
+     */
+    void markPending();
+
+    /**
+     * @brief Flushes now if writes are pending.
+     * @return SecureStorage::Error::Errc::Success on success (or if nothing was pending),
+     * or an error code if the flush failed (the writes then stay pending).
+     */
+    Error::Errc flush();
+
+    /**
+     * @brief Changes the flush interval. Takes effect from the next flush.
+     * @param interval Longest time a deferred write stays unflushed.
+     */
+    void setInterval(std::chrono::milliseconds interval);
+
+    /**
+     * @brief Returns how many filesystem flushes have been issued.
+     * @return The number of flushes.
+     */
+    uint64_t flushCount() const;
+
+private:
+    void syncLoop();
+
+    Utils::DirFileUtil& m_directory;
+    std::chrono::milliseconds m_interval;
+
+    mutable std::mutex m_mutex;   ///< Protects everything below
+    std::condition_variable m_cv; ///< Wakes the sync thread
+    bool m_pending;
+    bool m_stopping;
+    uint64_t m_flushes;
+    std::thread m_thread;         ///< Started by the first markPending()
+
+    std::mutex m_flushMutex;      ///< Allows one flush at a time
+};
+
+} // namespace Storage
+} // namespace SecureStorage
+
+#endif // SS_DEFERRED_SYNC_H
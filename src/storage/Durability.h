@@ -0,0 +1,40 @@
+#ifndef SS_DURABILITY_H
+#define SS_DURABILITY_H
+
+namespace SecureStorage {
+namespace Storage {
+
+/**
+ * @enum Durability
+ * @brief What a successful SecureStore::storeData() guarantees if the process or the
+ * machine goes down afterwards.
+ *
+ * Every level is safe against a crash of the process alone: the record is in the page
+ * cache and the kernel writes it back. The levels differ in what survives a power cut
+ * or kernel crash. Ordered from cheapest to strongest at call time:
+ */
+enum class Durability {
+    /// No flushes. After a power cut the id may hold the previous version, or its main file
+    /// may be empty or torn; reads then fall back to the backup file, which is only as
+    /// durable as the write that produced it. For caches that can be rebuilt.
+    None,
+
+    /// Like None when storeData() returns, but the store flushes the whole filesystem
+    /// (syncfs) once per deferred-sync interval when deferred writes are pending, so a
+    /// power cut loses at most that interval. Many writes share a single flush.
+    Deferred,
+
+    /// The record is flushed with fdatasync before it is renamed into place, but the
+    /// directory is not. After a power cut the id holds the new or the previous version,
+    /// never a torn record; the write itself may be lost.
+    DataSync,
+
+    /// The record is flushed with fsync and the directory afterwards. Once storeData()
+    /// returns, the new version survives a power cut. The default.
+    Full
+};
+
+} // namespace Storage
+} // namespace SecureStorage
+
+#endif // SS_DURABILITY_H
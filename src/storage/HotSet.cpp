@@ -0,0 +1,138 @@
+#include "HotSet.h"
+#include "DirFileUtil.h"
+#include "Logger.h" // For SS_LOG_ macros
+
+#include <algorithm> // For std::sort
+#include <cstdlib>   // For std::strtoul
+#include <sstream>
+
+namespace SecureStorage {
+namespace Storage {
+
+namespace {
+
+// First line of the file; the rest is one "<count> <id>" line per id, hottest first.
+const std::string HOT_SET_HEADER = "securestore-hotset 1";
+
+} // namespace
+
+HotSetTracker::HotSetTracker(size_t capacity)
+    : m_capacity(capacity), m_dirty(false) {}
+
+void HotSetTracker::recordAccess(const std::string& data_id) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint32_t& count = m_counts[data_id];
+    if (count < UINT32_MAX) {
+        count++;
+    }
+    m_dirty = true;
+    if (m_counts.size() > 4 * m_capacity) {
+        decayLocked();
+    }
+}
+
+void HotSetTracker::forget(const std::string& data_id) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_counts.erase(data_id) > 0) {
+        m_dirty = true;
+    }
+}
+
+std::vector<std::string> HotSetTracker::hottest(size_t limit) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<std::pair<std::string, uint32_t>> ranked = hottestLocked(limit);
+    std::vector<std::string> ids;
+    ids.reserve(ranked.size());
+    for (const auto& entry : ranked) {
+        ids.push_back(entry.first);
+    }
+    return ids;
+}
+
+Error::Errc HotSetTracker::load(const Utils::DirFileUtil& directory) {
+    if (!directory.pathExists(HOT_SET_FILE_NAME)) {
+        return Error::Errc::Success;
+    }
+    std::vector<unsigned char> content;
+    Error::Errc err = directory.readFile(HOT_SET_FILE_NAME, content);
+    if (err != Error::Errc::Success) {
+        SS_LOG_WARN("HotSetTracker: Failed to read '" << HOT_SET_FILE_NAME << "'. Error: " << static_cast<int>(err));
+        return err;
+    }
+    std::istringstream in(std::string(content.begin(), content.end()));
+    std::string line;
+    if (!std::getline(in, line) || line != HOT_SET_HEADER) {
+        SS_LOG_WARN("HotSetTracker: Ignoring '" << HOT_SET_FILE_NAME << "' with an unknown format.");
+        return Error::Errc::Success;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t loaded = 0;
+    while (std::getline(in, line) && loaded < m_capacity) {
+        size_t space = line.find(' ');
+        if (space == std::string::npos || space + 1 >= line.size()) {
+            continue;
+        }
+        uint32_t saved = static_cast<uint32_t>(std::strtoul(line.c_str(), nullptr, 10));
+        if (saved == 0) {
+            continue;
+        }
+        uint32_t count = std::max<uint32_t>(saved / 2, 1); // Decay per restart
+        uint32_t& current = m_counts[line.substr(space + 1)];
+        current = std::max(current, count);
+        loaded++;
+    }
+    SS_LOG_DEBUG("HotSetTracker: Loaded " << loaded << " ids from '" << HOT_SET_FILE_NAME << "'.");
+    return Error::Errc::Success;
+}
+
+Error::Errc HotSetTracker::save(Utils::DirFileUtil& directory) {
+    std::string text;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_dirty) {
+            return Error::Errc::Success;
+        }
+        std::ostringstream out;
+        out << HOT_SET_HEADER << '\n';
+        for (const auto& entry : hottestLocked(m_capacity)) {
+            if (entry.first.find('\n') == std::string::npos) {
+                out << entry.second << ' ' << entry.first << '\n';
+            }
+        }
+        text = out.str();
+        m_dirty = false;
+    }
+    // Only a hint for the next start, so the directory is not synced.
+    Error::Errc err = directory.atomicWriteFile(HOT_SET_FILE_NAME, std::vector<unsigned char>(text.begin(), text.end()), false);
+    if (err != Error::Errc::Success) {
+        SS_LOG_WARN("HotSetTracker: Failed to save '" << HOT_SET_FILE_NAME << "'. Error: " << static_cast<int>(err));
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_dirty = true;
+    }
+    return err;
+}
+
+void HotSetTracker::decayLocked() {
+    std::vector<std::pair<std::string, uint32_t>> kept = hottestLocked(2 * m_capacity);
+    m_counts.clear();
+    for (const auto& entry : kept) {
+        m_counts[entry.first] = std::max<uint32_t>(entry.second / 2, 1);
+    }
+}
+
+std::vector<std::pair<std::string, uint32_t>> HotSetTracker::hottestLocked(size_t limit) const {
+    std::vector<std::pair<std::string, uint32_t>> ranked(m_counts.begin(), m_counts.end());
+    auto hotter = [](const std::pair<std::string, uint32_t>& a, const std::pair<std::string, uint32_t>& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    };
+    if (ranked.size() > limit) {
+        std::partial_sort(ranked.begin(), ranked.begin() + limit, ranked.end(), hotter);
+        ranked.resize(limit);
+    } else {
+        std::sort(ranked.begin(), ranked.end(), hotter);
+    }
+    return ranked;
+}
+
+} // namespace Storage
+} // namespace SecureStorage
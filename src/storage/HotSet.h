@@ -0,0 +1,88 @@
+#ifndef SS_HOT_SET_H
+#define SS_HOT_SET_H
+
+#include "Error.h"
+#include <string>
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+#include <cstddef> // For size_t
+#include <cstdint> // For uint32_t
+
+namespace SecureStorage {
+namespace Utils {
+class DirFileUtil; // Forward declare
+}
+namespace Storage {
+
+// Where a store keeps its hot set, inside the storage root.
+const std::string HOT_SET_FILE_NAME = ".securestore.hotset";
+constexpr size_t HOT_SET_DEFAULT_CAPACITY = 256;
+
+/**
+ * @class HotSetTracker
+ * @brief Learns which ids are read most often, and remembers them across restarts.
+ *
+ * Every successful read counts one access. When the table grows past four times the
+ * capacity, only the hottest twice-capacity ids are kept and their counts are halved;
+ * counts are also halved each time the set is loaded. The hot set therefore follows
+ * recent use rather than all-time totals. save() persists the `capacity` hottest
+ * ids with their counts; ids only, never data. Thread-safe.
+ */
+class HotSetTracker {
+public:
+    /**
+     * @brief Creates an empty tracker.
+     * @param capacity Number of ids kept when the set is saved.
+     */
+    explicit HotSetTracker(size_t capacity = HOT_SET_DEFAULT_CAPACITY);
+
+    /**
+     * @brief Counts one read of an id.
+     * @param data_id The data identifier.
+     */
+    void recordAccess(const std::string& data_id);
+
+    /**
+     * @brief Forgets an id, e.g. because it was deleted.
+     * @param data_id The data identifier.
+     */
+    void forget(const std::string& data_id);
+
+    /**
+     * @brief Returns the most accessed ids, hottest first.
+     * @param limit Maximum number of ids to return.
+     * @return The ids.
+     */
+    std::vector<std::string> hottest(size_t limit) const;
+
+    /**
+     * @brief Merges the saved set from HOT_SET_FILE_NAME into the counts (halved).
+     * @param directory The storage root.
+     * @return SecureStorage::Error::Errc::Success on success (also if no set was saved yet),
+     * or an error code if the file exists but cannot be read.
+     */
+    Error::Errc load(const Utils::DirFileUtil& directory);
+
+    /**
+     * @brief Writes the hottest ids to HOT_SET_FILE_NAME if anything was recorded since
+     * the last load or save.
+     * @param directory The storage root.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc save(Utils::DirFileUtil& directory);
+
+private:
+    void decayLocked(); // Caller holds m_mutex
+    std::vector<std::pair<std::string, uint32_t>> hottestLocked(size_t limit) const; // Caller holds m_mutex
+
+    const size_t m_capacity;
+    mutable std::mutex m_mutex; ///< Protects everything below
+    std::unordered_map<std::string, uint32_t> m_counts;
+    bool m_dirty;
+};
+
+} // namespace Storage
+} // namespace SecureStorage
+
+#endif // SS_HOT_SET_H
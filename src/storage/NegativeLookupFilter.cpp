@@ -0,0 +1,140 @@
+#include "NegativeLookupFilter.h"
+#include "FileLock.h" // For the stable FNV-1a key hash
+
+#include <algorithm> // For std::max, std::min
+#include <bitset>    // For counting set bits
+#include <cmath>
+
+namespace SecureStorage {
+namespace Storage {
+
+namespace {
+
+// Smallest capacity a filter is sized for; 1024 ids cost about 1.2 KiB at 1 %.
+constexpr size_t MIN_CAPACITY = 1024;
+
+// Second, independent hash for double hashing (splitmix64 finalizer of the first).
+uint64_t mixHash(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h | 1; // Odd, so the probe sequence never collapses onto one bit
+}
+
+} // namespace
+
+NegativeLookupFilter::NegativeLookupFilter(double targetFalsePositiveRate)
+    : m_targetFalsePositiveRate(std::min(std::max(targetFalsePositiveRate, 1e-6), 0.5)),
+      m_bitCount(0),
+      m_hashCount(1),
+      m_capacity(0),
+      m_ids(0),
+      m_staleIds(0),
+      m_rebuilds(0),
+      m_lookups(0),
+      m_definitelyAbsent(0),
+      m_falsePositives(0) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    resize(MIN_CAPACITY);
+}
+
+void NegativeLookupFilter::resize(size_t capacity) {
+    // Optimal Bloom filter geometry: m/n = -ln(p) / ln(2)^2 bits per id, k = (m/n) ln(2) hashes.
+    const double ln2 = std::log(2.0);
+    double bits_per_id = -std::log(m_targetFalsePositiveRate) / (ln2 * ln2);
+    m_capacity = capacity;
+    m_bitCount = (static_cast<size_t>(std::ceil(bits_per_id * static_cast<double>(capacity))) + 63) / 64 * 64;
+    m_hashCount = std::max(1u, static_cast<unsigned>(std::lround(bits_per_id * ln2)));
+    m_bits.assign(m_bitCount / 64, 0);
+    m_ids = 0;
+    m_staleIds = 0;
+}
+
+void NegativeLookupFilter::setBits(uint64_t h1, uint64_t h2) {
+    for (unsigned i = 0; i < m_hashCount; ++i) {
+        uint64_t bit = (h1 + i * h2) % m_bitCount;
+        m_bits[bit / 64] |= 1ULL << (bit % 64);
+    }
+}
+
+void NegativeLookupFilter::rebuild(const std::unordered_set<std::string>& ids) {
+    // Hash outside the lock; lookups keep using the old bits meanwhile.
+    std::vector<uint64_t> hashes;
+    hashes.reserve(ids.size());
+    for (const std::string& id : ids) {
+        hashes.push_back(Utils::FileLock::hashKey(id));
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    resize(std::max(MIN_CAPACITY, 2 * ids.size()));
+    for (uint64_t h1 : hashes) {
+        setBits(h1, mixHash(h1));
+    }
+    m_ids = ids.size();
+    m_rebuilds++;
+}
+
+void NegativeLookupFilter::add(const std::string& id) {
+    uint64_t h1 = Utils::FileLock::hashKey(id);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    setBits(h1, mixHash(h1));
+    m_ids++;
+}
+
+void NegativeLookupFilter::remove() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_staleIds++;
+}
+
+bool NegativeLookupFilter::needsRebuild() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_ids > m_capacity || m_staleIds >= m_capacity / 2;
+}
+
+bool NegativeLookupFilter::mightContain(const std::string& id) const {
+    uint64_t h1 = Utils::FileLock::hashKey(id);
+    uint64_t h2 = mixHash(h1);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lookups++;
+    for (unsigned i = 0; i < m_hashCount; ++i) {
+        uint64_t bit = (h1 + i * h2) % m_bitCount;
+        if ((m_bits[bit / 64] & (1ULL << (bit % 64))) == 0) {
+            m_definitelyAbsent++;
+            return false;
+        }
+    }
+    return true;
+}
+
+void NegativeLookupFilter::recordFalsePositive() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_falsePositives++;
+}
+
+NegativeLookupStats NegativeLookupFilter::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    NegativeLookupStats stats;
+    stats.enabled = true;
+    stats.capacity = m_capacity;
+    stats.bitCount = m_bitCount;
+    stats.hashCount = m_hashCount;
+    stats.ids = m_ids;
+    stats.staleIds = m_staleIds;
+    stats.rebuilds = m_rebuilds;
+    stats.lookups = m_lookups;
+    stats.definitelyAbsent = m_definitelyAbsent;
+    stats.falsePositives = m_falsePositives;
+    size_t set_bits = 0;
+    for (uint64_t word : m_bits) {
+        set_bits += std::bitset<64>(word).count();
+    }
+    stats.estimatedFalsePositiveRate =
+        std::pow(static_cast<double>(set_bits) / static_cast<double>(m_bitCount), static_cast<double>(m_hashCount));
+    uint64_t absent = m_falsePositives + m_definitelyAbsent;
+    stats.observedFalsePositiveRate = absent == 0 ? 0.0 : static_cast<double>(m_falsePositives) / absent;
+    return stats;
+}
+
+} // namespace Storage
+} // namespace SecureStorage
@@ -0,0 +1,125 @@
+#ifndef SS_NEGATIVE_LOOKUP_FILTER_H
+#define SS_NEGATIVE_LOOKUP_FILTER_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <unordered_set>
+#include <cstddef> // For size_t
+#include <cstdint> // For uint64_t
+
+namespace SecureStorage {
+namespace Storage {
+
+constexpr double NEGATIVE_LOOKUP_DEFAULT_FALSE_POSITIVE_RATE = 0.01;
+
+/**
+ * @struct NegativeLookupStats
+ * @brief Size and effectiveness of a NegativeLookupFilter.
+ *
+ * Of the lookups for ids that turned out not to exist, the filter answered
+ * definitelyAbsent itself and let falsePositives through to the disk; the observed
+ * false-positive rate is falsePositives / (falsePositives + definitelyAbsent).
+ */
+struct NegativeLookupStats {
+    bool enabled = false;
+    size_t capacity = 0;              ///< Ids the filter is sized for before it is rebuilt larger
+    size_t bitCount = 0;
+    unsigned hashCount = 0;
+    size_t ids = 0;                   ///< Ids added since the last rebuild
+    size_t staleIds = 0;              ///< Ids deleted since the last rebuild; they still match
+    uint64_t rebuilds = 0;
+    uint64_t lookups = 0;
+    uint64_t definitelyAbsent = 0;    ///< Lookups answered without touching the disk
+    uint64_t falsePositives = 0;      ///< Lookups let through for ids that did not exist
+    double estimatedFalsePositiveRate = 0.0; ///< From the share of bits set: fill^hashCount
+    double observedFalsePositiveRate = 0.0;  ///< falsePositives / (falsePositives + definitelyAbsent)
+};
+
+/**
+ * @class NegativeLookupFilter
+ * @brief Bloom filter over the ids of a store, so lookups of missing ids skip the disk.
+ *
+ * mightContain() never returns false for an id that was added, so a false answer proves
+ * the id absent. Ids cannot be removed from a Bloom filter; remove() only counts them,
+ * and once they (or the added ids) outgrow the sizing, needsRebuild() asks the owner to
+ * rebuild() from its current id set. Thread-safe.
+ */
+class NegativeLookupFilter {
+public:
+    /**
+     * @brief Creates a filter that rejects every id until rebuild() or add() is called.
+     * @param targetFalsePositiveRate False-positive rate at full capacity; sets the bits per id.
+     */
+    explicit NegativeLookupFilter(double targetFalsePositiveRate = NEGATIVE_LOOKUP_DEFAULT_FALSE_POSITIVE_RATE);
+
+    NegativeLookupFilter(const NegativeLookupFilter&) = delete;
+    NegativeLookupFilter& operator=(const NegativeLookupFilter&) = delete;
+    NegativeLookupFilter(NegativeLookupFilter&&) = delete;
+    NegativeLookupFilter& operator=(NegativeLookupFilter&&) = delete;
+
+    /**
+     * @brief Replaces the content with exactly the given ids, sized for twice as many.
+     * @param ids The ids that exist.
+     */
+    void rebuild(const std::unordered_set<std::string>& ids);
+
+    /**
+     * @brief Adds an id.
+     * @param id The id.
+     */
+    void add(const std::string& id);
+
+    /**
+     * @brief Notes that an id was deleted. It keeps matching until the next rebuild().
+     */
+    void remove();
+
+    /**
+     * @brief Tells whether the filter has outgrown its sizing: more ids than its capacity,
+     * or stale ids making up half of it.
+     * @return true if the owner should call rebuild().
+     */
+    bool needsRebuild() const;
+
+    /**
+     * @brief Tests an id and counts the lookup.
+     * @param id The id.
+     * @return false if the id was definitely never added, true if it may have been.
+     */
+    bool mightContain(const std::string& id) const;
+
+    /**
+     * @brief Counts a lookup that mightContain() let through but that found nothing.
+     */
+    void recordFalsePositive();
+
+    /**
+     * @brief Returns size and effectiveness counters.
+     * @return A snapshot of the counters.
+     */
+    NegativeLookupStats getStats() const;
+
+private:
+    void resize(size_t capacity);                    // Caller holds m_mutex
+    void setBits(uint64_t h1, uint64_t h2);          // Caller holds m_mutex
+
+    const double m_targetFalsePositiveRate;
+
+    mutable std::mutex m_mutex; ///< Protects everything below
+    std::vector<uint64_t> m_bits;
+    size_t m_bitCount;
+    unsigned m_hashCount;
+    size_t m_capacity;
+    size_t m_ids;
+    size_t m_staleIds;
+    uint64_t m_rebuilds;
+    mutable uint64_t m_lookups;
+    mutable uint64_t m_definitelyAbsent;
+    uint64_t m_falsePositives;
+};
+
+} // namespace Storage
+} // namespace SecureStorage
+
+#endif // SS_NEGATIVE_LOOKUP_FILTER_H
@@ -0,0 +1,128 @@
+#include "PlaintextCache.h"
+#include "SecureWipe.h"
+
+#include <cstring>  // For memcpy
+#include <iterator> // For std::prev
+
+namespace SecureStorage {
+namespace Storage {
+
+PlaintextCache::PlaintextCache(size_t maxBytes)
+    : m_maxBytes(maxBytes), m_bytes(0) {}
+
+PlaintextCache::~PlaintextCache() {
+    for (Entry& entry : m_lru) {
+        Utils::secureWipe(entry.data);
+    }
+}
+
+bool PlaintextCache::lookup(const std::string& data_id, const Utils::FileIdentity& current,
+                            std::vector<unsigned char>& out_plain_data) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    EntryList::iterator it = findLocked(data_id, current);
+    if (it == m_lru.end()) {
+        return false;
+    }
+    out_plain_data.assign(it->data.begin(), it->data.end());
+    return true;
+}
+
+bool PlaintextCache::lookup(const std::string& data_id, const Utils::FileIdentity& current,
+                            unsigned char* out, size_t capacity, size_t& out_size) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    EntryList::iterator it = findLocked(data_id, current);
+    if (it == m_lru.end()) {
+        return false;
+    }
+    out_size = it->data.size();
+    if (out_size <= capacity && out_size > 0) {
+        std::memcpy(out, it->data.data(), out_size);
+    }
+    return true;
+}
+
+bool PlaintextCache::contains(const std::string& data_id) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_index.find(data_id) != m_index.end();
+}
+
+void PlaintextCache::insert(const std::string& data_id, const Utils::FileIdentity& identity,
+                            const std::vector<unsigned char>& plain_data, bool prefetched) {
+    insert(data_id, identity, plain_data.data(), plain_data.size(), prefetched);
+}
+
+void PlaintextCache::insert(const std::string& data_id, const Utils::FileIdentity& identity,
+                            const unsigned char* plain_data, size_t size, bool prefetched) {
+    if (identity.inode == 0 || size > m_maxBytes) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto found = m_index.find(data_id);
+    if (found != m_index.end()) {
+        eraseLocked(found->second);
+    }
+    while (!m_lru.empty() && m_bytes + size > m_maxBytes) {
+        m_stats.evictions++;
+        eraseLocked(std::prev(m_lru.end()));
+    }
+    Entry entry;
+    entry.dataId = data_id;
+    entry.identity = identity;
+    entry.data.assign(plain_data, plain_data + size);
+    entry.prefetched = prefetched;
+    m_lru.push_front(std::move(entry));
+    m_index[data_id] = m_lru.begin();
+    m_bytes += size;
+    if (prefetched) {
+        m_stats.prefetchedEntries++;
+    }
+}
+
+void PlaintextCache::invalidate(const std::string& data_id) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto found = m_index.find(data_id);
+    if (found != m_index.end()) {
+        eraseLocked(found->second);
+    }
+}
+
+PlaintextCacheStats PlaintextCache::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    PlaintextCacheStats stats = m_stats;
+    stats.entries = m_index.size();
+    stats.bytes = m_bytes;
+    return stats;
+}
+
+PlaintextCache::EntryList::iterator PlaintextCache::findLocked(const std::string& data_id,
+                                                              const Utils::FileIdentity& current) {
+    auto found = m_index.find(data_id);
+    if (found == m_index.end()) {
+        m_stats.misses++;
+        return m_lru.end();
+    }
+    EntryList::iterator it = found->second;
+    if (it->identity != current) {
+        m_stats.staleDrops++;
+        m_stats.misses++;
+        eraseLocked(it);
+        return m_lru.end();
+    }
+    if (it->prefetched) {
+        m_stats.prefetchHits++;
+        it->prefetched = false;
+    }
+    m_lru.splice(m_lru.begin(), m_lru, it);
+    m_stats.hits++;
+    return it;
+}
+
+void PlaintextCache::eraseLocked(EntryList::iterator it) {
+    m_bytes -= it->data.size();
+    Utils::secureWipe(it->data);
+    m_index.erase(it->dataId);
+    m_lru.erase(it);
+}
+
+} // namespace Storage
+} // namespace SecureStorage
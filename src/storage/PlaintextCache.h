@@ -0,0 +1,167 @@
+#ifndef SS_PLAINTEXT_CACHE_H
+#define SS_PLAINTEXT_CACHE_H
+
+#include "DirFileUtil.h" // For Utils::FileIdentity
+#include "SecureArena.h" // For Utils::SecureBytes
+#include <string>
+#include <vector>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <cstddef> // For size_t
+#include <cstdint> // For uint64_t
+#include <chrono>
+
+namespace SecureStorage {
+namespace Storage {
+
+constexpr size_t PLAINTEXT_CACHE_DEFAULT_MAX_BYTES = 4 * 1024 * 1024;
+
+/**
+ * @struct PlaintextCacheStats
+ * @brief Counters for a PlaintextCache.
+ *
+ * The prefetch hit rate is prefetchHits / prefetchedEntries: the share of prefetched
+ * records that were read at least once before being evicted or replaced.
+ */
+struct PlaintextCacheStats {
+    uint64_t hits = 0;              ///< Lookups served from memory
+    uint64_t misses = 0;            ///< Lookups with no entry
+    uint64_t staleDrops = 0;        ///< Entries dropped because the file changed under them
+    uint64_t evictions = 0;         ///< Entries evicted to stay within the byte budget
+    uint64_t prefetchedEntries = 0; ///< Entries inserted by prefetch
+    uint64_t prefetchHits = 0;      ///< Prefetched entries that served at least one lookup
+    size_t entries = 0;             ///< Entries currently cached
+    size_t bytes = 0;               ///< Plaintext bytes currently cached
+};
+
+/**
+ * @struct PrefetchReport
+ * @brief What a SecureStore::prefetch() call did.
+ */
+struct PrefetchReport {
+    size_t requested = 0;       ///< Distinct valid ids asked for
+    size_t loaded = 0;          ///< Records read, decrypted and cached
+    size_t alreadyCached = 0;   ///< Ids skipped because the cache already held them
+    size_t notFound = 0;        ///< Ids without a main file
+    size_t failed = 0;          ///< Invalid ids, and records that failed to read or decrypt
+    unsigned workerThreads = 0; ///< Threads that read and decrypted in parallel
+    std::chrono::microseconds elapsed = std::chrono::microseconds(0); ///< Wall time of the call
+};
+
+/**
+ * @class PlaintextCache
+ * @brief In-process LRU cache of decrypted records, bounded by total plaintext size.
+ *
+ * Each entry remembers the identity (inode, size, change time) of the file it was
+ * decrypted from. A lookup is only a hit if the main file still has that identity, so a
+ * record replaced by another process costs a miss rather than a stale read. Checking
+ * costs one fstatat(); the open, read and decrypt are saved.
+ *
+ * Evicted, replaced and invalidated plaintext is wiped. Entries are held in the secure
+ * arena, so they are not swapped out while the arena has room (see Utils::SecureArena).
+ * Thread-safe.
+ */
+class PlaintextCache {
+public:
+    /**
+     * @brief Creates an empty cache.
+     * @param maxBytes Budget for the cached plaintext; larger records are never cached.
+     */
+    explicit PlaintextCache(size_t maxBytes = PLAINTEXT_CACHE_DEFAULT_MAX_BYTES);
+
+    /**
+     * @brief Wipes all cached plaintext.
+     */
+    ~PlaintextCache();
+
+    PlaintextCache(const PlaintextCache&) = delete;
+    PlaintextCache& operator=(const PlaintextCache&) = delete;
+    PlaintextCache(PlaintextCache&&) = delete;
+    PlaintextCache& operator=(PlaintextCache&&) = delete;
+
+    /**
+     * @brief Looks up a record.
+     * @param data_id The data identifier.
+     * @param current Identity of the main file now; a different cached identity is dropped.
+     * @param[out] out_plain_data Receives a copy of the plaintext on a hit.
+     * @return true on a hit.
+     */
+    bool lookup(const std::string& data_id, const Utils::FileIdentity& current,
+                std::vector<unsigned char>& out_plain_data);
+
+    /**
+     * @brief Looks up a record and copies it into caller memory if it fits.
+     * @param data_id The data identifier.
+     * @param current Identity of the main file now; a different cached identity is dropped.
+     * @param[out] out Receives the plaintext on a hit that fits.
+     * @param capacity Number of bytes available at out.
+     * @param[out] out_size Set to the size of the plaintext on a hit, whether it fits or not.
+     * @return true on a hit.
+     */
+    bool lookup(const std::string& data_id, const Utils::FileIdentity& current,
+                unsigned char* out, size_t capacity, size_t& out_size);
+
+    /**
+     * @brief Checks for an entry without counting a lookup or validating it.
+     * @param data_id The data identifier.
+     * @return true if an entry is cached for the id.
+     */
+    bool contains(const std::string& data_id) const;
+
+    /**
+     * @brief Caches a record, replacing any entry for the id and evicting the least
+     * recently used entries as needed. Records with an unknown identity are not cached.
+     * @param data_id The data identifier.
+     * @param identity Identity of the file the plaintext was decrypted from.
+     * @param plain_data The plaintext.
+     * @param prefetched Whether the entry is loaded ahead of use (counted for the hit rate).
+     */
+    void insert(const std::string& data_id, const Utils::FileIdentity& identity,
+                const std::vector<unsigned char>& plain_data, bool prefetched);
+
+    /**
+     * @brief Caches a record held in caller memory.
+     * @see insert(const std::string&, const Utils::FileIdentity&, const std::vector<unsigned char>&, bool)
+     * @param size Number of bytes at plain_data.
+     */
+    void insert(const std::string& data_id, const Utils::FileIdentity& identity,
+                const unsigned char* plain_data, size_t size, bool prefetched);
+
+    /**
+     * @brief Drops the entry for an id, if any.
+     * @param data_id The data identifier.
+     */
+    void invalidate(const std::string& data_id);
+
+    /**
+     * @brief Returns the counters.
+     * @return A snapshot of the counters.
+     */
+    PlaintextCacheStats getStats() const;
+
+private:
+    struct Entry {
+        std::string dataId;
+        Utils::FileIdentity identity;
+        Utils::SecureBytes data; // Locked in RAM; zeroized when freed
+        bool prefetched = false; // Inserted by prefetch and not read yet
+    };
+    typedef std::list<Entry> EntryList;
+
+    // Finds a valid entry, counting the lookup and dropping a stale one; caller holds m_mutex.
+    EntryList::iterator findLocked(const std::string& data_id, const Utils::FileIdentity& current);
+    void eraseLocked(EntryList::iterator it); // Caller holds m_mutex
+
+    const size_t m_maxBytes;
+    mutable std::mutex m_mutex;  ///< Protects everything below
+    EntryList m_lru;             ///< Most recently used first
+    std::unordered_map<std::string, EntryList::iterator> m_index;
+    size_t m_bytes;
+    PlaintextCacheStats m_stats;
+};
+
+} // namespace Storage
+} // namespace SecureStorage
+
+#endif // SS_PLAINTEXT_CACHE_H
@@ -0,0 +1,57 @@
+#include "RecordFormat.h"
+#include <cstring> // For memcmp, memcpy
+
+namespace SecureStorage {
+namespace Storage {
+
+void RecordFormat::writeHeader(const RecordHeader& header, std::vector<unsigned char>& out) {
+    out.assign(RECORD_HEADER_SIZE, 0);
+    std::memcpy(out.data(), RECORD_MAGIC, RECORD_MAGIC_SIZE);
+    out[RECORD_MAGIC_SIZE] = header.version;
+    out[RECORD_MAGIC_SIZE + 1] = header.algorithm;
+    out[RECORD_MAGIC_SIZE + 2] = header.kind;
+    // The last byte is reserved and kept zero.
+}
+
+size_t RecordFormat::parseHeader(const unsigned char* data, size_t size, RecordHeader& header) {
+    header = RecordHeader();
+    if (data == nullptr || size < RECORD_HEADER_SIZE ||
+        std::memcmp(data, RECORD_MAGIC, RECORD_MAGIC_SIZE) != 0 ||
+        (data[RECORD_MAGIC_SIZE] != RECORD_FORMAT_VERSION_CURRENT &&
+         data[RECORD_MAGIC_SIZE] != RECORD_FORMAT_VERSION_SEGMENTED)) {
+        // Legacy records start directly with a random IV.
+        header.version = RECORD_FORMAT_VERSION_LEGACY;
+        header.algorithm = RECORD_ALGORITHM_AES_256_GCM;
+        return 0;
+    }
+    header.version = data[RECORD_MAGIC_SIZE];
+    header.algorithm = data[RECORD_MAGIC_SIZE + 1];
+    header.kind = data[RECORD_MAGIC_SIZE + 2];
+    return RECORD_HEADER_SIZE;
+}
+
+void RecordFormat::buildAad(const RecordHeader& header, const std::string& data_id, std::vector<unsigned char>& aad) {
+    writeHeader(header, aad);
+    aad.insert(aad.end(), data_id.begin(), data_id.end());
+}
+
+uint8_t RecordFormat::algorithmId(Crypto::CipherAlgorithm algorithm) {
+    return algorithm == Crypto::CipherAlgorithm::ChaCha20Poly1305 ? RECORD_ALGORITHM_CHACHA20_POLY1305
+                                                                  : RECORD_ALGORITHM_AES_256_GCM;
+}
+
+bool RecordFormat::cipherForAlgorithmId(uint8_t id, Crypto::CipherAlgorithm& algorithm) {
+    switch (id) {
+    case RECORD_ALGORITHM_AES_256_GCM:
+        algorithm = Crypto::CipherAlgorithm::Aes256Gcm;
+        return true;
+    case RECORD_ALGORITHM_CHACHA20_POLY1305:
+        algorithm = Crypto::CipherAlgorithm::ChaCha20Poly1305;
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // namespace Storage
+} // namespace SecureStorage
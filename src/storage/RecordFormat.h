@@ -0,0 +1,112 @@
+#ifndef SS_RECORD_FORMAT_H
+#define SS_RECORD_FORMAT_H
+
+#include "Error.h"
+#include "Encryptor.h" // For Crypto::CipherAlgorithm
+#include <string>
+#include <vector>
+#include <cstddef> // For size_t
+#include <cstdint> // For uint8_t
+
+namespace SecureStorage {
+namespace Storage {
+
+// On-disk record layout versions.
+// Version 1 (legacy) records have no header: [IV] + [Ciphertext] + [Tag], encrypted without AAD.
+// Version 2 records prepend a fixed header and bind it, together with the data_id, as AAD:
+// [Header (8 bytes)] + [IV] + [Ciphertext] + [Tag]
+// Version 3 records share that header but hold a segmented body (see SegmentedRecord):
+// [Header (8 bytes)] + [Segment table] + [Segment ciphertexts]
+constexpr uint8_t RECORD_FORMAT_VERSION_LEGACY = 1;
+constexpr uint8_t RECORD_FORMAT_VERSION_CURRENT = 2;
+constexpr uint8_t RECORD_FORMAT_VERSION_SEGMENTED = 3;
+
+constexpr size_t RECORD_MAGIC_SIZE = 4;
+constexpr size_t RECORD_HEADER_SIZE = 8; // magic(4) + version(1) + algorithm(1) + kind(1) + reserved(1)
+const unsigned char RECORD_MAGIC[RECORD_MAGIC_SIZE] = {'S', 'S', 'R', 'C'};
+
+// Algorithm identifiers stored in the record header. Legacy records are always AES-256-GCM.
+constexpr uint8_t RECORD_ALGORITHM_AES_256_GCM = 0;
+constexpr uint8_t RECORD_ALGORITHM_CHACHA20_POLY1305 = 1;
+
+// What a versioned record holds. The kind is part of the authenticated header, and readers
+// only accept the kind they expect, so a record of one kind cannot be passed off as another
+// even where their AAD ids coincide (e.g. the history of "a" and a data id "a.enc.hist",
+// or the transaction log and a data id ".securestore.wal").
+// Data records written before kinds existed carry 0 in this byte and read as data.
+constexpr uint8_t RECORD_KIND_DATA = 0;
+constexpr uint8_t RECORD_KIND_HISTORY = 1;         ///< A frame of `<id>.enc.hist`
+constexpr uint8_t RECORD_KIND_TRANSACTION_LOG = 2; ///< A record of the transaction log
+
+/**
+ * @struct RecordHeader
+ * @brief Parsed form of the fixed-size header that starts every versioned record.
+ */
+struct RecordHeader {
+    uint8_t version = RECORD_FORMAT_VERSION_CURRENT; ///< Record format version
+    uint8_t algorithm = RECORD_ALGORITHM_AES_256_GCM; ///< Cipher used for the body
+    uint8_t kind = RECORD_KIND_DATA; ///< RECORD_KIND_* of the content
+};
+
+/**
+ * @class RecordFormat
+ * @brief Encodes and decodes the on-disk framing of encrypted records.
+ *
+ * The header is never encrypted, but it is authenticated: the AAD passed to the cipher is
+ * the serialized header followed by the data_id. A record copied to another data_id,
+ * or re-labelled with a different version or kind, therefore fails tag verification in
+ * the same pass that decrypts it.
+ */
+class RecordFormat {
+public:
+    RecordFormat() = delete; // Static class, no instances
+
+    /**
+     * @brief Serializes a header into exactly RECORD_HEADER_SIZE bytes.
+     * @param header The header to serialize.
+     * @param[out] out Vector that receives the serialized header (overwritten).
+     */
+    static void writeHeader(const RecordHeader& header, std::vector<unsigned char>& out);
+
+    /**
+     * @brief Parses the header at the start of a stored record.
+     *
+     * @param data Pointer to the raw record bytes.
+     * @param size Number of bytes available at data.
+     * @param[out] header Receives the parsed header. For records without a recognised
+     * header, version is set to RECORD_FORMAT_VERSION_LEGACY.
+     * @return The offset at which the encrypted body starts:
+     * RECORD_HEADER_SIZE for versioned records, 0 for legacy records.
+     */
+    static size_t parseHeader(const unsigned char* data, size_t size, RecordHeader& header);
+
+    /**
+     * @brief Builds the Additional Authenticated Data for a versioned record.
+     * The AAD is the serialized header followed by the raw bytes of data_id.
+     *
+     * @param header The record header.
+     * @param data_id The identifier the record is stored under.
+     * @param[out] aad Vector that receives the AAD (overwritten).
+     */
+    static void buildAad(const RecordHeader& header, const std::string& data_id, std::vector<unsigned char>& aad);
+
+    /**
+     * @brief Returns the header algorithm id of a cipher.
+     * @param algorithm The cipher.
+     * @return Its RECORD_ALGORITHM_* value.
+     */
+    static uint8_t algorithmId(Crypto::CipherAlgorithm algorithm);
+
+    /**
+     * @brief Maps a header algorithm id to the cipher that reads the record.
+     * @param id A RECORD_ALGORITHM_* value.
+     * @param[out] algorithm Receives the cipher.
+     * @return true on success, false if the id is unknown.
+     */
+    static bool cipherForAlgorithmId(uint8_t id, Crypto::CipherAlgorithm& algorithm);
+};
+
+} // namespace Storage
+} // namespace SecureStorage
+
+#endif // SS_RECORD_FORMAT_H
@@ -0,0 +1,188 @@
+#include "RecordHistory.h"
+
+#include <algorithm> // For std::min, std::equal
+
+namespace SecureStorage {
+namespace Storage {
+
+namespace {
+
+// Sanity bound of one frame; an entry holds at most one record's worth of chunks.
+constexpr uint64_t MAX_FRAME_SIZE = 1ULL << 31;
+
+void putU32(std::vector<unsigned char>& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+    }
+}
+
+void putU64(std::vector<unsigned char>& out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+    }
+}
+
+// Little-endian reader that fails (and stays failed) instead of reading past the end.
+class Reader {
+public:
+    explicit Reader(const std::vector<unsigned char>& data) : m_data(data), m_pos(0), m_ok(true) {}
+
+    uint64_t get(size_t bytes) {
+        if (!m_ok || m_data.size() - m_pos < bytes) {
+            m_ok = false;
+            return 0;
+        }
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes; ++i) {
+            value |= static_cast<uint64_t>(m_data[m_pos + i]) << (8 * i);
+        }
+        m_pos += bytes;
+        return value;
+    }
+
+    bool getBytes(size_t count, std::vector<unsigned char>& out) {
+        if (!m_ok || m_data.size() - m_pos < count) {
+            m_ok = false;
+            return false;
+        }
+        out.assign(m_data.begin() + m_pos, m_data.begin() + m_pos + count);
+        m_pos += count;
+        return true;
+    }
+
+    bool ok() const { return m_ok; }
+    bool atEnd() const { return m_pos == m_data.size(); }
+
+private:
+    const std::vector<unsigned char>& m_data;
+    size_t m_pos;
+    bool m_ok;
+};
+
+} // namespace
+
+uint64_t RecordHistory::digest(const std::vector<unsigned char>& data) {
+    return digest(data.data(), data.size());
+}
+
+uint64_t RecordHistory::digest(const unsigned char* data, size_t size) {
+    uint64_t hash = 14695981039346656037ULL; // FNV-1a 64-bit offset basis
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 1099511628211ULL; // FNV-1a 64-bit prime
+    }
+    return hash;
+}
+
+void RecordHistory::makeDelta(const std::vector<unsigned char>& older, const std::vector<unsigned char>& newer,
+                              HistoryEntry& entry) {
+    makeDelta(older, newer.data(), newer.size(), entry);
+}
+
+void RecordHistory::makeDelta(const std::vector<unsigned char>& older, const unsigned char* newer, size_t newerSize,
+                              HistoryEntry& entry) {
+    entry.size = older.size();
+    entry.digest = digest(older);
+    entry.baseDigest = digest(newer, newerSize);
+    entry.chunks.clear();
+    for (size_t offset = 0; offset < older.size(); offset += HISTORY_CHUNK_SIZE) {
+        size_t length = std::min(HISTORY_CHUNK_SIZE, older.size() - offset);
+        // applyDelta() truncates or zero-extends newer to older's size, so a chunk is
+        // reproduced exactly when newer holds the same bytes at the same place.
+        bool same = newerSize >= offset + length &&
+                    std::equal(older.begin() + offset, older.begin() + offset + length, newer + offset);
+        if (!same) {
+            HistoryChunk chunk;
+            chunk.index = static_cast<uint32_t>(offset / HISTORY_CHUNK_SIZE);
+            chunk.data.assign(older.begin() + offset, older.begin() + offset + length);
+            entry.chunks.push_back(std::move(chunk));
+        }
+    }
+}
+
+bool RecordHistory::applyDelta(const HistoryEntry& entry, std::vector<unsigned char>& data) {
+    data.resize(static_cast<size_t>(entry.size), 0);
+    for (const HistoryChunk& chunk : entry.chunks) {
+        size_t offset = static_cast<size_t>(chunk.index) * HISTORY_CHUNK_SIZE;
+        if (offset > data.size() || chunk.data.size() > data.size() - offset) {
+            return false;
+        }
+        std::copy(chunk.data.begin(), chunk.data.end(), data.begin() + offset);
+    }
+    return digest(data) == entry.digest;
+}
+
+void RecordHistory::serializeEntry(const HistoryEntry& entry, std::vector<unsigned char>& out) {
+    out.clear();
+    putU32(out, entry.version);
+    putU64(out, static_cast<uint64_t>(entry.storedAtNs));
+    putU64(out, static_cast<uint64_t>(entry.supersededAtNs));
+    putU64(out, entry.size);
+    putU64(out, entry.digest);
+    putU64(out, entry.baseDigest);
+    putU32(out, static_cast<uint32_t>(entry.chunks.size()));
+    for (const HistoryChunk& chunk : entry.chunks) {
+        putU32(out, chunk.index);
+        putU32(out, static_cast<uint32_t>(chunk.data.size()));
+        out.insert(out.end(), chunk.data.begin(), chunk.data.end());
+    }
+}
+
+bool RecordHistory::parseEntry(const std::vector<unsigned char>& data, HistoryEntry& entry) {
+    Reader reader(data);
+    entry.version = static_cast<uint32_t>(reader.get(4));
+    entry.storedAtNs = static_cast<int64_t>(reader.get(8));
+    entry.supersededAtNs = static_cast<int64_t>(reader.get(8));
+    entry.size = reader.get(8);
+    entry.digest = reader.get(8);
+    entry.baseDigest = reader.get(8);
+    uint32_t chunk_count = static_cast<uint32_t>(reader.get(4));
+    entry.chunks.clear();
+    for (uint32_t i = 0; i < chunk_count && reader.ok(); ++i) {
+        HistoryChunk chunk;
+        chunk.index = static_cast<uint32_t>(reader.get(4));
+        size_t length = static_cast<size_t>(reader.get(4));
+        if (length > HISTORY_CHUNK_SIZE || !reader.getBytes(length, chunk.data)) {
+            return false;
+        }
+        entry.chunks.push_back(std::move(chunk));
+    }
+    return reader.ok() && reader.atEnd();
+}
+
+void RecordHistory::appendFrame(const std::vector<unsigned char>& record, std::vector<unsigned char>& out) {
+    putU32(out, static_cast<uint32_t>(record.size()));
+    out.insert(out.end(), record.begin(), record.end());
+}
+
+void RecordHistory::splitFrames(const std::vector<unsigned char>& file, std::vector<std::vector<unsigned char>>& frames) {
+    frames.clear();
+    Reader reader(file);
+    while (!reader.atEnd()) {
+        uint64_t length = reader.get(4);
+        std::vector<unsigned char> frame;
+        if (!reader.ok() || length == 0 || length > MAX_FRAME_SIZE || !reader.getBytes(static_cast<size_t>(length), frame)) {
+            return; // Torn append; everything before it is intact
+        }
+        frames.push_back(std::move(frame));
+    }
+}
+
+std::vector<size_t> RecordHistory::resolveChain(const std::vector<HistoryEntry>& entries, uint64_t currentDigest) {
+    std::vector<size_t> chain;
+    uint64_t expected = currentDigest;
+    for (size_t i = entries.size(); i-- > 0;) {
+        if (entries[i].baseDigest != expected) {
+            continue; // Its successor never became (or is no longer) the main file
+        }
+        if (!chain.empty() && entries[i].version >= entries[chain.back()].version) {
+            continue; // Versions only decrease going back
+        }
+        chain.push_back(i);
+        expected = entries[i].digest;
+    }
+    return chain;
+}
+
+} // namespace Storage
+} // namespace SecureStorage
@@ -0,0 +1,163 @@
+#ifndef SS_RECORD_HISTORY_H
+#define SS_RECORD_HISTORY_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstddef> // For size_t
+#include <cstdint> // For uint32_t, uint64_t
+
+namespace SecureStorage {
+namespace Storage {
+
+// Older versions of `<id>.enc` are kept in `<id>.enc` + HISTORY_FILE_EXTENSION.
+const std::string HISTORY_FILE_EXTENSION = ".hist";
+
+// Granularity at which versions are compared; only chunks that differ are kept.
+constexpr size_t HISTORY_CHUNK_SIZE = 4096;
+
+/**
+ * @struct VersionInfo
+ * @brief One version of a record, as listed by SecureStore::listVersions().
+ */
+struct VersionInfo {
+    uint32_t version = 0;                        ///< Numbered from 1, the current version is the highest
+    std::chrono::system_clock::time_point storedAt; ///< When this version was written
+    uint64_t size = 0;                           ///< Plaintext size in bytes
+    bool current = false;                        ///< This is the content of the main file
+};
+
+/**
+ * @struct HistoryChunk
+ * @brief One HISTORY_CHUNK_SIZE slice of an old version that differs from its successor.
+ */
+struct HistoryChunk {
+    uint32_t index = 0;              ///< Position of the slice, in chunks
+    std::vector<unsigned char> data; ///< The slice; the last chunk of a version may be short
+};
+
+/**
+ * @struct HistoryEntry
+ * @brief An old version, stored as a reverse delta against the version that replaced it.
+ */
+struct HistoryEntry {
+    uint32_t version = 0;
+    int64_t storedAtNs = 0;      ///< When this version was written (system clock, ns since epoch)
+    int64_t supersededAtNs = 0;  ///< When the version after it was written
+    uint64_t size = 0;           ///< Plaintext size of this version
+    uint64_t digest = 0;         ///< RecordHistory::digest() of this version
+    uint64_t baseDigest = 0;     ///< RecordHistory::digest() of the version it is a delta against
+    std::vector<HistoryChunk> chunks;
+};
+
+/**
+ * @class RecordHistory
+ * @brief Delta encoding and file framing of the per-id version history.
+ *
+ * When a record is replaced, the old version is stored as a reverse delta against the
+ * new one: its size plus only the chunks that differ. Going back n versions starts from
+ * the current plaintext and applies the n newest deltas. A small edit of a large record
+ * therefore adds about one chunk to the history, not a full copy.
+ *
+ * The history file is a sequence of frames, `[u32 length][encrypted entry]`, appended one
+ * per write and compacted to the newest entries once it holds twice as many as are kept.
+ * A torn last frame, from a crash during an append, ends the sequence.
+ *
+ * Each entry carries a digest of its own plaintext and of the version it is a delta
+ * against. resolveChain() links entries to the current version through these, so an
+ * entry appended by a write that never installed its main file, or a main file restored
+ * from an older backup, does not produce wrong content: entries that do not link are
+ * skipped.
+ */
+class RecordHistory {
+public:
+    RecordHistory() = delete; // Static class, no instances
+
+    /**
+     * @brief Fingerprint of a version's plaintext (FNV-1a, 64 bit). Only used to link
+     * entries that are already authenticated, so it need not be cryptographic.
+     * @param data The plaintext.
+     * @return The digest.
+     */
+    static uint64_t digest(const std::vector<unsigned char>& data);
+
+    /**
+     * @brief digest() of a buffer held in caller memory.
+     * @param data Pointer to the plaintext (may be null if size is 0).
+     * @param size Number of bytes at data.
+     * @return The digest.
+     */
+    static uint64_t digest(const unsigned char* data, size_t size);
+
+    /**
+     * @brief Builds the reverse delta that turns newer back into older.
+     * Fills size, digest, baseDigest and chunks of entry; the caller sets the rest.
+     * @param older The replaced version.
+     * @param newer The version replacing it.
+     * @param[out] entry Receives the delta.
+     */
+    static void makeDelta(const std::vector<unsigned char>& older, const std::vector<unsigned char>& newer,
+                          HistoryEntry& entry);
+
+    /**
+     * @brief makeDelta() against a newer version held in caller memory.
+     * @param older The replaced version.
+     * @param newer Pointer to the version replacing it (may be null if newerSize is 0).
+     * @param newerSize Number of bytes at newer.
+     * @param[out] entry Receives the delta.
+     */
+    static void makeDelta(const std::vector<unsigned char>& older, const unsigned char* newer, size_t newerSize,
+                          HistoryEntry& entry);
+
+    /**
+     * @brief Applies a reverse delta: turns the version after entry into entry's version.
+     * @param entry The delta.
+     * @param[in,out] data The newer plaintext on input, entry's version on output.
+     * @return true if the result matches entry.digest.
+     */
+    static bool applyDelta(const HistoryEntry& entry, std::vector<unsigned char>& data);
+
+    /**
+     * @brief Serializes an entry (the plaintext that is then encrypted).
+     * @param entry The entry.
+     * @param[out] out Receives the bytes (overwritten).
+     */
+    static void serializeEntry(const HistoryEntry& entry, std::vector<unsigned char>& out);
+
+    /**
+     * @brief Parses a serialized entry.
+     * @param data The bytes produced by serializeEntry().
+     * @param[out] entry Receives the entry.
+     * @return true on success, false if the bytes are malformed.
+     */
+    static bool parseEntry(const std::vector<unsigned char>& data, HistoryEntry& entry);
+
+    /**
+     * @brief Appends one length-prefixed frame to a history file image (also used for the
+     * records of the transaction log).
+     * @param record The encrypted entry.
+     * @param[in,out] out The bytes to append to.
+     */
+    static void appendFrame(const std::vector<unsigned char>& record, std::vector<unsigned char>& out);
+
+    /**
+     * @brief Splits a history file into its frames, stopping at a torn or malformed tail.
+     * @param file The file content.
+     * @param[out] frames Receives the frame payloads, oldest first.
+     */
+    static void splitFrames(const std::vector<unsigned char>& file, std::vector<std::vector<unsigned char>>& frames);
+
+    /**
+     * @brief Links entries to the current version through their digests.
+     * @param entries Entries in file order (oldest first).
+     * @param currentDigest digest() of the current plaintext.
+     * @return Indices into entries, newest version first, of the entries reachable from
+     * the current version.
+     */
+    static std::vector<size_t> resolveChain(const std::vector<HistoryEntry>& entries, uint64_t currentDigest);
+};
+
+} // namespace Storage
+} // namespace SecureStorage
+
+#endif // SS_RECORD_HISTORY_H
@@ -0,0 +1,148 @@
+#include "RepairQueue.h"
+#include "SecureStore.h"
+#include "Logger.h" // For SS_LOG_ macros
+
+#include <algorithm> // For std::min
+#include <vector>
+
+namespace SecureStorage {
+namespace Storage {
+
+RepairQueue::RepairQueue(SecureStore& store, RepairOptions options)
+    : m_store(store),
+      m_options(options),
+      m_stopping(false) {
+}
+
+RepairQueue::~RepairQueue() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    if (!m_pending.empty()) {
+        SS_LOG_INFO("RepairQueue: Dropping " << m_pending.size() << " pending repairs on shutdown.");
+    }
+}
+
+void RepairQueue::enqueue(const std::string& data_id) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_stopping) {
+        return;
+    }
+    if (m_pending.count(data_id) > 0) {
+        m_stats.deduplicated++;
+        return;
+    }
+    PendingRepair repair;
+    repair.due = std::chrono::steady_clock::now();
+    m_pending[data_id] = repair;
+    m_stats.enqueued++;
+    if (!m_thread.joinable()) {
+        m_thread = std::thread(&RepairQueue::repairLoop, this);
+    }
+    m_cv.notify_one();
+}
+
+Error::Errc RepairQueue::runPending() {
+    std::lock_guard<std::mutex> run_lock(m_runMutex);
+    std::vector<std::string> data_ids;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& entry : m_pending) {
+            data_ids.push_back(entry.first);
+        }
+    }
+    for (const std::string& data_id : data_ids) {
+        attempt(data_id);
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pending.empty() ? Error::Errc::Success : Error::Errc::OperationFailed;
+}
+
+RepairStats RepairQueue::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    RepairStats stats = m_stats;
+    stats.pending = m_pending.size();
+    return stats;
+}
+
+void RepairQueue::repairLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping) {
+        if (m_pending.empty()) {
+            m_cv.wait(lock, [this] { return m_stopping || !m_pending.empty(); });
+            continue;
+        }
+        auto next = m_pending.begin();
+        for (auto it = m_pending.begin(); it != m_pending.end(); ++it) {
+            if (it->second.due < next->second.due) {
+                next = it;
+            }
+        }
+        if (next->second.due > std::chrono::steady_clock::now()) {
+            // Woken early by a new id (due now) or by stopping; either way, look again. A copy:
+            // wait_until() rereads the deadline after waking, when runPending() may have erased next.
+            const std::chrono::steady_clock::time_point due = next->second.due;
+            m_cv.wait_until(lock, due);
+            continue;
+        }
+        std::string data_id = next->first;
+        lock.unlock();
+        {
+            std::lock_guard<std::mutex> run_lock(m_runMutex);
+            attempt(data_id);
+        }
+        lock.lock();
+    }
+}
+
+void RepairQueue::attempt(const std::string& data_id) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_pending.count(data_id) == 0) {
+            return; // Handled by runPending() meanwhile
+        }
+    }
+    ScrubRecordResult result;
+    Error::Errc err = m_store.scrubRecord(data_id, result);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_pending.find(data_id);
+    if (it == m_pending.end()) {
+        return;
+    }
+    if (err == Error::Errc::DataNotFound || (err == Error::Errc::Success && !result.skippedBusy)) {
+        if (result.unrecoverable) {
+            SS_LOG_ERROR("RepairQueue: Id '" << data_id << "' has no valid copy left; giving up.");
+            m_stats.abandoned++;
+        } else if (result.mainRepaired || result.backupRepaired) {
+            m_stats.repaired++;
+        } else {
+            m_stats.noLongerNeeded++;
+        }
+        m_pending.erase(it);
+        return;
+    }
+    PendingRepair& repair = it->second;
+    repair.attempts++;
+    if (repair.attempts >= m_options.maxAttempts) {
+        SS_LOG_WARN("RepairQueue: Giving up on id '" << data_id << "' after " << repair.attempts
+                    << " attempts (last error " << static_cast<int>(err) << ").");
+        m_stats.abandoned++;
+        m_pending.erase(it);
+        return;
+    }
+    // initialBackoff * 2^(attempts - 1), capped; the shift is bounded to avoid overflow.
+    std::chrono::milliseconds backoff = m_options.initialBackoff * (1LL << std::min(repair.attempts - 1, 20u));
+    repair.due = std::chrono::steady_clock::now() + std::min(backoff, m_options.maxBackoff);
+    m_stats.retries++;
+    SS_LOG_DEBUG("RepairQueue: Retrying id '" << data_id << "' in " << std::min(backoff, m_options.maxBackoff).count()
+                 << " ms (attempt " << repair.attempts << ").");
+}
+
+} // namespace Storage
+} // namespace SecureStorage
@@ -0,0 +1,121 @@
+#ifndef SS_REPAIR_QUEUE_H
+#define SS_REPAIR_QUEUE_H
+
+#include "Error.h"
+#include <string>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint> // For uint64_t
+
+namespace SecureStorage {
+namespace Storage {
+
+class SecureStore; // Forward declare
+
+/**
+ * @struct RepairOptions
+ * @brief Retry schedule of RepairQueue.
+ */
+struct RepairOptions {
+    /// Wait before the first retry of a repair that could not run; doubled on each retry.
+    std::chrono::milliseconds initialBackoff = std::chrono::milliseconds(100);
+    /// Upper bound of the wait between retries.
+    std::chrono::milliseconds maxBackoff = std::chrono::seconds(30);
+    /// Attempts per id before the repair is abandoned (the scrubber or a later read
+    /// queues it again).
+    unsigned maxAttempts = 8;
+};
+
+/**
+ * @struct RepairStats
+ * @brief Counters describing RepairQueue activity.
+ */
+struct RepairStats {
+    uint64_t enqueued = 0;       ///< Ids queued
+    uint64_t deduplicated = 0;   ///< Requests for ids that were already queued
+    uint64_t repaired = 0;       ///< Repairs that rewrote a damaged copy
+    uint64_t noLongerNeeded = 0; ///< Ids found healthy or deleted by the time they were processed
+    uint64_t retries = 0;        ///< Attempts rescheduled because a writer held the id or a write failed
+    uint64_t abandoned = 0;      ///< Ids given up on: no valid copy, or out of attempts
+    size_t pending = 0;          ///< Ids currently queued
+};
+
+/**
+ * @class RepairQueue
+ * @brief Background queue that restores main files from their backups off the read path.
+ *
+ * A read that falls back to the backup queues the id and returns at once. A thread,
+ * started by the first request, then calls SecureStore::scrubRecord() for the id, which
+ * checks both copies again under the id's shard lock and rewrites the damaged one.
+ * An id is queued at most once, however many reads hit its backup meanwhile. Attempts
+ * that find the id locked by a writer, or fail to write, are retried with exponential
+ * backoff.
+ *
+ * Pending repairs are dropped on destruction; the next read or scrub finds them again.
+ */
+class RepairQueue {
+public:
+    /**
+     * @param store The store whose records are repaired. Must outlive this object.
+     * @param options Retry schedule.
+     */
+    RepairQueue(SecureStore& store, RepairOptions options);
+
+    /**
+     * @brief Stops the repair thread.
+     */
+    ~RepairQueue();
+
+    RepairQueue(const RepairQueue&) = delete;
+    RepairQueue& operator=(const RepairQueue&) = delete;
+    RepairQueue(RepairQueue&&) = delete;
+    RepairQueue& operator=(RepairQueue&&) = delete;
+
+    /**
+     * @brief Queues a repair of an id, unless it is queued already.
+     * @param data_id The data identifier.
+     */
+    void enqueue(const std::string& data_id);
+
+    /**
+     * @brief Attempts every queued repair once now, ignoring their backoff.
+     * @return SecureStorage::Error::Errc::Success if the queue is empty afterwards,
+     * Errc::OperationFailed if some repairs stay queued for a retry.
+     */
+    Error::Errc runPending();
+
+    /**
+     * @brief Returns activity counters.
+     * @return A snapshot of the counters.
+     */
+    RepairStats getStats() const;
+
+private:
+    struct PendingRepair {
+        unsigned attempts = 0;
+        std::chrono::steady_clock::time_point due;
+    };
+
+    void repairLoop();
+    void attempt(const std::string& data_id); // Runs one attempt; caller holds m_runMutex
+
+    SecureStore& m_store;
+    const RepairOptions m_options;
+
+    mutable std::mutex m_mutex;   ///< Protects everything below
+    std::condition_variable m_cv; ///< Wakes the repair thread
+    std::map<std::string, PendingRepair> m_pending;
+    bool m_stopping;
+    RepairStats m_stats;
+    std::thread m_thread;         ///< Started by the first enqueue()
+
+    std::mutex m_runMutex;        ///< Allows one attempt at a time
+};
+
+} // namespace Storage
+} // namespace SecureStorage
+
+#endif // SS_REPAIR_QUEUE_H
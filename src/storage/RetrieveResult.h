@@ -0,0 +1,22 @@
+#ifndef SS_RETRIEVE_RESULT_H
+#define SS_RETRIEVE_RESULT_H
+
+#include "Error.h"
+#include <vector>
+
+namespace SecureStorage {
+namespace Storage {
+
+/**
+ * @struct RetrieveResult
+ * @brief The outcome of one id of SecureStore::retrieveMany().
+ */
+struct RetrieveResult {
+    Error::Errc status = Error::Errc::DataNotFound; ///< What retrieveData() would have returned
+    std::vector<unsigned char> data;                ///< The decrypted data if status is Success
+};
+
+} // namespace Storage
+} // namespace SecureStorage
+
+#endif // SS_RETRIEVE_RESULT_H
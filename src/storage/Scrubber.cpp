@@ -0,0 +1,169 @@
+#include "Scrubber.h"
+#include "SecureStore.h"
+#include "Logger.h" // For SS_LOG_ macros
+
+#if defined(__linux__)
+#include <sys/resource.h> // For setpriority
+#include <sys/syscall.h>  // For SYS_gettid, SYS_ioprio_set
+#include <unistd.h>       // For syscall
+#include <cerrno>
+#include <cstring>        // For strerror
+#endif
+
+namespace SecureStorage {
+namespace Storage {
+
+namespace {
+
+#if defined(__linux__)
+// From <linux/ioprio.h>, which not every toolchain ships.
+constexpr int IOPRIO_WHO_PROCESS = 1;
+constexpr int IOPRIO_CLASS_IDLE = 3;
+constexpr int IOPRIO_CLASS_SHIFT = 13;
+#endif
+
+// Applies the scheduling options to the calling thread only.
+void lowerThreadPriority(const ScrubOptions& options) {
+#if defined(__linux__)
+    if (options.idleIoPriority) {
+#ifdef SYS_ioprio_set
+        // Who 0 with IOPRIO_WHO_PROCESS is the calling thread.
+        if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) != 0) {
+            SS_LOG_WARN("Scrubber: Failed to set idle I/O priority: " << strerror(errno));
+        }
+#endif
+    }
+    if (options.lowCpuPriority) {
+        // On Linux, nice values are per thread when addressed by thread id.
+        if (setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19) != 0) {
+            SS_LOG_WARN("Scrubber: Failed to lower CPU priority: " << strerror(errno));
+        }
+    }
+#else
+    (void)options;
+#endif
+}
+
+} // namespace
+
+Scrubber::Scrubber(SecureStore& store, ScrubOptions options)
+    : m_store(store),
+      m_options(options),
+      m_stopping(false),
+      m_passRequested(false) {
+    m_thread = std::thread(&Scrubber::scrubLoop, this);
+}
+
+Scrubber::~Scrubber() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void Scrubber::requestPass() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stats.passRunning) {
+            return;
+        }
+        m_passRequested = true;
+    }
+    m_cv.notify_all();
+}
+
+ScrubStats Scrubber::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void Scrubber::scrubLoop() {
+    lowerThreadPriority(m_options);
+    std::chrono::milliseconds wait = m_options.startDelay;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping) {
+        m_cv.wait_for(lock, wait, [this] { return m_stopping || m_passRequested; });
+        if (m_stopping) {
+            break;
+        }
+        m_passRequested = false;
+        lock.unlock();
+        runPass();
+        lock.lock();
+        wait = m_options.passInterval;
+    }
+}
+
+void Scrubber::runPass() {
+    std::vector<std::string> data_ids;
+    Error::Errc err = m_store.listDataIds(data_ids);
+    if (err != Error::Errc::Success) {
+        SS_LOG_WARN("Scrubber: Failed to list ids (Error: " << static_cast<int>(err) << "), skipping this pass.");
+        return;
+    }
+    auto pass_start = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.passRunning = true;
+        m_stats.passRecordsTotal = data_ids.size();
+        m_stats.passRecordsDone = 0;
+        m_stats.unrecoverableIds.clear();
+    }
+
+    uint64_t pass_bytes = 0;
+    bool completed = true;
+    for (const std::string& data_id : data_ids) {
+        ScrubRecordResult result;
+        err = m_store.scrubRecord(data_id, result);
+        pass_bytes += result.bytesRead;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.passRecordsDone++;
+            m_stats.bytesVerified += result.bytesRead;
+            if (err == Error::Errc::Success) {
+                m_stats.recordsVerified++;
+            }
+            m_stats.mainRepairs += result.mainRepaired ? 1 : 0;
+            m_stats.backupRepairs += result.backupRepaired ? 1 : 0;
+            m_stats.skippedBusy += result.skippedBusy ? 1 : 0;
+            if (result.unrecoverable) {
+                m_stats.unrecoverable++;
+                m_stats.unrecoverableIds.push_back(data_id);
+            }
+        }
+        // Token-bucket pacing: the pass may not get ahead of bytesPerSecond.
+        std::chrono::steady_clock::time_point deadline = pass_start;
+        if (m_options.bytesPerSecond > 0) {
+            deadline += std::chrono::microseconds(pass_bytes * 1000000 / m_options.bytesPerSecond);
+        }
+        if (!paceUntil(deadline)) {
+            completed = false;
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.passRunning = false;
+    if (completed) {
+        m_stats.passesCompleted++;
+        m_stats.lastPassDuration = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - pass_start);
+        SS_LOG_INFO("Scrubber: Verified " << m_stats.passRecordsDone << " ids (" << pass_bytes << " bytes) in "
+                    << m_stats.lastPassDuration.count() << " ms; " << m_stats.mainRepairs << " main and "
+                    << m_stats.backupRepairs << " backup repairs, " << m_stats.unrecoverableIds.size()
+                    << " unrecoverable in this pass.");
+    }
+}
+
+bool Scrubber::paceUntil(std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait_until(lock, deadline, [this] { return m_stopping; });
+    return !m_stopping;
+}
+
+} // namespace Storage
+} // namespace SecureStorage
@@ -0,0 +1,131 @@
+#ifndef SS_SCRUBBER_H
+#define SS_SCRUBBER_H
+
+#include "Error.h"
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint> // For uint64_t
+
+namespace SecureStorage {
+namespace Storage {
+
+class SecureStore; // Forward declare
+
+/**
+ * @struct ScrubOptions
+ * @brief Budget and schedule of the background Scrubber.
+ */
+struct ScrubOptions {
+    /// Record bytes read per second, main and backup together; 0 removes the limit.
+    /// Decryption cost grows with the bytes read, so this bounds the CPU use as well.
+    uint64_t bytesPerSecond = 1024 * 1024;
+    /// Pause before the first pass, so it does not compete with start-up.
+    std::chrono::milliseconds startDelay = std::chrono::seconds(60);
+    /// Pause between the end of one pass and the start of the next.
+    std::chrono::milliseconds passInterval = std::chrono::hours(24);
+    /// Put the scrubber thread in the idle I/O scheduling class (Linux ioprio).
+    bool idleIoPriority = true;
+    /// Give the scrubber thread the lowest CPU priority (nice 19, Linux).
+    bool lowCpuPriority = true;
+};
+
+/**
+ * @struct ScrubRecordResult
+ * @brief What verifying one id found and did.
+ */
+struct ScrubRecordResult {
+    bool mainValid = false;      ///< The main file authenticated
+    bool backupPresent = false;  ///< A backup file exists
+    bool backupValid = false;    ///< The backup file authenticated
+    bool mainRepaired = false;   ///< The main file was rewritten from the backup
+    bool backupRepaired = false; ///< The backup file was rewritten from the main file
+    bool unrecoverable = false;  ///< Neither copy authenticated
+    bool skippedBusy = false;    ///< Damage was seen but a writer held the id; left for the next pass
+    uint64_t bytesRead = 0;      ///< Record bytes read
+};
+
+/**
+ * @struct ScrubStats
+ * @brief Progress and results of a Scrubber.
+ */
+struct ScrubStats {
+    bool passRunning = false;      ///< A pass is in progress
+    uint64_t passesCompleted = 0;
+    size_t passRecordsTotal = 0;   ///< Ids in the current (or last) pass
+    size_t passRecordsDone = 0;    ///< Ids verified so far in the current (or last) pass
+    uint64_t recordsVerified = 0;  ///< Ids verified over all passes
+    uint64_t bytesVerified = 0;    ///< Record bytes read over all passes
+    uint64_t mainRepairs = 0;
+    uint64_t backupRepairs = 0;
+    uint64_t unrecoverable = 0;    ///< Ids found with no valid copy
+    uint64_t skippedBusy = 0;
+    std::chrono::milliseconds lastPassDuration = std::chrono::milliseconds(0);
+    std::vector<std::string> unrecoverableIds; ///< Ids with no valid copy in the current or last pass
+};
+
+/**
+ * @class Scrubber
+ * @brief Background thread that verifies every record and repairs damaged copies.
+ *
+ * Each pass lists the ids of the store and calls SecureStore::scrubRecord() for each,
+ * which authenticates the main and backup file and rewrites a damaged copy from the
+ * intact one. Corruption is thereby found and repaired before a caller's read hits it.
+ *
+ * Reads are paced to ScrubOptions::bytesPerSecond and the thread runs at idle I/O and
+ * lowest CPU priority, so foreground requests are served first.
+ */
+class Scrubber {
+public:
+    /**
+     * @brief Starts the scrubber thread.
+     * @param store The store to scrub. Must outlive this object.
+     * @param options Budget and schedule.
+     */
+    Scrubber(SecureStore& store, ScrubOptions options);
+
+    /**
+     * @brief Stops the thread, abandoning a pass in progress after the current id.
+     */
+    ~Scrubber();
+
+    Scrubber(const Scrubber&) = delete;
+    Scrubber& operator=(const Scrubber&) = delete;
+    Scrubber(Scrubber&&) = delete;
+    Scrubber& operator=(Scrubber&&) = delete;
+
+    /**
+     * @brief Starts a pass now instead of at the end of the delay or interval.
+     * Does nothing if a pass is running.
+     */
+    void requestPass();
+
+    /**
+     * @brief Returns progress and results.
+     * @return A snapshot of the counters.
+     */
+    ScrubStats getStats() const;
+
+private:
+    void scrubLoop();
+    void runPass();
+    bool paceUntil(std::chrono::steady_clock::time_point deadline); // False if stopping
+
+    SecureStore& m_store;
+    const ScrubOptions m_options;
+
+    mutable std::mutex m_mutex;   ///< Protects everything below
+    std::condition_variable m_cv; ///< Wakes the scrubber thread
+    bool m_stopping;
+    bool m_passRequested;
+    ScrubStats m_stats;
+    std::thread m_thread;
+};
+
+} // namespace Storage
+} // namespace SecureStorage
+
+#endif // SS_SCRUBBER_H
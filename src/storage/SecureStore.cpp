@@ -1,17 +1,64 @@
 #include "SecureStore.h"
 #include "Logger.h"         // For SS_LOG_ macros
+#include "SecureWipe.h"     // For Utils::secureWipe
+#include "ScratchPool.h"    // For Utils::ScratchBuffer, Utils::ScratchName
 #include <algorithm>        // For std::remove_if for data_id sanitization (not used yet)
-#include <cstdio>           // For std::rename
-#include <cstring>          // For strerror
-#include <cerrno>           // For errno
+#include <atomic>
+#include <cstring>          // For memcpy
+#include <unistd.h>         // For pread, close
+#include <thread>
+#include <unordered_map>
 
 namespace SecureStorage {
 namespace Storage {
 
-SecureStore::SecureStore(std::string rootStoragePath, std::string deviceSerialNumber)
+namespace {
+
+// Default pool size cap of prefetch() and retrieveMany(); beyond this the disk, not the CPU, is the limit.
+constexpr unsigned MAX_DEFAULT_READ_WORKERS = 8;
+
+std::chrono::microseconds microsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+}
+
+// Holds the writer lock for a data_id's shard for the lifetime of the guard.
+class ShardWriteGuard {
+public:
+    ShardWriteGuard(Utils::FileLock& lock, const std::string& data_id, bool blocking)
+        : m_lock(lock), m_slot(Utils::FileLock::slotForKey(data_id, LOCK_SHARD_COUNT)), m_owned(false) {
+        m_owned = blocking ? (m_lock.lock(m_slot) == Error::Errc::Success) : m_lock.tryLock(m_slot);
+    }
+    ~ShardWriteGuard() {
+        if (m_owned) {
+            m_lock.unlock(m_slot);
+        }
+    }
+    bool owned() const { return m_owned; }
+
+private:
+    ShardWriteGuard(const ShardWriteGuard&) = delete;
+    ShardWriteGuard& operator=(const ShardWriteGuard&) = delete;
+
+    Utils::FileLock& m_lock;
+    uint64_t m_slot;
+    bool m_owned;
+};
+
+} // namespace
+
+SecureStore::SecureStore(std::string rootStoragePath, std::string deviceSerialNumber,
+                         const RecoveryOptions& recoveryOptions,
+                         const Crypto::KeyCacheOptions& keyCache)
     : m_rootStoragePath(std::move(rootStoragePath)),
       m_keyProvider(nullptr), // Initialize later
       m_encryptor(nullptr),   // Initialize later
+      m_cipher(Crypto::CipherAlgorithm::Aes256Gcm),
+      m_sharedCache(nullptr),
+      m_defaultDurability(Durability::Full),
+      m_segmentOptions(),
+      m_negativeFilter(nullptr),
+      m_plainCache(nullptr),
+      m_historyDepth(0),
       m_initialized(false) {
 
     if (m_rootStoragePath.empty()) {
@@ -23,6 +70,8 @@ SecureStore::SecureStore(std::string rootStoragePath, std::string deviceSerialNu
         return; // m_initialized remains false
     }
 
+    auto phase_start = std::chrono::steady_clock::now();
+
     // Ensure root path ends with a slash for consistent path joining
     if (m_rootStoragePath.back() != '/' && m_rootStoragePath.back() != '\\') {
         m_rootStoragePath += '/';
@@ -36,11 +85,55 @@ SecureStore::SecureStore(std::string rootStoragePath, std::string deviceSerialNu
         return; // m_initialized remains false
     }
 
+    m_rootDir = std::unique_ptr<Utils::DirFileUtil>(new Utils::DirFileUtil(m_rootStoragePath));
+    if (!m_rootDir->isOpen()) {
+        SS_LOG_ERROR("SecureStore: Failed to open root storage directory: " << m_rootStoragePath);
+        m_rootDir.reset();
+        return; // m_initialized remains false
+    }
+
+    m_deferredSync = std::unique_ptr<DeferredSync>(new DeferredSync(*m_rootDir, DEFAULT_DEFERRED_SYNC_INTERVAL));
+
+    m_writeLock = std::unique_ptr<Utils::FileLock>(new Utils::FileLock(m_rootStoragePath + LOCK_FILE_NAME));
+    if (!m_writeLock->isOpen()) {
+        SS_LOG_ERROR("SecureStore: Failed to open lock file in root storage directory: " << m_rootStoragePath);
+        m_writeLock.reset();
+        return; // m_initialized remains false
+    }
+    m_repairLock = std::unique_ptr<Utils::FileLock>(new Utils::FileLock(m_rootStoragePath + LOCK_FILE_NAME));
+    if (!m_repairLock->isOpen()) {
+        // Repairs then lock through m_writeLock, which still excludes other stores.
+        SS_LOG_WARN("SecureStore: Failed to open a second lock file handle for repairs in " << m_rootStoragePath);
+        m_repairLock.reset();
+    }
+    m_initTimings.directorySetup = microsSince(phase_start);
+
+    if (recoveryOptions.enabled) {
+        phase_start = std::chrono::steady_clock::now();
+        runStartupRecovery(recoveryOptions);
+        m_initTimings.recovery = microsSince(phase_start);
+    }
+
     // Initialize crypto components
+    phase_start = std::chrono::steady_clock::now();
     // Using C++11 style `new` for unique_ptr as make_unique is C++14
     m_keyProvider = std::unique_ptr<Crypto::KeyProvider>(new Crypto::KeyProvider(std::move(deviceSerialNumber)));
+    Crypto::KeyCacheOptions key_cache = keyCache;
+    if (key_cache.checkFile.empty()) {
+        key_cache.checkFile = m_rootStoragePath + KEY_CHECK_FILE_NAME;
+    }
+    m_keyProvider->setKeyCache(key_cache);
     m_encryptor = std::unique_ptr<Crypto::Encryptor>(new Crypto::Encryptor()); // Uses default seed
+    // A kernel crypto engine (AF_ALG gcm(aes)) is used where it beats mbedtls; the cipher
+    // benchmark below then already times AES-256-GCM on it.
+    const Crypto::CipherBackendKind backend = m_encryptor->selectFastestBackend();
+    SS_LOG_INFO("SecureStore: Running AES-256-GCM on " << Crypto::Encryptor::backendName(backend) << ".");
+    // Without AES instructions ChaCha20-Poly1305 is several times faster; let the machine decide.
+    m_cipher.store(m_encryptor->selectFastestAlgorithm(), std::memory_order_relaxed);
+    SS_LOG_INFO("SecureStore: Writing records with " << Crypto::Encryptor::algorithmName(m_cipher.load()) << ".");
+    m_initTimings.cryptoSetup = microsSince(phase_start);
 
+    phase_start = std::chrono::steady_clock::now();
     // Derive and store the master encryption key
     Error::Errc keyErr = m_keyProvider->getEncryptionKey(m_masterKey, Crypto::AES_GCM_KEY_SIZE_BYTES);
     if (keyErr != Error::Errc::Success) {
@@ -50,144 +143,1237 @@ SecureStore::SecureStore(std::string rootStoragePath, std::string deviceSerialNu
         m_encryptor.reset();
         return; // m_initialized remains false
     }
+    m_initTimings.keyDerivation = microsSince(phase_start);
+
+    m_sharedCachePath = SharedRecordCache::segmentPathForRoot(m_rootStoragePath);
+    attachSharedCacheIfPresent();
+
+    // Only a hint: a missing or unreadable hot set just means prefetching starts cold.
+    m_hotSet.load(*m_rootDir);
+
+    m_repairQueue = std::unique_ptr<RepairQueue>(new RepairQueue(*this, RepairOptions()));
+
+    // Applied changes are flushed together by the log's checkpoint, not one by one.
+    m_transactionLog = std::unique_ptr<TransactionLog>(new TransactionLog(
+        *m_rootDir, *m_writeLock, TRANSACTION_LOG_LOCK_SLOT, [this](const TransactionOp& op) {
+            return op.remove ? removeRecord(op.dataId)
+                              : writeRecord(op.dataId, op.data.data(), op.data.size(), Durability::None);
+        }));
+    Error::Errc redo_err = m_transactionLog->recover(
+        [this](const std::vector<unsigned char>& record, std::vector<unsigned char>& plain) {
+            return decryptRecord(TRANSACTION_LOG_FILE_NAME, record, plain, RECORD_KIND_TRANSACTION_LOG);
+        });
+    if (redo_err != Error::Errc::Success) {
+        // Not fatal: readers already see the transactions, and the applier keeps retrying.
+        SS_LOG_WARN("SecureStore: Redoing the transaction log failed (Error: " << static_cast<int>(redo_err) << ").");
+    }
 
     SS_LOG_INFO("SecureStore initialized successfully. Root path: " << m_rootStoragePath);
     m_initialized = true;
 }
 
+void SecureStore::runStartupRecovery(const RecoveryOptions& options) {
+    std::vector<std::string> data_ids;
+    Error::Errc err = StartupRecovery::run(*m_rootDir, *m_writeLock, LOCK_SHARD_COUNT, options,
+                                           m_recoveryReport, data_ids);
+    if (err != Error::Errc::Success) {
+        // Not fatal: every operation still works, the leftovers just stay until the next start.
+        SS_LOG_WARN("SecureStore: Startup recovery failed (Error: " << static_cast<int>(err) << ").");
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_idIndexMutex);
+        m_idIndex.reserve(data_ids.size());
+        m_idIndex.insert(data_ids.begin(), data_ids.end());
+    }
+    const RecoveryReport& r = m_recoveryReport;
+    SS_LOG_INFO("SecureStore: Startup recovery scanned " << r.entriesScanned << " files in "
+                << r.scanTime.count() << " us: " << r.dataIds << " ids, " << r.tempFilesRemoved
+                << " temp files removed, " << r.backupsPromoted << " backups promoted, "
+                << r.skippedBusy << " busy, " << r.failures << " failures (repair "
+                << r.repairTime.count() << " us, " << r.workerThreads << " workers).");
+}
+
+StoreInitTimings SecureStore::getInitTimings() const {
+    return m_initTimings;
+}
+
+RecoveryReport SecureStore::getRecoveryReport() const {
+    return m_recoveryReport;
+}
+
+Error::Errc SecureStore::listIndexedIds(std::vector<std::string>& out_data_ids) const {
+    out_data_ids.clear();
+    if (!m_initialized) {
+        SS_LOG_ERROR("SecureStore not initialized. Cannot list indexed IDs.");
+        return Error::Errc::NotInitialized;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_idIndexMutex);
+        out_data_ids.assign(m_idIndex.begin(), m_idIndex.end());
+    }
+    std::sort(out_data_ids.begin(), out_data_ids.end());
+    return Error::Errc::Success;
+}
+
+void SecureStore::indexId(const std::string& data_id) {
+    std::lock_guard<std::mutex> lock(m_idIndexMutex);
+    NegativeLookupFilter* filter = m_negativeFilter.load(std::memory_order_relaxed); // Set under this mutex
+    if (m_idIndex.insert(data_id).second && filter) {
+        filter->add(data_id);
+        if (filter->needsRebuild()) {
+            filter->rebuild(m_idIndex);
+        }
+    }
+}
+
+void SecureStore::unindexId(const std::string& data_id) {
+    std::lock_guard<std::mutex> lock(m_idIndexMutex);
+    NegativeLookupFilter* filter = m_negativeFilter.load(std::memory_order_relaxed); // Set under this mutex
+    if (m_idIndex.erase(data_id) > 0 && filter) {
+        filter->remove();
+        if (filter->needsRebuild()) {
+            filter->rebuild(m_idIndex);
+        }
+    }
+}
+
+Error::Errc SecureStore::enableNegativeLookupFilter(double targetFalsePositiveRate) {
+    if (!m_initialized) {
+        SS_LOG_ERROR("SecureStore not initialized. Cannot enable negative lookup filter.");
+        return Error::Errc::NotInitialized;
+    }
+    std::lock_guard<std::mutex> feature_lock(m_featureMutex);
+    if (m_negativeFilter.load(std::memory_order_acquire)) {
+        return Error::Errc::Success;
+    }
+    const RecoveryReport& r = m_recoveryReport;
+    if (!r.ran || r.skippedBusy > 0 || r.failures > 0) {
+        SS_LOG_WARN("SecureStore: Not enabling the negative lookup filter; the startup scan "
+                    << (r.ran ? "left ids unrepaired" : "did not run") << ", so the id index may be incomplete.");
+        return Error::Errc::OperationFailed;
+    }
+    std::unique_ptr<NegativeLookupFilter> filter(new NegativeLookupFilter(targetFalsePositiveRate));
+    std::lock_guard<std::mutex> lock(m_idIndexMutex);
+    filter->rebuild(m_idIndex);
+    m_negativeFilterOwner = std::move(filter);
+    m_negativeFilter.store(m_negativeFilterOwner.get(), std::memory_order_release);
+    SS_LOG_INFO("SecureStore: Negative lookup filter enabled over " << m_idIndex.size() << " ids.");
+    return Error::Errc::Success;
+}
+
+NegativeLookupStats SecureStore::getNegativeLookupStats() const {
+    const NegativeLookupFilter* filter = m_negativeFilter.load(std::memory_order_acquire);
+    return filter ? filter->getStats() : NegativeLookupStats();
+}
+
+SharedRecordCache* SecureStore::attachSharedCacheIfPresent() {
+    SharedRecordCache* attached = m_sharedCache.load(std::memory_order_acquire);
+    if (attached || !Utils::FileUtil::pathExists(m_sharedCachePath)) {
+        return attached;
+    }
+    std::lock_guard<std::mutex> feature_lock(m_featureMutex);
+    attached = m_sharedCache.load(std::memory_order_acquire);
+    if (attached) {
+        return attached; // Another thread attached first
+    }
+    std::unique_ptr<SharedRecordCache> cache(new SharedRecordCache(m_sharedCachePath, false));
+    if (!cache->isAttached()) {
+        return nullptr;
+    }
+    m_sharedCacheOwner = std::move(cache);
+    m_sharedCache.store(m_sharedCacheOwner.get(), std::memory_order_release);
+    return m_sharedCacheOwner.get();
+}
+
+Error::Errc SecureStore::enableSharedReadCache(uint32_t slotCount, uint32_t slotDataSize) {
+    if (!m_initialized) {
+        SS_LOG_ERROR("SecureStore not initialized. Cannot enable shared read cache.");
+        return Error::Errc::NotInitialized;
+    }
+    std::lock_guard<std::mutex> feature_lock(m_featureMutex);
+    if (m_sharedCache.load(std::memory_order_acquire)) {
+        return Error::Errc::Success;
+    }
+    std::unique_ptr<SharedRecordCache> cache(new SharedRecordCache(m_sharedCachePath, true, slotCount, slotDataSize));
+    if (!cache->isAttached()) {
+        SS_LOG_ERROR("SecureStore: Failed to enable shared read cache at '" << m_sharedCachePath << "'.");
+        return Error::Errc::OperationFailed;
+    }
+    m_sharedCacheOwner = std::move(cache);
+    m_sharedCache.store(m_sharedCacheOwner.get(), std::memory_order_release);
+    return Error::Errc::Success;
+}
+
+SharedCacheStats SecureStore::getSharedCacheStats() const {
+    const SharedRecordCache* shared_cache = m_sharedCache.load(std::memory_order_acquire);
+    return shared_cache ? shared_cache->getStats() : SharedCacheStats();
+}
+
+Error::Errc SecureStore::enablePlaintextCache(size_t maxBytes) {
+    if (!m_initialized) {
+        SS_LOG_ERROR("SecureStore not initialized. Cannot enable plaintext cache.");
+        return Error::Errc::NotInitialized;
+    }
+    std::lock_guard<std::mutex> feature_lock(m_featureMutex);
+    if (!m_plainCache.load(std::memory_order_acquire)) {
+        m_plainCacheOwner = std::unique_ptr<PlaintextCache>(new PlaintextCache(maxBytes));
+        m_plainCache.store(m_plainCacheOwner.get(), std::memory_order_release);
+    }
+    return Error::Errc::Success;
+}
+
+PlaintextCacheStats SecureStore::getPlaintextCacheStats() const {
+    const PlaintextCache* plain_cache = m_plainCache.load(std::memory_order_acquire);
+    return plain_cache ? plain_cache->getStats() : PlaintextCacheStats();
+}
+
+Error::Errc SecureStore::prefetch(const std::vector<std::string>& data_ids, PrefetchReport& report,
+                                  unsigned workerThreads) {
+    report = PrefetchReport();
+    if (!m_initialized) {
+        SS_LOG_ERROR("SecureStore not initialized. Cannot prefetch.");
+        return Error::Errc::NotInitialized;
+    }
+    PlaintextCache* plain_cache = m_plainCache.load(std::memory_order_acquire);
+    if (!plain_cache) {
+        SS_LOG_ERROR("SecureStore: Prefetch needs the plaintext cache; call enablePlaintextCache() first.");
+        return Error::Errc::OperationFailed;
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    std::unordered_set<std::string> seen;
+    std::vector<std::string> todo;
+    std::vector<std::string> main_files;
+    for (const std::string& data_id : data_ids) {
+        if (validateDataId(data_id) != Error::Errc::Success) {
+            report.failed++;
+            continue;
+        }
+        if (!seen.insert(data_id).second) {
+            continue;
+        }
+        report.requested++;
+        if (plain_cache->contains(data_id)) {
+            report.alreadyCached++; // Validated by the read that uses it
+            continue;
+        }
+        todo.push_back(data_id);
+        main_files.push_back(getDataFileName(data_id));
+    }
+    if (todo.empty()) {
+        report.elapsed = microsSince(start);
+        return Error::Errc::Success;
+    }
+
+    // Let the kernel start reading every file before the first worker blocks on one.
+    m_rootDir->adviseWillNeed(main_files);
+
+    unsigned workers = workerThreads;
+    if (workers == 0) {
+        workers = std::min(std::max(std::thread::hardware_concurrency(), 1u), MAX_DEFAULT_READ_WORKERS);
+    }
+    workers = static_cast<unsigned>(std::min<size_t>(workers, todo.size()));
+    report.workerThreads = workers;
+
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> loaded(0);
+    std::atomic<size_t> not_found(0);
+    std::atomic<size_t> failed(0);
+    auto work = [&]() {
+        std::vector<unsigned char> record;
+        std::vector<unsigned char> plain;
+        for (size_t i = next.fetch_add(1); i < todo.size(); i = next.fetch_add(1)) {
+            Utils::FileIdentity identity;
+            Error::Errc err = m_rootDir->readFile(main_files[i], record, &identity);
+            if (err == Error::Errc::Success) {
+                err = decryptRecord(todo[i], record, plain);
+            }
+            if (err == Error::Errc::Success) {
+                plain_cache->insert(todo[i], identity, plain, true);
+                loaded++;
+            } else if (err == Error::Errc::FileOpenFailed && !m_rootDir->pathExists(main_files[i])) {
+                not_found++;
+            } else {
+                SS_LOG_DEBUG("Prefetch of id '" << todo[i] << "' failed (Error: " << static_cast<int>(err)
+                             << "); leaving it to the read path.");
+                failed++;
+            }
+        }
+        Utils::secureWipe(plain);
+    };
+    if (workers <= 1) {
+        work();
+    } else {
+        std::vector<std::thread> pool;
+        pool.reserve(workers);
+        for (unsigned k = 0; k < workers; ++k) {
+            pool.push_back(std::thread(work));
+        }
+        for (std::thread& worker : pool) {
+            worker.join();
+        }
+    }
+
+    report.loaded = loaded.load();
+    report.notFound = not_found.load();
+    report.failed += failed.load();
+    report.elapsed = microsSince(start);
+    SS_LOG_INFO("SecureStore: Prefetched " << report.loaded << " of " << report.requested << " ids in "
+                << report.elapsed.count() << " us (" << report.alreadyCached << " already cached, "
+                << report.notFound << " not found, " << report.failed << " failed, "
+                << report.workerThreads << " workers).");
+    return Error::Errc::Success;
+}
+
+std::vector<std::string> SecureStore::getHotSet(size_t limit) const {
+    return m_hotSet.hottest(limit);
+}
+
+Error::Errc SecureStore::saveHotSet() {
+    if (!m_initialized) {
+        SS_LOG_ERROR("SecureStore not initialized. Cannot save hot set.");
+        return Error::Errc::NotInitialized;
+    }
+    return m_hotSet.save(*m_rootDir);
+}
+
+Error::Errc SecureStore::scrubRecord(const std::string& data_id, ScrubRecordResult& result) {
+    result = ScrubRecordResult();
+    if (!m_initialized) {
+        SS_LOG_ERROR("SecureStore not initialized. Cannot scrub data.");
+        return Error::Errc::NotInitialized;
+    }
+    Error::Errc id_validation_err = validateDataId(data_id);
+    if (id_validation_err != Error::Errc::Success) {
+        return id_validation_err;
+    }
+
+    const std::string main_file = getDataFileName(data_id);
+    const std::string backup_file = getBackupFileName(data_id);
+    std::vector<unsigned char> main_raw;
+    std::vector<unsigned char> backup_raw;
+    std::vector<unsigned char> plain;
+    bool main_present = false;
+    auto verify = [&]() {
+        main_raw.clear();
+        backup_raw.clear();
+        Error::Errc main_read = m_rootDir->readFile(main_file, main_raw);
+        Error::Errc backup_read = m_rootDir->readFile(backup_file, backup_raw);
+        main_present = main_read == Error::Errc::Success || m_rootDir->pathExists(main_file);
+        result.backupPresent = backup_read == Error::Errc::Success || m_rootDir->pathExists(backup_file);
+        result.mainValid = main_read == Error::Errc::Success &&
+                           decryptRecord(data_id, main_raw, plain) == Error::Errc::Success;
+        result.backupValid = backup_read == Error::Errc::Success &&
+                             decryptRecord(data_id, backup_raw, plain) == Error::Errc::Success;
+        result.bytesRead += main_raw.size() + backup_raw.size();
+        Utils::secureWipe(plain);
+    };
+
+    verify();
+    if (!main_present && !result.backupPresent) {
+        return Error::Errc::DataNotFound; // Deleted since it was listed
+    }
+    if (result.mainValid && (result.backupValid || !result.backupPresent)) {
+        return Error::Errc::Success;
+    }
+
+    // Something looks damaged. Writers may be mid-way through replacing the id, so look
+    // again while holding its shard, and never wait for a writer to do so.
+    ShardWriteGuard guard(m_repairLock ? *m_repairLock : *m_writeLock, data_id, false);
+    if (!guard.owned()) {
+        result.skippedBusy = true;
+        return Error::Errc::Success;
+    }
+    verify();
+    if (!main_present && !result.backupPresent) {
+        return Error::Errc::DataNotFound;
+    }
+    if (result.mainValid && result.backupPresent && !result.backupValid) {
+        SS_LOG_WARN("Scrubber: Backup of id '" << data_id << "' failed authentication; rewriting it from the main file.");
+        Error::Errc err = m_rootDir->atomicWriteFile(backup_file, main_raw);
+        if (err != Error::Errc::Success) {
+            SS_LOG_ERROR("Scrubber: Failed to repair backup of id '" << data_id << "'. Error: " << static_cast<int>(err));
+            return err;
+        }
+        result.backupRepaired = true;
+    } else if (!result.mainValid && result.backupValid) {
+        SS_LOG_WARN("Scrubber: Main file of id '" << data_id << "' is " << (main_present ? "corrupt" : "missing")
+                    << "; restoring it from the backup.");
+        SharedRecordCache* shared_cache = attachSharedCacheIfPresent();
+        if (shared_cache) {
+            shared_cache->invalidate(data_id);
+        }
+        PlaintextCache* plain_cache = m_plainCache.load(std::memory_order_acquire);
+        if (plain_cache) {
+            plain_cache->invalidate(data_id);
+        }
+        Error::Errc err = m_rootDir->atomicWriteFile(main_file, backup_raw);
+        if (err != Error::Errc::Success) {
+            SS_LOG_ERROR("Scrubber: Failed to restore main file of id '" << data_id << "'. Error: " << static_cast<int>(err));
+            return err;
+        }
+        result.mainRepaired = true;
+        indexId(data_id);
+    } else if (!result.mainValid && !result.backupValid) {
+        SS_LOG_ERROR("Scrubber: No copy of id '" << data_id << "' authenticates; it cannot be repaired.");
+        result.unrecoverable = true;
+    }
+    return Error::Errc::Success;
+}
+
+Error::Errc SecureStore::startScrubber(const ScrubOptions& options) {
+    if (!m_initialized) {
+        SS_LOG_ERROR("SecureStore not initialized. Cannot start scrubber.");
+        return Error::Errc::NotInitialized;
+    }
+    if (m_scrubber) {
+        SS_LOG_WARN("SecureStore: A scrubber is already running.");
+        return Error::Errc::OperationFailed;
+    }
+    m_scrubber = std::unique_ptr<Scrubber>(new Scrubber(*this, options));
+    return Error::Errc::Success;
+}
+
+void SecureStore::stopScrubber() {
+    m_scrubber.reset();
+}
+
+Error::Errc SecureStore::requestScrubPass() {
+    if (!m_scrubber) {
+        return Error::Errc::OperationFailed;
+    }
+    m_scrubber->requestPass();
+    return Error::Errc::Success;
+}
+
+Error::Errc SecureStore::runPendingRepairs() {
+    if (!m_initialized) {
+        SS_LOG_ERROR("SecureStore not initialized. Cannot run repairs.");
+        return Error::Errc::NotInitialized;
+    }
+    return m_repairQueue->runPending();
+}
+
+RepairStats SecureStore::getRepairStats() const {
+    return m_repairQueue ? m_repairQueue->getStats() : RepairStats();
+}
+
+ScrubStats SecureStore::getScrubStats() const {
+    return m_scrubber ? m_scrubber->getStats() : ScrubStats();
+}
+
+void SecureStore::setAnonymousTempFilesEnabled(bool enabled) {
+    if (m_rootDir) {
+        m_rootDir->setAnonymousFilesEnabled(enabled);
+    }
+}
+
+void SecureStore::setDefaultDurability(Durability durability) {
+    m_defaultDurability.store(durability, std::memory_order_relaxed);
+}
+
+Durability SecureStore::getDefaultDurability() const {
+    return m_defaultDurability.load(std::memory_order_relaxed);
+}
+
+void SecureStore::setDeferredSyncInterval(std::chrono::milliseconds interval) {
+    if (m_deferredSync) {
+        m_deferredSync->setInterval(interval);
+    }
+}
+
+Error::Errc SecureStore::syncDeferred() {
+    if (!m_initialized) {
+        SS_LOG_ERROR("SecureStore not initialized. Cannot sync deferred writes.");
+        return Error::Errc::NotInitialized;
+    }
+    return m_deferredSync->flush();
+}
+
+Utils::FileIoStats SecureStore::getIoStats() const {
+    return m_rootDir ? m_rootDir->getIoStats() : Utils::FileIoStats();
+}
+
+Crypto::KeyCacheStats SecureStore::getKeyCacheStats() const {
+    return m_keyProvider ? m_keyProvider->getKeyCacheStats() : Crypto::KeyCacheStats();
+}
+
 bool SecureStore::isInitialized() const {
     return m_initialized;
 }
 
-std::string SecureStore::getDataFilePath(const std::string& data_id) const {
-    return m_rootStoragePath + data_id + DATA_FILE_EXTENSION;
+std::string SecureStore::getDataFileName(const std::string& data_id) const {
+    std::string name;
+    getDataFileName(data_id, name);
+    return name;
+}
+
+void SecureStore::getDataFileName(const std::string& data_id, std::string& out_name) const {
+    out_name.assign(data_id).append(DATA_FILE_EXTENSION);
+}
+
+std::string SecureStore::getBackupFileName(const std::string& data_id) const {
+    std::string name;
+    getBackupFileName(data_id, name);
+    return name;
+}
+
+void SecureStore::getBackupFileName(const std::string& data_id, std::string& out_name) const {
+    // Backup file is just the main file name + .bak suffix
+    out_name.assign(data_id).append(DATA_FILE_EXTENSION).append(BACKUP_FILE_EXTENSION);
+}
+
+std::string SecureStore::getTempFileName(const std::string& data_id) const {
+    std::string name;
+    getTempFileName(data_id, name);
+    return name;
+}
+
+void SecureStore::getTempFileName(const std::string& data_id, std::string& out_name) const {
+    out_name.assign(data_id).append(DATA_FILE_EXTENSION).append(TEMP_FILE_SUFFIX);
+}
+
+
+Error::Errc SecureStore::validateDataId(const std::string& data_id) const {
+    if (data_id.empty()) {
+        SS_LOG_WARN("Invalid data_id: cannot be empty.");
+        return Error::Errc::InvalidArgument;
+    }
+    // Check for problematic characters like path separators or '..'
+    // A more robust check might involve a whitelist of allowed characters.
+    if (data_id.find('/') != std::string::npos ||
+        data_id.find('\\') != std::string::npos ||
+        data_id.find("..") != std::string::npos) {
+        SS_LOG_WARN("Invalid data_id: '" << data_id << "' contains forbidden characters or sequences.");
+        return Error::Errc::InvalidArgument;
+    }
+    // Check length, etc. if needed
+    return Error::Errc::Success;
+}
+
+
+Error::Errc SecureStore::decryptRecord(const std::string& data_id, const std::vector<unsigned char>& record,
+                                       std::vector<unsigned char>& out_plain_data, uint8_t kind) {
+    PlainOutput out;
+    out.vector = &out_plain_data;
+    return decryptRecord(data_id, record.data(), record.size(), out, kind);
+}
+
+Error::Errc SecureStore::decryptRecord(const std::string& data_id, const unsigned char* record, size_t record_size,
+                                       PlainOutput& out, uint8_t kind) {
+    if (out.vector) {
+        out.vector->clear();
+    }
+    RecordHeader header;
+    size_t body_offset = RecordFormat::parseHeader(record, record_size, header);
+    const unsigned char* body = record + body_offset;
+    const size_t body_size = record_size - body_offset;
+
+    Crypto::CipherAlgorithm cipher = Crypto::CipherAlgorithm::Aes256Gcm;
+    Utils::ScratchBuffer aad_scratch;
+    std::vector<unsigned char>& aad = aad_scratch.get();
+    if (header.version == RECORD_FORMAT_VERSION_LEGACY ? kind != RECORD_KIND_DATA : header.kind != kind) {
+        SS_LOG_WARN("Record read for id '" << data_id << "' is not of the expected kind " << static_cast<int>(kind) << ".");
+        return Error::Errc::AuthenticationFailed;
+    }
+    if (header.version == RECORD_FORMAT_VERSION_LEGACY) {
+        // Compatibility path: legacy records were encrypted without AAD and are not bound to their id.
+        SS_LOG_DEBUG("Record for id '" << data_id << "' uses the legacy format; it will be upgraded on next write.");
+    } else {
+        if (!RecordFormat::cipherForAlgorithmId(header.algorithm, cipher)) {
+            SS_LOG_ERROR("Record for id '" << data_id << "' uses unsupported algorithm id " << static_cast<int>(header.algorithm) << ".");
+            return Error::Errc::DeserializationFailed;
+        }
+        RecordFormat::buildAad(header, data_id, aad);
+    }
+
+    // Size the destination from the record before decrypting anything.
+    size_t plain_size = Crypto::Encryptor::decryptedSize(body_size);
+    if (header.version == RECORD_FORMAT_VERSION_SEGMENTED) {
+        Error::Errc size_err = SegmentedRecord::plaintextSize(body, body_size, plain_size);
+        if (size_err != Error::Errc::Success) {
+            return size_err;
+        }
+    }
+    out.size = plain_size;
+    unsigned char* dest = out.buffer;
+    size_t capacity = out.capacity;
+    if (out.vector) {
+        out.vector->resize(plain_size);
+        dest = out.vector->data();
+        capacity = plain_size;
+    } else if (capacity < plain_size) {
+        return Error::Errc::BufferTooSmall;
+    }
+
+    Error::Errc err;
+    if (header.version == RECORD_FORMAT_VERSION_SEGMENTED) {
+        err = SegmentedRecord::decrypt(*m_encryptor, m_masterKey, cipher, aad, body, body_size,
+                                       m_segmentOptions.workers, dest, capacity);
+    } else {
+        size_t written = 0;
+        err = m_encryptor->decrypt(body, body_size, m_masterKey.data(), m_masterKey.size(), dest, capacity, written,
+                                   aad.data(), aad.size(), cipher);
+    }
+    if (err != Error::Errc::Success) {
+        Utils::secureWipe(dest, plain_size);
+        if (out.vector) {
+            out.vector->clear();
+        }
+    }
+    return err;
+}
+
+std::string SecureStore::getHistoryFileName(const std::string& data_id) const {
+    return data_id + DATA_FILE_EXTENSION + HISTORY_FILE_EXTENSION;
+}
+
+Error::Errc SecureStore::encryptRecord(const std::string& aad_id, const unsigned char* plain_data, size_t size,
+                                       std::vector<unsigned char>& out_record, uint8_t kind) {
+    // Records are always written in the current format; legacy records are upgraded
+    // opportunistically the next time their id is written.
+    const Crypto::CipherAlgorithm cipher = m_cipher.load(std::memory_order_relaxed);
+    RecordHeader header;
+    header.algorithm = RecordFormat::algorithmId(cipher);
+    header.kind = kind;
+    Utils::ScratchBuffer aad_scratch;
+    std::vector<unsigned char>& aad = aad_scratch.get();
+    if (m_segmentOptions.threshold > 0 && size >= m_segmentOptions.threshold) {
+        header.version = RECORD_FORMAT_VERSION_SEGMENTED;
+        RecordFormat::buildAad(header, aad_id, aad);
+        out_record.assign(aad.begin(), aad.begin() + RECORD_HEADER_SIZE);
+        return SegmentedRecord::encrypt(*m_encryptor, m_masterKey, cipher, aad, plain_data, size,
+                                        m_segmentOptions.segmentSize, m_segmentOptions.workers, out_record);
+    }
+    RecordFormat::buildAad(header, aad_id, aad);
+
+    // The serialized header is the prefix of the AAD; the body is encrypted right behind it.
+    out_record.resize(RECORD_HEADER_SIZE + Crypto::Encryptor::encryptedSize(size));
+    std::copy(aad.begin(), aad.begin() + RECORD_HEADER_SIZE, out_record.begin());
+    size_t body_size = 0;
+    Error::Errc enc_err = m_encryptor->encrypt(plain_data, size, m_masterKey.data(), m_masterKey.size(),
+                                               out_record.data() + RECORD_HEADER_SIZE, out_record.size() - RECORD_HEADER_SIZE,
+                                               body_size, aad.data(), aad.size(), cipher);
+    if (enc_err != Error::Errc::Success) {
+        out_record.clear();
+        return enc_err;
+    }
+    return Error::Errc::Success;
+}
+
+Error::Errc SecureStore::encryptRecordInPlace(const std::string& aad_id, std::vector<unsigned char>& buffer) {
+    const Crypto::CipherAlgorithm cipher = m_cipher.load(std::memory_order_relaxed);
+    RecordHeader header;
+    header.algorithm = RecordFormat::algorithmId(cipher);
+    Utils::ScratchBuffer aad_scratch;
+    std::vector<unsigned char>& aad = aad_scratch.get();
+    const size_t size = buffer.size();
+    if (m_segmentOptions.threshold > 0 && size >= m_segmentOptions.threshold) {
+        header.version = RECORD_FORMAT_VERSION_SEGMENTED;
+        RecordFormat::buildAad(header, aad_id, aad);
+        Error::Errc err = SegmentedRecord::encryptInPlace(*m_encryptor, m_masterKey, cipher, aad, buffer, RECORD_HEADER_SIZE,
+                                                          m_segmentOptions.segmentSize, m_segmentOptions.workers);
+        if (err == Error::Errc::Success) {
+            std::copy(aad.begin(), aad.begin() + RECORD_HEADER_SIZE, buffer.begin());
+        }
+        return err;
+    }
+    RecordFormat::buildAad(header, aad_id, aad);
+
+    // [Header][IV][Plaintext][Tag]: the plaintext moves up once and is encrypted where it lies.
+    buffer.resize(RECORD_HEADER_SIZE + Crypto::Encryptor::encryptedSize(size));
+    std::memmove(buffer.data() + RECORD_HEADER_SIZE + Crypto::AES_GCM_IV_SIZE_BYTES, buffer.data(), size);
+    std::copy(aad.begin(), aad.begin() + RECORD_HEADER_SIZE, buffer.begin());
+    Error::Errc err = m_encryptor->encryptInPlace(buffer.data() + RECORD_HEADER_SIZE, size, m_masterKey.data(),
+                                                  m_masterKey.size(), aad.data(), aad.size(), cipher);
+    if (err != Error::Errc::Success) {
+        Utils::secureWipe(buffer);
+    }
+    return err;
+}
+
+size_t SecureStore::recordOverhead(size_t plaintextSize) const {
+    if (m_segmentOptions.threshold > 0 && plaintextSize >= m_segmentOptions.threshold) {
+        return RECORD_HEADER_SIZE + SegmentedRecord::bodyOverhead(plaintextSize, m_segmentOptions.segmentSize);
+    }
+    return RECORD_HEADER_SIZE + Crypto::Encryptor::encryptedSize(0);
+}
+
+Error::Errc SecureStore::storeData(const std::string& data_id, const std::vector<unsigned char>& plain_data) {
+    return storeData(data_id, plain_data.data(), plain_data.size(),
+                     m_defaultDurability.load(std::memory_order_relaxed));
 }
 
-std::string SecureStore::getBackupFilePath(const std::string& data_id) const {
-    // Backup file is just the main file path + .bak suffix to that full path
-    return m_rootStoragePath + data_id + DATA_FILE_EXTENSION + BACKUP_FILE_EXTENSION;
+Error::Errc SecureStore::storeData(const std::string& data_id, const std::vector<unsigned char>& plain_data,
+                                   Durability durability) {
+    return storeData(data_id, plain_data.data(), plain_data.size(), durability);
 }
 
-std::string SecureStore::getTempFilePath(const std::string& data_id) const {
-    return m_rootStoragePath + data_id + DATA_FILE_EXTENSION + TEMP_FILE_SUFFIX;
+Error::Errc SecureStore::storeData(const std::string& data_id, std::vector<unsigned char>&& plain_data) {
+    return storeData(data_id, std::move(plain_data), m_defaultDurability.load(std::memory_order_relaxed));
+}
+
+Error::Errc SecureStore::storeData(const std::string& data_id, std::vector<unsigned char>&& plain_data,
+                                   Durability durability) {
+    Error::Errc err = Error::Errc::Success;
+    if (!m_initialized) {
+        SS_LOG_ERROR("SecureStore not initialized. Cannot store data.");
+        err = Error::Errc::NotInitialized;
+    } else {
+        err = validateDataId(data_id);
+    }
+    if (err == Error::Errc::Success) {
+        err = applyTransactionsTouching(data_id);
+    }
+    if (err == Error::Errc::Success) {
+        err = writeRecordInPlace(data_id, plain_data, durability);
+    }
+    // Zeroized whatever it holds now (ciphertext, or plaintext if the write stopped early)
+    // and emptied with its capacity kept, so the caller can reuse it for the next record.
+    Utils::secureWipe(plain_data);
+    return err;
+}
+
+Error::Errc SecureStore::storeData(const std::string& data_id, const unsigned char* data, size_t size) {
+    return storeData(data_id, data, size, m_defaultDurability.load(std::memory_order_relaxed));
+}
+
+Error::Errc SecureStore::storeData(const std::string& data_id, const unsigned char* data, size_t size,
+                                   Durability durability) {
+    if (!m_initialized) {
+        SS_LOG_ERROR("SecureStore not initialized. Cannot store data.");
+        return Error::Errc::NotInitialized;
+    }
+    Error::Errc id_validation_err = validateDataId(data_id);
+    if (id_validation_err != Error::Errc::Success) {
+        return id_validation_err;
+    }
+    if (data == nullptr && size > 0) {
+        SS_LOG_ERROR("Null data of " << size << " bytes passed for id '" << data_id << "'.");
+        return Error::Errc::InvalidArgument;
+    }
+    Error::Errc txn_err = applyTransactionsTouching(data_id);
+    if (txn_err != Error::Errc::Success) {
+        return txn_err;
+    }
+    return writeRecord(data_id, data, size, durability);
+}
+
+Error::Errc SecureStore::writeRecord(const std::string& data_id, const unsigned char* plain_data, size_t size,
+                                     Durability durability) {
+    Utils::ScratchBuffer encrypted_scratch;
+    std::vector<unsigned char>& encrypted_data = encrypted_scratch.get();
+    Error::Errc enc_err = encryptRecord(data_id, plain_data, size, encrypted_data);
+    if (enc_err != Error::Errc::Success) {
+        SS_LOG_ERROR("Failed to encrypt data for id '" << data_id << "'. Error: " << static_cast<int>(enc_err));
+        return enc_err;
+    }
+    return installRecord(data_id, encrypted_data, durability, m_historyDepth.load(std::memory_order_relaxed) > 0,
+                         plain_data, size);
+}
+
+Error::Errc SecureStore::writeRecordInPlace(const std::string& data_id, std::vector<unsigned char>& buffer,
+                                            Durability durability) {
+    if (m_historyDepth.load(std::memory_order_relaxed) > 0) {
+        // The history delta is taken against the new plaintext, under the shard lock and
+        // after encryption; keep it intact and encrypt into a second buffer.
+        return writeRecord(data_id, buffer.data(), buffer.size(), durability);
+    }
+    Error::Errc enc_err = encryptRecordInPlace(data_id, buffer);
+    if (enc_err != Error::Errc::Success) {
+        SS_LOG_ERROR("Failed to encrypt data for id '" << data_id << "'. Error: " << static_cast<int>(enc_err));
+        return enc_err;
+    }
+    return installRecord(data_id, buffer, durability, false, nullptr, 0);
+}
+
+Error::Errc SecureStore::installRecord(const std::string& data_id, const std::vector<unsigned char>& encrypted_data,
+                                       Durability durability, bool keep_history, const unsigned char* plain_data,
+                                       size_t size) {
+
+    // File names are relative to m_rootDir, so the kernel never re-resolves the root path.
+    Utils::ScratchName main_name, backup_name, temp_name;
+    const std::string& main_file = main_name.get();
+    const std::string& backup_file = backup_name.get();
+    const std::string& temp_file = temp_name.get(); // Use a distinct temp file name
+    getDataFileName(data_id, main_name.get());
+    getBackupFileName(data_id, backup_name.get());
+    getTempFileName(data_id, temp_name.get());
+
+    // Serialize the temp/backup/main rename sequence with other writers of this shard.
+    ShardWriteGuard guard(*m_writeLock, data_id, true);
+    if (!guard.owned()) {
+        SS_LOG_ERROR("Failed to acquire write lock for id '" << data_id << "'.");
+        return Error::Errc::OperationFailed;
+    }
+
+    // The record is flushed before it is renamed into place, so the rename can only ever
+    // expose complete content; None and Deferred skip that flush.
+    Utils::FileSync file_sync = Utils::FileSync::None;
+    if (durability == Durability::Full) {
+        file_sync = Utils::FileSync::Full;
+    } else if (durability == Durability::DataSync) {
+        file_sync = Utils::FileSync::Data;
+    }
+
+    // The replaced version goes into the history first, so a crash never loses it; an
+    // entry whose write then fails does not link to the main file and is skipped. The
+    // caches still hold the replaced version here, which spares decrypting it again.
+    if (keep_history) {
+        Error::Errc hist_err = appendHistory(data_id, plain_data, size, file_sync);
+        if (hist_err != Error::Errc::Success) {
+            SS_LOG_ERROR("Failed to record history for id '" << data_id << "'. Error: " << static_cast<int>(hist_err));
+            return hist_err;
+        }
+    }
+
+    // Drop any cached copy before the main file changes, so a crash mid-way cannot leave
+    // a stale entry behind. Readers cannot refill it while we hold the shard lock.
+    SharedRecordCache* shared_cache = attachSharedCacheIfPresent();
+    if (shared_cache) {
+        shared_cache->invalidate(data_id);
+    }
+    PlaintextCache* plain_cache = m_plainCache.load(std::memory_order_acquire);
+    if (plain_cache) {
+        plain_cache->invalidate(data_id);
+    }
+
+    // Preferred path: the record never exists under a temporary name. Falls back to a
+    // named temporary file where O_TMPFILE or RENAME_EXCHANGE is unavailable.
+    Error::Errc install_err = installRecordAnonymously(main_file, backup_file, encrypted_data, file_sync);
+    if (install_err == Error::Errc::OperationFailed) {
+        install_err = installRecordViaTempFile(data_id, main_file, backup_file, temp_file, encrypted_data, file_sync);
+    }
+    if (install_err != Error::Errc::Success) {
+        SS_LOG_ERROR("Failed to install new record for id '" << data_id << "'. Error: " << static_cast<int>(install_err));
+        return install_err;
+    }
+
+    if (durability == Durability::Full) {
+        // One directory fsync (on the cached descriptor) makes all the renames above durable.
+        m_rootDir->syncDirectory();
+    } else if (durability == Durability::Deferred) {
+        m_deferredSync->markPending();
+    }
+
+    if (shared_cache) {
+        // Write-through: other processes get the new record without touching the disk. A
+        // record the slot cannot hold is not published; invalidate again so that a reader
+        // which read the replaced file after our first invalidation cannot publish it.
+        if (!shared_cache->fill(data_id, encrypted_data, shared_cache->sequenceFor(data_id))) {
+            shared_cache->invalidate(data_id);
+        }
+    }
+    indexId(data_id);
+
+    SS_LOG_INFO("Successfully stored data for id '" << data_id << "' to '" << main_file << "'.");
+    return Error::Errc::Success;
+}
+
+Error::Errc SecureStore::installRecordAnonymously(const std::string& main_file, const std::string& backup_file,
+                                                  const std::vector<unsigned char>& record, Utils::FileSync sync) {
+    if (!m_rootDir->anonymousFilesEnabled() || !m_rootDir->exchangeEnabled()) {
+        return Error::Errc::OperationFailed;
+    }
+    // The backup slot is about to receive the new record and is then swapped with main,
+    // which leaves main = new record and backup = previous main in a single rename.
+    Error::Errc err = m_rootDir->deleteFile(backup_file);
+    if (err != Error::Errc::Success) {
+        return err;
+    }
+    err = m_rootDir->linkNewFile(backup_file, record, sync);
+    if (err != Error::Errc::Success) {
+        return err; // OperationFailed (no O_TMPFILE) makes the caller fall back
+    }
+    err = m_rootDir->exchangeFiles(backup_file, main_file);
+    if (err == Error::Errc::Success) {
+        return Error::Errc::Success;
+    }
+    if (err == Error::Errc::PathNotFound) {
+        // First version of this id: there is no main to keep as backup.
+        return m_rootDir->renameFile(backup_file, main_file);
+    }
+    // Exchange unsupported or failed; main is untouched. Drop the new record from the
+    // backup slot so the fallback starts from a consistent state.
+    m_rootDir->deleteFile(backup_file);
+    return Error::Errc::OperationFailed;
+}
+
+Error::Errc SecureStore::installRecordViaTempFile(const std::string& data_id, const std::string& main_file,
+                                                  const std::string& backup_file, const std::string& temp_file,
+                                                  const std::vector<unsigned char>& record, Utils::FileSync sync) {
+    // Step 1: Write encrypted data to a temporary file. It is only renamed afterwards, so
+    // a plain write is enough; the caller syncs the directory if the durability asks for it.
+    Error::Errc write_err = m_rootDir->writeFile(temp_file, record, sync);
+    if (write_err != Error::Errc::Success) {
+        SS_LOG_ERROR("Failed to write encrypted data to temporary file '" << temp_file
+                     << "' for id '" << data_id << "'. Error: " << static_cast<int>(write_err));
+        m_rootDir->deleteFile(temp_file); // Attempt cleanup
+        return write_err;
+    }
+
+    // Step 2: Install the new record as main and keep the previous main as backup.
+    // Swapping temp and main in one syscall means main is never missing, not even briefly;
+    // the temp name then holds the previous main, which replaces the old backup.
+    Error::Errc swap_err = m_rootDir->exchangeFiles(temp_file, main_file);
+    if (swap_err == Error::Errc::Success) {
+        if (m_rootDir->renameFile(temp_file, backup_file) != Error::Errc::Success) {
+            SS_LOG_WARN("Failed to move previous main file to backup '" << backup_file
+                        << "'. Main file is up to date; old backup might persist.");
+            m_rootDir->deleteFile(temp_file);
+        }
+    } else {
+        if (swap_err != Error::Errc::PathNotFound) {
+            // Exchange is unsupported here (or failed): fall back to separate renames.
+            // We must delete any old backup first to allow rename to succeed if backup_file exists.
+            if (m_rootDir->pathExists(main_file)) {
+                Error::Errc del_bak_err = m_rootDir->deleteFile(backup_file);
+                if (del_bak_err != Error::Errc::Success) {
+                    SS_LOG_WARN("Failed to delete old backup file '" << backup_file
+                                << "'. Proceeding, but old backup might persist. Error: " << static_cast<int>(del_bak_err));
+                }
+                if (m_rootDir->renameFile(main_file, backup_file) != Error::Errc::Success) {
+                    // The old main_file is still there; the next step overwrites it.
+                    SS_LOG_WARN("Failed to move main file '" << main_file << "' to backup '" << backup_file
+                                << "'. Proceeding to write main file.");
+                } else {
+                    SS_LOG_DEBUG("Moved existing main file '" << main_file << "' to backup '" << backup_file << "'.");
+                }
+            }
+        }
+        // Step 3: Move temporary file to main file (also the first write of a new id)
+        if (m_rootDir->renameFile(temp_file, main_file) != Error::Errc::Success) {
+            SS_LOG_ERROR("CRITICAL: Failed to rename temp file '" << temp_file << "' to main file '" << main_file
+                         << "'. Data might be in temp file or backup.");
+            // Attempt to restore backup if it exists and main failed to be created
+            if (m_rootDir->pathExists(backup_file) && !m_rootDir->pathExists(main_file)) {
+                SS_LOG_INFO("Attempting to restore backup '"<< backup_file <<"' to main '" << main_file << "' due to final rename failure.");
+                if (m_rootDir->renameFile(backup_file, main_file) == Error::Errc::Success) {
+                    SS_LOG_INFO("Successfully restored backup to main file after temp->main rename failure.");
+                } else {
+                    SS_LOG_ERROR("Failed to restore backup to main file. Data for '" << data_id << "' may be inconsistent.");
+                }
+            }
+            m_rootDir->deleteFile(temp_file); // Clean up temp file in any case
+            return Error::Errc::FileRenameFailed; // Indicate a significant failure
+        }
+    }
+
+    return Error::Errc::Success;
 }
 
+Error::Errc SecureStore::retrieveData(const std::string& data_id, std::vector<unsigned char>& out_plain_data) {
+    out_plain_data.clear();
+    if (!m_initialized) {
+        SS_LOG_ERROR("SecureStore not initialized. Cannot retrieve data.");
+        return Error::Errc::NotInitialized;
+    }
+    Error::Errc id_validation_err = validateDataId(data_id);
+    if (id_validation_err != Error::Errc::Success) {
+        return id_validation_err;
+    }
 
-Error::Errc SecureStore::validateDataId(const std::string& data_id) const {
-    if (data_id.empty()) {
-        SS_LOG_WARN("Invalid data_id: cannot be empty.");
-        return Error::Errc::InvalidArgument;
+    // --- Committed transactions that are not applied yet override the files ---
+    bool removed = false;
+    if (m_transactionLog->lookup(data_id, removed, out_plain_data)) {
+        return removed ? Error::Errc::DataNotFound : Error::Errc::Success;
     }
-    // Check for problematic characters like path separators or '..'
-    // A more robust check might involve a whitelist of allowed characters.
-    if (data_id.find('/') != std::string::npos ||
-        data_id.find('\\') != std::string::npos ||
-        data_id.find("..") != std::string::npos) {
-        SS_LOG_WARN("Invalid data_id: '" << data_id << "' contains forbidden characters or sequences.");
-        return Error::Errc::InvalidArgument;
+
+    // --- Negative lookup filter: ids that were never stored cost no system call ---
+    const NegativeLookupFilter* filter = m_negativeFilter.load(std::memory_order_acquire);
+    if (filter && !filter->mightContain(data_id)) {
+        return Error::Errc::DataNotFound;
     }
-    // Check length, etc. if needed
-    return Error::Errc::Success;
-}
 
+    return readValidated(data_id, nullptr, out_plain_data);
+}
 
-Error::Errc SecureStore::storeData(const std::string& data_id, const std::vector<unsigned char>& plain_data) {
+Error::Errc SecureStore::retrieveData(const std::string& data_id, unsigned char* buffer, size_t capacity,
+                                      size_t& out_size) {
+    out_size = 0;
     if (!m_initialized) {
-        SS_LOG_ERROR("SecureStore not initialized. Cannot store data.");
+        SS_LOG_ERROR("SecureStore not initialized. Cannot retrieve data.");
         return Error::Errc::NotInitialized;
     }
     Error::Errc id_validation_err = validateDataId(data_id);
     if (id_validation_err != Error::Errc::Success) {
         return id_validation_err;
     }
+    if (buffer == nullptr && capacity > 0) {
+        return Error::Errc::InvalidArgument;
+    }
 
-    std::vector<unsigned char> encrypted_data;
-    Error::Errc enc_err = m_encryptor->encrypt(plain_data, m_masterKey, encrypted_data);
-    if (enc_err != Error::Errc::Success) {
-        SS_LOG_ERROR("Failed to encrypt data for id '" << data_id << "'. Error: " << static_cast<int>(enc_err));
-        return enc_err;
+    // --- Committed transactions that are not applied yet override the files ---
+    bool removed = false;
+    std::vector<unsigned char> pending;
+    if (m_transactionLog->lookup(data_id, removed, pending)) {
+        if (removed) {
+            return Error::Errc::DataNotFound;
+        }
+        out_size = pending.size();
+        bool fits = out_size <= capacity;
+        if (fits && out_size > 0) {
+            std::memcpy(buffer, pending.data(), out_size);
+        }
+        Utils::secureWipe(pending);
+        return fits ? Error::Errc::Success : Error::Errc::BufferTooSmall;
     }
 
-    std::string main_file = getDataFilePath(data_id);
-    std::string backup_file = getBackupFilePath(data_id);
-    std::string temp_file = getTempFilePath(data_id); // Use a distinct temp file name
+    // --- Negative lookup filter: ids that were never stored cost no system call ---
+    const NegativeLookupFilter* filter = m_negativeFilter.load(std::memory_order_acquire);
+    if (filter && !filter->mightContain(data_id)) {
+        return Error::Errc::DataNotFound;
+    }
 
-    // Step 1: Write encrypted data to a temporary file
-    Error::Errc write_err = Utils::FileUtil::atomicWriteFile(temp_file, encrypted_data);
-    if (write_err != Error::Errc::Success) {
-        SS_LOG_ERROR("Failed to write encrypted data to temporary file '" << temp_file
-                     << "' for id '" << data_id << "'. Error: " << static_cast<int>(write_err));
-        Utils::FileUtil::deleteFile(temp_file); // Attempt cleanup
-        return write_err;
+    PlainOutput out;
+    out.buffer = buffer;
+    out.capacity = capacity;
+    Error::Errc err = readValidated(data_id, nullptr, out);
+    if (err == Error::Errc::Success || err == Error::Errc::BufferTooSmall) {
+        out_size = out.size;
     }
+    return err;
+}
 
-    // Step 2: If main file exists, move it to backup
-    // We must delete any old backup first to allow rename to succeed if backup_file exists.
-    if (Utils::FileUtil::pathExists(main_file)) {
-        if (Utils::FileUtil::pathExists(backup_file)) {
-            Error::Errc del_bak_err = Utils::FileUtil::deleteFile(backup_file);
-            if (del_bak_err != Error::Errc::Success) {
-                SS_LOG_WARN("Failed to delete old backup file '" << backup_file
-                            << "'. Proceeding, but old backup might persist. Error: " << static_cast<int>(del_bak_err));
-                // Potentially critical, decide if we should abort. For now, continue.
-            }
-        }
-        if (std::rename(main_file.c_str(), backup_file.c_str()) != 0) {
-            SS_LOG_WARN("Failed to move main file '" << main_file << "' to backup '" << backup_file
-                        << "'. Error: " << strerror(errno) << ". Proceeding to write main file.");
-            // If this rename fails, the old main_file is still there.
-            // The new data will overwrite it in the next step if std::rename for temp->main works.
-            // This is not ideal for the backup strategy but makes the write more likely to succeed.
-            // A more robust approach might involve more stages or error out here.
-        } else {
-             SS_LOG_DEBUG("Moved existing main file '" << main_file << "' to backup '" << backup_file << "'.");
-        }
+Error::Errc SecureStore::retrieveData(const std::string& data_id, Utils::SecureBytes& out_plain_data) {
+    // Use the capacity the buffer already has; growing it re-queries in case the record
+    // was replaced by a larger one in between.
+    out_plain_data.resize(out_plain_data.capacity());
+    size_t size = 0;
+    Error::Errc err = retrieveData(data_id, out_plain_data.data(), out_plain_data.size(), size);
+    while (err == Error::Errc::BufferTooSmall) {
+        out_plain_data.resize(size);
+        err = retrieveData(data_id, out_plain_data.data(), out_plain_data.size(), size);
     }
+    if (err != Error::Errc::Success) {
+        Utils::secureWipe(out_plain_data);
+        return err;
+    }
+    out_plain_data.resize(size);
+    return err;
+}
 
-    // Step 3: Move temporary file to main file
-    if (std::rename(temp_file.c_str(), main_file.c_str()) != 0) {
-        SS_LOG_ERROR("CRITICAL: Failed to rename temp file '" << temp_file << "' to main file '" << main_file
-                     << "'. Error: " << strerror(errno) << ". Data might be in temp file or backup.");
-        // Attempt to restore backup if it exists and main failed to be created
-        if (Utils::FileUtil::pathExists(backup_file) && !Utils::FileUtil::pathExists(main_file)) {
-            SS_LOG_INFO("Attempting to restore backup '"<< backup_file <<"' to main '" << main_file << "' due to final rename failure.");
-            if (std::rename(backup_file.c_str(), main_file.c_str()) == 0) {
-                SS_LOG_INFO("Successfully restored backup to main file after temp->main rename failure.");
+Error::Errc SecureStore::readValidated(const std::string& data_id, const Utils::FileIdentity* identity,
+                                       std::vector<unsigned char>& out_plain_data) {
+    PlainOutput out;
+    out.vector = &out_plain_data;
+    return readValidated(data_id, identity, out);
+}
+
+Error::Errc SecureStore::readValidated(const std::string& data_id, const Utils::FileIdentity* identity,
+                                       PlainOutput& out) {
+    // --- Plaintext cache: one fstatat() proves the main file is the one we decrypted ---
+    PlaintextCache* plain_cache = m_plainCache.load(std::memory_order_acquire);
+    if (plain_cache) {
+        Utils::FileIdentity current;
+        bool known = identity != nullptr;
+        if (known) {
+            current = *identity;
+        } else {
+            Utils::ScratchName main_name;
+            getDataFileName(data_id, main_name.get());
+            known = m_rootDir->getFileIdentity(main_name.get(), current) == Error::Errc::Success;
+        }
+        bool hit = false;
+        if (known) {
+            if (out.vector) {
+                hit = plain_cache->lookup(data_id, current, *out.vector);
+                out.size = out.vector->size();
             } else {
-                SS_LOG_ERROR("Failed to restore backup to main file. Data for '" << data_id << "' may be inconsistent.");
+                hit = plain_cache->lookup(data_id, current, out.buffer, out.capacity, out.size);
             }
         }
-        Utils::FileUtil::deleteFile(temp_file); // Clean up temp file in any case
-        return Error::Errc::FileRenameFailed; // Indicate a significant failure
+        if (hit) {
+            if (!out.vector && out.size > out.capacity) {
+                return Error::Errc::BufferTooSmall;
+            }
+            SS_LOG_DEBUG("Retrieved data for id '" << data_id << "' from plaintext cache.");
+            m_hotSet.recordAccess(data_id);
+            return Error::Errc::Success;
+        }
     }
 
-    SS_LOG_INFO("Successfully stored data for id '" << data_id << "' to '" << main_file << "'.");
-    return Error::Errc::Success;
+    Error::Errc read_err = readRecord(data_id, out);
+    if (read_err == Error::Errc::Success) {
+        m_hotSet.recordAccess(data_id);
+    } else if (read_err == Error::Errc::DataNotFound) {
+        NegativeLookupFilter* filter = m_negativeFilter.load(std::memory_order_acquire);
+        if (filter) {
+            filter->recordFalsePositive();
+        }
+    }
+    return read_err;
 }
 
-Error::Errc SecureStore::retrieveData(const std::string& data_id, std::vector<unsigned char>& out_plain_data) {
-    out_plain_data.clear();
+Error::Errc SecureStore::retrieveMany(const std::vector<std::string>& data_ids, std::vector<RetrieveResult>& results,
+                                      unsigned workerThreads) {
+    results.clear();
     if (!m_initialized) {
         SS_LOG_ERROR("SecureStore not initialized. Cannot retrieve data.");
         return Error::Errc::NotInitialized;
     }
-    Error::Errc id_validation_err = validateDataId(data_id);
-    if (id_validation_err != Error::Errc::Success) {
-        return id_validation_err;
+    results.resize(data_ids.size());
+
+    // Answer what memory can, and stat the rest: the inode orders the reads below.
+    struct PendingRead {
+        size_t index;
+        bool haveIdentity;
+        Utils::FileIdentity identity;
+    };
+    std::vector<PendingRead> reads;
+    std::unordered_map<std::string, size_t> first_index;
+    std::vector<std::pair<size_t, size_t>> duplicates; // (index, index of its first occurrence)
+    for (size_t i = 0; i < data_ids.size(); ++i) {
+        const std::string& data_id = data_ids[i];
+        RetrieveResult& result = results[i];
+        result.status = validateDataId(data_id);
+        if (result.status != Error::Errc::Success) {
+            continue;
+        }
+        auto inserted = first_index.emplace(data_id, i);
+        if (!inserted.second) {
+            duplicates.emplace_back(i, inserted.first->second);
+            continue;
+        }
+        bool removed = false;
+        if (m_transactionLog->lookup(data_id, removed, result.data)) {
+            result.status = removed ? Error::Errc::DataNotFound : Error::Errc::Success;
+            continue;
+        }
+        const NegativeLookupFilter* filter = m_negativeFilter.load(std::memory_order_acquire);
+        if (filter && !filter->mightContain(data_id)) {
+            result.status = Error::Errc::DataNotFound;
+            continue;
+        }
+        PendingRead read;
+        read.index = i;
+        read.haveIdentity = m_rootDir->getFileIdentity(getDataFileName(data_id), read.identity) == Error::Errc::Success;
+        reads.push_back(read);
+    }
+
+    if (!reads.empty()) {
+        // Inode order approximates on-disk order on the file systems we run on; missing
+        // main files (backup fallback or not found) go last.
+        std::sort(reads.begin(), reads.end(), [](const PendingRead& a, const PendingRead& b) {
+            if (a.haveIdentity != b.haveIdentity) {
+                return a.haveIdentity;
+            }
+            if (a.identity.device != b.identity.device) {
+                return a.identity.device < b.identity.device;
+            }
+            return a.identity.inode < b.identity.inode;
+        });
+        std::vector<std::string> main_files;
+        main_files.reserve(reads.size());
+        for (const PendingRead& read : reads) {
+            if (read.haveIdentity) {
+                main_files.push_back(getDataFileName(data_ids[read.index]));
+            }
+        }
+        // Let the kernel queue every read before the first worker blocks on one.
+        m_rootDir->adviseWillNeed(main_files);
+
+        unsigned workers = workerThreads;
+        if (workers == 0) {
+            workers = std::min(std::max(std::thread::hardware_concurrency(), 1u), MAX_DEFAULT_READ_WORKERS);
+        }
+        workers = static_cast<unsigned>(std::min<size_t>(workers, reads.size()));
+
+        std::atomic<size_t> next(0);
+        auto work = [&]() {
+            for (size_t k = next.fetch_add(1); k < reads.size(); k = next.fetch_add(1)) {
+                const PendingRead& read = reads[k];
+                RetrieveResult& result = results[read.index];
+                result.status = readValidated(data_ids[read.index], read.haveIdentity ? &read.identity : nullptr,
+                                              result.data);
+            }
+        };
+        if (workers <= 1) {
+            work();
+        } else {
+            std::vector<std::thread> pool;
+            pool.reserve(workers);
+            for (unsigned k = 0; k < workers; ++k) {
+                pool.push_back(std::thread(work));
+            }
+            for (std::thread& worker : pool) {
+                worker.join();
+            }
+        }
+    }
+
+    for (const auto& duplicate : duplicates) {
+        results[duplicate.first] = results[duplicate.second];
     }
+    return Error::Errc::Success;
+}
+
+Error::Errc SecureStore::readRecord(const std::string& data_id, std::vector<unsigned char>& out_plain_data) {
+    PlainOutput out;
+    out.vector = &out_plain_data;
+    return readRecord(data_id, out);
+}
 
-    std::string main_file = getDataFilePath(data_id);
-    std::string backup_file = getBackupFilePath(data_id);
-    std::vector<unsigned char> encrypted_data_to_decrypt; // Will hold data from main or backup
+Error::Errc SecureStore::readRecord(const std::string& data_id, PlainOutput& out) {
+    Utils::ScratchBuffer record_scratch;
+    std::vector<unsigned char>& encrypted_data_to_decrypt = record_scratch.get(); // Will hold data from main or backup
     bool retrieved_from_main = false;
-    bool retrieved_from_backup = false;
+
+    // --- Stage 0: Shared read cache (no syscalls on a hit) ---
+    uint64_t cache_sequence = 0;
+    SharedRecordCache* shared_cache = m_sharedCache.load(std::memory_order_acquire);
+    if (shared_cache) {
+        if (shared_cache->lookup(data_id, encrypted_data_to_decrypt)) {
+            Error::Errc cache_err = decryptRecord(data_id, encrypted_data_to_decrypt.data(),
+                                                  encrypted_data_to_decrypt.size(), out);
+            if (cache_err == Error::Errc::Success) {
+                SS_LOG_DEBUG("Retrieved data for id '" << data_id << "' from shared read cache.");
+                return Error::Errc::Success;
+            }
+            if (cache_err == Error::Errc::BufferTooSmall) {
+                return cache_err; // Nothing was decrypted; the caller retries with out.size bytes
+            }
+            SS_LOG_WARN("Shared cache entry for id '" << data_id << "' failed authentication, dropping it.");
+            shared_cache->invalidate(data_id);
+        }
+        // Observed before reading the file; a writer changing the id in between makes fill() a no-op.
+        cache_sequence = shared_cache->sequenceFor(data_id);
+    }
+
+    Utils::ScratchName main_name, backup_name;
+    const std::string& main_file = main_name.get();
+    const std::string& backup_file = backup_name.get();
+    getDataFileName(data_id, main_name.get());
+    getBackupFileName(data_id, backup_name.get());
 
     // --- Stage 1: Try Main File ---
+    if (!shared_cache && m_encryptor->getCipherBackend() == Crypto::CipherBackendKind::Kernel) {
+        // No cache wants the ciphertext, so it is spliced from the file into the cipher.
+        Utils::FileIdentity identity;
+        Error::Errc file_err = decryptFileRecord(data_id, main_file, out, identity);
+        if (file_err == Error::Errc::Success) {
+            PlaintextCache* plain_cache = m_plainCache.load(std::memory_order_acquire);
+            if (plain_cache) {
+                plain_cache->insert(data_id, identity, out.vector ? out.vector->data() : out.buffer, out.size, false);
+            }
+            return Error::Errc::Success;
+        }
+        if (file_err == Error::Errc::BufferTooSmall) {
+            return file_err;
+        }
+        // Other record formats, and failures, take the ordinary read below (and the backup).
+    }
     SS_LOG_DEBUG("Attempting to retrieve data for id '" << data_id << "' from main file: " << main_file);
-    Error::Errc main_read_err = Utils::FileUtil::readFile(main_file, encrypted_data_to_decrypt);
+    Utils::FileIdentity main_identity;
+    Error::Errc main_read_err = m_rootDir->readFile(main_file, encrypted_data_to_decrypt, &main_identity);
 
     if (main_read_err == Error::Errc::Success) {
-        Error::Errc main_dec_err = m_encryptor->decrypt(encrypted_data_to_decrypt, m_masterKey, out_plain_data);
+        Error::Errc main_dec_err = decryptRecord(data_id, encrypted_data_to_decrypt.data(),
+                                                 encrypted_data_to_decrypt.size(), out);
+        if (main_dec_err == Error::Errc::BufferTooSmall) {
+            return main_dec_err; // Nothing was decrypted; the caller retries with out.size bytes
+        }
         if (main_dec_err == Error::Errc::Success) {
             SS_LOG_INFO("Successfully retrieved and decrypted data for id '" << data_id << "' from main file.");
             retrieved_from_main = true;
@@ -199,7 +1385,7 @@ Error::Errc SecureStore::retrieveData(const std::string& data_id, std::vector<un
                         << " (" << static_cast<int>(main_dec_err) << "). Will attempt backup.");
             // Consider deleting the corrupted main file to prevent reuse,
             // especially if backup retrieval is successful.
-            // Utils::FileUtil::deleteFile(main_file); // Or do this after successful backup retrieval & restore
+            // m_rootDir->deleteFile(main_file); // Or do this after successful backup retrieval & restore
         }
     } else {
         SS_LOG_WARN("Failed to read main data file '" << main_file << "' for id '" << data_id
@@ -208,6 +1394,17 @@ Error::Errc SecureStore::retrieveData(const std::string& data_id, std::vector<un
     }
 
     if (retrieved_from_main) {
+        PlaintextCache* plain_cache = m_plainCache.load(std::memory_order_acquire);
+        if (plain_cache) {
+            plain_cache->insert(data_id, main_identity, out.vector ? out.vector->data() : out.buffer, out.size, false);
+        }
+        if (shared_cache) {
+            // Publish only while no writer holds the shard (see storeData); never wait for it.
+            ShardWriteGuard guard(*m_writeLock, data_id, false);
+            if (guard.owned()) {
+                shared_cache->fill(data_id, encrypted_data_to_decrypt, cache_sequence);
+            }
+        }
         return Error::Errc::Success;
     }
 
@@ -215,9 +1412,8 @@ Error::Errc SecureStore::retrieveData(const std::string& data_id, std::vector<un
     SS_LOG_INFO("Attempting to retrieve data for id '" << data_id << "' from backup file: " << backup_file);
     // Clear buffer in case main file read partially filled it but then decryption failed
     encrypted_data_to_decrypt.clear(); 
-    out_plain_data.clear(); // Clear output from any failed main attempt
 
-    Error::Errc backup_read_err = Utils::FileUtil::readFile(backup_file, encrypted_data_to_decrypt);
+    Error::Errc backup_read_err = m_rootDir->readFile(backup_file, encrypted_data_to_decrypt);
     if (backup_read_err != Error::Errc::Success) {
         SS_LOG_ERROR("Failed to read backup data file '" << backup_file << "' for id '" << data_id
                      << "'. Error: " << Error::SecureStorageErrorCategory::get().message(static_cast<int>(backup_read_err))
@@ -225,7 +1421,11 @@ Error::Errc SecureStore::retrieveData(const std::string& data_id, std::vector<un
         return Error::Errc::DataNotFound; // Main failed (read or decrypt), and backup read failed.
     }
 
-    Error::Errc backup_dec_err = m_encryptor->decrypt(encrypted_data_to_decrypt, m_masterKey, out_plain_data);
+    Error::Errc backup_dec_err = decryptRecord(data_id, encrypted_data_to_decrypt.data(),
+                                               encrypted_data_to_decrypt.size(), out);
+    if (backup_dec_err == Error::Errc::BufferTooSmall) {
+        return backup_dec_err;
+    }
     if (backup_dec_err != Error::Errc::Success) {
         SS_LOG_ERROR("Failed to decrypt backup data file '" << backup_file << "' for id '" << data_id
                      << "'. Error: " << Error::SecureStorageErrorCategory::get().message(static_cast<int>(backup_dec_err))
@@ -233,28 +1433,450 @@ Error::Errc SecureStore::retrieveData(const std::string& data_id, std::vector<un
         return backup_dec_err; // Main failed, backup decryption failed.
     }
 
-    // If we are here, data was successfully read and decrypted from backup
-    retrieved_from_backup = true;
-    SS_LOG_INFO("Data for id '" << data_id << "' was successfully retrieved from backup. Attempting to restore to main file.");
-    
-    // Before restoring, if the main file failed due to corruption (not just missing), delete it.
-    if (main_read_err == Error::Errc::Success) { // Implies main file existed but failed decryption
-        SS_LOG_DEBUG("Deleting potentially corrupted main file '" << main_file << "' before restoring from backup.");
-        Utils::FileUtil::deleteFile(main_file);
+    // The caller gets the data now; restoring the main file (fsyncs included) is left to
+    // the repair thread, which rechecks both copies under the shard lock first.
+    SS_LOG_INFO("Data for id '" << data_id << "' was retrieved from backup; queueing a restore of the main file.");
+    m_repairQueue->enqueue(data_id);
+    return Error::Errc::Success;
+}
+
+Error::Errc SecureStore::decryptFileRecord(const std::string& data_id, const std::string& file_name,
+                                           PlainOutput& out, Utils::FileIdentity& identity) {
+    if (out.vector) {
+        out.vector->clear();
+    }
+    size_t file_size = 0;
+    const int fd = m_rootDir->openForRead(file_name, file_size, &identity);
+    if (fd < 0) {
+        return Error::Errc::FileOpenFailed;
+    }
+    unsigned char header_bytes[RECORD_HEADER_SIZE];
+    RecordHeader header;
+    Crypto::CipherAlgorithm cipher = Crypto::CipherAlgorithm::Aes256Gcm;
+    if (file_size < RECORD_HEADER_SIZE + Crypto::Encryptor::encryptedSize(0) ||
+        pread(fd, header_bytes, sizeof(header_bytes), 0) != static_cast<ssize_t>(sizeof(header_bytes)) ||
+        RecordFormat::parseHeader(header_bytes, sizeof(header_bytes), header) != RECORD_HEADER_SIZE ||
+        header.version != RECORD_FORMAT_VERSION_CURRENT || header.kind != RECORD_KIND_DATA ||
+        !RecordFormat::cipherForAlgorithmId(header.algorithm, cipher)) {
+        close(fd);
+        return Error::Errc::OperationFailed;
+    }
+    Utils::ScratchBuffer aad_scratch;
+    std::vector<unsigned char>& aad = aad_scratch.get();
+    RecordFormat::buildAad(header, data_id, aad);
+
+    const size_t body_size = file_size - RECORD_HEADER_SIZE;
+    const size_t plain_size = Crypto::Encryptor::decryptedSize(body_size);
+    out.size = plain_size;
+    unsigned char* dest = out.buffer;
+    size_t capacity = out.capacity;
+    if (out.vector) {
+        out.vector->resize(plain_size);
+        dest = out.vector->data();
+        capacity = plain_size;
+    } else if (capacity < plain_size) {
+        close(fd);
+        return Error::Errc::BufferTooSmall;
+    }
+    size_t written = 0;
+    Error::Errc err = m_encryptor->decryptFromFile(fd, RECORD_HEADER_SIZE, body_size, m_masterKey.data(),
+                                                   m_masterKey.size(), dest, capacity, written, aad.data(),
+                                                   aad.size(), cipher);
+    close(fd);
+    if (err != Error::Errc::Success) {
+        Utils::secureWipe(dest, plain_size);
+        if (out.vector) {
+            out.vector->clear();
+        }
+    }
+    return err;
+}
+
+void SecureStore::setCipherAlgorithm(Crypto::CipherAlgorithm algorithm) {
+    m_cipher.store(algorithm, std::memory_order_relaxed);
+}
+
+Crypto::CipherAlgorithm SecureStore::getCipherAlgorithm() const {
+    return m_cipher.load(std::memory_order_relaxed);
+}
+
+void SecureStore::setSegmentOptions(const SegmentOptions& options) {
+    m_segmentOptions = options;
+    if (m_segmentOptions.segmentSize == 0) {
+        m_segmentOptions.segmentSize = SEGMENTED_RECORD_DEFAULT_SEGMENT_SIZE;
+    }
+}
+
+void SecureStore::setHistoryDepth(unsigned versions) {
+    m_historyDepth.store(versions, std::memory_order_relaxed);
+}
+
+unsigned SecureStore::getHistoryDepth() const {
+    return m_historyDepth.load(std::memory_order_relaxed);
+}
+
+Error::Errc SecureStore::loadHistory(const std::string& data_id, std::vector<std::vector<unsigned char>>& frames,
+                                     std::vector<HistoryEntry>& entries) {
+    frames.clear();
+    entries.clear();
+    std::string history_file = getHistoryFileName(data_id);
+    std::vector<unsigned char> file;
+    Error::Errc read_err = m_rootDir->readFile(history_file, file);
+    if (read_err != Error::Errc::Success) {
+        return m_rootDir->pathExists(history_file) ? read_err : Error::Errc::Success;
+    }
+    RecordHistory::splitFrames(file, frames);
+    const std::string aad_id = history_file; // Binds each entry to its id and to the history
+    std::vector<unsigned char> payload;
+    for (const std::vector<unsigned char>& frame : frames) {
+        HistoryEntry entry;
+        RecordHeader header;
+        RecordFormat::parseHeader(frame.data(), frame.size(), header);
+        if (header.version == RECORD_FORMAT_VERSION_LEGACY ||
+            decryptRecord(aad_id, frame, payload, RECORD_KIND_HISTORY) != Error::Errc::Success ||
+            !RecordHistory::parseEntry(payload, entry)) {
+            SS_LOG_WARN("Skipping a history entry of id '" << data_id << "' that failed to authenticate or parse.");
+            entry = HistoryEntry(); // Version 0 never links into a chain
+        }
+        Utils::secureWipe(payload);
+        entries.push_back(std::move(entry));
+    }
+    return Error::Errc::Success;
+}
+
+Error::Errc SecureStore::appendHistory(const std::string& data_id, const unsigned char* new_plain_data,
+                                       size_t new_size, Utils::FileSync sync) {
+    Utils::FileIdentity main_identity;
+    if (m_rootDir->getFileIdentity(getDataFileName(data_id), main_identity) != Error::Errc::Success) {
+        return Error::Errc::Success; // First version of the id: nothing is replaced
+    }
+    std::vector<unsigned char> old_plain;
+    PlaintextCache* plain_cache = m_plainCache.load(std::memory_order_acquire);
+    if (!plain_cache || !plain_cache->lookup(data_id, main_identity, old_plain)) {
+        std::vector<unsigned char> raw;
+        if (m_rootDir->readFile(getDataFileName(data_id), raw, &main_identity) != Error::Errc::Success) {
+            return Error::Errc::Success;
+        }
+        if (decryptRecord(data_id, raw, old_plain) != Error::Errc::Success) {
+            SS_LOG_WARN("Main file of id '" << data_id << "' does not decrypt; its content is not added to the history.");
+            return Error::Errc::Success;
+        }
+    }
+    const uint64_t old_digest = RecordHistory::digest(old_plain);
+
+    const std::string history_file = getHistoryFileName(data_id);
+    const size_t depth = m_historyDepth.load(std::memory_order_relaxed);
+    HistoryHead head;
+    bool use_head = false;
+    Utils::FileIdentity history_identity;
+    if (m_rootDir->getFileIdentity(history_file, history_identity) == Error::Errc::Success) {
+        std::lock_guard<std::mutex> lock(m_historyHeadMutex);
+        auto it = m_historyHeads.find(data_id);
+        // A head left by another process's append, a failed install or a restored main file does not match.
+        use_head = it != m_historyHeads.end() && it->second.historyFile == history_identity &&
+                   it->second.mainDigest == old_digest && it->second.frames + 1 <= 2 * depth;
+        if (use_head) {
+            head = it->second;
+        }
+    }
+
+    std::vector<std::vector<unsigned char>> frames;
+    std::vector<HistoryEntry> entries;
+    std::vector<size_t> chain;
+    if (!use_head) {
+        Error::Errc load_err = loadHistory(data_id, frames, entries);
+        if (load_err != Error::Errc::Success) {
+            Utils::secureWipe(old_plain);
+            return load_err;
+        }
+        chain = RecordHistory::resolveChain(entries, old_digest);
+    }
+
+    HistoryEntry entry;
+    RecordHistory::makeDelta(old_plain, new_plain_data, new_size, entry);
+    Utils::secureWipe(old_plain);
+    if (use_head) {
+        entry.version = head.version + 1;
+        entry.storedAtNs = head.supersededAtNs;
+    } else {
+        entry.version = chain.empty() ? 1 : entries[chain.front()].version + 1;
+        entry.storedAtNs = chain.empty() ? main_identity.changeTimeNs : entries[chain.front()].supersededAtNs;
+    }
+    entry.supersededAtNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    std::vector<unsigned char> payload;
+    RecordHistory::serializeEntry(entry, payload);
+    std::vector<unsigned char> record;
+    Error::Errc enc_err = encryptRecord(history_file, payload.data(), payload.size(), record, RECORD_KIND_HISTORY);
+    Utils::secureWipe(payload);
+    for (HistoryChunk& chunk : entry.chunks) {
+        Utils::secureWipe(chunk.data);
+    }
+    if (enc_err != Error::Errc::Success) {
+        return enc_err;
+    }
+
+    std::vector<unsigned char> image;
+    size_t frame_count = 0;
+    Error::Errc write_err;
+    if (use_head || frames.size() + 1 <= 2 * depth) {
+        RecordHistory::appendFrame(record, image);
+        frame_count = (use_head ? head.frames : frames.size()) + 1;
+        write_err = m_rootDir->appendFile(history_file, image, sync);
+    } else {
+        // Compact: keep the newest depth - 1 linked entries plus the new one, oldest first.
+        // Frames are copied as they are; nothing is decrypted again.
+        size_t keep = std::min(chain.size(), depth > 0 ? depth - 1 : 0);
+        for (size_t i = keep; i-- > 0;) {
+            RecordHistory::appendFrame(frames[chain[i]], image);
+        }
+        RecordHistory::appendFrame(record, image);
+        frame_count = keep + 1;
+        write_err = m_rootDir->atomicWriteFile(history_file, image, false);
+    }
+
+    std::lock_guard<std::mutex> lock(m_historyHeadMutex);
+    HistoryHead& next = m_historyHeads[data_id];
+    if (write_err != Error::Errc::Success ||
+        m_rootDir->getFileIdentity(history_file, next.historyFile) != Error::Errc::Success) {
+        m_historyHeads.erase(data_id);
+        return write_err;
+    }
+    next.mainDigest = entry.baseDigest; // Holds once the caller installs the new version
+    next.version = entry.version;
+    next.supersededAtNs = entry.supersededAtNs;
+    next.frames = frame_count;
+    return Error::Errc::Success;
+}
+
+Error::Errc SecureStore::loadVersionChain(const std::string& data_id, std::vector<unsigned char>& current_plain,
+                                          std::vector<HistoryEntry>& entries, std::vector<size_t>& chain,
+                                          VersionInfo& current) {
+    const NegativeLookupFilter* filter = m_negativeFilter.load(std::memory_order_acquire);
+    if (filter && !filter->mightContain(data_id)) {
+        return Error::Errc::DataNotFound;
+    }
+    Error::Errc read_err = readRecord(data_id, current_plain);
+    if (read_err != Error::Errc::Success) {
+        return read_err;
+    }
+    std::vector<std::vector<unsigned char>> frames;
+    Error::Errc load_err = loadHistory(data_id, frames, entries);
+    if (load_err != Error::Errc::Success) {
+        Utils::secureWipe(current_plain);
+        return load_err;
+    }
+    chain = RecordHistory::resolveChain(entries, RecordHistory::digest(current_plain));
+    // The file may hold up to twice the depth between compactions; only the depth is promised.
+    const size_t depth = m_historyDepth.load(std::memory_order_relaxed);
+    if (depth > 0 && chain.size() > depth) {
+        chain.resize(depth);
     }
 
-    Error::Errc write_main_err = Utils::FileUtil::atomicWriteFile(main_file, encrypted_data_to_decrypt); // Write the raw ENCRYPTED backup data
-    if (write_main_err == Error::Errc::Success) {
-        SS_LOG_INFO("Successfully restored backup data to main file: " << main_file);
+    current = VersionInfo();
+    current.current = true;
+    current.size = current_plain.size();
+    int64_t stored_at_ns = 0;
+    if (!chain.empty()) {
+        current.version = entries[chain.front()].version + 1;
+        stored_at_ns = entries[chain.front()].supersededAtNs;
     } else {
-        SS_LOG_WARN("Failed to restore backup data to main file '" << main_file
-                    << "'. Error: " << Error::SecureStorageErrorCategory::get().message(static_cast<int>(write_main_err))
-                    << " (" << static_cast<int>(write_main_err) << "). Main file may be missing or outdated for next read.");
-        // Data is still successfully retrieved for this call, this is just a warning about the restore op.
+        current.version = 1;
+        Utils::FileIdentity identity;
+        if (m_rootDir->getFileIdentity(getDataFileName(data_id), identity) == Error::Errc::Success) {
+            stored_at_ns = identity.changeTimeNs;
+        }
+    }
+    current.storedAt = std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(stored_at_ns)));
+    return Error::Errc::Success;
+}
+
+Error::Errc SecureStore::listVersions(const std::string& data_id, std::vector<VersionInfo>& out_versions) {
+    out_versions.clear();
+    if (!m_initialized) {
+        SS_LOG_ERROR("SecureStore not initialized. Cannot list versions.");
+        return Error::Errc::NotInitialized;
+    }
+    Error::Errc id_validation_err = validateDataId(data_id);
+    if (id_validation_err != Error::Errc::Success) {
+        return id_validation_err;
+    }
+    Error::Errc txn_err = applyTransactionsTouching(data_id); // Versions are numbered on disk
+    if (txn_err != Error::Errc::Success) {
+        return txn_err;
+    }
+    std::vector<unsigned char> current_plain;
+    std::vector<HistoryEntry> entries;
+    std::vector<size_t> chain;
+    VersionInfo current;
+    Error::Errc err = loadVersionChain(data_id, current_plain, entries, chain, current);
+    Utils::secureWipe(current_plain);
+    if (err != Error::Errc::Success) {
+        return err;
+    }
+    out_versions.push_back(current);
+    for (size_t index : chain) {
+        const HistoryEntry& entry = entries[index];
+        VersionInfo info;
+        info.version = entry.version;
+        info.storedAt = std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(entry.storedAtNs)));
+        info.size = entry.size;
+        out_versions.push_back(info);
     }
     return Error::Errc::Success;
 }
 
+Error::Errc SecureStore::retrieveData(const std::string& data_id, uint32_t version,
+                                      std::vector<unsigned char>& out_plain_data) {
+    out_plain_data.clear();
+    if (!m_initialized) {
+        SS_LOG_ERROR("SecureStore not initialized. Cannot retrieve data.");
+        return Error::Errc::NotInitialized;
+    }
+    Error::Errc id_validation_err = validateDataId(data_id);
+    if (id_validation_err != Error::Errc::Success) {
+        return id_validation_err;
+    }
+    Error::Errc txn_err = applyTransactionsTouching(data_id); // Versions are numbered on disk
+    if (txn_err != Error::Errc::Success) {
+        return txn_err;
+    }
+    std::vector<HistoryEntry> entries;
+    std::vector<size_t> chain;
+    VersionInfo current;
+    Error::Errc err = loadVersionChain(data_id, out_plain_data, entries, chain, current);
+    if (err != Error::Errc::Success) {
+        return err;
+    }
+    if (version == current.version) {
+        return Error::Errc::Success;
+    }
+    // Walk back from the current content, one reverse delta per version.
+    for (size_t index : chain) {
+        if (entries[index].version < version) {
+            break;
+        }
+        if (!RecordHistory::applyDelta(entries[index], out_plain_data)) {
+            SS_LOG_ERROR("History of id '" << data_id << "' is inconsistent at version " << entries[index].version << ".");
+            Utils::secureWipe(out_plain_data);
+            return Error::Errc::DeserializationFailed;
+        }
+        if (entries[index].version == version) {
+            return Error::Errc::Success;
+        }
+    }
+    Utils::secureWipe(out_plain_data);
+    return Error::Errc::DataNotFound;
+}
+
+Error::Errc SecureStore::retrieveAsOf(const std::string& data_id, std::chrono::system_clock::time_point asOf,
+                                      std::vector<unsigned char>& out_plain_data) {
+    out_plain_data.clear();
+    if (!m_initialized) {
+        SS_LOG_ERROR("SecureStore not initialized. Cannot retrieve data.");
+        return Error::Errc::NotInitialized;
+    }
+    Error::Errc id_validation_err = validateDataId(data_id);
+    if (id_validation_err != Error::Errc::Success) {
+        return id_validation_err;
+    }
+    Error::Errc txn_err = applyTransactionsTouching(data_id); // Versions are numbered on disk
+    if (txn_err != Error::Errc::Success) {
+        return txn_err;
+    }
+    std::vector<HistoryEntry> entries;
+    std::vector<size_t> chain;
+    VersionInfo current;
+    Error::Errc err = loadVersionChain(data_id, out_plain_data, entries, chain, current);
+    if (err != Error::Errc::Success) {
+        return err;
+    }
+    if (current.storedAt <= asOf) {
+        return Error::Errc::Success;
+    }
+    const int64_t as_of_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(asOf.time_since_epoch()).count();
+    for (size_t index : chain) {
+        if (!RecordHistory::applyDelta(entries[index], out_plain_data)) {
+            SS_LOG_ERROR("History of id '" << data_id << "' is inconsistent at version " << entries[index].version << ".");
+            Utils::secureWipe(out_plain_data);
+            return Error::Errc::DeserializationFailed;
+        }
+        if (entries[index].storedAtNs <= as_of_ns) {
+            return Error::Errc::Success;
+        }
+    }
+    Utils::secureWipe(out_plain_data);
+    return Error::Errc::DataNotFound;
+}
+
+Transaction SecureStore::beginTransaction(std::function<Error::Errc()> beforeCommit) {
+    return Transaction([this, beforeCommit](std::vector<TransactionOp>& ops) {
+        if (beforeCommit) {
+            Error::Errc err = beforeCommit();
+            if (err != Error::Errc::Success) {
+                return err;
+            }
+        }
+        return commitTransaction(ops);
+    });
+}
+
+Error::Errc SecureStore::commitTransaction(std::vector<TransactionOp>& ops) {
+    if (!m_initialized) {
+        SS_LOG_ERROR("SecureStore not initialized. Cannot commit transaction.");
+        return Error::Errc::NotInitialized;
+    }
+    for (const TransactionOp& op : ops) {
+        Error::Errc id_validation_err = validateDataId(op.dataId);
+        if (id_validation_err != Error::Errc::Success) {
+            return id_validation_err; // Nothing of the transaction is written
+        }
+    }
+    std::vector<unsigned char> plain;
+    TransactionLog::serializeOps(ops, plain);
+    std::vector<unsigned char> record;
+    Error::Errc enc_err = encryptRecord(TRANSACTION_LOG_FILE_NAME, plain.data(), plain.size(), record,
+                                         RECORD_KIND_TRANSACTION_LOG);
+    Utils::secureWipe(plain);
+    if (enc_err != Error::Errc::Success) {
+        SS_LOG_ERROR("Failed to encrypt transaction of " << ops.size() << " changes. Error: " << static_cast<int>(enc_err));
+        return enc_err;
+    }
+    size_t count = ops.size();
+    Error::Errc err = m_transactionLog->commit(record, ops);
+    if (err == Error::Errc::Success) {
+        SS_LOG_INFO("Committed transaction of " << count << " changes.");
+    }
+    return err;
+}
+
+Error::Errc SecureStore::applyTransactionsTouching(const std::string& data_id) {
+    if (!m_transactionLog->touches(data_id)) {
+        return Error::Errc::Success;
+    }
+    Error::Errc err = m_transactionLog->applyPending();
+    if (err != Error::Errc::Success) {
+        SS_LOG_ERROR("Failed to apply the pending transactions that change id '" << data_id << "'. Error: "
+                     << static_cast<int>(err));
+    }
+    return err;
+}
+
+Error::Errc SecureStore::applyTransactions() {
+    if (!m_initialized) {
+        SS_LOG_ERROR("SecureStore not initialized. Cannot apply transactions.");
+        return Error::Errc::NotInitialized;
+    }
+    return m_transactionLog->applyPending();
+}
+
+TransactionStats SecureStore::getTransactionStats() const {
+    return m_transactionLog ? m_transactionLog->getStats() : TransactionStats();
+}
+
 Error::Errc SecureStore::deleteData(const std::string& data_id) {
     if (!m_initialized) {
         SS_LOG_ERROR("SecureStore not initialized. Cannot delete data.");
@@ -264,20 +1886,53 @@ Error::Errc SecureStore::deleteData(const std::string& data_id) {
     if (id_validation_err != Error::Errc::Success) {
         return id_validation_err; // Don't proceed with invalid ID
     }
+    Error::Errc txn_err = applyTransactionsTouching(data_id);
+    if (txn_err != Error::Errc::Success) {
+        return txn_err;
+    }
+    return removeRecord(data_id);
+}
+
+Error::Errc SecureStore::removeRecord(const std::string& data_id) {
+    std::string main_file = getDataFileName(data_id);
+    std::string backup_file = getBackupFileName(data_id);
+
+    ShardWriteGuard guard(*m_writeLock, data_id, true);
+    if (!guard.owned()) {
+        SS_LOG_ERROR("Failed to acquire write lock for id '" << data_id << "'.");
+        return Error::Errc::OperationFailed;
+    }
+
+    SharedRecordCache* shared_cache = attachSharedCacheIfPresent();
+    if (shared_cache) {
+        shared_cache->invalidate(data_id);
+    }
+    PlaintextCache* plain_cache = m_plainCache.load(std::memory_order_acquire);
+    if (plain_cache) {
+        plain_cache->invalidate(data_id);
+    }
 
-    std::string main_file = getDataFilePath(data_id);
-    std::string backup_file = getBackupFilePath(data_id);
-    bool main_existed = Utils::FileUtil::pathExists(main_file);
-    bool backup_existed = Utils::FileUtil::pathExists(backup_file);
+    bool main_existed = m_rootDir->pathExists(main_file);
+    bool backup_existed = m_rootDir->pathExists(backup_file);
 
-    Error::Errc del_main_err = Utils::FileUtil::deleteFile(main_file);
-    Error::Errc del_bak_err = Utils::FileUtil::deleteFile(backup_file);
+    Error::Errc del_main_err = m_rootDir->deleteFile(main_file);
+    Error::Errc del_bak_err = m_rootDir->deleteFile(backup_file);
 
     if (del_main_err != Error::Errc::Success && main_existed) { // Only error if it existed and failed to delete
         SS_LOG_ERROR("Failed to delete main data file '" << main_file << "'. Error: " << static_cast<int>(del_main_err));
         // If main delete failed, backup delete result is still relevant but the operation overall failed.
         return del_main_err;
     }
+    unindexId(data_id); // The main file is gone even if removing the backup fails
+    m_hotSet.forget(data_id);
+    std::string history_file = getHistoryFileName(data_id);
+    {
+        std::lock_guard<std::mutex> lock(m_historyHeadMutex);
+        m_historyHeads.erase(data_id);
+    }
+    if (m_rootDir->pathExists(history_file) && m_rootDir->deleteFile(history_file) != Error::Errc::Success) {
+        SS_LOG_WARN("Failed to delete version history '" << history_file << "' of deleted id '" << data_id << "'.");
+    }
     if (del_bak_err != Error::Errc::Success && backup_existed) { // Only error if it existed and failed to delete
         SS_LOG_ERROR("Failed to delete backup data file '" << backup_file << "'. Error: " << static_cast<int>(del_bak_err));
         // Main might have been deleted successfully, but backup failed.
@@ -291,9 +1946,21 @@ Error::Errc SecureStore::deleteData(const std::string& data_id) {
 bool SecureStore::dataExists(const std::string& data_id) const {
     if (!m_initialized) return false;
     if (validateDataId(data_id) != Error::Errc::Success) return false;
+    bool removed = false;
+    std::vector<unsigned char> pending_data;
+    if (m_transactionLog->lookup(data_id, removed, pending_data)) {
+        Utils::secureWipe(pending_data);
+        return !removed;
+    }
+    NegativeLookupFilter* filter = m_negativeFilter.load(std::memory_order_acquire);
+    if (filter && !filter->mightContain(data_id)) return false;
 
-    return Utils::FileUtil::pathExists(getDataFilePath(data_id)) ||
-           Utils::FileUtil::pathExists(getBackupFilePath(data_id));
+    bool exists = m_rootDir->pathExists(getDataFileName(data_id)) ||
+                  m_rootDir->pathExists(getBackupFileName(data_id));
+    if (!exists && filter) {
+        filter->recordFalsePositive();
+    }
+    return exists;
 }
 
 Error::Errc SecureStore::listDataIds(std::vector<std::string>& out_data_ids) const {
@@ -304,7 +1971,7 @@ Error::Errc SecureStore::listDataIds(std::vector<std::string>& out_data_ids) con
     }
 
     std::vector<std::string> all_files;
-    Error::Errc list_err = Utils::FileUtil::listDirectory(m_rootStoragePath, all_files);
+    Error::Errc list_err = m_rootDir->listDirectory(all_files);
     if (list_err != Error::Errc::Success) {
         SS_LOG_ERROR("Failed to list directory '" << m_rootStoragePath << "'. Error: " << static_cast<int>(list_err));
         return list_err;
@@ -329,6 +1996,19 @@ Error::Errc SecureStore::listDataIds(std::vector<std::string>& out_data_ids) con
             }
         }
     }
+    // Committed transactions that are not applied yet count as if they were.
+    std::unordered_map<std::string, bool> pending;
+    m_transactionLog->collectPending(pending);
+    if (!pending.empty()) {
+        out_data_ids.erase(std::remove_if(out_data_ids.begin(), out_data_ids.end(),
+                                          [&pending](const std::string& id) { return pending.count(id) > 0; }),
+                           out_data_ids.end());
+        for (const auto& change : pending) {
+            if (!change.second) {
+                out_data_ids.push_back(change.first);
+            }
+        }
+    }
     std::sort(out_data_ids.begin(), out_data_ids.end()); // Consistent order
     SS_LOG_DEBUG("Found " << out_data_ids.size() << " data IDs in storage path.");
     return Error::Errc::Success;
@@ -3,11 +3,34 @@
 
 #include "Error.h"
 #include "FileUtil.h"   // For filename suffix constants if any
+#include "FileLock.h"
+#include "DirFileUtil.h"
 #include "KeyProvider.h"
 #include "Encryptor.h"
+#include "RecordFormat.h"
+#include "SegmentedRecord.h"
+#include "SharedRecordCache.h"
+#include "Durability.h"
+#include "RetrieveResult.h"
+#include "DeferredSync.h"
+#include "StartupRecovery.h"
+#include "PlaintextCache.h"
+#include "HotSet.h"
+#include "Scrubber.h"
+#include "RepairQueue.h"
+#include "NegativeLookupFilter.h"
+#include "RecordHistory.h"
+#include "Transaction.h"
+#include "TransactionLog.h"
 #include <string>
 #include <vector>
 #include <memory> // For std::unique_ptr
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <unordered_set>
+#include <unordered_map>
+#include <functional>
 
 namespace SecureStorage {
 namespace Storage {
@@ -17,15 +40,57 @@ const std::string DATA_FILE_EXTENSION = ".enc";
 const std::string BACKUP_FILE_EXTENSION = ".bak";
 const std::string TEMP_FILE_SUFFIX = ".tmp";
 
+// Cross-process coordination: writers lock one byte of this file per id shard.
+const std::string LOCK_FILE_NAME = ".securestore.lock";
+constexpr uint64_t LOCK_SHARD_COUNT = 1024;
+// The slot after the id shards guards TRANSACTION_LOG_FILE_NAME.
+constexpr uint64_t TRANSACTION_LOG_LOCK_SLOT = LOCK_SHARD_COUNT;
+// Check value of the master key, against which a key from the keyring cache is verified.
+const std::string KEY_CHECK_FILE_NAME = ".securestore.keycheck";
+
+// Default flush interval for Durability::Deferred writes.
+const std::chrono::milliseconds DEFAULT_DEFERRED_SYNC_INTERVAL = std::chrono::milliseconds(1000);
+
+
+/**
+ * @struct StoreInitTimings
+ * @brief How long each phase of SecureStore construction took.
+ */
+struct StoreInitTimings {
+    std::chrono::microseconds directorySetup = std::chrono::microseconds(0); ///< Creating and opening the root and lock file
+    std::chrono::microseconds recovery = std::chrono::microseconds(0);       ///< StartupRecovery pass
+    std::chrono::microseconds cryptoSetup = std::chrono::microseconds(0);    ///< KeyProvider and Encryptor (seeds the DRBG, times the ciphers)
+    std::chrono::microseconds keyDerivation = std::chrono::microseconds(0);  ///< HKDF of the master key
+};
 
 /**
  * @class SecureStore
  * @brief Manages secure storage and retrieval of encrypted data items in files.
  *
  * This class uses a KeyProvider to derive a master encryption key based on a
- * device serial number, and an Encryptor to perform AES-256-GCM encryption.
+ * device serial number, and an Encryptor to perform AES-256-GCM or ChaCha20-Poly1305
+ * encryption, whichever the startup self-benchmark found faster on this machine.
  * Data items are stored as individual encrypted files within a specified root path.
+ * Each file carries a RecordFormat header that, together with the data_id, is
+ * authenticated as AAD so records cannot be swapped between ids. The header names the
+ * cipher, so records written with either one stay readable.
  * Includes a backup mechanism for resilience.
+ *
+ * Several SecureStore instances, in the same or in different processes, may share a
+ * root path. Mutations of an id (store, delete, backup restore) are serialized through
+ * a per-shard lock in LOCK_FILE_NAME, so writers to ids in different shards run in
+ * parallel. Readers never take the lock; the rename sequence in storeData always
+ * leaves a complete main or backup file for them to read.
+ *
+ * On construction the store runs a StartupRecovery pass over its root, which removes
+ * the temporary files and completes the backup renames of writes a crash interrupted.
+ *
+ * Successful reads are counted in a HotSetTracker, whose hottest ids are saved in
+ * HOT_SET_FILE_NAME by saveHotSet() and loaded again on construction, so a later start
+ * can prefetch() what the previous run used most.
+ *
+ * Changes of several ids that must take effect together go through a Transaction, which
+ * commits to a write-ahead log (see TransactionLog) that is redone after a crash.
  */
 class SecureStore {
 public:
@@ -35,8 +100,13 @@ public:
      * @param rootStoragePath The absolute path to the directory where encrypted files will be stored.
      * This directory will be created if it doesn't exist.
      * @param deviceSerialNumber The unique serial number of the device, used for key derivation.
+     * @param recoveryOptions Settings of the startup recovery pass (see StartupRecovery).
+     * @param keyCache Kernel keyring cache of the master key (see KeyProvider::setKeyCache()).
+     * Unless it names a check file, cached keys are checked against KEY_CHECK_FILE_NAME.
      */
-    SecureStore(std::string rootStoragePath, std::string deviceSerialNumber);
+    SecureStore(std::string rootStoragePath, std::string deviceSerialNumber,
+                const RecoveryOptions& recoveryOptions = RecoveryOptions(),
+                const Crypto::KeyCacheOptions& keyCache = Crypto::KeyCacheOptions());
 
     ~SecureStore() = default;
 
@@ -60,6 +130,8 @@ public:
      * The data is encrypted and written to a file named after the data_id.
      * An existing backup becomes the old backup, an existing main file becomes the new backup.
      *
+     * Uses the store's default durability (see setDefaultDurability()).
+     *
      * @param data_id A unique identifier for the data item. Used to name the file.
      * Should not contain path separators or be empty.
      * @param plain_data The raw data to be stored and encrypted.
@@ -67,11 +139,88 @@ public:
      */
     Error::Errc storeData(const std::string& data_id, const std::vector<unsigned char>& plain_data);
 
+    /**
+     * @brief Stores a data item securely with an explicit durability level.
+     * @see storeData(const std::string&, const std::vector<unsigned char>&)
+     *
+     * @param data_id A unique identifier for the data item.
+     * @param plain_data The raw data to be stored and encrypted.
+     * @param durability What the write must survive once this call returns (see Durability).
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc storeData(const std::string& data_id, const std::vector<unsigned char>& plain_data,
+                          Durability durability);
+
+    /**
+     * @brief Stores a data item, encrypting it inside the buffer it is handed in.
+     *
+     * No second buffer of the record's size is allocated: the plaintext is moved up behind
+     * the header and IV (or segment table) and overwritten by its ciphertext, which is then
+     * written out. If the buffer's capacity has recordOverhead() bytes to spare beyond its
+     * size, the write allocates nothing for the record at all. With a history depth set
+     * (see setHistoryDepth()) the record is encrypted into a separate buffer instead, as the
+     * new plaintext is still needed after encryption.
+     *
+     * On return plain_data is zeroed and empty but keeps its capacity, so it can be reused
+     * for the next record, whether the call succeeded or not.
+     *
+     * @param data_id A unique identifier for the data item.
+     * @param plain_data The raw data to be stored; used as the encryption buffer.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc storeData(const std::string& data_id, std::vector<unsigned char>&& plain_data);
+
+    /**
+     * @brief Stores a data item in the buffer it is handed in, with an explicit durability level.
+     * @see storeData(const std::string&, std::vector<unsigned char>&&)
+     *
+     * @param data_id A unique identifier for the data item.
+     * @param plain_data The raw data to be stored; used as the encryption buffer.
+     * @param durability What the write must survive once this call returns (see Durability).
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc storeData(const std::string& data_id, std::vector<unsigned char>&& plain_data, Durability durability);
+
+    /**
+     * @brief Returns how many bytes the record of a plaintext adds to it: header, IV and tag,
+     * or header and segment table. Reserving that much beyond the plaintext lets
+     * storeData(const std::string&, std::vector<unsigned char>&&) encrypt without allocating.
+     * @param plaintextSize Number of plaintext bytes.
+     * @return The overhead in bytes, under the current segment options.
+     */
+    size_t recordOverhead(size_t plaintextSize) const;
+
+    /**
+     * @brief Stores a data item held in caller memory (a std::string, an arena, a mapped
+     * file), without copying it into a vector first.
+     * @see storeData(const std::string&, const std::vector<unsigned char>&)
+     *
+     * @param data_id A unique identifier for the data item.
+     * @param data Pointer to the raw data (may be null if size is 0).
+     * @param size Number of bytes at data.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc storeData(const std::string& data_id, const unsigned char* data, size_t size);
+
+    /**
+     * @brief Stores a data item held in caller memory with an explicit durability level.
+     * @see storeData(const std::string&, const unsigned char*, size_t)
+     *
+     * @param data_id A unique identifier for the data item.
+     * @param data Pointer to the raw data (may be null if size is 0).
+     * @param size Number of bytes at data.
+     * @param durability What the write must survive once this call returns (see Durability).
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc storeData(const std::string& data_id, const unsigned char* data, size_t size,
+                          Durability durability);
+
     /**
      * @brief Retrieves a securely stored data item.
      * Attempts to read from the main data file first. If that fails (missing, corrupt),
      * it attempts to read from the backup file. If the backup is used and successfully
-     * decrypted, an attempt is made to restore it to the main file.
+     * decrypted, the id is queued for a background restore of the main file (see
+     * RepairQueue); the call itself returns without writing.
      *
      * @param data_id The unique identifier of the data item to retrieve.
      * @param[out] out_plain_data A vector to store the decrypted data.
@@ -80,9 +229,119 @@ public:
      */
     Error::Errc retrieveData(const std::string& data_id, std::vector<unsigned char>& out_plain_data);
 
+    /**
+     * @brief Retrieves a data item into caller memory.
+     *
+     * Reads like the vector overload, but decrypts straight into buffer. The plaintext size
+     * comes from the record before anything is decrypted: if buffer is too small, the call
+     * returns Errc::BufferTooSmall with out_size set, having decrypted nothing. Passing a
+     * null buffer and a capacity of 0 thus queries the size. The size is not authenticated
+     * until the data is read; a record replaced in between may need another attempt.
+     *
+     * @param data_id The unique identifier of the data item to retrieve.
+     * @param[out] buffer Receives the decrypted data; may be null if capacity is 0.
+     * @param capacity Number of bytes available at buffer.
+     * @param[out] out_size Set to the plaintext size on success and on Errc::BufferTooSmall,
+     * to 0 otherwise.
+     * @return SecureStorage::Error::Errc::Success on success, Errc::BufferTooSmall if the
+     * data does not fit, or another error code as the vector overload.
+     */
+    Error::Errc retrieveData(const std::string& data_id, unsigned char* buffer, size_t capacity, size_t& out_size);
+
+    /**
+     * @brief Retrieves a data item into a buffer in the secure arena.
+     *
+     * The plaintext never passes through ordinary heap memory: it is decrypted straight
+     * into out_plain_data, which is locked in RAM and zeroized when freed. A buffer that
+     * already has the capacity is filled in one read; otherwise the size is queried first.
+     *
+     * @param data_id The unique identifier of the data item to retrieve.
+     * @param[out] out_plain_data Receives the decrypted data; wiped and emptied on failure.
+     * @return As retrieveData(const std::string&, std::vector<unsigned char>&).
+     */
+    Error::Errc retrieveData(const std::string& data_id, Utils::SecureBytes& out_plain_data);
+
+    /**
+     * @brief Retrieves several data items at once.
+     *
+     * Each id is answered as retrieveData() would, including the backup fallback. Ids
+     * known from memory (pending transactions, the negative-lookup filter) are answered
+     * first; the main files of the rest are stat'ed, sorted by inode as an approximation
+     * of their order on disk, announced to the kernel with POSIX_FADV_WILLNEED and then
+     * read, authenticated and decrypted by a pool of worker threads. Duplicate ids are
+     * read once.
+     *
+     * @param data_ids The ids to read.
+     * @param[out] results One result per entry of data_ids, in the same order.
+     * @param workerThreads Number of threads; 0 picks one per CPU, at most 8.
+     * @return SecureStorage::Error::Errc::Success if the ids were looked up (see each
+     * result's status), or Errc::NotInitialized.
+     */
+    Error::Errc retrieveMany(const std::vector<std::string>& data_ids, std::vector<RetrieveResult>& results,
+                             unsigned workerThreads = 0);
+
+    /**
+     * @brief Retrieves one version of a data item from its history.
+     *
+     * Versions are numbered from 1 per id; the current content has the highest number
+     * (see listVersions()). Old versions exist only for writes made while a history depth
+     * was set (see setHistoryDepth()).
+     *
+     * @param data_id The unique identifier of the data item.
+     * @param version The version to read.
+     * @param[out] out_plain_data Receives the decrypted data of that version.
+     * @return SecureStorage::Error::Errc::Success on success, Errc::DataNotFound if the id
+     * or that version does not exist (any more), or another error code.
+     */
+    Error::Errc retrieveData(const std::string& data_id, uint32_t version, std::vector<unsigned char>& out_plain_data);
+
+    /**
+     * @brief Retrieves the version of a data item that was current at a point in time.
+     *
+     * @param data_id The unique identifier of the data item.
+     * @param asOf The point in time.
+     * @param[out] out_plain_data Receives the decrypted data of the newest version stored
+     * at or before asOf.
+     * @return SecureStorage::Error::Errc::Success on success, Errc::DataNotFound if the id
+     * does not exist or no kept version is that old, or another error code.
+     */
+    Error::Errc retrieveAsOf(const std::string& data_id, std::chrono::system_clock::time_point asOf,
+                             std::vector<unsigned char>& out_plain_data);
+
+    /**
+     * @brief Lists the versions of a data item that can be read back.
+     *
+     * At most getHistoryDepth() old versions are listed, unless history is off, in which
+     * case all that were kept are.
+     *
+     * @param data_id The unique identifier of the data item.
+     * @param[out] out_versions Receives the versions, newest (the current one) first.
+     * @return SecureStorage::Error::Errc::Success on success, Errc::DataNotFound if the id
+     * does not exist, or another error code.
+     */
+    Error::Errc listVersions(const std::string& data_id, std::vector<VersionInfo>& out_versions);
+
+    /**
+     * @brief Sets how many old versions storeData() keeps per id (see RecordHistory).
+     *
+     * Each write then appends the replaced version to `<id>.enc.hist`, as the chunks that
+     * differ from the new version, so the history costs roughly the size of the changes.
+     * The replaced version is read and decrypted first, under the id's lock. 0 (the
+     * default) keeps none; lowering the depth trims longer histories on their next write.
+     *
+     * @param versions Old versions to keep per id.
+     */
+    void setHistoryDepth(unsigned versions);
+
+    /**
+     * @brief Returns how many old versions storeData() keeps per id.
+     * @return The history depth; 0 if history is off.
+     */
+    unsigned getHistoryDepth() const;
+
     /**
      * @brief Deletes a securely stored data item.
-     * Removes both the main data file and its backup.
+     * Removes the main data file, its backup and its version history.
      *
      * @param data_id The unique identifier of the data item to delete.
      * @return SecureStorage::Error::Errc::Success on success (even if data didn't exist),
@@ -90,6 +349,39 @@ public:
      */
     Error::Errc deleteData(const std::string& data_id);
 
+    /**
+     * @brief Starts a transaction: puts and deletes of several ids that take effect together.
+     *
+     * Transaction::commit() validates the ids, writes all changes as one encrypted record
+     * to TRANSACTION_LOG_FILE_NAME and flushes it once; the record files are then updated
+     * in the background without flushing each of them. From the moment commit() returns,
+     * retrieveData(), dataExists() and listDataIds() of this store return the new values of
+     * all the ids, and before it none of them. A crash after commit() is repaired on the
+     * next start by redoing the log. storeData() or deleteData() of an id that a committed
+     * transaction has not updated yet first applies the pending transactions, so the later
+     * write wins. Other stores on the same root see the ids change one by one while they
+     * are applied; for them the transaction is only all-or-none across a crash. commit()
+     * flushes without holding the lock that reads of pending ids take.
+     *
+     * @param beforeCommit If set, called by commit() first; an error it returns fails the
+     * commit. Layers above the store use it to order their own pending writes first.
+     * @return The empty transaction; it must not outlive this store.
+     */
+    Transaction beginTransaction(std::function<Error::Errc()> beforeCommit = nullptr);
+
+    /**
+     * @brief Applies every committed transaction to the record files now, and empties the log.
+     * @return SecureStorage::Error::Errc::Success if none is left pending, or an error code
+     * on failure (they stay pending and are retried in the background).
+     */
+    Error::Errc applyTransactions();
+
+    /**
+     * @brief Returns the transaction counters.
+     * @return A snapshot of the counters; all zero if the store is not initialized.
+     */
+    TransactionStats getTransactionStats() const;
+
     /**
      * @brief Checks if a data item exists.
      *
@@ -107,43 +399,610 @@ public:
      */
     Error::Errc listDataIds(std::vector<std::string>& out_data_ids) const;
 
+    /**
+     * @brief Lists the ids this store knows of without scanning the directory.
+     * The index is seeded by the startup recovery scan and then follows this store's own
+     * storeData() and deleteData() calls; writes by other stores on the same root are
+     * not reflected. Use listDataIds() for the authoritative, on-disk view.
+     *
+     * @param[out] out_data_ids A vector to store the data IDs, sorted.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc listIndexedIds(std::vector<std::string>& out_data_ids) const;
+
+    /**
+     * @brief Enables the negative-lookup filter (see NegativeLookupFilter).
+     *
+     * The filter is built from the id index and then follows storeData() and deleteData().
+     * retrieveData() and dataExists() for an id it rules out return at once, without a
+     * system call or a log line. Because the index does not see writes by other stores, the
+     * filter must only be enabled when this store is the sole writer of its root. It also
+     * needs a complete index, so it refuses if the startup recovery pass did not run or left
+     * ids it could not repair (they may exist as backups only). Must be called before the
+     * store is shared between threads.
+     *
+     * @param targetFalsePositiveRate Share of lookups for missing ids that still go to disk
+     * once the filter is full; the filter is rebuilt larger before it gets there.
+     * @return SecureStorage::Error::Errc::Success on success (also if already enabled),
+     * Errc::OperationFailed if the index is incomplete, or another error code.
+     */
+    Error::Errc enableNegativeLookupFilter(double targetFalsePositiveRate = NEGATIVE_LOOKUP_DEFAULT_FALSE_POSITIVE_RATE);
+
+    /**
+     * @brief Returns the negative-lookup filter counters, including its false-positive rate.
+     * @return The counters; all zero if the filter is not enabled.
+     */
+    NegativeLookupStats getNegativeLookupStats() const;
+
+    /**
+     * @brief Returns how long each phase of construction took.
+     * Phases that did not run (because an earlier one failed) are zero.
+     * @return The timings.
+     */
+    StoreInitTimings getInitTimings() const;
+
+    /**
+     * @brief Returns what the startup recovery pass found and did.
+     * @return The report; `ran` is false if recovery was disabled or did not complete.
+     */
+    RecoveryReport getRecoveryReport() const;
+
+    /**
+     * @brief Enables the cross-process shared read cache for this storage root.
+     *
+     * Creates the shared segment if no process has done so yet, otherwise attaches to the
+     * existing one (whose geometry then wins). Cached entries are raw encrypted records:
+     * hits skip file I/O but are still authenticated and decrypted.
+     *
+     * Every SecureStore on the same root attaches to an existing segment when it writes,
+     * so writers keep the cache coherent even if they never enabled it themselves.
+     *
+     * @param slotCount Number of direct-mapped slots in a new segment.
+     * @param slotDataSize Largest record (in bytes, as stored on disk) a slot can hold.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc enableSharedReadCache(uint32_t slotCount = SHARED_CACHE_DEFAULT_SLOT_COUNT,
+                                      uint32_t slotDataSize = SHARED_CACHE_DEFAULT_SLOT_DATA_SIZE);
+
+    /**
+     * @brief Returns this process's counters for the shared read cache.
+     * @return The counters; all zero if the cache is not attached.
+     */
+    SharedCacheStats getSharedCacheStats() const;
+
+    /**
+     * @brief Enables the in-process plaintext cache (see PlaintextCache).
+     *
+     * Reads then first stat the main file and, if it is unchanged since it was cached,
+     * return the cached plaintext without opening or decrypting it. Writes and deletes
+     * through this store drop the id's entry; changes by other stores are caught by the
+     * identity check. Must be called before the store is shared between threads.
+     *
+     * @param maxBytes Budget for the cached plaintext.
+     * @return SecureStorage::Error::Errc::Success on success (also if already enabled),
+     * or an error code on failure.
+     */
+    Error::Errc enablePlaintextCache(size_t maxBytes = PLAINTEXT_CACHE_DEFAULT_MAX_BYTES);
+
+    /**
+     * @brief Returns the plaintext cache counters, including the prefetch hit rate.
+     * @return The counters; all zero if the cache is not enabled.
+     */
+    PlaintextCacheStats getPlaintextCacheStats() const;
+
+    /**
+     * @brief Loads records into the plaintext cache ahead of use.
+     *
+     * The main files are announced to the kernel with POSIX_FADV_WILLNEED so their reads
+     * are issued together, then read, authenticated and decrypted by a pool of worker
+     * threads. Ids the cache already holds are skipped. Records that fail are left to
+     * the normal read path, which also handles backups; prefetch never repairs anything.
+     *
+     * @param data_ids The ids to load. Duplicates are ignored.
+     * @param[out] report What was loaded, skipped and failed.
+     * @param workerThreads Number of threads; 0 picks one per CPU, at most 8.
+     * @return SecureStorage::Error::Errc::Success if the prefetch ran (individual ids may
+     * still have failed, see the report), Errc::OperationFailed if the plaintext cache is
+     * not enabled, or another error code.
+     */
+    Error::Errc prefetch(const std::vector<std::string>& data_ids, PrefetchReport& report,
+                         unsigned workerThreads = 0);
+
+    /**
+     * @brief Returns the ids read most often, as learned from this and previous runs.
+     * @param limit Maximum number of ids to return.
+     * @return The ids, hottest first.
+     */
+    std::vector<std::string> getHotSet(size_t limit = HOT_SET_DEFAULT_CAPACITY) const;
+
+    /**
+     * @brief Saves the hot set to HOT_SET_FILE_NAME if it changed since it was loaded.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc saveHotSet();
+
+    /**
+     * @brief Verifies both copies of a record and repairs a damaged one from the other.
+     *
+     * The main and backup file are authenticated without any lock. Only if one of them
+     * fails is the id's shard lock tried (through a separate handle, so that it excludes
+     * this store's writers on other threads as well); under it both are checked again. Then a corrupt or missing main file is rewritten from a valid backup,
+     * and a corrupt backup from a valid main file. A missing backup is normal (first
+     * version of an id) and left alone.
+     *
+     * @param data_id The data identifier.
+     * @param[out] result What was found and repaired.
+     * @return SecureStorage::Error::Errc::Success if the record was verified (including when
+     * it is unrecoverable or busy, see result), Errc::DataNotFound if neither file exists,
+     * or an error code if a repair failed.
+     */
+    Error::Errc scrubRecord(const std::string& data_id, ScrubRecordResult& result);
+
+    /**
+     * @brief Attempts every queued backup restore now instead of at its scheduled time.
+     * @return SecureStorage::Error::Errc::Success if no repair is left queued,
+     * Errc::OperationFailed if some stay queued for a retry, or another error code.
+     */
+    Error::Errc runPendingRepairs();
+
+    /**
+     * @brief Returns the counters of the background repair queue.
+     * @return A snapshot of the counters, including the number of pending repairs.
+     */
+    RepairStats getRepairStats() const;
+
+    /**
+     * @brief Starts a background Scrubber that runs scrubRecord() over all ids periodically.
+     * Must be called before the store is shared between threads.
+     * @param options Read budget, thread priority and schedule.
+     * @return SecureStorage::Error::Errc::Success on success, Errc::OperationFailed if a
+     * scrubber is already running, or another error code.
+     */
+    Error::Errc startScrubber(const ScrubOptions& options = ScrubOptions());
+
+    /**
+     * @brief Stops the background Scrubber, if any. A pass in progress is abandoned.
+     */
+    void stopScrubber();
+
+    /**
+     * @brief Makes the background Scrubber start a pass now.
+     * @return SecureStorage::Error::Errc::Success on success, Errc::OperationFailed if no
+     * scrubber is running.
+     */
+    Error::Errc requestScrubPass();
+
+    /**
+     * @brief Returns the progress and results of the background Scrubber.
+     * @return The counters; all zero if no scrubber was started.
+     */
+    ScrubStats getScrubStats() const;
+
+    /**
+     * @brief Chooses how storeData() stages a new record before installing it.
+     *
+     * Enabled (the default), the record is written to an anonymous O_TMPFILE and linked in
+     * only once durable, so an interrupted write leaves nothing behind. Disabled, or where
+     * the filesystem lacks O_TMPFILE or RENAME_EXCHANGE, a named `<id>.enc.tmp` file is used.
+     *
+     * @param enabled Whether anonymous temporary files may be used.
+     */
+    void setAnonymousTempFilesEnabled(bool enabled);
+
+    /**
+     * @brief Sets the durability of storeData() calls that do not pass one. May be called
+     * while other threads store data; each call uses the default it sees when it starts.
+     * @param durability The new default; Durability::Full initially.
+     */
+    void setDefaultDurability(Durability durability);
+
+    /**
+     * @brief Returns the durability of storeData() calls that do not pass one.
+     * @return The current default.
+     */
+    Durability getDefaultDurability() const;
+
+    /**
+     * @brief Sets the cipher of the records this store writes from now on.
+     * Records are read with the cipher their header names, whichever that is.
+     * @param algorithm The cipher; initially the one Encryptor::selectFastestAlgorithm()
+     * picked when the store was constructed.
+     */
+    void setCipherAlgorithm(Crypto::CipherAlgorithm algorithm);
+
+    /**
+     * @brief Returns the cipher of the records this store writes.
+     * @return The current cipher.
+     */
+    Crypto::CipherAlgorithm getCipherAlgorithm() const;
+
+    /**
+     * @brief Chooses which records are written as segmented records (see SegmentedRecord),
+     * whose segments are encrypted and decrypted on several threads. Records of any format
+     * stay readable whatever the options. Must be called before the store is shared
+     * between threads.
+     * @param options Threshold, segment size and workers; SegmentOptions() initially.
+     */
+    void setSegmentOptions(const SegmentOptions& options);
+
+    /**
+     * @brief Sets how long Durability::Deferred writes may stay unflushed.
+     * @param interval The flush interval; DEFAULT_DEFERRED_SYNC_INTERVAL initially.
+     */
+    void setDeferredSyncInterval(std::chrono::milliseconds interval);
+
+    /**
+     * @brief Flushes all Durability::Deferred writes now instead of at the end of the interval.
+     * @return SecureStorage::Error::Errc::Success on success (or if none were pending),
+     * or an error code on failure.
+     */
+    Error::Errc syncDeferred();
+
+    /**
+     * @brief Returns the file system call counters of this store.
+     * @return A snapshot of the counters.
+     */
+    Utils::FileIoStats getIoStats() const;
+
+    /**
+     * @brief Returns the counters of the master key's kernel keyring cache.
+     * @return A snapshot of the counters; all zero if no keyring is configured.
+     */
+    Crypto::KeyCacheStats getKeyCacheStats() const;
+
+    /**
+     * @brief Validates and sanitizes a data_id to ensure it's a safe filename component.
+     * Layers that defer writes use it to reject bad ids before accepting them.
+     * Checks for emptiness, path traversal characters ('/', '\'), '..', etc.
+     *
+     * @param data_id The data identifier to check.
+     * @return SecureStorage::Error::Errc::Success if valid, Errc::InvalidArgument otherwise.
+     */
+    Error::Errc validateDataId(const std::string& data_id) const;
+
 private:
+    /// Where a read puts the plaintext: a vector resized to fit, or caller memory of fixed capacity.
+    struct PlainOutput {
+        std::vector<unsigned char>* vector = nullptr; ///< Used if set; buffer and capacity are ignored
+        unsigned char* buffer = nullptr;
+        size_t capacity = 0;
+        size_t size = 0; ///< Plaintext size; also set when the read ends with Errc::BufferTooSmall
+    };
+
+    /// What appendHistory() needs of an id's history, as its last append left it. Valid
+    /// while the history file is unchanged and the main file holds what that write installed.
+    struct HistoryHead {
+        Utils::FileIdentity historyFile;
+        uint64_t mainDigest = 0;    ///< RecordHistory::digest() of the version that write installed
+        uint32_t version = 0;       ///< Version of the newest entry
+        int64_t supersededAtNs = 0; ///< supersededAtNs of the newest entry
+        size_t frames = 0;          ///< Frames in the history file
+    };
+
     std::string m_rootStoragePath;
     std::unique_ptr<Crypto::KeyProvider> m_keyProvider;
     std::unique_ptr<Crypto::Encryptor> m_encryptor;
-    std::vector<unsigned char> m_masterKey; // Stores the derived master encryption key
+    Utils::SecureBytes m_masterKey; // The derived master encryption key, in the secure arena
+    std::atomic<Crypto::CipherAlgorithm> m_cipher; // Cipher of new records
+    std::unique_ptr<Utils::DirFileUtil> m_rootDir; // Root directory held open; all record I/O is relative to it
+    std::unique_ptr<Utils::FileLock> m_writeLock; // Cross-process per-shard writer locks
+    // The optional caches and filter below are created at most once, under m_featureMutex,
+    // and published through their atomic pointer: readers on other threads load it without
+    // a lock, and it never changes again once set. The owners keep them alive until teardown.
+    std::mutex m_featureMutex;
+    std::unique_ptr<SharedRecordCache> m_sharedCacheOwner;
+    std::atomic<SharedRecordCache*> m_sharedCache; // Optional cross-process read cache
+    std::string m_sharedCachePath;
+    std::unique_ptr<DeferredSync> m_deferredSync; // Periodic syncfs for Durability::Deferred writes
+    std::atomic<Durability> m_defaultDurability; // Set at any time by setDefaultDurability()
+    SegmentOptions m_segmentOptions; // Which records encryptRecord() segments
+    RecoveryReport m_recoveryReport;
+    StoreInitTimings m_initTimings;
+    std::unordered_set<std::string> m_idIndex; // Ids with a main file, as far as this store knows
+    mutable std::mutex m_idIndexMutex;         // Protects m_idIndex and the updates of m_negativeFilter
+    std::unique_ptr<NegativeLookupFilter> m_negativeFilterOwner;
+    std::atomic<NegativeLookupFilter*> m_negativeFilter; // Optional; rules out ids missing from m_idIndex
+    std::unique_ptr<PlaintextCache> m_plainCacheOwner;
+    std::atomic<PlaintextCache*> m_plainCache; // Optional in-process cache of decrypted records
+    HotSetTracker m_hotSet;                       // Read frequency per id, persisted by saveHotSet()
+    std::atomic<unsigned> m_historyDepth;         // Old versions kept per id; 0 disables history
+    std::mutex m_historyHeadMutex;                // Protects m_historyHeads
+    std::unordered_map<std::string, HistoryHead> m_historyHeads; // Spares appends decrypting the whole history
     bool m_initialized;
+    // Lock handle of repairs (scrubRecord): locks through m_writeLock would not exclude
+    // this store's writers on other threads, as they share its open file description.
+    std::unique_ptr<Utils::FileLock> m_repairLock;
+    // Declared last so they are destroyed, and their threads stopped, before what they use.
+    std::unique_ptr<RepairQueue> m_repairQueue; // Restores main files from backups off the read path
+    std::unique_ptr<Scrubber> m_scrubber;
+    std::unique_ptr<TransactionLog> m_transactionLog; // Applies its pending transactions on destruction
+
+    /**
+     * @brief Constructs the file name (relative to the root) of a main data file.
+     * @param data_id The data identifier.
+     * @return The file name.
+     */
+    std::string getDataFileName(const std::string& data_id) const;
 
     /**
-     * @brief Constructs the full file path for a main data file.
+     * @brief Builds the file name of a main data file into out_name, reusing its capacity.
      * @param data_id The data identifier.
-     * @return The full path string.
+     * @param[out] out_name Receives the file name.
      */
-    std::string getDataFilePath(const std::string& data_id) const;
+    void getDataFileName(const std::string& data_id, std::string& out_name) const;
 
     /**
-     * @brief Constructs the full file path for a backup data file.
+     * @brief Constructs the file name (relative to the root) of a backup data file.
      * @param data_id The data identifier.
-     * @return The full path string.
+     * @return The file name.
      */
-    std::string getBackupFilePath(const std::string& data_id) const;
+    std::string getBackupFileName(const std::string& data_id) const;
 
     /**
-     * @brief Constructs the full file path for a temporary data file.
+     * @brief Builds the file name of a backup data file into out_name, reusing its capacity.
      * @param data_id The data identifier.
-     * @return The full path string.
+     * @param[out] out_name Receives the file name.
      */
-    std::string getTempFilePath(const std::string& data_id) const;
+    void getBackupFileName(const std::string& data_id, std::string& out_name) const;
 
+    /**
+     * @brief Constructs the file name (relative to the root) of a temporary data file.
+     * @param data_id The data identifier.
+     * @return The file name.
+     */
+    std::string getTempFileName(const std::string& data_id) const;
 
     /**
-     * @brief Validates and sanitizes a data_id to ensure it's a safe filename component.
-     * Checks for emptiness, path traversal characters ('/', '\'), '..', etc.
+     * @brief Builds the file name of a temporary data file into out_name, reusing its capacity.
+     * @param data_id The data identifier.
+     * @param[out] out_name Receives the file name.
+     */
+    void getTempFileName(const std::string& data_id, std::string& out_name) const;
+
+    /**
+     * @brief Constructs the file name (relative to the root) of a version history file.
+     * @param data_id The data identifier.
+     * @return The file name.
+     */
+    std::string getHistoryFileName(const std::string& data_id) const;
+
+    /**
+     * @brief Encrypts, installs and indexes a record; storeData() after validation.
+     * @param data_id A validated data identifier.
+     * @param plain_data Pointer to the data to store (may be null if size is 0).
+     * @param size Number of bytes at plain_data.
+     * @param durability What the write must survive once this call returns.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc writeRecord(const std::string& data_id, const unsigned char* plain_data, size_t size,
+                            Durability durability);
+
+    /**
+     * @brief writeRecord() that encrypts inside buffer, falling back to writeRecord() while
+     * a history is kept.
+     * @param data_id A validated data identifier.
+     * @param[in,out] buffer The plaintext; holds the record (or, on failure, nothing) afterwards.
+     * @param durability What the write must survive once this call returns.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc writeRecordInPlace(const std::string& data_id, std::vector<unsigned char>& buffer,
+                                   Durability durability);
+
+    /**
+     * @brief The second half of writeRecord(): installs an encrypted record under the shard
+     * lock, with its history entry, and updates caches and index.
+     * @param data_id A validated data identifier.
+     * @param encrypted_data The record.
+     * @param durability What the write must survive once this call returns.
+     * @param keep_history Whether to append the replaced version to the history first.
+     * @param plain_data Pointer to the record's plaintext; only used if keep_history is set.
+     * @param size Number of bytes at plain_data.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc installRecord(const std::string& data_id, const std::vector<unsigned char>& encrypted_data,
+                              Durability durability, bool keep_history, const unsigned char* plain_data, size_t size);
+
+    /**
+     * @brief Deletes the main file, backup and history of a record; deleteData() after validation.
+     * @param data_id A validated data identifier.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc removeRecord(const std::string& data_id);
+
+    /**
+     * @brief Commits the changes of a Transaction to the transaction log.
+     * @param[in,out] ops The changes; taken on success.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc commitTransaction(std::vector<TransactionOp>& ops);
+
+    /**
+     * @brief Applies the pending transactions if one of them changes data_id, so that a
+     * write of data_id that follows is not overwritten by them.
+     * @param data_id A validated data identifier.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc applyTransactionsTouching(const std::string& data_id);
+
+    /**
+     * @brief Encrypts plaintext into a versioned record bound to aad_id; a segmented one
+     * if it reaches the threshold of m_segmentOptions.
+     * @param aad_id The identifier authenticated with the record (the data_id for records).
+     * @param plain_data Pointer to the plaintext (may be null if size is 0).
+     * @param size Number of bytes at plain_data.
+     * @param[out] out_record Receives header and encrypted body.
+     * @param kind RECORD_KIND_* written to the (authenticated) header.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc encryptRecord(const std::string& aad_id, const unsigned char* plain_data, size_t size,
+                              std::vector<unsigned char>& out_record, uint8_t kind = RECORD_KIND_DATA);
+
+    /**
+     * @brief encryptRecord() inside the plaintext's own buffer.
+     * @param aad_id The identifier authenticated with the record.
+     * @param[in,out] buffer The plaintext; the record on success, wiped and empty on failure.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc encryptRecordInPlace(const std::string& aad_id, std::vector<unsigned char>& buffer);
+
+    /**
+     * @brief Reads and decrypts the history entries of data_id, in file order.
+     * Frames that fail to decrypt or parse are kept as entries that never link.
      *
-     * @param data_id The data identifier to check.
-     * @return SecureStorage::Error::Errc::Success if valid, Errc::InvalidArgument otherwise.
+     * @param data_id The data identifier.
+     * @param[out] frames Receives the raw frames (for compaction).
+     * @param[out] entries Receives one entry per frame.
+     * @return SecureStorage::Error::Errc::Success (also if there is no history), or an
+     * error code if the file exists but cannot be read.
      */
-    Error::Errc validateDataId(const std::string& data_id) const;
+    Error::Errc loadHistory(const std::string& data_id, std::vector<std::vector<unsigned char>>& frames,
+                            std::vector<HistoryEntry>& entries);
+
+    /**
+     * @brief Appends the version that new_plain_data replaces to the history of data_id.
+     * The caller holds the id's shard lock. A main file that cannot be read or decrypted
+     * is not recorded; that ends the history reachable from the new version. The history
+     * is only decrypted when its remembered head (m_historyHeads) is stale or it is compacted.
+     *
+     * @return SecureStorage::Error::Errc::Success on success, or an error code if the
+     * history could not be written (the write must then not proceed).
+     */
+    Error::Errc appendHistory(const std::string& data_id, const unsigned char* new_plain_data, size_t new_size,
+                              Utils::FileSync sync);
+
+    /**
+     * @brief Reads the current version of data_id and the history entries linked to it.
+     *
+     * @param data_id A validated data identifier.
+     * @param[out] current_plain Receives the current plaintext.
+     * @param[out] entries Receives the history entries in file order.
+     * @param[out] chain Receives indices into entries, newest version first.
+     * @param[out] current Receives the description of the current version.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc loadVersionChain(const std::string& data_id, std::vector<unsigned char>& current_plain,
+                                 std::vector<HistoryEntry>& entries, std::vector<size_t>& chain, VersionInfo& current);
+
+    /**
+     * @brief Installs record as main_file, keeping the previous main as backup_file, using
+     * an anonymous file that is linked in once flushed and swapped with main atomically.
+     * Does not sync the directory.
+     *
+     * @return SecureStorage::Error::Errc::Success on success, Errc::OperationFailed if this
+     * path is unavailable (nothing was changed except the old backup), or another error code.
+     */
+    Error::Errc installRecordAnonymously(const std::string& main_file, const std::string& backup_file,
+                                         const std::vector<unsigned char>& record, Utils::FileSync sync);
+
+    /**
+     * @brief Installs record as main_file, keeping the previous main as backup_file, by way
+     * of the named temporary file temp_file. Does not sync the directory.
+     *
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc installRecordViaTempFile(const std::string& data_id, const std::string& main_file,
+                                         const std::string& backup_file, const std::string& temp_file,
+                                         const std::vector<unsigned char>& record, Utils::FileSync sync);
+
+    /**
+     * @brief Attaches to the shared read cache segment if another store created it.
+     * Called by writers so that they invalidate entries other processes may be serving;
+     * the attachment is published once and then reused.
+     * @return The attached cache, or nullptr if there is none.
+     */
+    SharedRecordCache* attachSharedCacheIfPresent();
+
+    /**
+     * @brief Runs StartupRecovery on the root and seeds m_idIndex from its scan.
+     * Failures are logged and leave the store usable.
+     * @param options The recovery settings passed to the constructor.
+     */
+    void runStartupRecovery(const RecoveryOptions& options);
+
+    /**
+     * @brief Records that data_id has a main file now: adds it to m_idIndex and, if it
+     * was new there, to the negative-lookup filter.
+     * @param data_id The data identifier.
+     */
+    void indexId(const std::string& data_id);
+
+    /**
+     * @brief Records that data_id's main file is gone.
+     * @param data_id The data identifier.
+     */
+    void unindexId(const std::string& data_id);
+
+    /**
+     * @brief retrieveData() after validation and the in-memory checks: the plaintext cache,
+     * then readRecord(). Counts hot set accesses and negative-filter false positives.
+     *
+     * @param data_id A validated data identifier.
+     * @param identity The main file's identity if the caller just stat'ed it, or nullptr.
+     * @param[out] out_plain_data Receives the decrypted data.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc readValidated(const std::string& data_id, const Utils::FileIdentity* identity,
+                              std::vector<unsigned char>& out_plain_data);
+
+    /**
+     * @brief readValidated() into a PlainOutput; a too small caller buffer ends the read
+     * with Errc::BufferTooSmall and out.size set.
+     */
+    Error::Errc readValidated(const std::string& data_id, const Utils::FileIdentity* identity, PlainOutput& out);
+
+    /**
+     * @brief Reads data_id from the shared cache, the main file or its backup, in that
+     * order, queueing a restore of the main file when the backup had to be used.
+     * The plaintext cache is filled from main file reads but not consulted.
+     *
+     * @param data_id A validated data identifier.
+     * @param[out] out_plain_data Receives the decrypted data.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc readRecord(const std::string& data_id, std::vector<unsigned char>& out_plain_data);
+
+    /**
+     * @brief readRecord() into a PlainOutput. Errc::BufferTooSmall ends the read at once
+     * (the backup would not fit either), without dropping the shared cache entry.
+     */
+    Error::Errc readRecord(const std::string& data_id, PlainOutput& out);
+
+    /**
+     * @brief Decrypts a main file with Encryptor::decryptFromFile(), so that with the kernel
+     * backend its ciphertext never reaches user memory. readRecord() uses it when no shared
+     * cache wants the ciphertext.
+     * @param data_id A validated data identifier.
+     * @param file_name Name of the main file of data_id.
+     * @param[out] out Receives the plaintext.
+     * @param[out] identity Receives the identity of the file read.
+     * @return SecureStorage::Error::Errc::Success on success; Errc::OperationFailed without
+     * decrypting for records it leaves to decryptRecord() (legacy, segmented), or another
+     * error code on failure.
+     */
+    Error::Errc decryptFileRecord(const std::string& data_id, const std::string& file_name, PlainOutput& out,
+                                  Utils::FileIdentity& identity);
+
+    /**
+     * @brief Authenticates and decrypts a raw record read from disk.
+     * Versioned records are verified against their header and data_id (as AAD) in the
+     * same pass that decrypts them; legacy headerless records are decrypted without AAD.
+     *
+     * @param data_id The identifier the record was read for.
+     * @param record The raw file content.
+     * @param[out] out_plain_data Receives the decrypted data.
+     * @param kind RECORD_KIND_* the record must carry; legacy records only pass as data.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc decryptRecord(const std::string& data_id, const std::vector<unsigned char>& record,
+                              std::vector<unsigned char>& out_plain_data, uint8_t kind = RECORD_KIND_DATA);
+
+    /**
+     * @brief decryptRecord() of a record in memory into a PlainOutput. The plaintext size
+     * is taken from the record first; if a caller buffer is too small, nothing is decrypted
+     * and Errc::BufferTooSmall is returned with out.size set. Wipes the output on failure.
+     */
+    Error::Errc decryptRecord(const std::string& data_id, const unsigned char* record, size_t record_size,
+                              PlainOutput& out, uint8_t kind = RECORD_KIND_DATA);
 };
 
 } // namespace Storage
@@ -0,0 +1,294 @@
+#include "SegmentedRecord.h"
+#include "Encryptor.h"
+#include "Logger.h"
+#include "SecureWipe.h" // For Utils::secureWipe
+
+#include <algorithm> // For std::min, std::max
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <cstdint>   // For uint32_t, uint64_t
+#include <cstring>   // For memcpy
+
+namespace SecureStorage {
+namespace Storage {
+
+namespace {
+
+// [segment size u32][segment count u32][plaintext size u64]
+constexpr size_t TABLE_HEAD_SIZE = 4 + 4 + 8;
+// Counter value reserved for the IV of the table tag; segment indexes stay below it.
+constexpr uint32_t TABLE_IV_INDEX = 0xFFFFFFFFu;
+
+void putLe(unsigned char* out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+        out[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+uint64_t getLe(const unsigned char* in, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+void deriveIv(const unsigned char* base, uint32_t index, unsigned char* iv) {
+    std::memcpy(iv, base, Crypto::AES_GCM_IV_SIZE_BYTES);
+    unsigned char* counter = iv + Crypto::AES_GCM_IV_SIZE_BYTES - 4;
+    for (size_t i = 0; i < 4; ++i) {
+        counter[i] ^= static_cast<unsigned char>(index >> (8 * (3 - i)));
+    }
+}
+
+// AAD of one segment: the record's AAD, the table head and the segment index.
+void buildSegmentAad(const std::vector<unsigned char>& aad, const unsigned char* tableHead, uint32_t index,
+                     std::vector<unsigned char>& out) {
+    out.assign(aad.begin(), aad.end());
+    out.insert(out.end(), tableHead, tableHead + TABLE_HEAD_SIZE);
+    unsigned char encoded[4];
+    putLe(encoded, index, 4);
+    out.insert(out.end(), encoded, encoded + 4);
+}
+
+size_t tableSize(size_t segmentCount) {
+    return TABLE_HEAD_SIZE + Crypto::AES_GCM_IV_SIZE_BYTES + (segmentCount + 1) * Crypto::AES_GCM_TAG_SIZE_BYTES;
+}
+
+// Runs fn(0) .. fn(count - 1) on up to workers threads, the caller being one of them.
+// Stops handing out segments after the first failure and returns its error.
+Error::Errc forEachSegment(size_t count, unsigned workers, const std::function<Error::Errc(size_t)>& fn) {
+    if (workers == 0) {
+        workers = std::min(std::max(std::thread::hardware_concurrency(), 1u), SEGMENTED_RECORD_MAX_DEFAULT_WORKERS);
+    }
+    size_t threads = std::max<size_t>(std::min<size_t>(workers, count), 1);
+
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+    std::mutex error_mutex;
+    Error::Errc first_error = Error::Errc::Success;
+    auto work = [&]() {
+        while (!failed.load(std::memory_order_relaxed)) {
+            size_t i = next.fetch_add(1, std::memory_order_relaxed);
+            if (i >= count) {
+                break;
+            }
+            Error::Errc err = fn(i);
+            if (err != Error::Errc::Success) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!failed.exchange(true)) {
+                    first_error = err;
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (size_t t = 1; t < threads; ++t) {
+        pool.emplace_back(work);
+    }
+    work();
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+    return first_error;
+}
+
+// Writes the segment table at table and encrypts size bytes from plaintext into the
+// ciphertext area that follows it. plaintext may be that area itself (in place).
+Error::Errc sealBody(Crypto::Encryptor& encryptor, const Utils::SecureBytes& key,
+                     Crypto::CipherAlgorithm algorithm, const std::vector<unsigned char>& aad,
+                     const unsigned char* plaintext, size_t size, size_t segmentSize, size_t count,
+                     unsigned workers, unsigned char* table) {
+    std::vector<unsigned char> base_iv;
+    Error::Errc err = encryptor.generateIv(base_iv);
+    if (err != Error::Errc::Success) {
+        return err;
+    }
+    putLe(table, segmentSize, 4);
+    putLe(table + 4, count, 4);
+    putLe(table + 8, size, 8);
+    std::memcpy(table + TABLE_HEAD_SIZE, base_iv.data(), Crypto::AES_GCM_IV_SIZE_BYTES);
+    unsigned char* tags = table + TABLE_HEAD_SIZE + Crypto::AES_GCM_IV_SIZE_BYTES;
+    unsigned char* ciphertext = table + tableSize(count);
+
+    // Each worker writes only its own segment and tag.
+    err = forEachSegment(count, workers, [&](size_t i) {
+        size_t offset = i * segmentSize;
+        size_t length = std::min(segmentSize, size - offset);
+        unsigned char iv[Crypto::AES_GCM_IV_SIZE_BYTES];
+        deriveIv(base_iv.data(), static_cast<uint32_t>(i), iv);
+        std::vector<unsigned char> segment_aad;
+        buildSegmentAad(aad, table, static_cast<uint32_t>(i), segment_aad);
+        return encryptor.encryptDetached(plaintext + offset, length, key.data(), key.size(), iv, segment_aad,
+                                         ciphertext + offset, tags + i * Crypto::AES_GCM_TAG_SIZE_BYTES, algorithm);
+    });
+    if (err != Error::Errc::Success) {
+        return err;
+    }
+    // Sign the table: the tag of an empty message over the record's AAD and everything before the table tag.
+    std::vector<unsigned char> table_aad(aad);
+    table_aad.insert(table_aad.end(), table, tags + count * Crypto::AES_GCM_TAG_SIZE_BYTES);
+    unsigned char iv[Crypto::AES_GCM_IV_SIZE_BYTES];
+    deriveIv(base_iv.data(), TABLE_IV_INDEX, iv);
+    return encryptor.encryptDetached(nullptr, 0, key.data(), key.size(), iv, table_aad, nullptr,
+                                     tags + count * Crypto::AES_GCM_TAG_SIZE_BYTES, algorithm);
+}
+
+// Counts the segments of size bytes; InvalidArgument if the arguments are unusable.
+Error::Errc segmentCount(const unsigned char* plaintext, size_t size, size_t segmentSize, size_t& count) {
+    if (segmentSize == 0 || segmentSize > UINT32_MAX || (size > 0 && plaintext == nullptr)) {
+        return Error::Errc::InvalidArgument;
+    }
+    count = (size + segmentSize - 1) / segmentSize;
+    if (count >= TABLE_IV_INDEX) {
+        SS_LOG_ERROR("Record of " << size << " bytes needs too many segments of " << segmentSize << " bytes.");
+        return Error::Errc::InvalidArgument;
+    }
+    return Error::Errc::Success;
+}
+
+} // namespace
+
+Error::Errc SegmentedRecord::encrypt(Crypto::Encryptor& encryptor, const Utils::SecureBytes& key,
+                                     Crypto::CipherAlgorithm algorithm, const std::vector<unsigned char>& aad,
+                                     const unsigned char* plaintext, size_t size, size_t segmentSize, unsigned workers,
+                                     std::vector<unsigned char>& out) {
+    size_t count = 0;
+    Error::Errc err = segmentCount(plaintext, size, segmentSize, count);
+    if (err != Error::Errc::Success) {
+        return err;
+    }
+    const size_t start = out.size();
+    // One allocation for the whole body.
+    out.resize(start + tableSize(count) + size);
+    err = sealBody(encryptor, key, algorithm, aad, plaintext, size, segmentSize, count, workers, out.data() + start);
+    if (err != Error::Errc::Success) {
+        out.resize(start);
+        return err;
+    }
+    SS_LOG_DEBUG("Encrypted " << size << " bytes as " << count << " segments.");
+    return Error::Errc::Success;
+}
+
+Error::Errc SegmentedRecord::encryptInPlace(Crypto::Encryptor& encryptor, const Utils::SecureBytes& key,
+                                            Crypto::CipherAlgorithm algorithm, const std::vector<unsigned char>& aad,
+                                            std::vector<unsigned char>& buffer, size_t headroom, size_t segmentSize,
+                                            unsigned workers) {
+    const size_t size = buffer.size();
+    size_t count = 0;
+    Error::Errc err = segmentCount(buffer.data(), size, segmentSize, count);
+    if (err != Error::Errc::Success) {
+        Utils::secureWipe(buffer);
+        return err;
+    }
+    // Slide the plaintext up behind the headroom and the table in one move; the segments
+    // are then encrypted where they lie.
+    const size_t table_size = tableSize(count);
+    buffer.resize(headroom + table_size + size);
+    unsigned char* table = buffer.data() + headroom;
+    std::memmove(table + table_size, buffer.data(), size);
+    err = sealBody(encryptor, key, algorithm, aad, table + table_size, size, segmentSize, count, workers, table);
+    if (err != Error::Errc::Success) {
+        // Segments that were not reached still hold plaintext.
+        Utils::secureWipe(buffer);
+        return err;
+    }
+    SS_LOG_DEBUG("Encrypted " << size << " bytes in place as " << count << " segments.");
+    return Error::Errc::Success;
+}
+
+size_t SegmentedRecord::bodyOverhead(size_t size, size_t segmentSize) {
+    return tableSize(segmentSize == 0 ? 0 : (size + segmentSize - 1) / segmentSize);
+}
+
+Error::Errc SegmentedRecord::decrypt(Crypto::Encryptor& encryptor, const Utils::SecureBytes& key,
+                                     Crypto::CipherAlgorithm algorithm, const std::vector<unsigned char>& aad,
+                                     const unsigned char* body, size_t size, unsigned workers,
+                                     std::vector<unsigned char>& plaintext) {
+    plaintext.clear();
+    size_t plain_size = 0;
+    Error::Errc err = plaintextSize(body, size, plain_size);
+    if (err != Error::Errc::Success) {
+        return err;
+    }
+    plaintext.resize(plain_size);
+    err = decrypt(encryptor, key, algorithm, aad, body, size, workers, plaintext.data(), plaintext.size());
+    if (err != Error::Errc::Success) {
+        plaintext.clear(); // Already wiped
+    }
+    return err;
+}
+
+Error::Errc SegmentedRecord::decrypt(Crypto::Encryptor& encryptor, const Utils::SecureBytes& key,
+                                     Crypto::CipherAlgorithm algorithm, const std::vector<unsigned char>& aad,
+                                     const unsigned char* body, size_t size, unsigned workers,
+                                     unsigned char* plaintext, size_t capacity) {
+    size_t plain_size = 0;
+    Error::Errc err = plaintextSize(body, size, plain_size);
+    if (err != Error::Errc::Success) {
+        return err;
+    }
+    if (plain_size > 0 && (plaintext == nullptr || capacity < plain_size)) {
+        return Error::Errc::BufferTooSmall;
+    }
+    const size_t segment_size = static_cast<size_t>(getLe(body, 4));
+    const size_t count = static_cast<size_t>(getLe(body + 4, 4));
+
+    const unsigned char* base_iv = body + TABLE_HEAD_SIZE;
+    const unsigned char* tags = base_iv + Crypto::AES_GCM_IV_SIZE_BYTES;
+    const unsigned char* table_tag = tags + count * Crypto::AES_GCM_TAG_SIZE_BYTES;
+    const unsigned char* ciphertext = table_tag + Crypto::AES_GCM_TAG_SIZE_BYTES;
+
+    std::vector<unsigned char> table_aad(aad);
+    table_aad.insert(table_aad.end(), body, table_tag);
+    unsigned char iv[Crypto::AES_GCM_IV_SIZE_BYTES];
+    deriveIv(base_iv, TABLE_IV_INDEX, iv);
+    err = encryptor.decryptDetached(nullptr, 0, key.data(), key.size(), iv, table_aad, table_tag, nullptr, algorithm);
+    if (err != Error::Errc::Success) {
+        return err;
+    }
+
+    err = forEachSegment(count, workers, [&](size_t i) {
+        size_t offset = i * segment_size;
+        size_t length = std::min(segment_size, plain_size - offset);
+        unsigned char segment_iv[Crypto::AES_GCM_IV_SIZE_BYTES];
+        deriveIv(base_iv, static_cast<uint32_t>(i), segment_iv);
+        std::vector<unsigned char> segment_aad;
+        buildSegmentAad(aad, body, static_cast<uint32_t>(i), segment_aad);
+        return encryptor.decryptDetached(ciphertext + offset, length, key.data(), key.size(), segment_iv, segment_aad,
+                                         tags + i * Crypto::AES_GCM_TAG_SIZE_BYTES, plaintext + offset, algorithm);
+    });
+    if (err != Error::Errc::Success) {
+        // Do not leave the plaintext of the segments that did authenticate behind.
+        Utils::secureWipe(plaintext, plain_size);
+        return err;
+    }
+    return Error::Errc::Success;
+}
+
+Error::Errc SegmentedRecord::plaintextSize(const unsigned char* body, size_t size, size_t& plaintextSize) {
+    plaintextSize = 0;
+    if (body == nullptr || size < tableSize(0)) {
+        return Error::Errc::DeserializationFailed;
+    }
+    const size_t segment_size = static_cast<size_t>(getLe(body, 4));
+    const uint64_t count = getLe(body + 4, 4);
+    const uint64_t plain_size = getLe(body + 8, 8);
+    // The table must describe exactly the bytes that follow it.
+    if (segment_size == 0 || count >= TABLE_IV_INDEX ||
+        count > (size - tableSize(0)) / Crypto::AES_GCM_TAG_SIZE_BYTES ||
+        plain_size != size - tableSize(static_cast<size_t>(count)) ||
+        count != (plain_size + segment_size - 1) / segment_size) {
+        SS_LOG_WARN("Malformed segment table.");
+        return Error::Errc::DeserializationFailed;
+    }
+    plaintextSize = static_cast<size_t>(plain_size);
+    return Error::Errc::Success;
+}
+
+} // namespace Storage
+} // namespace SecureStorage
@@ -0,0 +1,158 @@
+#ifndef SS_SEGMENTED_RECORD_H
+#define SS_SEGMENTED_RECORD_H
+
+#include "Error.h"
+#include "Encryptor.h" // For Crypto::CipherAlgorithm
+#include "SecureArena.h" // For Utils::SecureBytes
+#include <vector>
+#include <cstddef> // For size_t
+
+namespace SecureStorage {
+namespace Storage {
+
+// Plaintexts at least this large are stored as segmented records by default.
+constexpr size_t SEGMENTED_RECORD_DEFAULT_THRESHOLD = 4 * 1024 * 1024;
+// Plaintext bytes per segment by default.
+constexpr size_t SEGMENTED_RECORD_DEFAULT_SEGMENT_SIZE = 1024 * 1024;
+// Upper bound of the default number of segment workers.
+constexpr unsigned SEGMENTED_RECORD_MAX_DEFAULT_WORKERS = 8;
+
+/**
+ * @struct SegmentOptions
+ * @brief When and how SecureStore splits large records into segments.
+ */
+struct SegmentOptions {
+    /// Plaintexts of at least this many bytes are segmented; 0 never segments.
+    size_t threshold = SEGMENTED_RECORD_DEFAULT_THRESHOLD;
+    /// Plaintext bytes per segment; the last segment may be shorter.
+    size_t segmentSize = SEGMENTED_RECORD_DEFAULT_SEGMENT_SIZE;
+    /// Threads that encrypt or decrypt the segments of one record, the caller included;
+    /// 0 picks min(hardware threads, SEGMENTED_RECORD_MAX_DEFAULT_WORKERS).
+    unsigned workers = 0;
+};
+
+/**
+ * @class SegmentedRecord
+ * @brief Encrypts large records as independently authenticated segments, in parallel.
+ *
+ * A single AEAD pass is sequential, so one large record would keep one core busy. A
+ * segmented record instead encrypts each segment with its own IV and tag, on a pool of
+ * workers that write straight into their segment's place in the output. Its body is
+ *
+ *     [segment size u32][segment count u32][plaintext size u64][base IV]
+ *     [tag of segment 0] ... [tag of segment n-1] [table tag]
+ *     [ciphertext of segment 0] ... [ciphertext of segment n-1]
+ *
+ * (integers little-endian). The IV of segment i is the random base IV with its last four
+ * bytes XORed with i. Each segment authenticates the record's AAD, the first three table
+ * fields and its index, so segments cannot be moved, dropped or spliced in from another
+ * record. The table up to the segment tags is signed by the table tag, the tag of an empty
+ * message (a GMAC, for AES-GCM) under the same key and cipher over the record's AAD and
+ * the table, with the IV of index 0xFFFFFFFF; it is verified before any segment is decrypted.
+ */
+class SegmentedRecord {
+public:
+    SegmentedRecord() = delete; // Static class, no instances
+
+    /**
+     * @brief Encrypts plaintext as a segmented body and appends it to out.
+     * @param encryptor Supplies the base IV (drawn like Encryptor::encrypt()'s) and the
+     * per-segment passes.
+     * @param key The 256-bit encryption key.
+     * @param algorithm The cipher of every segment and of the table tag.
+     * @param aad The AAD of the record (serialized header and id).
+     * @param plaintext Pointer to the data to encrypt (may be null if size is 0).
+     * @param size Number of bytes at plaintext.
+     * @param segmentSize Plaintext bytes per segment; must not be 0.
+     * @param workers Threads to use, the caller included; 0 picks the default.
+     * @param[in,out] out The body is appended to it (typically after the header).
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure
+     * (out is then restored to its previous size).
+     */
+    static Error::Errc encrypt(Crypto::Encryptor& encryptor, const Utils::SecureBytes& key,
+                               Crypto::CipherAlgorithm algorithm, const std::vector<unsigned char>& aad,
+                               const unsigned char* plaintext, size_t size, size_t segmentSize, unsigned workers,
+                               std::vector<unsigned char>& out);
+
+    /**
+     * @brief Encrypts plaintext as a segmented body where it lies, without a second buffer.
+     *
+     * The plaintext is moved up to make room for headroom bytes and the segment table (within
+     * the buffer's capacity if it has bodyOverhead() + headroom bytes to spare), and each
+     * segment is then encrypted in place.
+     *
+     * @param encryptor Supplies the base IV and the per-segment passes.
+     * @param key The 256-bit encryption key.
+     * @param algorithm The cipher of every segment and of the table tag.
+     * @param aad The AAD of the record (serialized header and id).
+     * @param[in,out] buffer Holds the plaintext; on success headroom bytes left for the caller
+     * (typically the header) followed by the body. Wiped and emptied on failure.
+     * @param headroom Bytes to leave in front of the body.
+     * @param segmentSize Plaintext bytes per segment; must not be 0.
+     * @param workers Threads to use, the caller included; 0 picks the default.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    static Error::Errc encryptInPlace(Crypto::Encryptor& encryptor, const Utils::SecureBytes& key,
+                                      Crypto::CipherAlgorithm algorithm, const std::vector<unsigned char>& aad,
+                                      std::vector<unsigned char>& buffer, size_t headroom, size_t segmentSize,
+                                      unsigned workers);
+
+    /**
+     * @brief Returns how many bytes a segmented body adds to its plaintext (the table).
+     * @param size Number of plaintext bytes.
+     * @param segmentSize Plaintext bytes per segment.
+     * @return The size of the body minus size.
+     */
+    static size_t bodyOverhead(size_t size, size_t segmentSize);
+
+    /**
+     * @brief Verifies the segment table and decrypts a segmented body.
+     * @param encryptor Performs the per-segment passes.
+     * @param key The 256-bit encryption key.
+     * @param algorithm The cipher the record was encrypted with.
+     * @param aad The AAD the record was encrypted with.
+     * @param body Pointer to the body (after the header).
+     * @param size Number of bytes at body.
+     * @param workers Threads to use, the caller included; 0 picks the default.
+     * @param[out] plaintext Receives the data; cleared on failure.
+     * @return SecureStorage::Error::Errc::Success on success,
+     * Errc::DeserializationFailed if the body is malformed,
+     * Errc::AuthenticationFailed if the table or a segment fails to authenticate,
+     * or another error code.
+     */
+    static Error::Errc decrypt(Crypto::Encryptor& encryptor, const Utils::SecureBytes& key,
+                               Crypto::CipherAlgorithm algorithm, const std::vector<unsigned char>& aad,
+                               const unsigned char* body, size_t size, unsigned workers,
+                               std::vector<unsigned char>& plaintext);
+
+    /**
+     * @brief Verifies the segment table and decrypts a segmented body into caller memory.
+     * @see decrypt(Crypto::Encryptor&, const Utils::SecureBytes&, Crypto::CipherAlgorithm,
+     * const std::vector<unsigned char>&, const unsigned char*, size_t, unsigned, std::vector<unsigned char>&)
+     *
+     * @param[out] plaintext Receives plaintextSize() bytes; wiped on failure.
+     * @param capacity Number of bytes available at plaintext.
+     * @return As the vector overload, or Errc::BufferTooSmall if capacity is too small
+     * (nothing is decrypted then).
+     */
+    static Error::Errc decrypt(Crypto::Encryptor& encryptor, const Utils::SecureBytes& key,
+                               Crypto::CipherAlgorithm algorithm, const std::vector<unsigned char>& aad,
+                               const unsigned char* body, size_t size, unsigned workers,
+                               unsigned char* plaintext, size_t capacity);
+
+    /**
+     * @brief Reads the plaintext size from the segment table without decrypting.
+     * The size is checked against the body's length but not authenticated yet.
+     * @param body Pointer to the body (after the header).
+     * @param size Number of bytes at body.
+     * @param[out] plaintextSize Receives the size of the decrypted data.
+     * @return SecureStorage::Error::Errc::Success on success, or
+     * Errc::DeserializationFailed if the body is malformed.
+     */
+    static Error::Errc plaintextSize(const unsigned char* body, size_t size, size_t& plaintextSize);
+};
+
+} // namespace Storage
+} // namespace SecureStorage
+
+#endif // SS_SEGMENTED_RECORD_H
@@ -0,0 +1,309 @@
+#include "SharedRecordCache.h"
+#include "FileLock.h"  // For the stable FNV-1a key hash
+#include "FileUtil.h"
+#include "Logger.h"    // For SS_LOG_ macros
+
+#include <cerrno>      // For errno
+#include <cstring>     // For strerror, memcpy, memcmp, memset
+#include <climits>     // For PATH_MAX
+#include <cstdlib>     // For realpath
+#include <fstream>
+#include <sstream>
+#include <sys/file.h>  // For flock
+#include <sys/mman.h>  // For mmap, munmap
+#include <sys/stat.h>  // For fstat
+#include <fcntl.h>     // For open
+#include <unistd.h>    // For close, ftruncate, link, unlink, getpid
+
+#if !defined(ATOMIC_LLONG_LOCK_FREE) || ATOMIC_LLONG_LOCK_FREE != 2
+#error "SharedRecordCache requires lock-free 64-bit atomics to share them between processes."
+#endif
+
+namespace SecureStorage {
+namespace Storage {
+
+namespace {
+const char SEGMENT_MAGIC[8] = {'S', 'S', 'C', 'A', 'C', 'H', 'E', '1'};
+constexpr size_t BOOT_ID_SIZE = 40;
+constexpr size_t SLOT_ALIGNMENT = 64; // Keep slot headers on separate cache lines
+
+size_t alignUp(size_t value) {
+    return (value + SLOT_ALIGNMENT - 1) / SLOT_ALIGNMENT * SLOT_ALIGNMENT;
+}
+
+std::string readBootId() {
+    std::ifstream ifs("/proc/sys/kernel/random/boot_id");
+    std::string id;
+    std::getline(ifs, id);
+    return id;
+}
+} // namespace
+
+struct SharedRecordCache::SegmentHeader {
+    char magic[8];
+    uint32_t slotCount;
+    uint32_t slotDataSize;
+    char bootId[BOOT_ID_SIZE];
+};
+
+struct SharedRecordCache::SlotHeader {
+    std::atomic<uint64_t> sequence; // Even: stable, odd: being filled
+    std::atomic<uint32_t> valid;
+    uint32_t idLength;
+    uint32_t dataLength;
+    char id[SHARED_CACHE_MAX_ID_LENGTH];
+};
+
+std::string SharedRecordCache::segmentPathForRoot(const std::string& rootStoragePath) {
+    std::string resolved = rootStoragePath;
+    char buf[PATH_MAX];
+    if (realpath(rootStoragePath.c_str(), buf) != nullptr) {
+        resolved = buf;
+    }
+    std::ostringstream name;
+    name << SHARED_CACHE_FILE_PREFIX << std::hex << Utils::FileLock::hashKey(resolved);
+
+    struct stat st;
+    if (stat("/dev/shm", &st) == 0 && S_ISDIR(st.st_mode) && access("/dev/shm", W_OK) == 0) {
+        return "/dev/shm/" + name.str();
+    }
+    // Segment only ever holds ciphertext, so falling back to the storage root leaks nothing.
+    return rootStoragePath + "." + name.str();
+}
+
+SharedRecordCache::SharedRecordCache(std::string segmentPath, bool create, uint32_t slotCount, uint32_t slotDataSize)
+    : m_segmentPath(std::move(segmentPath)),
+      m_mapping(nullptr),
+      m_mappingSize(0),
+      m_slotCount(0),
+      m_slotDataSize(0),
+      m_slotStride(0),
+      m_hits(0),
+      m_misses(0),
+      m_fills(0),
+      m_invalidations(0) {
+    int fd = open(m_segmentPath.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0 && errno == ENOENT && create) {
+        if (slotCount == 0 || slotDataSize == 0) {
+            SS_LOG_ERROR("SharedRecordCache: Slot count and slot size must be non-zero.");
+            return;
+        }
+        // Build the segment under a private name and publish it with link(), so no
+        // process can ever map a half-initialized segment.
+        std::ostringstream tmp;
+        tmp << m_segmentPath << "." << getpid() << Utils::TEMP_FILE_UTIL_SUFFIX;
+        std::string tmpPath = tmp.str();
+        int tmpFd = open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+        if (tmpFd < 0) {
+            SS_LOG_ERROR("SharedRecordCache: Failed to create segment '" << tmpPath << "': " << strerror(errno));
+            return;
+        }
+        size_t stride = alignUp(sizeof(SlotHeader) + slotDataSize);
+        if (ftruncate(tmpFd, static_cast<off_t>(alignUp(sizeof(SegmentHeader)) + stride * slotCount)) != 0) {
+            SS_LOG_ERROR("SharedRecordCache: Failed to size segment: " << strerror(errno));
+            close(tmpFd);
+            unlink(tmpPath.c_str());
+            return;
+        }
+        SegmentHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, SEGMENT_MAGIC, sizeof(header.magic));
+        header.slotCount = slotCount;
+        header.slotDataSize = slotDataSize;
+        std::string bootId = readBootId();
+        std::strncpy(header.bootId, bootId.c_str(), BOOT_ID_SIZE - 1);
+        if (pwrite(tmpFd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+            SS_LOG_ERROR("SharedRecordCache: Failed to write segment header: " << strerror(errno));
+            close(tmpFd);
+            unlink(tmpPath.c_str());
+            return;
+        }
+        if (link(tmpPath.c_str(), m_segmentPath.c_str()) != 0 && errno != EEXIST) {
+            SS_LOG_ERROR("SharedRecordCache: Failed to publish segment '" << m_segmentPath << "': " << strerror(errno));
+            close(tmpFd);
+            unlink(tmpPath.c_str());
+            return;
+        }
+        close(tmpFd);
+        unlink(tmpPath.c_str());
+        fd = open(m_segmentPath.c_str(), O_RDWR | O_CLOEXEC); // Ours or the one another process won with
+    }
+    if (fd < 0) {
+        if (create) {
+            SS_LOG_ERROR("SharedRecordCache: Failed to open segment '" << m_segmentPath << "': " << strerror(errno));
+        }
+        return;
+    }
+
+    if (mapSegment(fd)) {
+        resetIfRebooted(fd);
+        SS_LOG_INFO("SharedRecordCache: Attached to '" << m_segmentPath << "' (" << m_slotCount
+                    << " slots of " << m_slotDataSize << " bytes).");
+    }
+    close(fd); // The mapping stays valid
+}
+
+SharedRecordCache::~SharedRecordCache() {
+    if (m_mapping != nullptr) {
+        munmap(m_mapping, m_mappingSize);
+    }
+}
+
+bool SharedRecordCache::mapSegment(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SegmentHeader)) {
+        SS_LOG_ERROR("SharedRecordCache: Segment '" << m_segmentPath << "' is missing or truncated.");
+        return false;
+    }
+    void* mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        SS_LOG_ERROR("SharedRecordCache: Failed to map segment '" << m_segmentPath << "': " << strerror(errno));
+        return false;
+    }
+    const SegmentHeader* header = static_cast<const SegmentHeader*>(mapping);
+    size_t stride = alignUp(sizeof(SlotHeader) + header->slotDataSize);
+    size_t headerSize = alignUp(sizeof(SegmentHeader));
+    if (std::memcmp(header->magic, SEGMENT_MAGIC, sizeof(header->magic)) != 0 || header->slotCount == 0 ||
+        headerSize + stride * header->slotCount > static_cast<size_t>(st.st_size)) {
+        SS_LOG_ERROR("SharedRecordCache: Segment '" << m_segmentPath << "' has an invalid header.");
+        munmap(mapping, static_cast<size_t>(st.st_size));
+        return false;
+    }
+    m_mapping = mapping;
+    m_mappingSize = static_cast<size_t>(st.st_size);
+    m_slotCount = header->slotCount;
+    m_slotDataSize = header->slotDataSize;
+    m_slotStride = stride;
+    return true;
+}
+
+void SharedRecordCache::resetIfRebooted(int fd) {
+    SegmentHeader* header = static_cast<SegmentHeader*>(m_mapping);
+    std::string bootId = readBootId();
+    if (bootId.empty() || std::strncmp(header->bootId, bootId.c_str(), BOOT_ID_SIZE) == 0) {
+        return;
+    }
+    // Segment survived a reboot (e.g. root fallback on persistent storage): drop every slot.
+    flock(fd, LOCK_EX);
+    if (std::strncmp(header->bootId, bootId.c_str(), BOOT_ID_SIZE) != 0) {
+        for (uint32_t i = 0; i < m_slotCount; ++i) {
+            SlotHeader* slot = reinterpret_cast<SlotHeader*>(
+                static_cast<unsigned char*>(m_mapping) + alignUp(sizeof(SegmentHeader)) + i * m_slotStride);
+            slot->valid.store(0, std::memory_order_relaxed);
+            slot->sequence.store(0, std::memory_order_relaxed); // Also clears fills abandoned mid-way
+        }
+        std::memset(header->bootId, 0, BOOT_ID_SIZE);
+        std::strncpy(header->bootId, bootId.c_str(), BOOT_ID_SIZE - 1);
+        SS_LOG_INFO("SharedRecordCache: Segment '" << m_segmentPath << "' predates this boot, cleared.");
+    }
+    flock(fd, LOCK_UN);
+}
+
+bool SharedRecordCache::isAttached() const {
+    return m_mapping != nullptr;
+}
+
+SharedRecordCache::SlotHeader* SharedRecordCache::slotFor(const std::string& data_id) const {
+    uint64_t index = Utils::FileLock::slotForKey(data_id, m_slotCount);
+    return reinterpret_cast<SlotHeader*>(static_cast<unsigned char*>(m_mapping) + alignUp(sizeof(SegmentHeader)) + index * m_slotStride);
+}
+
+unsigned char* SharedRecordCache::slotData(SlotHeader* slot) const {
+    return reinterpret_cast<unsigned char*>(slot) + sizeof(SlotHeader);
+}
+
+bool SharedRecordCache::lookup(const std::string& data_id, std::vector<unsigned char>& record) {
+    record.clear();
+    if (!isAttached() || data_id.size() > SHARED_CACHE_MAX_ID_LENGTH) {
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    SlotHeader* slot = slotFor(data_id);
+    for (int attempt = 0; attempt < 3; ++attempt) {
+        uint64_t before = slot->sequence.load(std::memory_order_acquire);
+        if ((before & 1) != 0 || slot->valid.load(std::memory_order_acquire) == 0) {
+            break;
+        }
+        uint32_t idLength = slot->idLength;
+        uint32_t dataLength = slot->dataLength;
+        if (idLength != data_id.size() || dataLength > m_slotDataSize ||
+            std::memcmp(slot->id, data_id.data(), data_id.size()) != 0) {
+            // Either another id or a torn read; the sequence check tells them apart.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot->sequence.load(std::memory_order_relaxed) == before) {
+                break;
+            }
+            continue;
+        }
+        record.resize(dataLength);
+        if (dataLength > 0) {
+            std::memcpy(record.data(), slotData(slot), dataLength);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->sequence.load(std::memory_order_relaxed) == before) {
+            m_hits.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    record.clear();
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+uint64_t SharedRecordCache::sequenceFor(const std::string& data_id) const {
+    if (!isAttached()) {
+        return 1; // Odd: fill() will refuse it
+    }
+    return slotFor(data_id)->sequence.load(std::memory_order_acquire);
+}
+
+bool SharedRecordCache::fill(const std::string& data_id, const std::vector<unsigned char>& record, uint64_t expectedSequence) {
+    if (!isAttached() || (expectedSequence & 1) != 0 ||
+        data_id.size() > SHARED_CACHE_MAX_ID_LENGTH || record.size() > m_slotDataSize) {
+        return false;
+    }
+    SlotHeader* slot = slotFor(data_id);
+    if (!slot->sequence.compare_exchange_strong(expectedSequence, expectedSequence + 1, std::memory_order_acq_rel)) {
+        return false; // Invalidated or refilled since the caller read the file
+    }
+    slot->valid.store(0, std::memory_order_relaxed);
+    slot->idLength = static_cast<uint32_t>(data_id.size());
+    slot->dataLength = static_cast<uint32_t>(record.size());
+    std::memcpy(slot->id, data_id.data(), data_id.size());
+    if (!record.empty()) {
+        std::memcpy(slotData(slot), record.data(), record.size());
+    }
+    slot->valid.store(1, std::memory_order_release);
+
+    uint64_t writing = expectedSequence + 1;
+    if (!slot->sequence.compare_exchange_strong(writing, expectedSequence + 2, std::memory_order_release)) {
+        // A writer invalidated the slot while we were copying; our data may be stale.
+        slot->valid.store(0, std::memory_order_release);
+        slot->sequence.fetch_add(1, std::memory_order_release);
+        return false;
+    }
+    m_fills.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void SharedRecordCache::invalidate(const std::string& data_id) {
+    if (!isAttached()) {
+        return;
+    }
+    SlotHeader* slot = slotFor(data_id);
+    slot->valid.store(0, std::memory_order_release);
+    slot->sequence.fetch_add(2, std::memory_order_acq_rel); // Keeps parity, fails pending fills
+    m_invalidations.fetch_add(1, std::memory_order_relaxed);
+}
+
+SharedCacheStats SharedRecordCache::getStats() const {
+    SharedCacheStats stats;
+    stats.hits = m_hits.load(std::memory_order_relaxed);
+    stats.misses = m_misses.load(std::memory_order_relaxed);
+    stats.fills = m_fills.load(std::memory_order_relaxed);
+    stats.invalidations = m_invalidations.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace Storage
+} // namespace SecureStorage
@@ -0,0 +1,147 @@
+#ifndef SS_SHARED_RECORD_CACHE_H
+#define SS_SHARED_RECORD_CACHE_H
+
+#include "Error.h"
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstddef> // For size_t
+#include <cstdint> // For uint64_t, uint32_t
+
+namespace SecureStorage {
+namespace Storage {
+
+constexpr uint32_t SHARED_CACHE_DEFAULT_SLOT_COUNT = 256;
+constexpr uint32_t SHARED_CACHE_DEFAULT_SLOT_DATA_SIZE = 4096;
+constexpr uint32_t SHARED_CACHE_MAX_ID_LENGTH = 128;
+const std::string SHARED_CACHE_FILE_PREFIX = "securestore-cache-";
+
+/**
+ * @struct SharedCacheStats
+ * @brief Per-process counters for a SharedRecordCache.
+ */
+struct SharedCacheStats {
+    uint64_t hits = 0;          ///< Lookups served from the shared segment
+    uint64_t misses = 0;        ///< Lookups that found no (consistent) entry
+    uint64_t fills = 0;         ///< Entries published by this process
+    uint64_t invalidations = 0; ///< Entries invalidated by this process
+};
+
+/**
+ * @class SharedRecordCache
+ * @brief Direct-mapped cache of raw (encrypted) records in a memory segment shared by
+ * every process that uses the same storage root.
+ *
+ * Only ciphertext is cached: a hit saves the open/read syscalls and disk I/O, and the
+ * caller still authenticates the record with GCM, so a corrupted or forged slot can
+ * never be returned as valid data and no plaintext ever lives in shared memory.
+ *
+ * Each slot is guarded by a seqlock. Readers copy the slot without any syscall and retry
+ * or miss if the sequence changed underneath them. Publishing is done with a
+ * compare-and-swap on the sequence observed *before* the caller read the file, so a
+ * fill racing with a writer's invalidate() is dropped instead of caching a stale record.
+ *
+ * The segment is a file mapped with MAP_SHARED: in /dev/shm when available, otherwise
+ * inside the storage root. The kernel boot id is stamped into the segment, and all slots
+ * are discarded on first attach after a reboot.
+ */
+class SharedRecordCache {
+public:
+    /**
+     * @brief Returns the segment path used for a storage root.
+     * The name is derived from the resolved root path so all processes agree on it.
+     * @param rootStoragePath The storage root (with trailing separator).
+     * @return Absolute path of the segment file.
+     */
+    static std::string segmentPathForRoot(const std::string& rootStoragePath);
+
+    /**
+     * @brief Attaches to the segment at segmentPath, creating it if requested.
+     *
+     * When the segment already exists its geometry is used and the given sizes are ignored.
+     *
+     * @param segmentPath Path of the segment file.
+     * @param create Whether to create the segment if it does not exist.
+     * @param slotCount Number of slots for a newly created segment.
+     * @param slotDataSize Maximum record size (bytes) a slot can hold for a new segment.
+     */
+    SharedRecordCache(std::string segmentPath, bool create,
+                      uint32_t slotCount = SHARED_CACHE_DEFAULT_SLOT_COUNT,
+                      uint32_t slotDataSize = SHARED_CACHE_DEFAULT_SLOT_DATA_SIZE);
+    ~SharedRecordCache();
+
+    SharedRecordCache(const SharedRecordCache&) = delete;
+    SharedRecordCache& operator=(const SharedRecordCache&) = delete;
+    SharedRecordCache(SharedRecordCache&&) = delete;
+    SharedRecordCache& operator=(SharedRecordCache&&) = delete;
+
+    /**
+     * @brief Checks whether the segment is mapped and usable.
+     * @return true if attached, false otherwise.
+     */
+    bool isAttached() const;
+
+    /**
+     * @brief Copies the cached record for data_id, if present and consistent.
+     * Does not perform any system call.
+     * @param data_id The data identifier.
+     * @param[out] record Receives the raw record on a hit.
+     * @return true on a hit, false on a miss.
+     */
+    bool lookup(const std::string& data_id, std::vector<unsigned char>& record);
+
+    /**
+     * @brief Returns the current sequence of data_id's slot.
+     * Must be called before reading the record from disk; pass the value to fill().
+     * @param data_id The data identifier.
+     * @return The slot sequence.
+     */
+    uint64_t sequenceFor(const std::string& data_id) const;
+
+    /**
+     * @brief Publishes a record for data_id, unless the slot changed since expectedSequence.
+     * @param data_id The data identifier.
+     * @param record The raw record as stored on disk.
+     * @param expectedSequence Value returned by sequenceFor() before the record was read.
+     * @return true if published, false if skipped (too large, slot busy or changed).
+     */
+    bool fill(const std::string& data_id, const std::vector<unsigned char>& record, uint64_t expectedSequence);
+
+    /**
+     * @brief Invalidates data_id's slot. Writers call this while holding the id's shard lock.
+     * @param data_id The data identifier.
+     */
+    void invalidate(const std::string& data_id);
+
+    /**
+     * @brief Returns this process's counters for the cache.
+     * @return A snapshot of the counters.
+     */
+    SharedCacheStats getStats() const;
+
+private:
+    struct SegmentHeader;
+    struct SlotHeader;
+
+    bool mapSegment(int fd);
+    void resetIfRebooted(int fd);
+    SlotHeader* slotFor(const std::string& data_id) const;
+    unsigned char* slotData(SlotHeader* slot) const;
+
+    std::string m_segmentPath;
+    void* m_mapping;
+    size_t m_mappingSize;
+    uint32_t m_slotCount;
+    uint32_t m_slotDataSize;
+    size_t m_slotStride;
+
+    std::atomic<uint64_t> m_hits;
+    std::atomic<uint64_t> m_misses;
+    std::atomic<uint64_t> m_fills;
+    std::atomic<uint64_t> m_invalidations;
+};
+
+} // namespace Storage
+} // namespace SecureStorage
+
+#endif // SS_SHARED_RECORD_CACHE_H
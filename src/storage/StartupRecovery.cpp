@@ -0,0 +1,194 @@
+#include "StartupRecovery.h"
+#include "SecureStore.h"  // For the file extension constants
+#include "DirFileUtil.h"
+#include "FileLock.h"
+#include "Logger.h"       // For SS_LOG_ macros
+
+#include <algorithm>      // For std::min
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace SecureStorage {
+namespace Storage {
+
+namespace {
+
+// Below this many repairs, starting threads costs more than it saves.
+const size_t MIN_TASKS_FOR_WORKERS = 64;
+const unsigned MAX_DEFAULT_WORKERS = 8;
+
+bool stripSuffix(std::string& name, const std::string& suffix) {
+    if (name.size() < suffix.size() || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+        return false;
+    }
+    name.resize(name.size() - suffix.size());
+    return true;
+}
+
+struct RepairTask {
+    std::string dataId;
+    std::vector<std::string> tempFiles;
+    bool promoteBackup = false;
+    uint64_t slot = 0;
+};
+
+struct RepairCounters {
+    std::atomic<size_t> tempFilesRemoved{0};
+    std::atomic<size_t> backupsPromoted{0};
+    std::atomic<size_t> skippedBusy{0};
+    std::atomic<size_t> failures{0};
+    std::mutex promotedMutex;
+    std::vector<std::string> promotedIds;
+};
+
+void repair(Utils::DirFileUtil& directory, Utils::FileLock& writeLock, const RepairTask& task,
+            RepairCounters& counters) {
+    // A writer holding the shard may own these files right now; its own sequence finishes them.
+    if (!writeLock.tryLock(task.slot)) {
+        counters.skippedBusy++;
+        return;
+    }
+    for (const std::string& temp : task.tempFiles) {
+        if (directory.deleteFile(temp) == Error::Errc::Success) {
+            counters.tempFilesRemoved++;
+        } else {
+            counters.failures++;
+        }
+    }
+    if (task.promoteBackup) {
+        // Re-check under the lock: a writer may have finished between the scan and now.
+        std::string main_file = task.dataId + DATA_FILE_EXTENSION;
+        std::string backup_file = main_file + BACKUP_FILE_EXTENSION;
+        if (!directory.pathExists(main_file) && directory.pathExists(backup_file)) {
+            if (directory.renameFile(backup_file, main_file) == Error::Errc::Success) {
+                counters.backupsPromoted++;
+                std::lock_guard<std::mutex> lock(counters.promotedMutex);
+                counters.promotedIds.push_back(task.dataId);
+            } else {
+                counters.failures++;
+            }
+        }
+    }
+    writeLock.unlock(task.slot);
+}
+
+} // namespace
+
+Error::Errc StartupRecovery::run(Utils::DirFileUtil& directory, Utils::FileLock& writeLock, uint64_t shardCount,
+                                 const RecoveryOptions& options, RecoveryReport& report,
+                                 std::vector<std::string>& dataIds) {
+    report = RecoveryReport();
+    dataIds.clear();
+    auto scan_start = std::chrono::steady_clock::now();
+
+    std::vector<std::string> files;
+    Error::Errc list_err = directory.listDirectory(files);
+    if (list_err != Error::Errc::Success) {
+        SS_LOG_ERROR("StartupRecovery: Failed to scan the storage root. Error: " << static_cast<int>(list_err));
+        return list_err;
+    }
+    report.entriesScanned = files.size();
+
+    // Classify: main files go straight to the id list; backups and temps are matched up after.
+    std::unordered_set<std::string> main_ids;
+    main_ids.reserve(files.size());
+    std::vector<std::string> backup_ids;
+    std::vector<std::pair<std::string, std::string>> temps; // (data_id, file name)
+    dataIds.reserve(files.size());
+    for (const std::string& name : files) {
+        std::string base = name;
+        bool is_temp = false;
+        while (stripSuffix(base, TEMP_FILE_SUFFIX)) {
+            is_temp = true; // `.enc.tmp`, and `.enc.tmp.tmp` from older versions
+        }
+        bool is_backup = stripSuffix(base, BACKUP_FILE_EXTENSION);
+        if (is_temp && !is_backup) {
+            stripSuffix(base, HISTORY_FILE_EXTENSION); // `.enc.hist.tmp` of an interrupted compaction
+        }
+        if (!stripSuffix(base, DATA_FILE_EXTENSION) || base.empty()) {
+            continue; // Lock file, cache segment or anything else that is not a record
+        }
+        if (is_temp) {
+            temps.push_back(std::make_pair(base, name));
+        } else if (is_backup) {
+            backup_ids.push_back(base);
+        } else {
+            main_ids.insert(base);
+            dataIds.push_back(base);
+        }
+    }
+
+    // Group the repairs by id, so each id's shard is locked once.
+    std::vector<RepairTask> tasks;
+    std::unordered_map<std::string, size_t> task_index;
+    for (const std::string& id : backup_ids) {
+        if (main_ids.find(id) == main_ids.end()) {
+            task_index[id] = tasks.size();
+            tasks.push_back(RepairTask());
+            tasks.back().dataId = id;
+            tasks.back().promoteBackup = true;
+        }
+    }
+    for (const auto& temp : temps) {
+        auto it = task_index.find(temp.first);
+        if (it == task_index.end()) {
+            it = task_index.insert(std::make_pair(temp.first, tasks.size())).first;
+            tasks.push_back(RepairTask());
+            tasks.back().dataId = temp.first;
+        }
+        tasks[it->second].tempFiles.push_back(temp.second);
+    }
+    for (RepairTask& task : tasks) {
+        task.slot = Utils::FileLock::slotForKey(task.dataId, shardCount);
+    }
+    auto repair_start = std::chrono::steady_clock::now();
+    report.scanTime = std::chrono::duration_cast<std::chrono::microseconds>(repair_start - scan_start);
+
+    RepairCounters counters;
+    if (tasks.size() < MIN_TASKS_FOR_WORKERS) {
+        for (const RepairTask& task : tasks) {
+            repair(directory, writeLock, task, counters);
+        }
+    } else {
+        unsigned workers = options.workerThreads;
+        if (workers == 0) {
+            workers = std::min(std::max(std::thread::hardware_concurrency(), 1u), MAX_DEFAULT_WORKERS);
+        }
+        report.workerThreads = workers;
+        // The writer lock is one open file description shared by all workers, so two workers
+        // must never hold the same shard: worker k owns the shards with slot % workers == k.
+        std::vector<std::thread> pool;
+        pool.reserve(workers);
+        for (unsigned k = 0; k < workers; ++k) {
+            pool.push_back(std::thread([&directory, &writeLock, &tasks, &counters, workers, k]() {
+                for (const RepairTask& task : tasks) {
+                    if (task.slot % workers == k) {
+                        repair(directory, writeLock, task, counters);
+                    }
+                }
+            }));
+        }
+        for (std::thread& worker : pool) {
+            worker.join();
+        }
+    }
+
+    report.tempFilesRemoved = counters.tempFilesRemoved.load();
+    report.backupsPromoted = counters.backupsPromoted.load();
+    report.skippedBusy = counters.skippedBusy.load();
+    report.failures = counters.failures.load();
+    if (report.tempFilesRemoved > 0 || report.backupsPromoted > 0) {
+        directory.syncDirectory(); // One flush for all removals and renames
+    }
+    dataIds.insert(dataIds.end(), counters.promotedIds.begin(), counters.promotedIds.end());
+    report.dataIds = dataIds.size();
+    report.repairTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - repair_start);
+    report.ran = true;
+    return Error::Errc::Success;
+}
+
+} // namespace Storage
+} // namespace SecureStorage
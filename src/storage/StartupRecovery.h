@@ -0,0 +1,81 @@
+#ifndef SS_STARTUP_RECOVERY_H
+#define SS_STARTUP_RECOVERY_H
+
+#include "Error.h"
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstddef> // For size_t
+
+namespace SecureStorage {
+namespace Utils {
+class DirFileUtil; // Forward declare
+class FileLock;    // Forward declare
+}
+namespace Storage {
+
+/**
+ * @struct RecoveryOptions
+ * @brief Settings of the recovery pass a SecureStore runs when it opens its root.
+ */
+struct RecoveryOptions {
+    bool enabled = true;         ///< Run the pass at all
+    unsigned workerThreads = 0;  ///< Repair workers; 0 picks min(hardware threads, 8)
+};
+
+/**
+ * @struct RecoveryReport
+ * @brief What the recovery pass found and did.
+ */
+struct RecoveryReport {
+    bool ran = false;              ///< false if recovery was disabled or the scan failed
+    size_t entriesScanned = 0;     ///< Regular files in the root
+    size_t dataIds = 0;            ///< Ids with a main file once recovery finished
+    size_t tempFilesRemoved = 0;   ///< Stale `.tmp` files of interrupted writes
+    size_t backupsPromoted = 0;    ///< Backups renamed to main because main was missing
+    size_t skippedBusy = 0;        ///< Ids left alone because a live writer held their shard
+    size_t failures = 0;           ///< Repairs that failed (logged); retried on next start
+    unsigned workerThreads = 0;    ///< Workers used for the repair phase (0: done inline)
+    std::chrono::microseconds scanTime = std::chrono::microseconds(0);   ///< Listing and classifying
+    std::chrono::microseconds repairTime = std::chrono::microseconds(0); ///< Removing and renaming
+};
+
+/**
+ * @class StartupRecovery
+ * @brief Reconciles the files an interrupted storeData() can leave behind.
+ *
+ * One getdents64 scan of the root classifies every file. Per id:
+ * - `<id>.enc.tmp` (and the `.enc.tmp.tmp` of older versions) is removed. A temp file only
+ *   exists while a writer holds the id's shard, so one seen without a writer is stale.
+ * - `<id>.enc.bak` without `<id>.enc` is renamed to `<id>.enc`. This is the state between
+ *   moving main to backup and installing the new main on the rename fallback path.
+ * Main files are not decrypted: a main that fails authentication is still repaired from
+ * its backup on the read path. That keeps the pass proportional to the directory size,
+ * with file system work only for the leftovers.
+ *
+ * Repairs are spread over a worker pool. Each worker owns a disjoint set of lock shards
+ * and try-locks the shard of every id it touches, so ids that a writer in another process
+ * is busy with are skipped rather than waited for.
+ */
+class StartupRecovery {
+public:
+    /**
+     * @brief Runs the recovery pass.
+     * @param directory The store root.
+     * @param writeLock The store's per-shard writer lock.
+     * @param shardCount Number of lock shards.
+     * @param options Worker pool settings.
+     * @param[out] report Receives the summary.
+     * @param[out] dataIds Receives the ids that have a main file afterwards, unsorted.
+     * @return SecureStorage::Error::Errc::Success if the scan succeeded (individual repair
+     * failures are counted in the report), or the scan's error code.
+     */
+    static Error::Errc run(Utils::DirFileUtil& directory, Utils::FileLock& writeLock, uint64_t shardCount,
+                           const RecoveryOptions& options, RecoveryReport& report,
+                           std::vector<std::string>& dataIds);
+};
+
+} // namespace Storage
+} // namespace SecureStorage
+
+#endif // SS_STARTUP_RECOVERY_H
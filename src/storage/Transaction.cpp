@@ -0,0 +1,103 @@
+#include "Transaction.h"
+#include "SecureWipe.h" // For Utils::secureWipe
+
+namespace SecureStorage {
+namespace Storage {
+
+Transaction::Transaction(Committer committer)
+    : m_committer(std::move(committer)),
+      m_finished(false) {
+}
+
+Transaction::~Transaction() {
+    wipe();
+}
+
+Transaction::Transaction(Transaction&& other)
+    : m_committer(std::move(other.m_committer)),
+      m_ops(std::move(other.m_ops)),
+      m_finished(other.m_finished) {
+    other.m_ops.clear();
+    other.m_finished = true;
+}
+
+Transaction& Transaction::operator=(Transaction&& other) {
+    if (this != &other) {
+        wipe();
+        m_committer = std::move(other.m_committer);
+        m_ops = std::move(other.m_ops);
+        m_finished = other.m_finished;
+        other.m_ops.clear();
+        other.m_finished = true;
+    }
+    return *this;
+}
+
+Error::Errc Transaction::put(const std::string& data_id, const std::vector<unsigned char>& plain_data) {
+    if (m_finished) {
+        return Error::Errc::OperationFailed;
+    }
+    TransactionOp& op = m_ops[data_id];
+    Utils::secureWipe(op.data);
+    op.dataId = data_id;
+    op.remove = false;
+    op.data = plain_data;
+    return Error::Errc::Success;
+}
+
+Error::Errc Transaction::remove(const std::string& data_id) {
+    if (m_finished) {
+        return Error::Errc::OperationFailed;
+    }
+    TransactionOp& op = m_ops[data_id];
+    Utils::secureWipe(op.data);
+    op.dataId = data_id;
+    op.remove = true;
+    op.data.clear();
+    return Error::Errc::Success;
+}
+
+size_t Transaction::size() const {
+    return m_ops.size();
+}
+
+Error::Errc Transaction::commit() {
+    if (m_finished || !m_committer) {
+        return Error::Errc::OperationFailed;
+    }
+    if (m_ops.empty()) {
+        m_finished = true;
+        return Error::Errc::Success;
+    }
+    std::vector<TransactionOp> ops;
+    ops.reserve(m_ops.size());
+    for (auto& entry : m_ops) {
+        ops.push_back(std::move(entry.second));
+    }
+    Error::Errc err = m_committer(ops);
+    if (err != Error::Errc::Success) {
+        // The committer left the changes in place; stage them again for a retry.
+        for (TransactionOp& op : ops) {
+            m_ops[op.dataId] = std::move(op);
+        }
+        return err;
+    }
+    m_ops.clear();
+    m_finished = true;
+    return Error::Errc::Success;
+}
+
+void Transaction::abort() {
+    wipe();
+    m_finished = true;
+}
+
+void Transaction::wipe() {
+    for (auto& entry : m_ops) {
+        Utils::secureWipe(entry.second.data);
+    }
+    m_ops.clear();
+}
+
+} // namespace Storage
+} // namespace SecureStorage
@@ -0,0 +1,109 @@
+#ifndef SS_TRANSACTION_H
+#define SS_TRANSACTION_H
+
+#include "Error.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <cstddef> // For size_t
+
+namespace SecureStorage {
+namespace Storage {
+
+/**
+ * @struct TransactionOp
+ * @brief One staged change of a Transaction: a put of data, or a delete.
+ */
+struct TransactionOp {
+    std::string dataId;
+    bool remove = false;             ///< Delete the id instead of writing data
+    std::vector<unsigned char> data; ///< The plaintext to store; empty for a delete
+};
+
+/**
+ * @class Transaction
+ * @brief A set of puts and deletes that commit() makes take effect together.
+ *
+ * Changes are only staged in memory until commit(); a later change of the same id
+ * replaces an earlier one. A transaction that is destroyed or abort()ed without a
+ * successful commit() changes nothing. Obtained from SecureStore::beginTransaction(),
+ * which it must not outlive. Not thread-safe; one thread builds and commits it.
+ *
+ * "Together" is what readers of the committing store see, and what survives a crash.
+ * Other stores on the same root, e.g. in other processes, see the ids change one by one
+ * while the committed transaction is applied to the record files.
+ */
+class Transaction {
+public:
+    /**
+     * @brief Makes the staged changes take effect. On success it takes the changes;
+     * on failure it must leave them in place.
+     */
+    using Committer = std::function<Error::Errc(std::vector<TransactionOp>& ops)>;
+
+    /**
+     * @brief Creates an empty transaction.
+     * @param committer Called by commit() with the staged changes, in id order.
+     */
+    explicit Transaction(Committer committer);
+
+    /**
+     * @brief Discards the staged changes, if not committed, and wipes their plaintext.
+     */
+    ~Transaction();
+
+    Transaction(const Transaction&) = delete;
+    Transaction& operator=(const Transaction&) = delete;
+    Transaction(Transaction&& other);
+    Transaction& operator=(Transaction&& other);
+
+    /**
+     * @brief Stages storing plain_data under data_id.
+     * @param data_id The data identifier (validated by commit()).
+     * @param plain_data The data to store.
+     * @return SecureStorage::Error::Errc::Success on success, Errc::OperationFailed if the
+     * transaction was already committed or aborted.
+     */
+    Error::Errc put(const std::string& data_id, const std::vector<unsigned char>& plain_data);
+
+    /**
+     * @brief Stages deleting data_id.
+     * @param data_id The data identifier (validated by commit()).
+     * @return SecureStorage::Error::Errc::Success on success, Errc::OperationFailed if the
+     * transaction was already committed or aborted.
+     */
+    Error::Errc remove(const std::string& data_id);
+
+    /**
+     * @brief Returns the number of ids with a staged change.
+     * @return The count.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Makes all staged changes take effect, or none of them.
+     * Committing an empty transaction succeeds without writing anything.
+     * @return SecureStorage::Error::Errc::Success on success; Errc::OperationFailed if the
+     * transaction was already committed or aborted; otherwise the committer's error, in
+     * which case the changes stay staged and commit() may be called again.
+     */
+    Error::Errc commit();
+
+    /**
+     * @brief Discards the staged changes. Further calls other than size() fail.
+     */
+    void abort();
+
+private:
+    void wipe();
+
+    Committer m_committer;
+    std::map<std::string, TransactionOp> m_ops; ///< Staged changes by id
+    bool m_finished;                            ///< Committed or aborted
+};
+
+} // namespace Storage
+} // namespace SecureStorage
+
+#endif // SS_TRANSACTION_H
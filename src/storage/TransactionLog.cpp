@@ -0,0 +1,398 @@
+#include "TransactionLog.h"
+#include "RecordHistory.h" // For the length-prefixed frames of the log file
+#include "DirFileUtil.h"
+#include "FileLock.h"
+#include "Logger.h"        // For SS_LOG_ macros
+#include "SecureWipe.h"    // For Utils::secureWipe
+
+namespace SecureStorage {
+namespace Storage {
+
+namespace {
+
+constexpr unsigned char OP_PUT = 0;
+constexpr unsigned char OP_DELETE = 1;
+
+void putU32(std::vector<unsigned char>& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+    }
+}
+
+bool getU32(const std::vector<unsigned char>& data, size_t& pos, uint32_t& value) {
+    if (data.size() - pos < 4) {
+        return false;
+    }
+    value = 0;
+    for (size_t i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(data[pos + i]) << (8 * i);
+    }
+    pos += 4;
+    return true;
+}
+
+} // namespace
+
+TransactionLog::TransactionLog(Utils::DirFileUtil& directory, Utils::FileLock& lock, uint64_t lockSlot,
+                               ApplyFunction apply)
+    : m_directory(directory),
+      m_lock(lock),
+      m_lockSlot(lockSlot),
+      m_apply(std::move(apply)),
+      m_lockHeld(false),
+      m_pendingCount(0),
+      m_logDirty(false),
+      m_stopping(false) {
+}
+
+TransactionLog::~TransactionLog() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    Error::Errc err = applyPending();
+    if (err != Error::Errc::Success) {
+        SS_LOG_ERROR("TransactionLog: " << m_pendingCount.load() << " transactions could not be applied (error "
+                     << static_cast<int>(err) << "); they are redone on the next start.");
+    }
+    std::lock_guard<std::mutex> append_lock(m_appendMutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (PendingTransaction& txn : m_pending) {
+            for (TransactionOp& op : txn.ops) {
+                Utils::secureWipe(op.data);
+            }
+        }
+    }
+    releaseLock();
+}
+
+void TransactionLog::serializeOps(const std::vector<TransactionOp>& ops, std::vector<unsigned char>& out) {
+    out.clear();
+    putU32(out, static_cast<uint32_t>(ops.size()));
+    for (const TransactionOp& op : ops) {
+        out.push_back(op.remove ? OP_DELETE : OP_PUT);
+        putU32(out, static_cast<uint32_t>(op.dataId.size()));
+        out.insert(out.end(), op.dataId.begin(), op.dataId.end());
+        putU32(out, static_cast<uint32_t>(op.data.size()));
+        out.insert(out.end(), op.data.begin(), op.data.end());
+    }
+}
+
+bool TransactionLog::parseOps(const std::vector<unsigned char>& data, std::vector<TransactionOp>& ops) {
+    ops.clear();
+    size_t pos = 0;
+    uint32_t count = 0;
+    if (!getU32(data, pos, count)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        TransactionOp op;
+        uint32_t length = 0;
+        if (pos >= data.size() || data[pos] > OP_DELETE) {
+            return false;
+        }
+        op.remove = data[pos++] == OP_DELETE;
+        if (!getU32(data, pos, length) || data.size() - pos < length) {
+            return false;
+        }
+        op.dataId.assign(data.begin() + pos, data.begin() + pos + length);
+        pos += length;
+        if (!getU32(data, pos, length) || data.size() - pos < length) {
+            return false;
+        }
+        op.data.assign(data.begin() + pos, data.begin() + pos + length);
+        pos += length;
+        ops.push_back(std::move(op));
+    }
+    return pos == data.size();
+}
+
+Error::Errc TransactionLog::recover(const DecryptFunction& decrypt) {
+    {
+        std::lock_guard<std::mutex> append_lock(m_appendMutex);
+        if (!m_lock.tryLock(m_lockSlot)) {
+            // Its owner is alive and applies it; taking it over would race with that.
+            SS_LOG_INFO("TransactionLog: Another store holds the transaction log; not redoing it.");
+            return Error::Errc::Success;
+        }
+        m_lockHeld = true;
+
+        if (!m_directory.pathExists(TRANSACTION_LOG_FILE_NAME)) {
+            releaseLock();
+            return Error::Errc::Success;
+        }
+        std::vector<unsigned char> file;
+        Error::Errc read_err = m_directory.readFile(TRANSACTION_LOG_FILE_NAME, file);
+        if (read_err == Error::Errc::Success && file.empty()) {
+            releaseLock();
+            return Error::Errc::Success;
+        }
+        if (read_err != Error::Errc::Success) {
+            SS_LOG_ERROR("TransactionLog: Failed to read the transaction log (error " << static_cast<int>(read_err) << ").");
+            releaseLock();
+            return read_err;
+        }
+
+        std::vector<std::vector<unsigned char>> frames;
+        RecordHistory::splitFrames(file, frames);
+        std::vector<unsigned char> plain;
+        std::deque<PendingTransaction> recovered;
+        for (std::vector<unsigned char>& frame : frames) {
+            PendingTransaction txn;
+            if (decrypt(frame, plain) != Error::Errc::Success || !parseOps(plain, txn.ops)) {
+                // Only a complete, authenticated record ever committed; this one is damaged.
+                SS_LOG_ERROR("TransactionLog: Skipping a damaged record in the transaction log.");
+                Utils::secureWipe(plain);
+                continue;
+            }
+            Utils::secureWipe(plain);
+            txn.record = std::move(frame);
+            recovered.push_back(std::move(txn));
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_logDirty = true;
+        m_stats.recovered += recovered.size();
+        for (PendingTransaction& txn : recovered) {
+            m_pending.push_back(std::move(txn));
+        }
+        m_pendingCount.store(m_pending.size());
+        if (!m_pending.empty()) {
+            SS_LOG_INFO("TransactionLog: Redoing " << m_pending.size() << " committed transactions.");
+        }
+    }
+
+    Error::Errc err = applyPending();
+    if (err != Error::Errc::Success) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        startThread();
+        m_cv.notify_one();
+    }
+    return err;
+}
+
+Error::Errc TransactionLog::commit(const std::vector<unsigned char>& record, std::vector<TransactionOp>& ops) {
+    std::vector<unsigned char> frame;
+    RecordHistory::appendFrame(record, frame);
+
+    // Readers only take m_mutex, which is not held across the flush below; the transaction
+    // becomes visible to them once it is durable.
+    std::lock_guard<std::mutex> append_lock(m_appendMutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping) {
+            return Error::Errc::OperationFailed;
+        }
+    }
+    if (!m_lockHeld) {
+        // Waits while another store's log is not checkpointed yet.
+        Error::Errc lock_err = m_lock.lock(m_lockSlot);
+        if (lock_err != Error::Errc::Success) {
+            SS_LOG_ERROR("TransactionLog: Failed to lock the transaction log (error " << static_cast<int>(lock_err) << ").");
+            return lock_err;
+        }
+        m_lockHeld = true;
+    }
+
+    bool created = !m_directory.pathExists(TRANSACTION_LOG_FILE_NAME);
+    // The only flush of the commit: the size change is covered by fdatasync.
+    Error::Errc err = m_directory.appendFile(TRANSACTION_LOG_FILE_NAME, frame, Utils::FileSync::Data);
+    if (err == Error::Errc::Success && created) {
+        err = m_directory.syncDirectory();
+    }
+    if (err != Error::Errc::Success) {
+        SS_LOG_ERROR("TransactionLog: Failed to append to the transaction log (error " << static_cast<int>(err) << ").");
+        // A torn record would hide every record appended after it; drop it.
+        if (rewriteLog() != Error::Errc::Success) {
+            SS_LOG_ERROR("TransactionLog: Failed to rewrite the transaction log after a failed append.");
+        }
+        bool idle = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            idle = m_pending.empty() && !m_logDirty;
+        }
+        if (idle) {
+            releaseLock();
+        }
+        return err;
+    }
+
+    PendingTransaction txn;
+    txn.record = std::move(frame);
+    txn.ops = std::move(ops);
+    ops.clear();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.push_back(std::move(txn));
+    m_pendingCount.store(m_pending.size());
+    m_logDirty = true;
+    m_stats.committed++;
+    startThread();
+    m_cv.notify_one();
+    return Error::Errc::Success;
+}
+
+bool TransactionLog::touches(const std::string& data_id) const {
+    if (m_pendingCount.load() == 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const PendingTransaction& txn : m_pending) {
+        for (const TransactionOp& op : txn.ops) {
+            if (op.dataId == data_id) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool TransactionLog::lookup(const std::string& data_id, bool& removed, std::vector<unsigned char>& data) const {
+    if (m_pendingCount.load() == 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto txn = m_pending.rbegin(); txn != m_pending.rend(); ++txn) {
+        for (const TransactionOp& op : txn->ops) {
+            if (op.dataId == data_id) {
+                removed = op.remove;
+                data = op.data;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void TransactionLog::collectPending(std::unordered_map<std::string, bool>& removedById) const {
+    removedById.clear();
+    if (m_pendingCount.load() == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const PendingTransaction& txn : m_pending) {
+        for (const TransactionOp& op : txn.ops) {
+            removedById[op.dataId] = op.remove;
+        }
+    }
+}
+
+Error::Errc TransactionLog::applyPending() {
+    std::lock_guard<std::mutex> apply_lock(m_applyMutex);
+    for (;;) {
+        PendingTransaction* txn = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_pending.empty()) {
+                break;
+            }
+            // Only this pass pops, and commits push at the back, so the front stays put.
+            txn = &m_pending.front();
+        }
+        for (const TransactionOp& op : txn->ops) {
+            Error::Errc err = m_apply(op);
+            if (err != Error::Errc::Success) {
+                // Stays pending (and visible through lookup()); reapplying is idempotent.
+                SS_LOG_ERROR("TransactionLog: Failed to apply the change of id '" << op.dataId << "' (error "
+                             << static_cast<int>(err) << ").");
+                return err;
+            }
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (TransactionOp& op : txn->ops) {
+            Utils::secureWipe(op.data);
+        }
+        m_pending.pop_front();
+        m_pendingCount.store(m_pending.size());
+        m_stats.applied++;
+    }
+    return checkpoint();
+}
+
+Error::Errc TransactionLog::checkpoint() {
+    // Holding m_appendMutex keeps commits from appending to a log that is about to be
+    // truncated; readers, which only need m_mutex, are not held up by the syncs.
+    std::lock_guard<std::mutex> append_lock(m_appendMutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_pending.empty() || !m_logDirty) {
+            return Error::Errc::Success;
+        }
+    }
+    // The changes were applied without flushing; make them durable before the log goes.
+    Error::Errc err = m_directory.syncFilesystem();
+    if (err == Error::Errc::Success) {
+        // Truncated rather than deleted, so the next commit's append needs no directory sync.
+        err = m_directory.writeFile(TRANSACTION_LOG_FILE_NAME, std::vector<unsigned char>(), Utils::FileSync::Data);
+    }
+    if (err != Error::Errc::Success) {
+        SS_LOG_ERROR("TransactionLog: Checkpoint failed (error " << static_cast<int>(err) << ").");
+        return err;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_logDirty = false;
+        m_stats.checkpoints++;
+    }
+    releaseLock();
+    return Error::Errc::Success;
+}
+
+Error::Errc TransactionLog::rewriteLog() {
+    std::vector<unsigned char> image;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const PendingTransaction& txn : m_pending) {
+            image.insert(image.end(), txn.record.begin(), txn.record.end());
+        }
+    }
+    Error::Errc err = m_directory.atomicWriteFile(TRANSACTION_LOG_FILE_NAME, image);
+    if (err == Error::Errc::Success) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_logDirty = !image.empty();
+    }
+    return err;
+}
+
+void TransactionLog::releaseLock() {
+    if (m_lockHeld) {
+        m_lock.unlock(m_lockSlot);
+        m_lockHeld = false;
+    }
+}
+
+void TransactionLog::startThread() {
+    if (!m_thread.joinable() && !m_stopping) {
+        m_thread = std::thread(&TransactionLog::applyLoop, this);
+    }
+}
+
+TransactionStats TransactionLog::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    TransactionStats stats = m_stats;
+    stats.pending = m_pending.size();
+    return stats;
+}
+
+void TransactionLog::applyLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping) {
+        m_cv.wait(lock, [this] { return m_stopping || !m_pending.empty() || m_logDirty; });
+        if (m_stopping) {
+            break; // The destructor applies what is left
+        }
+        lock.unlock();
+        Error::Errc err = applyPending();
+        lock.lock();
+        if (err != Error::Errc::Success) {
+            m_cv.wait_for(lock, TRANSACTION_APPLY_RETRY_INTERVAL, [this] { return m_stopping; });
+        }
+    }
+}
+
+} // namespace Storage
+} // namespace SecureStorage
@@ -0,0 +1,204 @@
+#ifndef SS_TRANSACTION_LOG_H
+#define SS_TRANSACTION_LOG_H
+
+#include "Error.h"
+#include "Transaction.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstddef> // For size_t
+#include <cstdint> // For uint64_t
+
+namespace SecureStorage {
+namespace Utils {
+class DirFileUtil; // Forward declare
+class FileLock;    // Forward declare
+}
+namespace Storage {
+
+// Write-ahead log of committed transactions, in the storage root.
+const std::string TRANSACTION_LOG_FILE_NAME = ".securestore.wal";
+
+// Pause before the applier retries after a failed apply or checkpoint.
+const std::chrono::milliseconds TRANSACTION_APPLY_RETRY_INTERVAL = std::chrono::milliseconds(1000);
+
+/**
+ * @struct TransactionStats
+ * @brief Counters of a TransactionLog.
+ */
+struct TransactionStats {
+    uint64_t committed = 0;   ///< Transactions committed through this store
+    uint64_t recovered = 0;   ///< Transactions found in the log at startup and redone
+    uint64_t applied = 0;     ///< Transactions whose changes reached the record files
+    uint64_t checkpoints = 0; ///< Times the log was emptied after everything in it was applied
+    size_t pending = 0;       ///< Committed transactions not applied yet
+};
+
+/**
+ * @class TransactionLog
+ * @brief Commits transactions to a write-ahead log and applies them in the background.
+ *
+ * commit() appends one encrypted record holding every change of a transaction to
+ * TRANSACTION_LOG_FILE_NAME and flushes it with a single fdatasync; from then on the
+ * transaction is durable. Its changes are applied to the record files later, in commit
+ * order, by a background thread through the owner's apply function, without flushing
+ * each file. Once nothing is pending the file system is synced once and the log is
+ * truncated (a checkpoint). Until a transaction is applied, lookup() answers for its
+ * ids from memory, so readers of the owner see all of its changes as soon as commit()
+ * returns and none before. Readers are never held up by a flush of the log.
+ *
+ * That all-or-none view is limited to the owner. Other stores on the root, such as other
+ * processes, read the record files and see the ids change one by one while they are
+ * applied; for them a transaction is only all-or-none across a crash, through recover().
+ *
+ * A crash leaves the log in place; recover() redoes it on the next start. A torn last
+ * record never committed and is dropped. While its log is not empty a store holds a
+ * lock slot of the root's lock file, so another store neither redoes that log at startup
+ * nor appends to it before it is checkpointed; other stores' commits wait for that.
+ */
+class TransactionLog {
+public:
+    /**
+     * @brief Applies one change to the record files without flushing them.
+     */
+    using ApplyFunction = std::function<Error::Errc(const TransactionOp& op)>;
+
+    /**
+     * @brief Decrypts one log record.
+     */
+    using DecryptFunction = std::function<Error::Errc(const std::vector<unsigned char>& record,
+                                                      std::vector<unsigned char>& plain)>;
+
+    /**
+     * @brief Creates the log. The background thread starts with the first commit.
+     * @param directory The storage root; must outlive the log.
+     * @param lock The root's lock file; must outlive the log.
+     * @param lockSlot The slot of lock that guards the log.
+     * @param apply Applies one change; called from the background thread or by applyPending().
+     */
+    TransactionLog(Utils::DirFileUtil& directory, Utils::FileLock& lock, uint64_t lockSlot, ApplyFunction apply);
+
+    /**
+     * @brief Stops the background thread and applies what is still pending. What cannot
+     * be applied stays in the log for recover().
+     */
+    ~TransactionLog();
+
+    TransactionLog(const TransactionLog&) = delete;
+    TransactionLog& operator=(const TransactionLog&) = delete;
+    TransactionLog(TransactionLog&&) = delete;
+    TransactionLog& operator=(TransactionLog&&) = delete;
+
+    /**
+     * @brief Redoes the transactions a previous run left in the log, then checkpoints.
+     * Does nothing if another store holds the log's lock slot (it applies them itself).
+     * @param decrypt Decrypts a log record.
+     * @return SecureStorage::Error::Errc::Success on success (also if there was no log),
+     * or an error code if the log could not be read or applied; what was not applied
+     * stays pending and is retried in the background.
+     */
+    Error::Errc recover(const DecryptFunction& decrypt);
+
+    /**
+     * @brief Makes a transaction durable and visible through lookup().
+     * @param record The encrypted serializeOps() of ops.
+     * @param[in,out] ops The changes; taken on success, left in place on failure.
+     * @return SecureStorage::Error::Errc::Success once the record is flushed, or an error
+     * code if it could not be written (the transaction then did not commit).
+     */
+    Error::Errc commit(const std::vector<unsigned char>& record, std::vector<TransactionOp>& ops);
+
+    /**
+     * @brief Tells whether a pending transaction changes data_id.
+     * @param data_id The data identifier.
+     * @return true if a committed change of data_id has not been applied yet.
+     */
+    bool touches(const std::string& data_id) const;
+
+    /**
+     * @brief Looks up the newest pending change of data_id.
+     * @param data_id The data identifier.
+     * @param[out] removed Set to true if that change deletes the id.
+     * @param[out] data Receives the data it stores, if it is a put.
+     * @return true if a pending change of data_id was found.
+     */
+    bool lookup(const std::string& data_id, bool& removed, std::vector<unsigned char>& data) const;
+
+    /**
+     * @brief Collects the outcome of all pending changes, per id.
+     * @param[out] removedById Receives every id with a pending change, mapped to true if
+     * that id ends up deleted and to false if it ends up stored.
+     */
+    void collectPending(std::unordered_map<std::string, bool>& removedById) const;
+
+    /**
+     * @brief Applies every pending transaction now and checkpoints the log.
+     * @return SecureStorage::Error::Errc::Success if nothing is left pending, or the error
+     * of the first change or checkpoint that failed.
+     */
+    Error::Errc applyPending();
+
+    /**
+     * @brief Returns the counters.
+     * @return A snapshot of the counters.
+     */
+    TransactionStats getStats() const;
+
+    /**
+     * @brief Serializes the changes of a transaction (the plaintext of a log record).
+     * @param ops The changes.
+     * @param[out] out Receives the bytes (overwritten).
+     */
+    static void serializeOps(const std::vector<TransactionOp>& ops, std::vector<unsigned char>& out);
+
+    /**
+     * @brief Parses the changes of a transaction.
+     * @param data The bytes produced by serializeOps().
+     * @param[out] ops Receives the changes.
+     * @return true on success, false if the bytes are malformed.
+     */
+    static bool parseOps(const std::vector<unsigned char>& data, std::vector<TransactionOp>& ops);
+
+private:
+    struct PendingTransaction {
+        std::vector<unsigned char> record; ///< As appended to the log, to rewrite it after a failed append
+        std::vector<TransactionOp> ops;
+    };
+
+    Error::Errc checkpoint();                   // Caller holds m_applyMutex
+    Error::Errc rewriteLog();                   // Caller holds m_appendMutex
+    void releaseLock();                         // Caller holds m_appendMutex
+    void startThread();                         // Caller holds m_mutex
+    void applyLoop();
+
+    Utils::DirFileUtil& m_directory;
+    Utils::FileLock& m_lock;
+    const uint64_t m_lockSlot;
+    const ApplyFunction m_apply;
+
+    // Lock order: m_applyMutex, m_appendMutex, m_mutex. Flushes of the log file happen
+    // under m_appendMutex only, so lookup() never waits for one.
+    std::mutex m_applyMutex;                ///< Serializes apply passes and checkpoints
+    std::mutex m_appendMutex;               ///< Serializes writes of the log file; protects m_lockHeld
+    bool m_lockHeld;                        ///< We hold m_lockSlot of m_lock
+    mutable std::mutex m_mutex;             ///< Protects everything below
+    std::condition_variable m_cv;
+    std::deque<PendingTransaction> m_pending; ///< Committed, oldest first; popped once applied
+    std::atomic<size_t> m_pendingCount;     ///< m_pending.size(), read without the mutex
+    bool m_logDirty;                        ///< The log file holds records
+    bool m_stopping;
+    TransactionStats m_stats;
+    std::thread m_thread;                   ///< Started by the first commit or a failed recovery
+};
+
+} // namespace Storage
+} // namespace SecureStorage
+
+#endif // SS_TRANSACTION_LOG_H
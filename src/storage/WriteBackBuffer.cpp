@@ -0,0 +1,373 @@
+#include "WriteBackBuffer.h"
+#include "SecureStore.h"
+#include "Logger.h" // For SS_LOG_ macros
+#include "SecureWipe.h"
+
+#include <algorithm> // For std::sort, std::unique
+
+namespace SecureStorage {
+namespace Storage {
+
+WriteBackBuffer::WriteBackBuffer(SecureStore& store, WriteBackOptions options)
+    : m_store(store),
+      m_options(options),
+      m_dirtyBytes(0),
+      m_stopping(false) {
+    m_commitThread = std::thread(&WriteBackBuffer::commitLoop, this);
+    SS_LOG_INFO("WriteBackBuffer: Started. Durability window " << m_options.maxDirtyAge.count()
+                << " ms, limits " << m_options.maxDirtyIds << " ids / " << m_options.maxDirtyBytes << " bytes.");
+}
+
+WriteBackBuffer::~WriteBackBuffer() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    if (m_commitThread.joinable()) {
+        m_commitThread.join();
+    }
+    Error::Errc err = flush();
+    if (err != Error::Errc::Success) {
+        SS_LOG_ERROR("WriteBackBuffer: Final flush failed with error " << static_cast<int>(err)
+                     << ". Buffered writes that could not be committed are lost.");
+    }
+    for (auto& entry : m_dirty) {
+        Utils::secureWipe(entry.second.data);
+    }
+    SS_LOG_INFO("WriteBackBuffer: Stopped.");
+}
+
+bool WriteBackBuffer::limitsExceeded() const {
+    return m_dirty.size() >= m_options.maxDirtyIds || m_dirtyBytes >= m_options.maxDirtyBytes;
+}
+
+const WriteBackBuffer::PendingWrite* WriteBackBuffer::findBuffered(const std::string& data_id) const {
+    auto it = m_dirty.find(data_id);
+    if (it != m_dirty.end()) {
+        return &it->second;
+    }
+    it = m_inflight.find(data_id);
+    return it != m_inflight.end() ? &it->second : nullptr;
+}
+
+Error::Errc WriteBackBuffer::storeData(const std::string& data_id, const std::vector<unsigned char>& plain_data) {
+    return storeData(data_id, plain_data, m_store.getDefaultDurability());
+}
+
+Error::Errc WriteBackBuffer::storeData(const std::string& data_id, const std::vector<unsigned char>& plain_data,
+                                       Durability durability) {
+    return storeData(data_id, plain_data.data(), plain_data.size(), durability);
+}
+
+Error::Errc WriteBackBuffer::storeData(const std::string& data_id, const unsigned char* data, size_t size,
+                                       Durability durability) {
+    if (data == nullptr && size > 0) {
+        return Error::Errc::InvalidArgument;
+    }
+    std::vector<unsigned char> buffered(data, data + size);
+    Error::Errc err = bufferWrite(data_id, buffered, durability);
+    Utils::secureWipe(buffered);
+    return err;
+}
+
+Error::Errc WriteBackBuffer::storeData(const std::string& data_id, std::vector<unsigned char>&& plain_data,
+                                       Durability durability) {
+    Error::Errc err = bufferWrite(data_id, plain_data, durability);
+    Utils::secureWipe(plain_data);
+    return err;
+}
+
+Error::Errc WriteBackBuffer::bufferWrite(const std::string& data_id, std::vector<unsigned char>& data,
+                                         Durability durability) {
+    Error::Errc id_validation_err = m_store.validateDataId(data_id);
+    if (id_validation_err != Error::Errc::Success) {
+        return id_validation_err;
+    }
+
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_dirty.find(data_id);
+        if (it == m_dirty.end()) {
+            PendingWrite pending;
+            pending.dirtySince = std::chrono::steady_clock::now();
+            it = m_dirty.insert(std::make_pair(data_id, std::move(pending))).first;
+            wake = m_dirty.size() == 1; // First dirty id sets the commit deadline
+        } else {
+            // Keep the original dirtySince: the window is bounded from the oldest unsaved write.
+            m_dirtyBytes -= it->second.data.size();
+            Utils::secureWipe(it->second.data);
+            m_stats.coalescedWrites++;
+        }
+        it->second.data.swap(data);
+        it->second.isDelete = false;
+        if (durability > it->second.durability) {
+            it->second.durability = durability;
+        }
+        m_dirtyBytes += it->second.data.size();
+        m_stats.bufferedWrites++;
+        wake = wake || limitsExceeded();
+    }
+    if (wake) {
+        m_cv.notify_one();
+    }
+    return Error::Errc::Success;
+}
+
+Error::Errc WriteBackBuffer::deleteData(const std::string& data_id) {
+    Error::Errc id_validation_err = m_store.validateDataId(data_id);
+    if (id_validation_err != Error::Errc::Success) {
+        return id_validation_err;
+    }
+
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_dirty.find(data_id);
+        if (it == m_dirty.end()) {
+            PendingWrite pending;
+            pending.dirtySince = std::chrono::steady_clock::now();
+            it = m_dirty.insert(std::make_pair(data_id, std::move(pending))).first;
+            wake = m_dirty.size() == 1;
+        } else {
+            m_dirtyBytes -= it->second.data.size();
+            Utils::secureWipe(it->second.data);
+            m_stats.coalescedWrites++;
+        }
+        it->second.isDelete = true;
+        m_stats.bufferedWrites++;
+        wake = wake || limitsExceeded();
+    }
+    if (wake) {
+        m_cv.notify_one();
+    }
+    return Error::Errc::Success;
+}
+
+Error::Errc WriteBackBuffer::retrieveData(const std::string& data_id, std::vector<unsigned char>& out_plain_data) {
+    out_plain_data.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const PendingWrite* pending = findBuffered(data_id);
+        if (pending) {
+            if (pending->isDelete) {
+                return Error::Errc::DataNotFound;
+            }
+            out_plain_data = pending->data;
+            return Error::Errc::Success;
+        }
+    }
+    // Not buffered. A commit retires an id from m_inflight only once the store call for it
+    // has returned, so the id's latest committed value is already on disk.
+    return m_store.retrieveData(data_id, out_plain_data);
+}
+
+Error::Errc WriteBackBuffer::retrieveData(const std::string& data_id, unsigned char* buffer, size_t capacity,
+                                          size_t& out_size) {
+    out_size = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const PendingWrite* pending = findBuffered(data_id);
+        if (pending) {
+            if (pending->isDelete) {
+                return Error::Errc::DataNotFound;
+            }
+            out_size = pending->data.size();
+            if (out_size > capacity) {
+                return Error::Errc::BufferTooSmall;
+            }
+            std::copy(pending->data.begin(), pending->data.end(), buffer);
+            return Error::Errc::Success;
+        }
+    }
+    return m_store.retrieveData(data_id, buffer, capacity, out_size);
+}
+
+Error::Errc WriteBackBuffer::retrieveMany(const std::vector<std::string>& data_ids,
+                                          std::vector<RetrieveResult>& results) {
+    results.clear();
+    results.resize(data_ids.size());
+    std::vector<std::string> unbuffered_ids;
+    std::vector<size_t> unbuffered_index;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < data_ids.size(); ++i) {
+            const PendingWrite* pending = findBuffered(data_ids[i]);
+            if (!pending) {
+                unbuffered_ids.push_back(data_ids[i]);
+                unbuffered_index.push_back(i);
+            } else if (pending->isDelete) {
+                results[i].status = Error::Errc::DataNotFound;
+            } else {
+                results[i].status = Error::Errc::Success;
+                results[i].data = pending->data;
+            }
+        }
+    }
+    if (unbuffered_ids.empty()) {
+        return Error::Errc::Success;
+    }
+    // As in retrieveData(): ids that were not buffered have their latest value on disk.
+    std::vector<RetrieveResult> read;
+    Error::Errc err = m_store.retrieveMany(unbuffered_ids, read);
+    if (err != Error::Errc::Success) {
+        return err;
+    }
+    for (size_t k = 0; k < read.size(); ++k) {
+        results[unbuffered_index[k]] = std::move(read[k]);
+    }
+    return Error::Errc::Success;
+}
+
+bool WriteBackBuffer::dataExists(const std::string& data_id) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const PendingWrite* pending = findBuffered(data_id);
+        if (pending) {
+            return !pending->isDelete;
+        }
+    }
+    return m_store.dataExists(data_id);
+}
+
+Error::Errc WriteBackBuffer::listDataIds(std::vector<std::string>& out_data_ids) {
+    // Snapshot the buffered overlay before listing the disk: an id committed and retired in
+    // between is then still applied from the snapshot, and its commit is already visible.
+    std::vector<std::pair<std::string, bool>> overlay; // Id and whether it is a delete
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // In-flight writes first, then newer dirty writes on top.
+        const std::map<std::string, PendingWrite>* layers[] = { &m_inflight, &m_dirty };
+        for (const std::map<std::string, PendingWrite>* layer : layers) {
+            for (const auto& entry : *layer) {
+                overlay.push_back(std::make_pair(entry.first, entry.second.isDelete));
+            }
+        }
+    }
+    Error::Errc err = m_store.listDataIds(out_data_ids);
+    if (err != Error::Errc::Success) {
+        return err;
+    }
+
+    for (const auto& entry : overlay) {
+        if (entry.second) {
+            out_data_ids.erase(std::remove(out_data_ids.begin(), out_data_ids.end(), entry.first),
+                               out_data_ids.end());
+        } else {
+            out_data_ids.push_back(entry.first);
+        }
+    }
+    std::sort(out_data_ids.begin(), out_data_ids.end());
+    out_data_ids.erase(std::unique(out_data_ids.begin(), out_data_ids.end()), out_data_ids.end());
+    return Error::Errc::Success;
+}
+
+Error::Errc WriteBackBuffer::commitBatch(const std::string* only_id) {
+    std::lock_guard<std::mutex> commit_lock(m_commitMutex);
+
+    std::vector<std::string> ids;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (only_id) {
+            auto it = m_dirty.find(*only_id);
+            if (it == m_dirty.end()) {
+                return Error::Errc::Success;
+            }
+            m_dirtyBytes -= it->second.data.size();
+            m_inflight.insert(std::make_pair(it->first, std::move(it->second)));
+            m_dirty.erase(it);
+        } else {
+            if (m_dirty.empty()) {
+                return Error::Errc::Success;
+            }
+            // m_inflight is always empty between rounds; take every dirty id in one group.
+            m_inflight.swap(m_dirty);
+            m_dirtyBytes = 0;
+        }
+        m_stats.groupCommits++;
+        ids.reserve(m_inflight.size());
+        for (const auto& entry : m_inflight) {
+            ids.push_back(entry.first);
+        }
+    }
+    SS_LOG_DEBUG("WriteBackBuffer: Committing " << ids.size() << " buffered id(s).");
+
+    Error::Errc first_err = Error::Errc::Success;
+    for (const std::string& id : ids) {
+        // Only this thread erases from m_inflight, so the entry can be read without m_mutex.
+        PendingWrite& pending = m_inflight.find(id)->second;
+        Error::Errc err = pending.isDelete ? m_store.deleteData(id)
+                                           : m_store.storeData(id, pending.data, pending.durability);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_inflight.find(id);
+        if (err == Error::Errc::Success) {
+            m_stats.committedWrites++;
+        } else {
+            SS_LOG_ERROR("WriteBackBuffer: Failed to commit id '" << id << "'. Error: " << static_cast<int>(err));
+            m_stats.failedCommits++;
+            if (first_err == Error::Errc::Success) {
+                first_err = err;
+            }
+            if (m_dirty.find(id) == m_dirty.end()) {
+                // Not superseded by a newer write: keep it buffered and retry after another window.
+                it->second.dirtySince = std::chrono::steady_clock::now();
+                m_dirtyBytes += it->second.data.size();
+                m_dirty.insert(std::make_pair(id, std::move(it->second)));
+            }
+        }
+        Utils::secureWipe(it->second.data);
+        m_inflight.erase(it);
+    }
+    return first_err;
+}
+
+void WriteBackBuffer::commitLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping) {
+        if (m_dirty.empty()) {
+            m_cv.wait(lock, [this] { return m_stopping || !m_dirty.empty(); });
+            continue;
+        }
+        if (!limitsExceeded()) {
+            std::chrono::steady_clock::time_point oldest = std::chrono::steady_clock::time_point::max();
+            for (const auto& entry : m_dirty) {
+                oldest = std::min(oldest, entry.second.dirtySince);
+            }
+            std::chrono::steady_clock::time_point deadline = oldest + m_options.maxDirtyAge;
+            if (std::chrono::steady_clock::now() < deadline) {
+                m_cv.wait_until(lock, deadline);
+                continue; // Re-evaluate: stop, size trigger or deadline
+            }
+        }
+
+        lock.unlock();
+        Error::Errc err = commitBatch(nullptr);
+        lock.lock();
+        if (err != Error::Errc::Success) {
+            // Back off for one window so a persistent failure does not spin on the size trigger.
+            m_cv.wait_for(lock, m_options.maxDirtyAge, [this] { return m_stopping; });
+        }
+    }
+}
+
+Error::Errc WriteBackBuffer::flush() {
+    // Waits for a round already in progress, then commits whatever is left (including any
+    // ids that round put back after a failure).
+    return commitBatch(nullptr);
+}
+
+Error::Errc WriteBackBuffer::flush(const std::string& data_id) {
+    return commitBatch(&data_id);
+}
+
+WriteBackStats WriteBackBuffer::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    WriteBackStats stats = m_stats;
+    stats.dirtyIds = m_dirty.size() + m_inflight.size();
+    return stats;
+}
+
+} // namespace Storage
+} // namespace SecureStorage
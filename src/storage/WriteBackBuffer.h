@@ -0,0 +1,166 @@
+#ifndef SS_WRITE_BACK_BUFFER_H
+#define SS_WRITE_BACK_BUFFER_H
+
+#include "Error.h"
+#include "Durability.h"
+#include "RetrieveResult.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint> // For uint64_t
+
+namespace SecureStorage {
+namespace Storage {
+
+class SecureStore; // Forward declare
+
+/**
+ * @struct WriteBackOptions
+ * @brief Tuning knobs for WriteBackBuffer.
+ */
+struct WriteBackOptions {
+    /// Longest time a buffered write may stay in memory before it is committed to disk.
+    /// This bounds the data that can be lost per id on a crash or power cut.
+    std::chrono::milliseconds maxDirtyAge = std::chrono::milliseconds(1000);
+    /// Commit as soon as this many distinct ids are dirty.
+    size_t maxDirtyIds = 256;
+    /// Commit as soon as the buffered plaintext reaches this many bytes.
+    size_t maxDirtyBytes = 1024 * 1024;
+};
+
+/**
+ * @struct WriteBackStats
+ * @brief Counters describing WriteBackBuffer activity.
+ */
+struct WriteBackStats {
+    uint64_t bufferedWrites = 0;  ///< storeData/deleteData calls accepted into the buffer
+    uint64_t coalescedWrites = 0; ///< Buffered writes replaced by a newer write before commit
+    uint64_t committedWrites = 0; ///< Per-id commits applied to the SecureStore
+    uint64_t groupCommits = 0;    ///< Commit rounds (time, size or explicit flush triggered)
+    uint64_t failedCommits = 0;   ///< Per-id commits that failed and were kept for retry
+    size_t dirtyIds = 0;          ///< Ids currently waiting to be committed
+};
+
+/**
+ * @class WriteBackBuffer
+ * @brief Read-your-writes write-back layer with group commit in front of a SecureStore.
+ *
+ * storeData() and deleteData() only update an in-memory map and return. A background
+ * thread commits the latest value of every dirty id when the oldest buffered write
+ * reaches WriteBackOptions::maxDirtyAge, or earlier when the id or byte limits are hit.
+ * Repeated writes to the same id between commits cost one disk write in total.
+ *
+ * Reads, existence checks and listings see buffered writes and deletes immediately.
+ * flush() commits everything synchronously. Buffered plaintext is wiped from memory
+ * once committed or replaced.
+ *
+ * Reads of ids that are not buffered go straight to the SecureStore without waiting for
+ * a commit round: an id leaves the buffer only after its commit has returned, so the
+ * store already holds its latest value. Writes to the wrapped SecureStore must still go
+ * through this object once it is in use, or a later commit may overwrite them.
+ */
+class WriteBackBuffer {
+public:
+    /**
+     * @brief Creates a buffer in front of store and starts its commit thread.
+     * @param store The SecureStore that receives committed writes. Must outlive this object.
+     * @param options Commit triggers.
+     */
+    WriteBackBuffer(SecureStore& store, WriteBackOptions options);
+
+    /**
+     * @brief Stops the commit thread after committing all buffered writes.
+     */
+    ~WriteBackBuffer();
+
+    WriteBackBuffer(const WriteBackBuffer&) = delete;
+    WriteBackBuffer& operator=(const WriteBackBuffer&) = delete;
+    WriteBackBuffer(WriteBackBuffer&&) = delete;
+    WriteBackBuffer& operator=(WriteBackBuffer&&) = delete;
+
+    /// @see SecureStore::storeData. Returns once the write is buffered.
+    Error::Errc storeData(const std::string& data_id, const std::vector<unsigned char>& plain_data);
+    /// @see SecureStore::storeData. The durability applies when the write is committed;
+    /// writes coalesced into one commit use the strongest level among them.
+    Error::Errc storeData(const std::string& data_id, const std::vector<unsigned char>& plain_data,
+                          Durability durability);
+    /// @see SecureStore::storeData. Copies the data once, into the buffer.
+    Error::Errc storeData(const std::string& data_id, const unsigned char* data, size_t size,
+                          Durability durability);
+    /// @see SecureStore::storeData. Buffers plain_data itself, without a copy; it is left
+    /// empty (and zeroed) as SecureStore leaves it.
+    Error::Errc storeData(const std::string& data_id, std::vector<unsigned char>&& plain_data,
+                          Durability durability);
+    /// @see SecureStore::retrieveData. Buffered writes are returned without touching the disk.
+    Error::Errc retrieveData(const std::string& data_id, std::vector<unsigned char>& out_plain_data);
+    /// @see SecureStore::retrieveData. Buffered writes are copied straight into buffer.
+    Error::Errc retrieveData(const std::string& data_id, unsigned char* buffer, size_t capacity, size_t& out_size);
+    /// @see SecureStore::retrieveMany. Buffered ids are answered from memory, the rest in one batch.
+    Error::Errc retrieveMany(const std::vector<std::string>& data_ids, std::vector<RetrieveResult>& results);
+    /// @see SecureStore::deleteData. Returns once the delete is buffered.
+    Error::Errc deleteData(const std::string& data_id);
+    /// @see SecureStore::dataExists
+    bool dataExists(const std::string& data_id);
+    /// @see SecureStore::listDataIds
+    Error::Errc listDataIds(std::vector<std::string>& out_data_ids);
+
+    /**
+     * @brief Commits every buffered write to the SecureStore before returning.
+     * @return SecureStorage::Error::Errc::Success if all writes were committed, otherwise
+     * the first error encountered (failed ids stay buffered for a later retry).
+     */
+    Error::Errc flush();
+
+    /**
+     * @brief Commits the buffered write of one id, if any, before returning.
+     * Used before reads the buffer cannot answer, such as reads of older versions.
+     * @param data_id The id to commit.
+     * @return SecureStorage::Error::Errc::Success if the id was committed or not buffered,
+     * otherwise the commit error (the write stays buffered for a later retry).
+     */
+    Error::Errc flush(const std::string& data_id);
+
+    /**
+     * @brief Returns activity counters.
+     * @return A snapshot of the counters.
+     */
+    WriteBackStats getStats() const;
+
+private:
+    struct PendingWrite {
+        std::vector<unsigned char> data;
+        bool isDelete = false;
+        Durability durability = Durability::None; // Strongest level requested since the last commit
+        std::chrono::steady_clock::time_point dirtySince;
+    };
+
+    // Swaps data into the pending write of data_id; data receives the wiped previous buffer.
+    Error::Errc bufferWrite(const std::string& data_id, std::vector<unsigned char>& data, Durability durability);
+    void commitLoop();
+    Error::Errc commitBatch(const std::string* only_id); // Every dirty id if only_id is null
+    bool limitsExceeded() const;
+    const PendingWrite* findBuffered(const std::string& data_id) const; // Caller holds m_mutex
+
+    SecureStore& m_store;
+    WriteBackOptions m_options;
+
+    mutable std::mutex m_mutex;          ///< Protects the maps, counters and m_stopping
+    std::condition_variable m_cv;        ///< Wakes the commit thread
+    std::map<std::string, PendingWrite> m_dirty;    ///< Writes not yet picked up by a commit
+    std::map<std::string, PendingWrite> m_inflight; ///< Writes being committed right now
+    size_t m_dirtyBytes;
+    bool m_stopping;
+    WriteBackStats m_stats;
+
+    std::mutex m_commitMutex;            ///< Allows one commit round at a time
+    std::thread m_commitThread;
+};
+
+} // namespace Storage
+} // namespace SecureStorage
+
+#endif // SS_WRITE_BACK_BUFFER_H
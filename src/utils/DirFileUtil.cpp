@@ -0,0 +1,696 @@
+#include "DirFileUtil.h"
+#include "FileUtil.h" // For TEMP_FILE_UTIL_SUFFIX and the non-POSIX fallback
+#include "Logger.h"   // For SS_LOG_ macros
+#include "ScratchPool.h" // For ScratchName
+
+#include "SyscallShim.h" // File system calls, routed through FaultInjector
+
+#include <cerrno>     // For errno
+#include <cstring>    // For strerror
+#include <cstdio>     // For std::rename, snprintf
+#ifndef _WIN32
+#include <fcntl.h>    // For O_* flags, AT_* flags
+#include <dirent.h>   // For fdopendir, readdir
+#endif
+
+#ifndef RENAME_EXCHANGE
+#define RENAME_EXCHANGE (1 << 1) // From <linux/fs.h>, which clashes with other system headers
+#endif
+
+namespace SecureStorage {
+namespace Utils {
+
+DirFileUtil::DirFileUtil(const std::string& directoryPath)
+    : m_directoryPath(directoryPath),
+      m_fd(-1),
+      m_exchangeSupported(true),
+#ifdef O_TMPFILE
+      m_anonymousFilesSupported(true),
+#else
+      m_anonymousFilesSupported(false),
+#endif
+      m_linkViaProc(false),
+      m_syscalls(0),
+      m_fsyncs(0),
+      m_bytesWritten(0),
+      m_bytesRead(0) {
+    if (!m_directoryPath.empty() && m_directoryPath.back() != '/' && m_directoryPath.back() != '\\') {
+        m_directoryPath += '/';
+    }
+#ifndef _WIN32
+    m_fd = Shim::open(directoryPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (m_fd < 0) {
+        SS_LOG_ERROR("DirFileUtil: Failed to open directory '" << directoryPath << "': " << strerror(errno));
+        return;
+    }
+    SS_LOG_DEBUG("DirFileUtil: Opened directory '" << directoryPath << "'.");
+#else
+    m_fd = FileUtil::pathExists(directoryPath) ? 0 : -1;
+    m_exchangeSupported = false;
+#endif
+}
+
+DirFileUtil::~DirFileUtil() {
+#ifndef _WIN32
+    if (m_fd >= 0) {
+        Shim::close(m_fd);
+    }
+#endif
+}
+
+bool DirFileUtil::isOpen() const {
+    return m_fd >= 0;
+}
+
+bool DirFileUtil::exchangeEnabled() const {
+    return m_exchangeSupported;
+}
+
+bool DirFileUtil::anonymousFilesEnabled() const {
+    return m_anonymousFilesSupported;
+}
+
+void DirFileUtil::setAnonymousFilesEnabled(bool enabled) {
+#ifdef O_TMPFILE
+    m_anonymousFilesSupported = enabled;
+#else
+    (void)enabled;
+#endif
+}
+
+FileIoStats DirFileUtil::getIoStats() const {
+    FileIoStats stats;
+    stats.syscalls = m_syscalls.load(std::memory_order_relaxed);
+    stats.fsyncs = m_fsyncs.load(std::memory_order_relaxed);
+    stats.bytesWritten = m_bytesWritten.load(std::memory_order_relaxed);
+    stats.bytesRead = m_bytesRead.load(std::memory_order_relaxed);
+    return stats;
+}
+
+Error::Errc DirFileUtil::writeAll(int fd, const std::vector<unsigned char>& data, const std::string& name) {
+#ifndef _WIN32
+    size_t written = 0;
+    while (written < data.size()) {
+        countSyscall();
+        ssize_t ret = Shim::write(fd, data.data() + written, data.size() - written);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            SS_LOG_ERROR("Failed to write data to '" << m_directoryPath << name << "': " << strerror(errno));
+            return Error::Errc::FileWriteFailed;
+        }
+        written += static_cast<size_t>(ret);
+    }
+    m_bytesWritten.fetch_add(data.size(), std::memory_order_relaxed);
+#else
+    (void)fd; (void)data; (void)name;
+#endif
+    return Error::Errc::Success;
+}
+
+Error::Errc DirFileUtil::syncFile(int fd, FileSync sync, const std::string& name) {
+#ifndef _WIN32
+    if (sync == FileSync::None) {
+        return Error::Errc::Success;
+    }
+    countSyscall();
+    m_fsyncs.fetch_add(1, std::memory_order_relaxed);
+    int ret = sync == FileSync::Full ? Shim::fsync(fd) : Shim::fdatasync(fd);
+    if (ret != 0) {
+        SS_LOG_ERROR("Failed to " << (sync == FileSync::Full ? "fsync" : "fdatasync") << " file '"
+                     << m_directoryPath << name << "': " << strerror(errno));
+        return Error::Errc::FileWriteFailed;
+    }
+#else
+    (void)fd; (void)sync; (void)name;
+#endif
+    return Error::Errc::Success;
+}
+
+Error::Errc DirFileUtil::writeFile(const std::string& name, const std::vector<unsigned char>& data, FileSync sync) {
+    if (name.empty()) {
+        SS_LOG_ERROR("File name for write is empty.");
+        return Error::Errc::InvalidArgument;
+    }
+    if (!isOpen()) {
+        return Error::Errc::NotInitialized;
+    }
+#ifndef _WIN32
+    countSyscall();
+    int fd = Shim::openat(m_fd, name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                    S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH); // Permissions 0644
+    if (fd < 0) {
+        SS_LOG_ERROR("Failed to open file '" << m_directoryPath << name << "' for writing: " << strerror(errno));
+        return Error::Errc::FileOpenFailed;
+    }
+    Error::Errc err = writeAll(fd, data, name);
+    if (err == Error::Errc::Success) {
+        err = syncFile(fd, sync, name);
+    }
+    countSyscall();
+    if (Shim::close(fd) != 0 && err == Error::Errc::Success) {
+        SS_LOG_ERROR("Failed to close file '" << m_directoryPath << name << "' after writing: " << strerror(errno));
+        err = Error::Errc::FileWriteFailed;
+    }
+    return err;
+#else
+    (void)sync;
+    std::ofstream ofs(m_directoryPath + name, std::ios::binary | std::ios::trunc);
+    ofs.write(reinterpret_cast<const char*>(data.data()), data.size());
+    ofs.close();
+    return ofs.fail() ? Error::Errc::FileWriteFailed : Error::Errc::Success;
+#endif
+}
+
+Error::Errc DirFileUtil::appendFile(const std::string& name, const std::vector<unsigned char>& data, FileSync sync) {
+    if (name.empty()) {
+        SS_LOG_ERROR("File name for append is empty.");
+        return Error::Errc::InvalidArgument;
+    }
+    if (!isOpen()) {
+        return Error::Errc::NotInitialized;
+    }
+#ifndef _WIN32
+    countSyscall();
+    int fd = Shim::openat(m_fd, name.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+                    S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH); // Permissions 0644
+    if (fd < 0) {
+        SS_LOG_ERROR("Failed to open file '" << m_directoryPath << name << "' for appending: " << strerror(errno));
+        return Error::Errc::FileOpenFailed;
+    }
+    Error::Errc err = writeAll(fd, data, name);
+    if (err == Error::Errc::Success) {
+        err = syncFile(fd, sync, name);
+    }
+    countSyscall();
+    if (Shim::close(fd) != 0 && err == Error::Errc::Success) {
+        SS_LOG_ERROR("Failed to close file '" << m_directoryPath << name << "' after appending: " << strerror(errno));
+        err = Error::Errc::FileWriteFailed;
+    }
+    return err;
+#else
+    (void)sync;
+    std::ofstream ofs(m_directoryPath + name, std::ios::binary | std::ios::app);
+    ofs.write(reinterpret_cast<const char*>(data.data()), data.size());
+    ofs.close();
+    return ofs.fail() ? Error::Errc::FileWriteFailed : Error::Errc::Success;
+#endif
+}
+
+Error::Errc DirFileUtil::linkNewFile(const std::string& name, const std::vector<unsigned char>& data, FileSync sync) {
+    if (name.empty()) {
+        SS_LOG_ERROR("File name for linkNewFile is empty.");
+        return Error::Errc::InvalidArgument;
+    }
+    if (!isOpen()) {
+        return Error::Errc::NotInitialized;
+    }
+    if (!m_anonymousFilesSupported) {
+        return Error::Errc::OperationFailed;
+    }
+#if !defined(_WIN32) && defined(O_TMPFILE)
+    countSyscall();
+    int fd = Shim::openat(m_fd, ".", O_TMPFILE | O_WRONLY | O_CLOEXEC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (fd < 0) {
+        int err = errno;
+        if (err == EOPNOTSUPP || err == EISDIR || err == EINVAL) {
+            SS_LOG_WARN("DirFileUtil: O_TMPFILE not supported for '" << m_directoryPath << "' ("
+                        << strerror(err) << "), falling back to named temporary files.");
+            m_anonymousFilesSupported = false;
+            return Error::Errc::OperationFailed;
+        }
+        SS_LOG_ERROR("Failed to open anonymous file in '" << m_directoryPath << "': " << strerror(err));
+        return Error::Errc::FileOpenFailed;
+    }
+
+    Error::Errc result = writeAll(fd, data, name);
+    if (result == Error::Errc::Success) {
+        result = syncFile(fd, sync, name);
+    }
+
+    if (result == Error::Errc::Success) {
+        int ret = -1;
+        if (!m_linkViaProc) {
+            countSyscall();
+            ret = Shim::linkat(fd, "", m_fd, name.c_str(), AT_EMPTY_PATH);
+            if (ret != 0 && errno == ENOENT) {
+                m_linkViaProc = true; // No CAP_DAC_READ_SEARCH; use the /proc link from now on
+            }
+        }
+        if (m_linkViaProc) {
+            char procPath[64];
+            snprintf(procPath, sizeof(procPath), "/proc/self/fd/%d", fd);
+            countSyscall();
+            ret = Shim::linkat(AT_FDCWD, procPath, m_fd, name.c_str(), AT_SYMLINK_FOLLOW);
+        }
+        if (ret != 0) {
+            int err = errno;
+            if (err == EEXIST) {
+                result = Error::Errc::DataAlreadyExists;
+            } else {
+                SS_LOG_ERROR("Failed to link anonymous file as '" << m_directoryPath << name << "': " << strerror(err));
+                result = Error::Errc::FileWriteFailed;
+            }
+        }
+    }
+
+    countSyscall();
+    Shim::close(fd); // An anonymous file that was not linked is freed here
+    return result;
+#else
+    (void)data; (void)sync;
+    return Error::Errc::OperationFailed;
+#endif
+}
+
+Error::Errc DirFileUtil::atomicWriteFile(const std::string& name, const std::vector<unsigned char>& data,
+                                         bool syncDirectory) {
+    if (name.empty()) {
+        SS_LOG_ERROR("File name for atomic write is empty.");
+        return Error::Errc::InvalidArgument;
+    }
+    if (!isOpen()) {
+        return Error::Errc::NotInitialized;
+    }
+#ifndef _WIN32
+    ScratchName temp_name;
+    const std::string& tempName = temp_name.get();
+    temp_name.get().assign(name).append(TEMP_FILE_UTIL_SUFFIX);
+
+    countSyscall();
+    int fd = Shim::openat(m_fd, tempName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                    S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH); // Permissions 0644
+    if (fd < 0) {
+        SS_LOG_ERROR("Failed to open temporary file '" << m_directoryPath << tempName << "' for writing: " << strerror(errno));
+        return Error::Errc::FileOpenFailed;
+    }
+
+    if (writeAll(fd, data, tempName) != Error::Errc::Success) {
+        Shim::close(fd);
+        Shim::unlinkat(m_fd, tempName.c_str(), 0);
+        return Error::Errc::FileWriteFailed;
+    }
+
+    countSyscall();
+    m_fsyncs.fetch_add(1, std::memory_order_relaxed);
+    if (Shim::fsync(fd) != 0) {
+        SS_LOG_ERROR("Failed to fsync temporary file '" << m_directoryPath << tempName << "': " << strerror(errno));
+        Shim::close(fd);
+        Shim::unlinkat(m_fd, tempName.c_str(), 0);
+        return Error::Errc::FileWriteFailed;
+    }
+    countSyscall();
+    if (Shim::close(fd) != 0) {
+        SS_LOG_ERROR("Failed to close temporary file '" << m_directoryPath << tempName << "' after fsync: " << strerror(errno));
+        Shim::unlinkat(m_fd, tempName.c_str(), 0);
+        return Error::Errc::FileWriteFailed;
+    }
+
+    countSyscall();
+    if (Shim::renameat(m_fd, tempName.c_str(), m_fd, name.c_str()) != 0) {
+        SS_LOG_ERROR("Failed to rename temporary file '" << tempName << "' to '" << name << "' in '"
+                     << m_directoryPath << "': " << strerror(errno));
+        Shim::unlinkat(m_fd, tempName.c_str(), 0);
+        return Error::Errc::FileRenameFailed;
+    }
+
+    if (syncDirectory) {
+        this->syncDirectory(); // Failure is logged; the data itself is already durable
+    }
+    SS_LOG_DEBUG("Successfully wrote " << data.size() << " bytes to '" << m_directoryPath << name << "'.");
+    return Error::Errc::Success;
+#else
+    (void)syncDirectory;
+    return FileUtil::atomicWriteFile(m_directoryPath + name, data);
+#endif
+}
+
+namespace {
+
+#ifndef _WIN32
+FileIdentity identityOf(const struct stat& st) {
+    FileIdentity identity;
+    identity.device = static_cast<uint64_t>(st.st_dev);
+    identity.inode = static_cast<uint64_t>(st.st_ino);
+    identity.size = static_cast<uint64_t>(st.st_size);
+    identity.changeTimeNs = static_cast<int64_t>(st.st_ctim.tv_sec) * 1000000000LL + st.st_ctim.tv_nsec;
+    return identity;
+}
+#endif
+
+} // namespace
+
+int DirFileUtil::openForRead(const std::string& name, size_t& size, FileIdentity* identity) const {
+    size = 0;
+    if (name.empty() || !isOpen()) {
+        return -1;
+    }
+#ifndef _WIN32
+    countSyscall();
+    int fd = Shim::openat(m_fd, name.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        SS_LOG_DEBUG("Failed to open file for reading: " << m_directoryPath << name << " - " << strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    countSyscall();
+    if (Shim::fstat(fd, &st) != 0) {
+        SS_LOG_ERROR("Failed to determine size of file: " << m_directoryPath << name << " - " << strerror(errno));
+        Shim::close(fd);
+        return -1;
+    }
+    if (identity) {
+        *identity = identityOf(st);
+    }
+    size = static_cast<size_t>(st.st_size);
+    m_bytesRead.fetch_add(size, std::memory_order_relaxed);
+    return fd;
+#else
+    (void)identity;
+    return -1;
+#endif
+}
+
+Error::Errc DirFileUtil::readFile(const std::string& name, std::vector<unsigned char>& data,
+                                  FileIdentity* identity) const {
+    data.clear();
+    if (name.empty()) {
+        SS_LOG_ERROR("File name for read is empty.");
+        return Error::Errc::InvalidArgument;
+    }
+    if (!isOpen()) {
+        return Error::Errc::NotInitialized;
+    }
+#ifndef _WIN32
+    countSyscall();
+    int fd = Shim::openat(m_fd, name.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        SS_LOG_DEBUG("Failed to open file for reading: " << m_directoryPath << name << " - " << strerror(errno));
+        return Error::Errc::FileOpenFailed;
+    }
+
+    struct stat st;
+    countSyscall();
+    if (Shim::fstat(fd, &st) != 0) {
+        SS_LOG_ERROR("Failed to determine size of file: " << m_directoryPath << name << " - " << strerror(errno));
+        Shim::close(fd);
+        return Error::Errc::FileReadFailed;
+    }
+    if (identity) {
+        *identity = identityOf(st);
+    }
+
+    data.resize(static_cast<size_t>(st.st_size));
+    size_t total = 0;
+    while (total < data.size()) {
+        countSyscall();
+        ssize_t ret = Shim::read(fd, data.data() + total, data.size() - total);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret < 0) {
+            SS_LOG_ERROR("Failed to read data from file: " << m_directoryPath << name << " - " << strerror(errno));
+            data.clear();
+            Shim::close(fd);
+            return Error::Errc::FileReadFailed;
+        }
+        if (ret == 0) {
+            data.resize(total); // File shrank after fstat
+            break;
+        }
+        total += static_cast<size_t>(ret);
+    }
+    countSyscall();
+    Shim::close(fd);
+    m_bytesRead.fetch_add(data.size(), std::memory_order_relaxed);
+    SS_LOG_DEBUG("Successfully read " << data.size() << " bytes from file: " << m_directoryPath << name);
+    return Error::Errc::Success;
+#else
+    if (identity) {
+        *identity = FileIdentity();
+    }
+    return FileUtil::readFile(m_directoryPath + name, data);
+#endif
+}
+
+Error::Errc DirFileUtil::getFileIdentity(const std::string& name, FileIdentity& identity) const {
+    identity = FileIdentity();
+    if (name.empty() || !isOpen()) {
+        return Error::Errc::InvalidArgument;
+    }
+#ifndef _WIN32
+    struct stat st;
+    countSyscall();
+    if (Shim::fstatat(m_fd, name.c_str(), &st, 0) != 0) {
+        return errno == ENOENT ? Error::Errc::PathNotFound : Error::Errc::FileReadFailed;
+    }
+    identity = identityOf(st);
+    return Error::Errc::Success;
+#else
+    return Error::Errc::FileReadFailed;
+#endif
+}
+
+void DirFileUtil::adviseWillNeed(const std::vector<std::string>& names) const {
+#if !defined(_WIN32) && defined(POSIX_FADV_WILLNEED)
+    if (!isOpen()) {
+        return;
+    }
+    for (const std::string& name : names) {
+        countSyscall();
+        int fd = Shim::openat(m_fd, name.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        countSyscall();
+        Shim::fadvise(fd, 0, 0, POSIX_FADV_WILLNEED); // Only a hint; errors change nothing
+        countSyscall();
+        Shim::close(fd);
+    }
+#else
+    (void)names;
+#endif
+}
+
+Error::Errc DirFileUtil::deleteFile(const std::string& name) {
+    if (name.empty()) {
+        SS_LOG_ERROR("File name for delete is empty.");
+        return Error::Errc::InvalidArgument;
+    }
+    if (!isOpen()) {
+        return Error::Errc::NotInitialized;
+    }
+#ifndef _WIN32
+    countSyscall();
+    if (Shim::unlinkat(m_fd, name.c_str(), 0) != 0) {
+        if (errno == ENOENT) {
+            SS_LOG_DEBUG("File to delete does not exist, no action needed: " << m_directoryPath << name);
+            return Error::Errc::Success;
+        }
+        SS_LOG_ERROR("Failed to delete file: " << m_directoryPath << name << " - " << strerror(errno));
+        return Error::Errc::FileRemoveFailed;
+    }
+    SS_LOG_DEBUG("Successfully deleted file: " << m_directoryPath << name);
+    return Error::Errc::Success;
+#else
+    return FileUtil::deleteFile(m_directoryPath + name);
+#endif
+}
+
+bool DirFileUtil::pathExists(const std::string& name) const {
+    if (name.empty() || !isOpen()) {
+        return false;
+    }
+#ifndef _WIN32
+    struct stat st;
+    countSyscall();
+    return Shim::fstatat(m_fd, name.c_str(), &st, 0) == 0;
+#else
+    return FileUtil::pathExists(m_directoryPath + name);
+#endif
+}
+
+Error::Errc DirFileUtil::renameFile(const std::string& from, const std::string& to) {
+    if (from.empty() || to.empty()) {
+        SS_LOG_ERROR("File name for rename is empty.");
+        return Error::Errc::InvalidArgument;
+    }
+    if (!isOpen()) {
+        return Error::Errc::NotInitialized;
+    }
+    countSyscall();
+#ifndef _WIN32
+    if (Shim::renameat(m_fd, from.c_str(), m_fd, to.c_str()) != 0) {
+#else
+    if (std::rename((m_directoryPath + from).c_str(), (m_directoryPath + to).c_str()) != 0) {
+#endif
+        SS_LOG_ERROR("Failed to rename '" << from << "' to '" << to << "' in '" << m_directoryPath << "': " << strerror(errno));
+        return Error::Errc::FileRenameFailed;
+    }
+    return Error::Errc::Success;
+}
+
+Error::Errc DirFileUtil::exchangeFiles(const std::string& first, const std::string& second) {
+    if (first.empty() || second.empty()) {
+        SS_LOG_ERROR("File name for exchange is empty.");
+        return Error::Errc::InvalidArgument;
+    }
+    if (!isOpen()) {
+        return Error::Errc::NotInitialized;
+    }
+    if (!m_exchangeSupported) {
+        return Error::Errc::OperationFailed;
+    }
+#ifndef _WIN32
+    countSyscall();
+    if (Shim::renameat2(m_fd, first.c_str(), m_fd, second.c_str(), RENAME_EXCHANGE) != 0) {
+        int err = errno;
+        if (err == ENOENT) {
+            return Error::Errc::PathNotFound;
+        }
+        if (err == ENOSYS || err == EINVAL) {
+            SS_LOG_WARN("DirFileUtil: Atomic exchange not supported for '" << m_directoryPath << "' ("
+                        << strerror(err) << "), falling back to renames.");
+            m_exchangeSupported = false;
+            return Error::Errc::OperationFailed;
+        }
+        SS_LOG_ERROR("Failed to exchange '" << first << "' and '" << second << "' in '" << m_directoryPath << "': " << strerror(err));
+        return Error::Errc::FileRenameFailed;
+    }
+    return Error::Errc::Success;
+#else
+    return Error::Errc::OperationFailed;
+#endif
+}
+
+Error::Errc DirFileUtil::syncDirectory() {
+    if (!isOpen()) {
+        return Error::Errc::NotInitialized;
+    }
+#ifndef _WIN32
+    countSyscall();
+    m_fsyncs.fetch_add(1, std::memory_order_relaxed);
+    if (Shim::fsync(m_fd) != 0) {
+        SS_LOG_WARN("Failed to fsync directory '" << m_directoryPath << "': " << strerror(errno)
+                    << ". Rename operation might not be fully persistent on power loss.");
+        return Error::Errc::FileWriteFailed;
+    }
+#endif
+    return Error::Errc::Success;
+}
+
+Error::Errc DirFileUtil::syncFilesystem() {
+    if (!isOpen()) {
+        return Error::Errc::NotInitialized;
+    }
+#ifndef _WIN32
+    countSyscall();
+    m_fsyncs.fetch_add(1, std::memory_order_relaxed);
+#ifdef __linux__
+    if (Shim::syncfs(m_fd) != 0) {
+        SS_LOG_WARN("Failed to syncfs the filesystem of '" << m_directoryPath << "': " << strerror(errno));
+        return Error::Errc::FileWriteFailed;
+    }
+#else
+    Shim::sync(); // Cannot fail, but flushes every filesystem
+#endif
+#endif
+    return Error::Errc::Success;
+}
+
+bool DirFileUtil::isRegularEntry(const char* name, unsigned char type) const {
+#ifndef _WIN32
+    if (std::strcmp(name, ".") == 0 || std::strcmp(name, "..") == 0) {
+        return false;
+    }
+#ifdef DT_REG
+    if (type == DT_REG) {
+        return true;
+    }
+    if (type != DT_UNKNOWN && type != DT_LNK) {
+        return false;
+    }
+#endif
+    // Type not reported by the filesystem, or a symlink: check what it resolves to.
+    struct stat entry_stat;
+    countSyscall();
+    if (Shim::fstatat(m_fd, name, &entry_stat, 0) == 0) {
+        return S_ISREG(entry_stat.st_mode);
+    }
+    SS_LOG_WARN("Failed to stat entry: " << m_directoryPath << name << " - " << strerror(errno));
+#else
+    (void)name; (void)type;
+#endif
+    return false;
+}
+
+Error::Errc DirFileUtil::listDirectory(std::vector<std::string>& files) const {
+    files.clear();
+    if (!isOpen()) {
+        return Error::Errc::NotInitialized;
+    }
+#ifndef _WIN32
+    // A fresh descriptor, so the directory offset is not shared with m_fd.
+    countSyscall();
+    int list_fd = Shim::openat(m_fd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (list_fd < 0) {
+        SS_LOG_ERROR("Failed to open directory: " << m_directoryPath << " - " << strerror(errno));
+        return Error::Errc::FileOpenFailed;
+    }
+#ifdef SYS_getdents64
+    // getdents64 with a large buffer returns thousands of entries per call, where readdir's
+    // internal buffer needs one call per ~32 KiB.
+    std::vector<char> buffer(DIRECTORY_SCAN_BUFFER_SIZE);
+    for (;;) {
+        countSyscall();
+        long nread = Shim::getdents64(list_fd, buffer.data(), buffer.size());
+        if (nread < 0) {
+            SS_LOG_ERROR("Failed to read directory: " << m_directoryPath << " - " << strerror(errno));
+            Shim::close(list_fd);
+            files.clear();
+            return Error::Errc::FileReadFailed;
+        }
+        if (nread == 0) {
+            break;
+        }
+        for (long offset = 0; offset < nread;) {
+            const Shim::LinuxDirent64* entry = reinterpret_cast<const Shim::LinuxDirent64*>(buffer.data() + offset);
+            if (isRegularEntry(entry->d_name, entry->d_type)) {
+                files.push_back(entry->d_name);
+            }
+            offset += entry->d_reclen;
+        }
+    }
+    countSyscall();
+    Shim::close(list_fd);
+#else
+    DIR* dir = fdopendir(list_fd);
+    if (dir == nullptr) {
+        SS_LOG_ERROR("Failed to open directory: " << m_directoryPath << " - " << strerror(errno));
+        Shim::close(list_fd);
+        return Error::Errc::FileOpenFailed;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+#ifdef DT_REG
+        unsigned char type = entry->d_type;
+#else
+        unsigned char type = 0;
+#endif
+        if (isRegularEntry(entry->d_name, type)) {
+            files.push_back(entry->d_name);
+        }
+    }
+    countSyscall();
+    closedir(dir); // Also closes list_fd
+#endif
+    SS_LOG_DEBUG("Listed " << files.size() << " regular files in directory: " << m_directoryPath);
+    return Error::Errc::Success;
+#else
+    return FileUtil::listDirectory(m_directoryPath, files);
+#endif
+}
+
+} // namespace Utils
+} // namespace SecureStorage
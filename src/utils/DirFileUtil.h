@@ -0,0 +1,295 @@
+#ifndef SS_DIR_FILE_UTIL_H
+#define SS_DIR_FILE_UTIL_H
+
+#include "Error.h" // For SecureStorage::Error::Errc
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint> // For uint64_t
+
+namespace SecureStorage {
+namespace Utils {
+
+// Buffer size for directory listings; roughly 8000 typical entries per getdents64 call.
+constexpr size_t DIRECTORY_SCAN_BUFFER_SIZE = 256 * 1024;
+
+/**
+ * @struct FileIoStats
+ * @brief Counts of the system calls a DirFileUtil has issued.
+ */
+struct FileIoStats {
+    uint64_t syscalls = 0;     ///< All file system calls, including the ones below
+    uint64_t fsyncs = 0;       ///< fsync/fdatasync calls on files and on the directory
+    uint64_t bytesWritten = 0; ///< Payload bytes passed to write()
+    uint64_t bytesRead = 0;    ///< Payload bytes returned by read()
+};
+
+/**
+ * @struct FileIdentity
+ * @brief Identifies one version of a file. Files are only ever replaced (renamed or linked
+ * over), never rewritten in place, so a changed file has a different inode or change time.
+ */
+struct FileIdentity {
+    uint64_t device = 0;
+    uint64_t inode = 0;       ///< 0 if unknown
+    uint64_t size = 0;
+    int64_t changeTimeNs = 0; ///< st_ctim in nanoseconds
+};
+
+inline bool operator==(const FileIdentity& a, const FileIdentity& b) {
+    return a.device == b.device && a.inode == b.inode && a.size == b.size && a.changeTimeNs == b.changeTimeNs;
+}
+
+inline bool operator!=(const FileIdentity& a, const FileIdentity& b) {
+    return !(a == b);
+}
+
+/**
+ * @enum FileSync
+ * @brief How far a written file is flushed before the write call returns.
+ */
+enum class FileSync {
+    None, ///< Left in the page cache; the kernel writes it back on its own schedule
+    Data, ///< fdatasync: content and the metadata needed to read it back (size)
+    Full  ///< fsync: content and all inode metadata
+};
+
+/**
+ * @class DirFileUtil
+ * @brief File operations relative to one directory, held open as an O_DIRECTORY descriptor.
+ *
+ * FileUtil takes full paths, so the kernel resolves every component of the path again on
+ * each call, and callers build a new path string per operation. DirFileUtil resolves the
+ * directory once and then uses the *at() system calls (openat, renameat, unlinkat,
+ * fstatat) with plain file names. The directory fsync that makes renames durable reuses
+ * the cached descriptor instead of reopening the directory.
+ *
+ * exchangeFiles() swaps two names atomically with renameat2(RENAME_EXCHANGE), so a
+ * replaced file and its replacement never both go missing, not even briefly.
+ *
+ * linkNewFile() writes into an anonymous O_TMPFILE inode and links it in only once its
+ * data is on disk, so an interrupted write never leaves a named temporary file behind.
+ *
+ * All names must be single path components (no separators). On platforms without the
+ * *at() calls, the operations fall back to FileUtil on the joined path.
+ */
+class DirFileUtil {
+public:
+    /**
+     * @brief Opens the directory. It must already exist.
+     * @param directoryPath Path of the directory.
+     */
+    explicit DirFileUtil(const std::string& directoryPath);
+    ~DirFileUtil();
+
+    DirFileUtil(const DirFileUtil&) = delete;
+    DirFileUtil& operator=(const DirFileUtil&) = delete;
+    DirFileUtil(DirFileUtil&&) = delete;
+    DirFileUtil& operator=(DirFileUtil&&) = delete;
+
+    /**
+     * @brief Checks whether the directory was opened successfully.
+     * @return true if operations can be performed, false otherwise.
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Atomically writes data to a file in the directory.
+     * Writes `name` + TEMP_FILE_UTIL_SUFFIX, fsyncs it, then renames it over `name`.
+     *
+     * @param name The file name.
+     * @param data The byte vector containing data to write.
+     * @param syncDirectory Whether to fsync the directory so the rename itself is durable.
+     * Callers that perform further renames can pass false and call syncDirectory() once.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc atomicWriteFile(const std::string& name, const std::vector<unsigned char>& data,
+                                bool syncDirectory = true);
+
+    /**
+     * @brief Creates or truncates a file, writes data and flushes it as requested.
+     * Not atomic: meant for temporary files that are renamed into place afterwards.
+     *
+     * @param name The file name.
+     * @param data The byte vector containing data to write.
+     * @param sync How to flush the file before returning.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc writeFile(const std::string& name, const std::vector<unsigned char>& data,
+                          FileSync sync = FileSync::Data);
+
+    /**
+     * @brief Appends data to a file, creating it if needed, and flushes it as requested.
+     * Not atomic: a crash can leave a prefix of data at the end of the file, so callers
+     * must be able to recognise a torn tail.
+     *
+     * @param name The file name.
+     * @param data The byte vector containing data to append.
+     * @param sync How to flush the file before returning.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc appendFile(const std::string& name, const std::vector<unsigned char>& data,
+                           FileSync sync = FileSync::Data);
+
+    /**
+     * @brief Writes data to an anonymous file (O_TMPFILE), flushes it as requested and
+     * links it into the directory as name.
+     *
+     * Unless sync is FileSync::None, the name only appears once the content is durable.
+     * A failure at any point leaves no file behind. The directory itself is not synced;
+     * call syncDirectory().
+     *
+     * @param name The file name; must not exist.
+     * @param data The byte vector containing data to write.
+     * @param sync How to flush the file before linking it.
+     * @return SecureStorage::Error::Errc::Success on success.
+     * @return Errc::DataAlreadyExists if name already exists.
+     * @return Errc::OperationFailed if anonymous files are disabled or unsupported by the
+     * filesystem; later calls then fail fast, and callers should use writeFile() instead.
+     * @return Another error code on I/O failure.
+     */
+    Error::Errc linkNewFile(const std::string& name, const std::vector<unsigned char>& data,
+                            FileSync sync = FileSync::Data);
+
+    /**
+     * @brief Enables or disables linkNewFile(). Enabling re-probes filesystem support.
+     * @param enabled Whether linkNewFile() may be used.
+     */
+    void setAnonymousFilesEnabled(bool enabled);
+
+    /**
+     * @brief Checks whether linkNewFile() is enabled and not known to be unsupported.
+     * @return true if linkNewFile() is worth trying.
+     */
+    bool anonymousFilesEnabled() const;
+
+    /**
+     * @brief Checks whether exchangeFiles() is not known to be unsupported.
+     * @return true if exchangeFiles() is worth trying.
+     */
+    bool exchangeEnabled() const;
+
+    /**
+     * @brief Reads the entire content of a file in the directory.
+     * @param name The file name.
+     * @param[out] data Receives the file's content.
+     * @param[out] identity If not null, receives the identity of the file that was read.
+     * @return SecureStorage::Error::Errc::Success on success, Errc::FileOpenFailed if the file
+     * cannot be opened (including when it does not exist), or another error code on failure.
+     */
+    Error::Errc readFile(const std::string& name, std::vector<unsigned char>& data,
+                         FileIdentity* identity = nullptr) const;
+
+    /**
+     * @brief Opens a file in the directory for a reader that takes its descriptor, e.g. to
+     * splice it into the kernel's cipher. Its size is counted as read.
+     * @param name The file name.
+     * @param[out] size Receives the file's size.
+     * @param[out] identity If not null, receives the identity of the opened file.
+     * @return The read-only descriptor, which the caller closes, or -1 if the file cannot
+     * be opened (including when it does not exist) or on Windows.
+     */
+    int openForRead(const std::string& name, size_t& size, FileIdentity* identity = nullptr) const;
+
+    /**
+     * @brief Returns the identity of a file in the directory, with one fstatat().
+     * @param name The file name.
+     * @param[out] identity Receives the identity.
+     * @return SecureStorage::Error::Errc::Success on success, Errc::PathNotFound if the file
+     * does not exist, or Errc::FileReadFailed (also where identities are unsupported).
+     */
+    Error::Errc getFileIdentity(const std::string& name, FileIdentity& identity) const;
+
+    /**
+     * @brief Asks the kernel to start reading the given files into the page cache.
+     * Returns without waiting for the reads; missing files are ignored.
+     * @param names The file names.
+     */
+    void adviseWillNeed(const std::vector<std::string>& names) const;
+
+    /**
+     * @brief Deletes a file in the directory.
+     * @param name The file name.
+     * @return SecureStorage::Error::Errc::Success on success (or if the file didn't exist),
+     * or an error code if deletion fails for an existing file.
+     */
+    Error::Errc deleteFile(const std::string& name);
+
+    /**
+     * @brief Checks if an entry exists in the directory.
+     * @param name The entry name.
+     * @return true if the entry exists, false otherwise.
+     */
+    bool pathExists(const std::string& name) const;
+
+    /**
+     * @brief Renames a file within the directory, replacing the target if it exists.
+     * @param from The current name.
+     * @param to The new name.
+     * @return SecureStorage::Error::Errc::Success on success, or Errc::FileRenameFailed.
+     */
+    Error::Errc renameFile(const std::string& from, const std::string& to);
+
+    /**
+     * @brief Atomically swaps two existing entries of the directory.
+     * @param first First name.
+     * @param second Second name.
+     * @return SecureStorage::Error::Errc::Success on success.
+     * @return Errc::PathNotFound if either entry does not exist.
+     * @return Errc::OperationFailed if the kernel or filesystem does not support the swap;
+     * later calls then fail fast with the same code, and callers should fall back to renames.
+     * @return Errc::FileRenameFailed on any other failure.
+     */
+    Error::Errc exchangeFiles(const std::string& first, const std::string& second);
+
+    /**
+     * @brief Flushes the directory itself, making preceding renames and deletions durable.
+     * @return SecureStorage::Error::Errc::Success on success, or Errc::FileWriteFailed.
+     */
+    Error::Errc syncDirectory();
+
+    /**
+     * @brief Flushes every dirty file and directory of the filesystem holding the directory
+     * (syncfs). One call covers any number of earlier unsynced writes.
+     * Where syncfs is unavailable, all filesystems are flushed with sync().
+     * @return SecureStorage::Error::Errc::Success on success, or Errc::FileWriteFailed.
+     */
+    Error::Errc syncFilesystem();
+
+    /**
+     * @brief Lists all regular files in the directory. Does not recurse.
+     * On Linux the directory is read with getdents64 into a DIRECTORY_SCAN_BUFFER_SIZE
+     * buffer, so large directories are listed in few system calls.
+     * @param[out] files Receives the names of the files found.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc listDirectory(std::vector<std::string>& files) const;
+
+    /**
+     * @brief Returns the system call counters accumulated since construction.
+     * @return A snapshot of the counters.
+     */
+    FileIoStats getIoStats() const;
+
+private:
+    Error::Errc writeAll(int fd, const std::vector<unsigned char>& data, const std::string& name);
+    Error::Errc syncFile(int fd, FileSync sync, const std::string& name);
+    bool isRegularEntry(const char* name, unsigned char type) const;
+    void countSyscall() const { m_syscalls.fetch_add(1, std::memory_order_relaxed); }
+
+    std::string m_directoryPath; ///< Kept for log messages and the fallback path
+    int m_fd;
+    bool m_exchangeSupported;
+    bool m_anonymousFilesSupported;
+    bool m_linkViaProc; ///< linkat(AT_EMPTY_PATH) needs CAP_DAC_READ_SEARCH; fall back to /proc/self/fd
+
+    mutable std::atomic<uint64_t> m_syscalls;
+    mutable std::atomic<uint64_t> m_fsyncs;
+    mutable std::atomic<uint64_t> m_bytesWritten;
+    mutable std::atomic<uint64_t> m_bytesRead;
+};
+
+} // namespace Utils
+} // namespace SecureStorage
+
+#endif // SS_DIR_FILE_UTIL_H
@@ -61,6 +61,10 @@ std::string SecureStorageErrorCategory::message(int condition) const {
             return "Failed to read events from file watcher";
         case Errc::FileTampered:
             return "File watcher detected potential tampering";
+        case Errc::NotReady:
+            return "Initialization is still in progress";
+        case Errc::BufferTooSmall:
+            return "Output buffer is too small";
         default:
             return "Unrecognized error code";
     }
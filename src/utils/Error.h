@@ -47,7 +47,13 @@ enum class Errc {
     // File Watcher Errors
     WatcherStartFailed,
     WatcherReadFailed,
-    FileTampered // Custom error if watcher detects unauthorized modification
+    FileTampered, // Custom error if watcher detects unauthorized modification
+
+    // Lifecycle Errors (appended so existing values stay stable)
+    NotReady,     // Asynchronous initialization has not finished yet
+
+    // Caller Buffer Errors (appended so existing values stay stable)
+    BufferTooSmall // Caller-provided output buffer cannot hold the result
 };
 
 /**
@@ -0,0 +1,103 @@
+#include "FaultInjection.h"
+
+#include <cerrno> // For errno, EIO
+
+namespace SecureStorage {
+namespace Utils {
+
+FaultInjector& FaultInjector::getInstance() {
+    static FaultInjector instance; // Singleton instance
+    return instance;
+}
+
+FaultInjector::FaultInjector()
+    : m_active(false),
+      m_mode(Mode::Off),
+      m_target(0),
+      m_errorNumber(0),
+      m_crashed(false) {
+}
+
+void FaultInjector::reset(Mode mode, uint64_t nth, int errorNumber) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_mode = mode;
+    m_target = nth;
+    m_errorNumber = errorNumber;
+    m_crashed = false;
+    m_stats = FileIoStats();
+    m_trace.clear();
+    m_active.store(mode != Mode::Off, std::memory_order_release);
+}
+
+void FaultInjector::startCounting() {
+    reset(Mode::Count, 0, 0);
+}
+
+void FaultInjector::armFailure(uint64_t nth, int errorNumber) {
+    reset(Mode::Fail, nth, errorNumber);
+}
+
+void FaultInjector::armCrash(uint64_t nth) {
+    reset(Mode::Crash, nth, EIO);
+}
+
+void FaultInjector::disarm() {
+    reset(Mode::Off, 0, 0);
+}
+
+bool FaultInjector::crashed() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_crashed;
+}
+
+FileIoStats FaultInjector::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+std::vector<SyscallKind> FaultInjector::getTrace() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_trace;
+}
+
+bool FaultInjector::intercept(SyscallKind kind, size_t bytes) {
+    if (!m_active.load(std::memory_order_acquire)) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_crashed) {
+        // The process is "dead": nothing it does from here on reaches the disk. Reads,
+        // stats and closes are let through; they do not change what a reboot would see.
+        if (kind == SyscallKind::Read || kind == SyscallKind::Stat || kind == SyscallKind::Close) {
+            return true;
+        }
+        errno = m_errorNumber;
+        return false;
+    }
+
+    uint64_t index = m_stats.syscalls + 1;
+    if (m_mode == Mode::Crash && index == m_target) {
+        m_crashed = true;
+        errno = m_errorNumber;
+        return false;
+    }
+
+    m_stats.syscalls = index;
+    m_trace.push_back(kind);
+    if (kind == SyscallKind::Fsync) {
+        m_stats.fsyncs++;
+    }
+    if (m_mode == Mode::Fail && index == m_target) {
+        errno = m_errorNumber;
+        return false;
+    }
+    if (kind == SyscallKind::Write) {
+        m_stats.bytesWritten += bytes;
+    } else if (kind == SyscallKind::Read) {
+        m_stats.bytesRead += bytes;
+    }
+    return true;
+}
+
+} // namespace Utils
+} // namespace SecureStorage
@@ -0,0 +1,131 @@
+#ifndef SS_FAULT_INJECTION_H
+#define SS_FAULT_INJECTION_H
+
+#include "DirFileUtil.h" // For FileIoStats
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstddef> // For size_t
+#include <cstdint> // For uint64_t
+
+namespace SecureStorage {
+namespace Utils {
+
+/**
+ * @enum SyscallKind
+ * @brief The file system calls that go through the FaultInjector shim.
+ */
+enum class SyscallKind {
+    Open,   ///< open, openat (including O_TMPFILE and directories)
+    Read,
+    Write,
+    Fsync,  ///< fsync, fdatasync, syncfs, sync
+    Close,
+    Rename, ///< rename, renameat, renameat2
+    Unlink,
+    Link,
+    Stat    ///< stat, fstat, fstatat
+};
+
+/**
+ * @class FaultInjector
+ * @brief Process-wide shim in front of the file system calls of FileUtil and DirFileUtil.
+ *
+ * Every file system call the two classes issue first calls intercept(). Unarmed, that is
+ * one relaxed atomic load. Armed, the injector counts the calls and can make one of them
+ * fail, or simulate a crash: the Nth call and every later open, write, sync, rename, link
+ * and unlink fail without touching the disk, so the directory is left exactly as the
+ * process would have left it had it died just before that call. Tests then "reboot" by
+ * disarming and reopening the store on the same directory, and check that recovery
+ * yields the old or the new value.
+ *
+ * The crash model is a process crash, or a power cut on a filesystem that persists
+ * operations in order. It does not reorder or drop writes that were not flushed.
+ *
+ * It also counts calls, fsyncs and bytes written while armed or in counting mode, which
+ * gives a per-operation cost of the commit protocol that covers FileUtil's static calls.
+ */
+class FaultInjector {
+public:
+    /**
+     * @brief Gets the singleton instance.
+     * @return Reference to the FaultInjector.
+     */
+    static FaultInjector& getInstance();
+
+    /**
+     * @brief Starts counting calls from zero, without injecting anything.
+     */
+    void startCounting();
+
+    /**
+     * @brief Makes the nth intercepted call from now fail once with errorNumber.
+     * @param nth 1-based index of the call to fail.
+     * @param errorNumber The errno the failed call reports.
+     */
+    void armFailure(uint64_t nth, int errorNumber);
+
+    /**
+     * @brief Simulates a crash right before the nth intercepted call from now.
+     * That call and every later call except reads, stats and closes fail with EIO.
+     * @param nth 1-based index of the first call that does not happen.
+     */
+    void armCrash(uint64_t nth);
+
+    /**
+     * @brief Stops injecting and counting.
+     */
+    void disarm();
+
+    /**
+     * @brief Checks whether an armed crash has been reached.
+     * @return true if calls are being suppressed.
+     */
+    bool crashed() const;
+
+    /**
+     * @brief Returns the counters since the last startCounting()/armFailure()/armCrash().
+     * Calls suppressed by a crash are not counted.
+     * @return A snapshot of the counters.
+     */
+    FileIoStats getStats() const;
+
+    /**
+     * @brief Returns the kinds of the calls counted so far, in order.
+     * @return The call trace.
+     */
+    std::vector<SyscallKind> getTrace() const;
+
+    /**
+     * @brief Called by the shim before each file system call.
+     * @param kind The kind of call about to be made.
+     * @param bytes Payload size for reads and writes, otherwise 0.
+     * @return true if the call may proceed; false if it must fail, in which case errno is set.
+     */
+    bool intercept(SyscallKind kind, size_t bytes = 0);
+
+private:
+    FaultInjector();
+    ~FaultInjector() = default;
+    FaultInjector(const FaultInjector&) = delete;
+    FaultInjector& operator=(const FaultInjector&) = delete;
+
+    enum class Mode { Off, Count, Fail, Crash };
+
+    void reset(Mode mode, uint64_t nth, int errorNumber);
+
+    std::atomic<bool> m_active; ///< Fast-path check; false when Mode::Off
+    mutable std::mutex m_mutex; ///< Protects everything below
+    Mode m_mode;
+    uint64_t m_target;
+    int m_errorNumber;
+    bool m_crashed;
+    FileIoStats m_stats;
+    std::vector<SyscallKind> m_trace;
+};
+
+} // namespace Utils
+} // namespace SecureStorage
+
+#endif // SS_FAULT_INJECTION_H
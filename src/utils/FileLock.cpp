@@ -0,0 +1,173 @@
+#include "FileLock.h"
+#include "Logger.h" // For SS_LOG_ macros
+
+#include <cerrno>   // For errno
+#include <cstring>  // For strerror, memset
+#include <algorithm> // For std::find
+#ifndef _WIN32
+#include <fcntl.h>  // For open, fcntl, struct flock
+#include <unistd.h> // For close
+#endif
+
+namespace SecureStorage {
+namespace Utils {
+
+FileLock::FileLock(std::string lockFilePath)
+    : m_lockFilePath(std::move(lockFilePath)),
+      m_fd(-1),
+#ifdef F_OFD_SETLK
+      m_useOfdLocks(true) {
+#else
+      m_useOfdLocks(false) {
+#endif
+#ifndef _WIN32
+    m_fd = open(m_lockFilePath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (m_fd < 0) {
+        SS_LOG_ERROR("FileLock: Failed to open lock file '" << m_lockFilePath << "': " << strerror(errno));
+        return;
+    }
+    // Reserved so that claiming a slot does not allocate while few threads hold locks.
+    m_heldSlots.reserve(32);
+    SS_LOG_DEBUG("FileLock: Opened lock file '" << m_lockFilePath << "'.");
+#else
+    SS_LOG_WARN("FileLock: Cross-process locking is not supported on this platform.");
+#endif
+}
+
+FileLock::~FileLock() {
+#ifndef _WIN32
+    if (m_fd >= 0) {
+        close(m_fd); // Releases every lock held through this descriptor
+    }
+#endif
+}
+
+bool FileLock::isOpen() const {
+    return m_fd >= 0;
+}
+
+int FileLock::setLock(uint64_t slot, short type, bool wait) {
+#ifndef _WIN32
+    struct flock fl;
+    std::memset(&fl, 0, sizeof(fl));
+    fl.l_type = type;
+    fl.l_whence = SEEK_SET;
+    fl.l_start = static_cast<off_t>(slot);
+    fl.l_len = 1;
+    // l_pid must be 0 for OFD locks
+
+#ifdef F_OFD_SETLK
+    if (m_useOfdLocks) {
+        int ret;
+        do {
+            ret = fcntl(m_fd, wait ? F_OFD_SETLKW : F_OFD_SETLK, &fl);
+        } while (ret != 0 && wait && errno == EINTR);
+        if (ret == 0 || errno != EINVAL) {
+            return ret == 0 ? 0 : errno;
+        }
+        if (m_useOfdLocks.exchange(false)) {
+            SS_LOG_WARN("FileLock: OFD locks not supported by kernel, falling back to process-associated locks.");
+        }
+    }
+#endif
+    int ret;
+    do {
+        ret = fcntl(m_fd, wait ? F_SETLKW : F_SETLK, &fl);
+    } while (ret != 0 && wait && errno == EINTR);
+    return ret == 0 ? 0 : errno;
+#else
+    (void)slot; (void)type; (void)wait;
+    return 0;
+#endif
+}
+
+bool FileLock::claimSlot(uint64_t slot, bool wait) {
+    std::unique_lock<std::mutex> lock(m_slotMutex);
+    auto held = [this, slot]() { return std::find(m_heldSlots.begin(), m_heldSlots.end(), slot) != m_heldSlots.end(); };
+    if (held()) {
+        if (!wait) {
+            return false;
+        }
+        m_slotReleased.wait(lock, [&held]() { return !held(); });
+    }
+    m_heldSlots.push_back(slot);
+    return true;
+}
+
+void FileLock::releaseSlot(uint64_t slot) {
+    {
+        std::lock_guard<std::mutex> lock(m_slotMutex);
+        auto it = std::find(m_heldSlots.begin(), m_heldSlots.end(), slot);
+        if (it != m_heldSlots.end()) {
+            *it = m_heldSlots.back();
+            m_heldSlots.pop_back();
+        }
+    }
+    m_slotReleased.notify_all();
+}
+
+Error::Errc FileLock::lock(uint64_t slot) {
+    if (!isOpen()) {
+        return Error::Errc::NotInitialized;
+    }
+    claimSlot(slot, true);
+#ifndef _WIN32
+    int err = setLock(slot, F_WRLCK, true);
+    if (err != 0) {
+        releaseSlot(slot);
+        SS_LOG_ERROR("FileLock: Failed to lock slot " << slot << " of '" << m_lockFilePath << "': " << strerror(err));
+        return Error::Errc::OperationFailed;
+    }
+#endif
+    return Error::Errc::Success;
+}
+
+bool FileLock::tryLock(uint64_t slot) {
+    if (!isOpen()) {
+        return false;
+    }
+    if (!claimSlot(slot, false)) {
+        return false; // Held by another thread of this process
+    }
+#ifndef _WIN32
+    int err = setLock(slot, F_WRLCK, false);
+    if (err != 0) {
+        releaseSlot(slot);
+        if (err != EAGAIN && err != EACCES) {
+            SS_LOG_WARN("FileLock: tryLock on slot " << slot << " failed: " << strerror(err));
+        }
+        return false;
+    }
+#endif
+    return true;
+}
+
+void FileLock::unlock(uint64_t slot) {
+    if (!isOpen()) {
+        return;
+    }
+#ifndef _WIN32
+    // The file lock goes first: once the slot is released here, another thread may take it.
+    int err = setLock(slot, F_UNLCK, false);
+    if (err != 0) {
+        SS_LOG_WARN("FileLock: Failed to unlock slot " << slot << ": " << strerror(err));
+    }
+#endif
+    releaseSlot(slot);
+}
+
+uint64_t FileLock::hashKey(const std::string& key) {
+    uint64_t hash = 14695981039346656037ULL; // FNV-1a 64-bit offset basis
+    for (unsigned char c : key) {
+        hash ^= c;
+        hash *= 1099511628211ULL; // FNV-1a 64-bit prime
+    }
+    return hash;
+}
+
+uint64_t FileLock::slotForKey(const std::string& key, uint64_t slotCount) {
+    return slotCount == 0 ? 0 : hashKey(key) % slotCount;
+}
+
+} // namespace Utils
+} // namespace SecureStorage
@@ -0,0 +1,118 @@
+#ifndef SS_FILE_LOCK_H
+#define SS_FILE_LOCK_H
+
+#include "Error.h"
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint> // For uint64_t
+
+namespace SecureStorage {
+namespace Utils {
+
+/**
+ * @class FileLock
+ * @brief Cross-process byte-range locks on a shared lock file.
+ *
+ * Each byte of the lock file acts as an independent lock slot, so callers can shard
+ * a key space over many slots and let unrelated keys proceed in parallel.
+ *
+ * On Linux, open file description (OFD) locks (`F_OFD_SETLK`/`F_OFD_SETLKW`) are used.
+ * They are owned by this object's file descriptor rather than by the process, so two
+ * FileLock instances in the same process exclude each other exactly like two processes
+ * do. On kernels without OFD support, classic POSIX record locks are used instead; those
+ * only exclude other processes.
+ *
+ * Locks taken through one descriptor do not conflict with each other, so each instance
+ * also keeps a table of the slots its threads hold: a thread first claims the slot in
+ * that table (waiting for another thread of this instance to release it), then takes
+ * the file lock. Threads sharing one FileLock therefore exclude each other as well, and
+ * one thread's unlock() never drops a lock another thread still relies on.
+ */
+class FileLock {
+public:
+    /**
+     * @brief Opens (creating if needed) the lock file.
+     * @param lockFilePath Path of the lock file. Its content is never read or written.
+     */
+    explicit FileLock(std::string lockFilePath);
+    ~FileLock();
+
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+    FileLock(FileLock&&) = delete;
+    FileLock& operator=(FileLock&&) = delete;
+
+    /**
+     * @brief Checks whether the lock file was opened successfully.
+     * @return true if locks can be taken, false otherwise.
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Acquires an exclusive lock on one slot, blocking until it is available.
+     * @param slot Byte offset in the lock file.
+     * @return SecureStorage::Error::Errc::Success on success, or an error code on failure.
+     */
+    Error::Errc lock(uint64_t slot);
+
+    /**
+     * @brief Attempts to acquire an exclusive lock on one slot without blocking.
+     * @param slot Byte offset in the lock file.
+     * @return true if the lock was acquired, false if it is held elsewhere or an error occurred.
+     */
+    bool tryLock(uint64_t slot);
+
+    /**
+     * @brief Releases a slot previously acquired with lock() or tryLock().
+     * @param slot Byte offset in the lock file.
+     */
+    void unlock(uint64_t slot);
+
+    /**
+     * @brief Maps a key to one of slotCount slots using a hash that is stable across
+     * processes and builds (FNV-1a), so independent processes agree on the slot.
+     * @param key The key to map.
+     * @param slotCount Number of slots; must be non-zero.
+     * @return The slot index in [0, slotCount).
+     */
+    static uint64_t slotForKey(const std::string& key, uint64_t slotCount);
+
+    /**
+     * @brief Hashes a key with 64-bit FNV-1a, which is stable across processes and builds.
+     * @param key The key to hash.
+     * @return The 64-bit hash.
+     */
+    static uint64_t hashKey(const std::string& key);
+
+private:
+    int setLock(uint64_t slot, short type, bool wait);
+
+    /**
+     * @brief Claims a slot for the calling thread in the in-process table.
+     * @param slot The slot.
+     * @param wait Whether to wait for another thread to release it.
+     * @return true if claimed, false if held by another thread and wait is false.
+     */
+    bool claimSlot(uint64_t slot, bool wait);
+
+    /**
+     * @brief Releases a slot claimed with claimSlot() and wakes waiting threads.
+     * @param slot The slot.
+     */
+    void releaseSlot(uint64_t slot);
+
+    std::string m_lockFilePath;
+    int m_fd;
+    std::atomic<bool> m_useOfdLocks;
+    std::mutex m_slotMutex;                 ///< Protects m_heldSlots
+    std::condition_variable m_slotReleased; ///< Signaled whenever a slot leaves m_heldSlots
+    std::vector<uint64_t> m_heldSlots;      ///< Slots held by threads of this process through this instance
+};
+
+} // namespace Utils
+} // namespace SecureStorage
+
+#endif // SS_FILE_LOCK_H
@@ -1,5 +1,6 @@
 #include "FileUtil.h"
 #include "Logger.h" // For SS_LOG_ macros
+#include "SyscallShim.h" // File system calls of atomicWriteFile/deleteFile, routed through FaultInjector
 
 #include <cstdio>   // For std::remove, std::rename
 #include <sys/stat.h> // For mkdir, stat
@@ -74,7 +75,7 @@ Error::Errc FileUtil::atomicWriteFile(const std::string& filepath, const std::ve
             if (!ofs.good()) { 
                 SS_LOG_ERROR("Failed to write data to temporary file (Windows fallback): " << tempFilepath << " - " << strerror(errno));
                 ofs.close();
-                std::remove(tempFilepath.c_str());
+                Shim::remove(tempFilepath.c_str());
                 return Error::Errc::FileWriteFailed;
             }
         }
@@ -82,45 +83,45 @@ Error::Errc FileUtil::atomicWriteFile(const std::string& filepath, const std::ve
         ofs.close();
         if (ofs.fail() && !ofs.eof()) { 
              SS_LOG_ERROR("Error during close after writing temporary file (Windows fallback): " << tempFilepath << " - " << strerror(errno));
-             std::remove(tempFilepath.c_str());
+             Shim::remove(tempFilepath.c_str());
              return Error::Errc::FileWriteFailed;
         }
     }
 #else // POSIX
-    fd = open(tempFilepath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH); // Permissions 0644
+    fd = Shim::open(tempFilepath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH); // Permissions 0644
     if (fd < 0) {
         SS_LOG_ERROR("Failed to open temporary file '" << tempFilepath << "' for writing: " << strerror(errno));
         return Error::Errc::FileOpenFailed;
     }
 
     if (!data.empty()) {
-        ssize_t bytes_written = write(fd, data.data(), data.size());
+        ssize_t bytes_written = Shim::write(fd, data.data(), data.size());
         if (bytes_written < 0 || static_cast<size_t>(bytes_written) != data.size()) {
             SS_LOG_ERROR("Failed to write data to temporary file '" << tempFilepath << "': " << strerror(errno));
-            close(fd);
-            std::remove(tempFilepath.c_str());
+            Shim::close(fd);
+            Shim::remove(tempFilepath.c_str());
             return Error::Errc::FileWriteFailed;
         }
     }
 
-    if (fsync(fd) != 0) {
+    if (Shim::fsync(fd) != 0) {
         SS_LOG_ERROR("Failed to fsync temporary file '" << tempFilepath << "': " << strerror(errno));
-        close(fd);
-        std::remove(tempFilepath.c_str());
+        Shim::close(fd);
+        Shim::remove(tempFilepath.c_str());
         return Error::Errc::FileWriteFailed; 
     }
 
-    if (close(fd) != 0) {
+    if (Shim::close(fd) != 0) {
         SS_LOG_ERROR("Failed to close temporary file '" << tempFilepath << "' after fsync: " << strerror(errno));
-        std::remove(tempFilepath.c_str());
+        Shim::remove(tempFilepath.c_str());
         return Error::Errc::FileWriteFailed; 
     }
 #endif
     SS_LOG_DEBUG("Successfully wrote and synced data to temporary file: " << tempFilepath);
 
-    if (std::rename(tempFilepath.c_str(), filepath.c_str()) != 0) {
+    if (Shim::rename(tempFilepath.c_str(), filepath.c_str()) != 0) {
         SS_LOG_ERROR("Failed to rename temporary file '" << tempFilepath << "' to '" << filepath << "' - " << strerror(errno));
-        std::remove(tempFilepath.c_str()); 
+        Shim::remove(tempFilepath.c_str()); 
         return Error::Errc::FileRenameFailed;
     }
     SS_LOG_DEBUG("Successfully renamed temp file to: " << filepath);
@@ -131,16 +132,16 @@ Error::Errc FileUtil::atomicWriteFile(const std::string& filepath, const std::ve
         dirToSync = ".";
     }
     
-    int dir_fd = open(dirToSync.c_str(), O_RDONLY | O_DIRECTORY);
+    int dir_fd = Shim::open(dirToSync.c_str(), O_RDONLY | O_DIRECTORY);
     if (dir_fd < 0) {
         SS_LOG_WARN("Failed to open directory '" << dirToSync << "' for fsync: " << strerror(errno) 
                     << ". Rename operation might not be fully persistent on power loss.");
     } else {
-        if (fsync(dir_fd) != 0) {
+        if (Shim::fsync(dir_fd) != 0) {
             SS_LOG_WARN("Failed to fsync directory '" << dirToSync << "': " << strerror(errno)
                         << ". Rename operation might not be fully persistent on power loss.");
         }
-        close(dir_fd);
+        Shim::close(dir_fd);
         SS_LOG_DEBUG("Successfully fsynced directory: " << dirToSync);
     }
 #else
@@ -202,7 +203,7 @@ Error::Errc FileUtil::deleteFile(const std::string& filepath) {
         return Error::Errc::Success; 
     }
 
-    if (std::remove(filepath.c_str()) != 0) {
+    if (Shim::remove(filepath.c_str()) != 0) {
         SS_LOG_ERROR("Failed to delete file: " << filepath << " - " << strerror(errno));
         return Error::Errc::FileRemoveFailed;
     }
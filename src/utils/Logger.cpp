@@ -25,6 +25,14 @@ void Logger::setLogLevel(LogLevel level) {
     m_currentLevel = level;
 }
 
+LogLevel Logger::getLogLevel() const {
+    return m_currentLevel.load(std::memory_order_relaxed);
+}
+
+bool Logger::isEnabled(LogLevel level) const {
+    return level >= m_currentLevel.load(std::memory_order_relaxed);
+}
+
 std::string Logger::logLevelToString(LogLevel level) {
     switch (level) {
         case LogLevel::DEBUG:   return "DEBUG";
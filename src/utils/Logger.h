@@ -5,6 +5,7 @@
 #include <string>
 #include <sstream>
 #include <mutex>
+#include <atomic>
 #include <chrono>
 #include <iomanip> // For std::put_time
 
@@ -57,6 +58,20 @@ public:
      */
     void setLogLevel(LogLevel level);
 
+    /**
+     * @brief Gets the minimum log level currently output.
+     * @return The current LogLevel.
+     */
+    LogLevel getLogLevel() const;
+
+    /**
+     * @brief Checks whether messages of a level are output, without taking the mutex.
+     * The SS_LOG_* macros only format their message if this returns true.
+     * @param level The severity level to check.
+     * @return true if messages of this level are currently output.
+     */
+    bool isEnabled(LogLevel level) const;
+
 private:
     Logger(); // Private constructor for singleton
     ~Logger() = default;
@@ -68,17 +83,20 @@ private:
     static std::string logLevelToString(LogLevel level);
     static std::string getCurrentTimestamp();
 
-    std::mutex m_mutex;      ///< Mutex to protect concurrent access to std::cout
-    LogLevel m_currentLevel; ///< Current minimum log level to output
+    std::mutex m_mutex;                   ///< Mutex to protect concurrent access to std::cout
+    std::atomic<LogLevel> m_currentLevel; ///< Current minimum log level to output
 };
 
 // Convenience macros for logging
 // SS_LOG_X(message_stream)
+// Filtered-out messages are never formatted, so they cost no allocation.
 #define SS_LOG(level, message) \
     do { \
-        std::ostringstream oss; \
-        oss << message; \
-        SecureStorage::Utils::Logger::getInstance().log(level, oss.str(), __FILE__, __LINE__); \
+        if (SecureStorage::Utils::Logger::getInstance().isEnabled(level)) { \
+            std::ostringstream oss; \
+            oss << message; \
+            SecureStorage::Utils::Logger::getInstance().log(level, oss.str(), __FILE__, __LINE__); \
+        } \
     } while (false)
 
 #define SS_LOG_DEBUG(message) SS_LOG(SecureStorage::Utils::LogLevel::DEBUG, message)
@@ -0,0 +1,68 @@
+#include "ScratchPool.h"
+#include "SecureWipe.h"
+#include <utility> // For std::move
+
+namespace SecureStorage {
+namespace Utils {
+
+namespace {
+
+struct ThreadPool {
+    ThreadPool() {
+        // Reserved up front, so returning a lease never allocates.
+        buffers.reserve(SCRATCH_POOL_SLOTS);
+        names.reserve(SCRATCH_POOL_SLOTS);
+    }
+
+    std::vector<std::vector<unsigned char>> buffers;
+    std::vector<std::string> names;
+};
+
+ThreadPool& threadPool() {
+    thread_local ThreadPool pool;
+    return pool;
+}
+
+} // namespace
+
+ScratchBuffer::ScratchBuffer() {
+    ThreadPool& pool = threadPool();
+    if (!pool.buffers.empty()) {
+        m_buffer = std::move(pool.buffers.back());
+        pool.buffers.pop_back();
+    }
+}
+
+ScratchBuffer::~ScratchBuffer() {
+    if (m_buffer.capacity() == 0) {
+        return;
+    }
+    // Bytes past the current size may still hold data from a larger use.
+    m_buffer.resize(m_buffer.capacity());
+    secureWipe(m_buffer);
+    ThreadPool& pool = threadPool();
+    if (m_buffer.capacity() <= SCRATCH_BUFFER_MAX_RETAINED_BYTES && pool.buffers.size() < SCRATCH_POOL_SLOTS) {
+        pool.buffers.push_back(std::move(m_buffer));
+    }
+}
+
+ScratchName::ScratchName() {
+    ThreadPool& pool = threadPool();
+    if (!pool.names.empty()) {
+        m_name = std::move(pool.names.back());
+        pool.names.pop_back();
+    } else {
+        m_name.reserve(SCRATCH_NAME_CAPACITY);
+    }
+}
+
+ScratchName::~ScratchName() {
+    ThreadPool& pool = threadPool();
+    if (pool.names.size() < SCRATCH_POOL_SLOTS) {
+        m_name.clear();
+        pool.names.push_back(std::move(m_name));
+    }
+}
+
+} // namespace Utils
+} // namespace SecureStorage
@@ -0,0 +1,91 @@
+#ifndef SS_SCRATCH_POOL_H
+#define SS_SCRATCH_POOL_H
+
+#include <vector>
+#include <string>
+#include <cstddef> // For size_t
+
+namespace SecureStorage {
+namespace Utils {
+
+// Buffers each thread keeps for reuse, and likewise names.
+constexpr size_t SCRATCH_POOL_SLOTS = 8;
+// Released buffers with a larger capacity are freed instead of kept, so one large record
+// does not pin its size on every thread that ever touched it.
+constexpr size_t SCRATCH_BUFFER_MAX_RETAINED_BYTES = 1024 * 1024;
+// Capacity reserved for a pooled name (NAME_MAX plus the terminator).
+constexpr size_t SCRATCH_NAME_CAPACITY = 256;
+
+/**
+ * @class ScratchBuffer
+ * @brief A byte buffer leased from a per-thread pool for the duration of a scope.
+ *
+ * The buffer keeps the capacity it had when it was last released, so once a thread has
+ * handled a record of a given size, later records of that size cost no allocation. On
+ * release the whole capacity is zeroized (it may have held plaintext or a key-derived
+ * value beyond its current size) before the buffer goes back to the pool.
+ *
+ * A lease must be released on the thread that took it; scope-bound use ensures this.
+ */
+class ScratchBuffer {
+public:
+    /**
+     * @brief Takes a buffer from this thread's pool, or starts an empty one.
+     * The buffer is always empty; its capacity is whatever it had last.
+     */
+    ScratchBuffer();
+
+    /**
+     * @brief Zeroizes the buffer and returns it to this thread's pool.
+     */
+    ~ScratchBuffer();
+
+    /**
+     * @brief Gives access to the leased buffer.
+     * @return The buffer; it may be resized freely while leased.
+     */
+    std::vector<unsigned char>& get() { return m_buffer; }
+
+private:
+    ScratchBuffer(const ScratchBuffer&) = delete;
+    ScratchBuffer& operator=(const ScratchBuffer&) = delete;
+
+    std::vector<unsigned char> m_buffer;
+};
+
+/**
+ * @class ScratchName
+ * @brief A string for building file names, leased from a per-thread pool.
+ *
+ * Pooled names are reserved with SCRATCH_NAME_CAPACITY bytes, so any name the file system
+ * accepts is built without an allocation. Names are not secret and are only cleared on release.
+ */
+class ScratchName {
+public:
+    /**
+     * @brief Takes a name from this thread's pool, or reserves a new one.
+     */
+    ScratchName();
+
+    /**
+     * @brief Returns the name to this thread's pool.
+     */
+    ~ScratchName();
+
+    /**
+     * @brief Gives access to the leased name.
+     * @return The name; always empty when leased.
+     */
+    std::string& get() { return m_name; }
+
+private:
+    ScratchName(const ScratchName&) = delete;
+    ScratchName& operator=(const ScratchName&) = delete;
+
+    std::string m_name;
+};
+
+} // namespace Utils
+} // namespace SecureStorage
+
+#endif // SS_SCRATCH_POOL_H
@@ -0,0 +1,146 @@
+#include "SecureArena.h"
+#include "Logger.h" // For SS_LOG_ macros
+
+#include <cerrno>   // For errno
+#include <cstring>  // For strerror
+
+#ifndef _WIN32
+#include <sys/mman.h> // For mmap, mprotect, mlock, madvise
+#include <unistd.h>   // For sysconf
+#endif
+
+namespace SecureStorage {
+namespace Utils {
+
+namespace {
+
+// Index of the smallest size class that holds size bytes; size must not exceed SECURE_ARENA_MAX_BLOCK.
+size_t sizeClassFor(size_t size) {
+    size_t index = 0;
+    size_t block = SECURE_ARENA_MIN_BLOCK;
+    while (block < size) {
+        block <<= 1;
+        ++index;
+    }
+    return index;
+}
+
+size_t classBlockSize(size_t index) {
+    return SECURE_ARENA_MIN_BLOCK << index;
+}
+
+} // namespace
+
+SecureArena& SecureArena::instance() {
+    // Intentionally never destroyed: containers with static storage may free their
+    // blocks after a function-local static arena would already be gone.
+    static SecureArena* arena = new SecureArena(SECURE_ARENA_DEFAULT_BYTES);
+    return *arena;
+}
+
+SecureArena::SecureArena(size_t capacity)
+    : m_region(nullptr), m_capacity(0), m_used(0), m_locked(false), m_freeLists() {
+#ifndef _WIN32
+    const long page_size = sysconf(_SC_PAGESIZE);
+    const size_t page = page_size > 0 ? static_cast<size_t>(page_size) : 4096;
+    capacity = (capacity + page - 1) / page * page;
+
+    // [guard page][region][guard page]; the guard pages stay PROT_NONE, so running off
+    // either end of a block at the edge of the region faults instead of reading the heap.
+    void* mapping = mmap(nullptr, capacity + 2 * page, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        SS_LOG_ERROR("SecureArena: Failed to map " << capacity << " bytes: " << strerror(errno)
+                     << ". Sensitive buffers will use the heap.");
+        return;
+    }
+    unsigned char* region = static_cast<unsigned char*>(mapping) + page;
+    if (mprotect(region, capacity, PROT_READ | PROT_WRITE) != 0) {
+        SS_LOG_ERROR("SecureArena: Failed to make the region writable: " << strerror(errno)
+                     << ". Sensitive buffers will use the heap.");
+        munmap(mapping, capacity + 2 * page);
+        return;
+    }
+#ifdef MADV_DONTDUMP
+    madvise(region, capacity, MADV_DONTDUMP); // Keep keys out of core dumps; best effort
+#endif
+    if (mlock(region, capacity) == 0) {
+        m_locked = true;
+    } else {
+        SS_LOG_WARN("SecureArena: Failed to lock " << capacity << " bytes in RAM: " << strerror(errno)
+                    << ". Sensitive buffers may be swapped out (check RLIMIT_MEMLOCK).");
+    }
+    m_region = region;
+    m_capacity = capacity;
+#else
+    (void)capacity;
+#endif
+    m_stats.capacity = m_capacity;
+    m_stats.locked = m_locked;
+}
+
+bool SecureArena::owns(const void* block) const {
+    const unsigned char* p = static_cast<const unsigned char*>(block);
+    return m_region != nullptr && p >= m_region && p < m_region + m_capacity;
+}
+
+void* SecureArena::allocate(size_t size) {
+    if (size == 0) {
+        size = 1;
+    }
+    if (size <= SECURE_ARENA_MAX_BLOCK) {
+        const size_t index = sizeClassFor(size);
+        const size_t block_size = classBlockSize(index);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        void* block = nullptr;
+        if (m_freeLists[index] != nullptr) {
+            FreeBlock* head = m_freeLists[index];
+            m_freeLists[index] = head->next;
+            head->next = nullptr; // Blocks are handed out zeroized
+            block = head;
+        } else if (m_region != nullptr && m_capacity - m_used >= block_size) {
+            block = m_region + m_used;
+            m_used += block_size;
+        }
+        if (block != nullptr) {
+            m_stats.bytesInUse += block_size;
+            ++m_stats.allocations;
+            return block;
+        }
+        ++m_stats.heapFallbacks;
+    } else {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.heapFallbacks;
+    }
+    return ::operator new(size);
+}
+
+void SecureArena::deallocate(void* block, size_t size) noexcept {
+    if (block == nullptr) {
+        return;
+    }
+    if (size == 0) {
+        size = 1;
+    }
+    if (!owns(block)) {
+        secureWipe(static_cast<unsigned char*>(block), size);
+        ::operator delete(block);
+        return;
+    }
+    const size_t index = sizeClassFor(size);
+    const size_t block_size = classBlockSize(index);
+    // The whole block, not just size bytes: the allocator may hand it out for any size of its class.
+    secureWipe(static_cast<unsigned char*>(block), block_size);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    FreeBlock* freed = static_cast<FreeBlock*>(block);
+    freed->next = m_freeLists[index];
+    m_freeLists[index] = freed;
+    m_stats.bytesInUse -= block_size;
+}
+
+SecureArenaStats SecureArena::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+} // namespace Utils
+} // namespace SecureStorage
@@ -0,0 +1,153 @@
+#ifndef SS_SECURE_ARENA_H
+#define SS_SECURE_ARENA_H
+
+#include "SecureWipe.h"
+#include <vector>
+#include <mutex>
+#include <new>     // For std::bad_alloc
+#include <cstddef> // For size_t
+#include <cstdint> // For uint64_t
+
+namespace SecureStorage {
+namespace Utils {
+
+// Bytes of locked memory the arena reserves on first use.
+constexpr size_t SECURE_ARENA_DEFAULT_BYTES = 1024 * 1024;
+// Smallest and largest size class; larger requests are served from the heap.
+constexpr size_t SECURE_ARENA_MIN_BLOCK = 16;
+constexpr size_t SECURE_ARENA_MAX_BLOCK = 64 * 1024;
+// Size classes are the powers of two from SECURE_ARENA_MIN_BLOCK to SECURE_ARENA_MAX_BLOCK.
+constexpr size_t SECURE_ARENA_CLASS_COUNT = 13;
+
+/**
+ * @struct SecureArenaStats
+ * @brief Usage of the secure arena.
+ */
+struct SecureArenaStats {
+    size_t capacity = 0;              ///< Bytes of the region (0 if it could not be mapped)
+    bool locked = false;              ///< Whether the region is locked in RAM (mlock)
+    size_t bytesInUse = 0;            ///< Bytes of allocated blocks, rounded up to their size class
+    uint64_t allocations = 0;         ///< Allocations served from the region
+    uint64_t heapFallbacks = 0;       ///< Allocations that were too large or found the region full
+};
+
+/**
+ * @class SecureArena
+ * @brief A process-wide allocator for keys and plaintext, backed by one locked region.
+ *
+ * The region is mapped once, with an inaccessible guard page on either side, locked into
+ * RAM with mlock() and excluded from core dumps where supported. Locking per allocation
+ * would cost two system calls each; here an allocation only takes a block from the free
+ * list of its size class (or carves a new one off the region), so it costs about as much
+ * as malloc. Freed blocks are zeroized before they are reused.
+ *
+ * Requests larger than SECURE_ARENA_MAX_BLOCK, or made once the region is used up, fall
+ * back to the heap. Those blocks are still zeroized when freed, but are not locked; see
+ * getStats().heapFallbacks. If mlock() fails (e.g. RLIMIT_MEMLOCK is too low), the region
+ * is used unlocked and a warning is logged once.
+ *
+ * The arena lives until the process exits and is never unmapped, so blocks may be freed
+ * from static destructors.
+ */
+class SecureArena {
+public:
+    /**
+     * @brief Gets the process-wide arena, mapping its region on first use.
+     * @return Reference to the arena.
+     */
+    static SecureArena& instance();
+
+    /**
+     * @brief Allocates a block of at least size bytes, aligned for any scalar type.
+     * @param size Number of bytes needed.
+     * @return Pointer to the block (never null; throws std::bad_alloc like operator new).
+     */
+    void* allocate(size_t size);
+
+    /**
+     * @brief Zeroizes and frees a block returned by allocate().
+     * @param block Pointer to the block (may be null).
+     * @param size The size passed to allocate().
+     */
+    void deallocate(void* block, size_t size) noexcept;
+
+    /**
+     * @brief Returns the current usage of the arena.
+     * @return A snapshot of the statistics.
+     */
+    SecureArenaStats getStats() const;
+
+private:
+    explicit SecureArena(size_t capacity);
+    ~SecureArena() = default; // Never called, see instance()
+    SecureArena(const SecureArena&) = delete;
+    SecureArena& operator=(const SecureArena&) = delete;
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    bool owns(const void* block) const;
+
+    unsigned char* m_region;  ///< Start of the usable region, after the leading guard page
+    size_t m_capacity;        ///< Usable bytes of the region
+    size_t m_used;            ///< Bytes carved off the region so far
+    bool m_locked;
+    FreeBlock* m_freeLists[SECURE_ARENA_CLASS_COUNT];
+    mutable std::mutex m_mutex;
+    SecureArenaStats m_stats;
+};
+
+/**
+ * @class SecureAllocator
+ * @brief An STL allocator that takes its memory from the SecureArena.
+ *
+ * All instances are interchangeable, so containers using it can be swapped and moved freely.
+ */
+template <typename T>
+class SecureAllocator {
+public:
+    typedef T value_type;
+
+    SecureAllocator() noexcept {}
+    template <typename U>
+    SecureAllocator(const SecureAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        if (n > static_cast<size_t>(-1) / sizeof(T)) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(SecureArena::instance().allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        SecureArena::instance().deallocate(p, n * sizeof(T));
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const SecureAllocator<T>&, const SecureAllocator<U>&) noexcept {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const SecureAllocator<T>&, const SecureAllocator<U>&) noexcept {
+    return false;
+}
+
+/// A byte buffer for keys and plaintext, held in locked memory and zeroized when freed.
+typedef std::vector<unsigned char, SecureAllocator<unsigned char>> SecureBytes;
+
+/**
+ * @brief Overwrites a secure buffer with zeros, then empties it (keeping its block).
+ * @param buffer The buffer to wipe.
+ */
+inline void secureWipe(SecureBytes& buffer) {
+    secureWipe(buffer.data(), buffer.size());
+    buffer.clear();
+}
+
+} // namespace Utils
+} // namespace SecureStorage
+
+#endif // SS_SECURE_ARENA_H
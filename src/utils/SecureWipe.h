@@ -0,0 +1,35 @@
+#ifndef SS_SECURE_WIPE_H
+#define SS_SECURE_WIPE_H
+
+#include <vector>
+#include <cstddef> // For size_t
+
+namespace SecureStorage {
+namespace Utils {
+
+/**
+ * @brief Overwrites caller memory holding plaintext or key material with zeros.
+ * The stores go through a volatile pointer so the compiler cannot drop them as dead.
+ * @param data Pointer to the bytes to wipe (may be null if size is 0).
+ * @param size Number of bytes at data.
+ */
+inline void secureWipe(unsigned char* data, size_t size) {
+    volatile unsigned char* p = data;
+    for (size_t i = 0; i < size; ++i) {
+        p[i] = 0;
+    }
+}
+
+/**
+ * @brief Overwrites a buffer holding plaintext or key material with zeros, then empties it.
+ * @param buffer The buffer to wipe.
+ */
+inline void secureWipe(std::vector<unsigned char>& buffer) {
+    secureWipe(buffer.data(), buffer.size());
+    buffer.clear();
+}
+
+} // namespace Utils
+} // namespace SecureStorage
+
+#endif // SS_SECURE_WIPE_H
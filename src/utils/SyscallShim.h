@@ -0,0 +1,143 @@
+#ifndef SS_SYSCALL_SHIM_H
+#define SS_SYSCALL_SHIM_H
+
+// Internal to ss_utils: the file system calls of FileUtil and DirFileUtil, routed through
+// FaultInjector so tests can count them and make them fail. Not installed.
+
+#include "FaultInjection.h"
+
+#include <cerrno>        // For errno
+#include <cstdio>        // For std::rename, std::remove
+#ifndef _WIN32
+#include <fcntl.h>       // For open, openat, posix_fadvise
+#include <unistd.h>      // For read, write, fsync, fdatasync, syncfs, close, unlinkat, linkat
+#include <sys/stat.h>    // For stat, fstat, fstatat
+#include <sys/syscall.h> // For SYS_renameat2
+#endif
+
+namespace SecureStorage {
+namespace Utils {
+namespace Shim {
+
+inline bool enter(SyscallKind kind, size_t bytes = 0) {
+    return FaultInjector::getInstance().intercept(kind, bytes);
+}
+
+inline int rename(const char* from, const char* to) {
+    return enter(SyscallKind::Rename) ? std::rename(from, to) : -1;
+}
+
+inline int remove(const char* path) {
+    return enter(SyscallKind::Unlink) ? std::remove(path) : -1;
+}
+
+#ifndef _WIN32
+
+inline int open(const char* path, int flags, mode_t mode = 0) {
+    return enter(SyscallKind::Open) ? ::open(path, flags, mode) : -1;
+}
+
+inline int openat(int dirfd, const char* path, int flags, mode_t mode = 0) {
+    return enter(SyscallKind::Open) ? ::openat(dirfd, path, flags, mode) : -1;
+}
+
+inline ssize_t read(int fd, void* buf, size_t count) {
+    return enter(SyscallKind::Read, count) ? ::read(fd, buf, count) : -1;
+}
+
+inline ssize_t write(int fd, const void* buf, size_t count) {
+    return enter(SyscallKind::Write, count) ? ::write(fd, buf, count) : -1;
+}
+
+inline int fsync(int fd) {
+    return enter(SyscallKind::Fsync) ? ::fsync(fd) : -1;
+}
+
+inline int fdatasync(int fd) {
+    return enter(SyscallKind::Fsync) ? ::fdatasync(fd) : -1;
+}
+
+#ifdef __linux__
+inline int syncfs(int fd) {
+    return enter(SyscallKind::Fsync) ? ::syncfs(fd) : -1;
+}
+#endif
+
+inline int sync() {
+    if (!enter(SyscallKind::Fsync)) {
+        return -1;
+    }
+    ::sync();
+    return 0;
+}
+
+inline int close(int fd) {
+    return enter(SyscallKind::Close) ? ::close(fd) : -1;
+}
+
+inline int renameat(int olddirfd, const char* oldpath, int newdirfd, const char* newpath) {
+    return enter(SyscallKind::Rename) ? ::renameat(olddirfd, oldpath, newdirfd, newpath) : -1;
+}
+
+inline int renameat2(int olddirfd, const char* oldpath, int newdirfd, const char* newpath, unsigned int flags) {
+    if (!enter(SyscallKind::Rename)) {
+        return -1;
+    }
+#ifdef SYS_renameat2
+    return static_cast<int>(::syscall(SYS_renameat2, olddirfd, oldpath, newdirfd, newpath, flags));
+#else
+    (void)olddirfd; (void)oldpath; (void)newdirfd; (void)newpath; (void)flags;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+inline int unlinkat(int dirfd, const char* path, int flags) {
+    return enter(SyscallKind::Unlink) ? ::unlinkat(dirfd, path, flags) : -1;
+}
+
+inline int linkat(int olddirfd, const char* oldpath, int newdirfd, const char* newpath, int flags) {
+    return enter(SyscallKind::Link) ? ::linkat(olddirfd, oldpath, newdirfd, newpath, flags) : -1;
+}
+
+#ifdef POSIX_FADV_WILLNEED
+// Counted as a read: it only starts readahead and changes nothing on disk.
+inline int fadvise(int fd, off_t offset, off_t length, int advice) {
+    return enter(SyscallKind::Read) ? ::posix_fadvise(fd, offset, length, advice) : -1;
+}
+#endif
+
+inline int stat(const char* path, struct ::stat* st) {
+    return enter(SyscallKind::Stat) ? ::stat(path, st) : -1;
+}
+
+inline int fstat(int fd, struct ::stat* st) {
+    return enter(SyscallKind::Stat) ? ::fstat(fd, st) : -1;
+}
+
+inline int fstatat(int dirfd, const char* path, struct ::stat* st, int flags) {
+    return enter(SyscallKind::Stat) ? ::fstatat(dirfd, path, st, flags) : -1;
+}
+
+#ifdef SYS_getdents64
+// Record layout of getdents64 (glibc only wraps it from 2.30 on).
+struct LinuxDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1]; // Null-terminated, d_reclen - 19 bytes at most
+};
+
+inline long getdents64(int fd, void* buffer, size_t size) {
+    return enter(SyscallKind::Read, size) ? ::syscall(SYS_getdents64, fd, buffer, size) : -1;
+}
+#endif
+
+#endif // _WIN32
+
+} // namespace Shim
+} // namespace Utils
+} // namespace SecureStorage
+
+#endif // SS_SYSCALL_SHIM_H
@@ -4,6 +4,8 @@
 #include <vector>
 #include <string>
 #include <algorithm> // For std::equal
+#include <cstdio>    // For tmpfile
+#include <unistd.h>  // For pwrite
 
 class EncryptorTest : public ::testing::Test {
 protected:
@@ -132,6 +134,120 @@ TEST_F(EncryptorTest, EncryptEmptyPlaintext) {
     ASSERT_TRUE(decryptedData.empty());
 }
 
+TEST_F(EncryptorTest, DetachedRoundTripMatchesEncrypt) {
+    std::vector<unsigned char> iv;
+    ASSERT_EQ(encryptor.generateIv(iv), SecureStorage::Error::Errc::Success);
+    ASSERT_EQ(iv.size(), SecureStorage::Crypto::AES_GCM_IV_SIZE_BYTES);
+
+    std::vector<unsigned char> ciphertext(plaintext.size());
+    std::vector<unsigned char> tag(SecureStorage::Crypto::AES_GCM_TAG_SIZE_BYTES);
+    ASSERT_EQ(encryptor.encryptDetached(plaintext.data(), plaintext.size(), key, iv.data(), aad,
+                                        ciphertext.data(), tag.data()),
+              SecureStorage::Error::Errc::Success);
+
+    // [IV] + [Ciphertext] + [Tag] of the same pass decrypts through the regular API.
+    std::vector<unsigned char> joined(iv);
+    joined.insert(joined.end(), ciphertext.begin(), ciphertext.end());
+    joined.insert(joined.end(), tag.begin(), tag.end());
+    std::vector<unsigned char> decryptedData;
+    ASSERT_EQ(encryptor.decrypt(joined, key, decryptedData, aad), SecureStorage::Error::Errc::Success);
+    ASSERT_EQ(decryptedData, plaintext);
+
+    std::vector<unsigned char> out(plaintext.size());
+    ASSERT_EQ(encryptor.decryptDetached(ciphertext.data(), ciphertext.size(), key, iv.data(), aad, tag.data(), out.data()),
+              SecureStorage::Error::Errc::Success);
+    ASSERT_EQ(out, plaintext);
+    tag[0] ^= 0x01;
+    ASSERT_EQ(encryptor.decryptDetached(ciphertext.data(), ciphertext.size(), key, iv.data(), aad, tag.data(), out.data()),
+              SecureStorage::Error::Errc::AuthenticationFailed);
+}
+
+TEST_F(EncryptorTest, ChaCha20Poly1305RoundTripAndAlgorithmIsAuthenticated) {
+    using SecureStorage::Crypto::CipherAlgorithm;
+    std::vector<unsigned char> encryptedData;
+    ASSERT_EQ(encryptor.encrypt(plaintext, key, encryptedData, aad, CipherAlgorithm::ChaCha20Poly1305),
+              SecureStorage::Error::Errc::Success);
+    ASSERT_EQ(encryptedData.size(), SecureStorage::Crypto::AES_GCM_IV_SIZE_BYTES + plaintext.size() +
+                                    SecureStorage::Crypto::AES_GCM_TAG_SIZE_BYTES);
+
+    std::vector<unsigned char> decryptedData;
+    ASSERT_EQ(encryptor.decrypt(encryptedData, key, decryptedData, aad, CipherAlgorithm::ChaCha20Poly1305),
+              SecureStorage::Error::Errc::Success);
+    ASSERT_EQ(decryptedData, plaintext);
+    // The same bytes do not authenticate under the other cipher.
+    ASSERT_EQ(encryptor.decrypt(encryptedData, key, decryptedData, aad, CipherAlgorithm::Aes256Gcm),
+              SecureStorage::Error::Errc::AuthenticationFailed);
+    ASSERT_TRUE(decryptedData.empty());
+
+    CipherAlgorithm fastest = encryptor.selectFastestAlgorithm(4096);
+    ASSERT_TRUE(fastest == CipherAlgorithm::Aes256Gcm || fastest == CipherAlgorithm::ChaCha20Poly1305);
+}
+
+TEST_F(EncryptorTest, CallerBuffersWithSizeQuery) {
+    using SecureStorage::Crypto::Encryptor;
+    const std::string text = "held in a std::string";
+    const unsigned char* text_data = reinterpret_cast<const unsigned char*>(text.data());
+
+    // Too small: nothing written, the needed size is reported.
+    size_t needed = 0;
+    std::vector<unsigned char> encrypted(Encryptor::encryptedSize(text.size()) - 1);
+    ASSERT_EQ(encryptor.encrypt(text_data, text.size(), key.data(), key.size(), encrypted.data(), encrypted.size(),
+                                needed, aad.data(), aad.size()),
+              SecureStorage::Error::Errc::BufferTooSmall);
+    ASSERT_EQ(needed, Encryptor::encryptedSize(text.size()));
+
+    encrypted.resize(needed);
+    size_t written = 0;
+    ASSERT_EQ(encryptor.encrypt(text_data, text.size(), key.data(), key.size(), encrypted.data(), encrypted.size(),
+                                written, aad.data(), aad.size()),
+              SecureStorage::Error::Errc::Success);
+    ASSERT_EQ(written, needed);
+
+    // Same format as the vector API, in both directions.
+    std::vector<unsigned char> decryptedData;
+    ASSERT_EQ(encryptor.decrypt(encrypted, key, decryptedData, aad), SecureStorage::Error::Errc::Success);
+    ASSERT_EQ(std::string(decryptedData.begin(), decryptedData.end()), text);
+
+    ASSERT_EQ(Encryptor::decryptedSize(encrypted.size()), text.size());
+    std::vector<unsigned char> out(text.size());
+    ASSERT_EQ(encryptor.decrypt(encrypted.data(), encrypted.size(), key.data(), key.size(), out.data(), out.size() - 1,
+                                needed, aad.data(), aad.size()),
+              SecureStorage::Error::Errc::BufferTooSmall);
+    ASSERT_EQ(needed, text.size());
+    ASSERT_EQ(encryptor.decrypt(encrypted.data(), encrypted.size(), key.data(), key.size(), out.data(), out.size(),
+                                written, aad.data(), aad.size()),
+              SecureStorage::Error::Errc::Success);
+    ASSERT_EQ(std::string(out.begin(), out.end()), text);
+
+    encrypted[Encryptor::encryptedSize(0) / 2] ^= 0x01;
+    ASSERT_EQ(encryptor.decrypt(encrypted.data(), encrypted.size(), key.data(), key.size(), out.data(), out.size(),
+                                written, aad.data(), aad.size()),
+              SecureStorage::Error::Errc::AuthenticationFailed);
+    ASSERT_EQ(encryptor.encrypt(text_data, text.size(), key.data(), key.size() - 1, encrypted.data(), encrypted.size(),
+                                written),
+              SecureStorage::Error::Errc::InvalidKey);
+}
+
+TEST_F(EncryptorTest, EncryptInPlaceMatchesEncrypt) {
+    using SecureStorage::Crypto::Encryptor;
+    using SecureStorage::Crypto::AES_GCM_IV_SIZE_BYTES;
+    std::vector<unsigned char> buffer(Encryptor::encryptedSize(plaintext.size()));
+    std::copy(plaintext.begin(), plaintext.end(), buffer.begin() + AES_GCM_IV_SIZE_BYTES);
+    ASSERT_EQ(encryptor.encryptInPlace(buffer.data(), plaintext.size(), key.data(), key.size(), aad.data(), aad.size()),
+              SecureStorage::Error::Errc::Success);
+    ASSERT_FALSE(std::equal(plaintext.begin(), plaintext.end(), buffer.begin() + AES_GCM_IV_SIZE_BYTES));
+
+    std::vector<unsigned char> decryptedData;
+    ASSERT_EQ(encryptor.decrypt(buffer, key, decryptedData, aad), SecureStorage::Error::Errc::Success);
+    ASSERT_EQ(decryptedData, plaintext);
+
+    // A failed call leaves no plaintext behind.
+    std::copy(plaintext.begin(), plaintext.end(), buffer.begin() + AES_GCM_IV_SIZE_BYTES);
+    ASSERT_EQ(encryptor.encryptInPlace(buffer.data(), plaintext.size(), key.data(), key.size() - 1),
+              SecureStorage::Error::Errc::InvalidKey);
+    ASSERT_EQ(std::count(buffer.begin(), buffer.end(), 0), static_cast<long>(buffer.size()));
+}
+
 TEST_F(EncryptorTest, InvalidKeySize) {
     std::vector<unsigned char> shortKey(16, 0x01); // Too short
     std::vector<unsigned char> encryptedData;
@@ -173,4 +289,115 @@ TEST_F(EncryptorTest, MoveSemantics) {
     std::vector<unsigned char> dec2;
     ASSERT_EQ(e3.decrypt(enc1, key, dec2, aad), SecureStorage::Error::Errc::Success);
     ASSERT_EQ(dec2, plaintext);
-}
\ No newline at end of file
+}
+
+TEST_F(EncryptorTest, SoftwareBackendUnlessKernelIsAvailable) {
+    using SecureStorage::Crypto::CipherBackendKind;
+    ASSERT_EQ(encryptor.getCipherBackend(), CipherBackendKind::Software);
+    if (!encryptor.isKernelBackendAvailable()) {
+        EXPECT_EQ(encryptor.setCipherBackend(CipherBackendKind::Kernel), SecureStorage::Error::Errc::OperationFailed);
+        EXPECT_EQ(encryptor.getCipherBackend(), CipherBackendKind::Software);
+        EXPECT_EQ(encryptor.selectFastestBackend(4096), CipherBackendKind::Software);
+        return;
+    }
+    CipherBackendKind fastest = encryptor.selectFastestBackend(4096);
+    EXPECT_EQ(encryptor.getCipherBackend(), fastest);
+    EXPECT_EQ(encryptor.setCipherBackend(CipherBackendKind::Software), SecureStorage::Error::Errc::Success);
+    EXPECT_EQ(encryptor.getCipherBackend(), CipherBackendKind::Software);
+}
+
+TEST_F(EncryptorTest, KernelBackendMatchesSoftwareGcm) {
+    using SecureStorage::Crypto::CipherBackendKind;
+    using SecureStorage::Crypto::AES_GCM_IV_SIZE_BYTES;
+    using SecureStorage::Crypto::AES_GCM_TAG_SIZE_BYTES;
+    SecureStorage::Crypto::Encryptor kernel_encryptor;
+    if (kernel_encryptor.setCipherBackend(CipherBackendKind::Kernel) != SecureStorage::Error::Errc::Success) {
+        GTEST_SKIP() << "The kernel crypto API offers no gcm(aes) here.";
+    }
+    const unsigned char iv[AES_GCM_IV_SIZE_BYTES] = {1, 2, 3};
+    // Small messages go through sendmsg(), large ones through vmsplice()/splice().
+    for (size_t size : {size_t(0), plaintext.size(), size_t(256 * 1024)}) {
+        std::vector<unsigned char> input(size);
+        for (size_t i = 0; i < size; ++i) {
+            input[i] = static_cast<unsigned char>(i * 7);
+        }
+        std::vector<unsigned char> expected(size), actual(size);
+        unsigned char expected_tag[AES_GCM_TAG_SIZE_BYTES], tag[AES_GCM_TAG_SIZE_BYTES];
+        ASSERT_EQ(encryptor.encryptDetached(input.data(), size, key, iv, aad, expected.data(), expected_tag),
+                  SecureStorage::Error::Errc::Success);
+        ASSERT_EQ(kernel_encryptor.encryptDetached(input.data(), size, key, iv, aad, actual.data(), tag),
+                  SecureStorage::Error::Errc::Success);
+        EXPECT_EQ(actual, expected) << size << " bytes";
+        EXPECT_TRUE(std::equal(tag, tag + AES_GCM_TAG_SIZE_BYTES, expected_tag)) << size << " bytes";
+
+        std::vector<unsigned char> opened(size);
+        ASSERT_EQ(kernel_encryptor.decryptDetached(expected.data(), size, key, iv, aad, expected_tag, opened.data()),
+                  SecureStorage::Error::Errc::Success);
+        EXPECT_EQ(opened, input);
+        expected_tag[0] ^= 0x01;
+        EXPECT_EQ(kernel_encryptor.decryptDetached(expected.data(), size, key, iv, aad, expected_tag, opened.data()),
+                  SecureStorage::Error::Errc::AuthenticationFailed);
+    }
+
+    // In place, the kernel gets a copy; the result still opens in software.
+    std::vector<unsigned char> buffer(SecureStorage::Crypto::Encryptor::encryptedSize(plaintext.size()));
+    std::copy(plaintext.begin(), plaintext.end(), buffer.begin() + AES_GCM_IV_SIZE_BYTES);
+    ASSERT_EQ(kernel_encryptor.encryptInPlace(buffer.data(), plaintext.size(), key.data(), key.size(), aad.data(),
+                                              aad.size()),
+              SecureStorage::Error::Errc::Success);
+    std::vector<unsigned char> decryptedData;
+    ASSERT_EQ(encryptor.decrypt(buffer, key, decryptedData, aad), SecureStorage::Error::Errc::Success);
+    EXPECT_EQ(decryptedData, plaintext);
+}
+
+TEST_F(EncryptorTest, DecryptFromFileMatchesDecrypt) {
+    using SecureStorage::Crypto::CipherBackendKind;
+    std::vector<unsigned char> large(300 * 1024);
+    for (size_t i = 0; i < large.size(); ++i) {
+        large[i] = static_cast<unsigned char>(i % 251);
+    }
+    std::vector<CipherBackendKind> backends = {CipherBackendKind::Software};
+    if (encryptor.isKernelBackendAvailable()) {
+        backends.push_back(CipherBackendKind::Kernel);
+    }
+    for (CipherBackendKind backend : backends) {
+        ASSERT_EQ(encryptor.setCipherBackend(backend), SecureStorage::Error::Errc::Success);
+        for (const std::vector<unsigned char>* input : {&plaintext, &large}) {
+            std::vector<unsigned char> encrypted;
+            ASSERT_EQ(encryptor.encrypt(*input, key, encrypted, aad), SecureStorage::Error::Errc::Success);
+            // The body sits behind a header, as in a record file.
+            const off_t offset = 7;
+            FILE* file = std::tmpfile();
+            ASSERT_NE(file, nullptr);
+            const int fd = fileno(file);
+            ASSERT_EQ(pwrite(fd, encrypted.data(), encrypted.size(), offset), static_cast<ssize_t>(encrypted.size()));
+
+            std::vector<unsigned char> out(input->size());
+            size_t written = 0;
+            EXPECT_EQ(encryptor.decryptFromFile(fd, offset, encrypted.size(), key.data(), key.size(), out.data(),
+                                                out.size(), written, aad.data(), aad.size()),
+                      SecureStorage::Error::Errc::Success);
+            EXPECT_EQ(written, input->size());
+            EXPECT_EQ(out, *input);
+
+            size_t needed = 0;
+            EXPECT_EQ(encryptor.decryptFromFile(fd, offset, encrypted.size(), key.data(), key.size(), out.data(),
+                                                out.size() - 1, needed, aad.data(), aad.size()),
+                      SecureStorage::Error::Errc::BufferTooSmall);
+            EXPECT_EQ(needed, input->size());
+
+            // The file ends before the range does.
+            std::vector<unsigned char> longer(input->size() + 1);
+            EXPECT_EQ(encryptor.decryptFromFile(fd, offset, encrypted.size() + 1, key.data(), key.size(),
+                                                longer.data(), longer.size(), written, aad.data(), aad.size()),
+                      SecureStorage::Error::Errc::FileReadFailed);
+
+            const unsigned char flipped = static_cast<unsigned char>(encrypted.back() ^ 0x01);
+            ASSERT_EQ(pwrite(fd, &flipped, 1, offset + encrypted.size() - 1), 1);
+            EXPECT_EQ(encryptor.decryptFromFile(fd, offset, encrypted.size(), key.data(), key.size(), out.data(),
+                                                out.size(), written, aad.data(), aad.size()),
+                      SecureStorage::Error::Errc::AuthenticationFailed);
+            std::fclose(file);
+        }
+    }
+}
@@ -4,6 +4,13 @@
 #include <vector>
 #include <string>
 #include <iomanip> // For std::hex
+#include <algorithm> // For std::equal
+#include <chrono>
+#include <unistd.h> // For getpid
+#include <cstdio>   // For std::remove
+#include <cstring>
+#include <linux/keyctl.h>  // For KEYCTL_*, KEY_SPEC_*
+#include <sys/syscall.h>   // For SYS_add_key, SYS_keyctl
 
 // Helper to convert byte vector to hex string for easy comparison
 std::string bytesToHex(const std::vector<unsigned char>& bytes) {
@@ -85,6 +92,156 @@ TEST(KeyProviderTest, CustomSaltAndInfo) {
     SS_LOG_INFO("Key2 (default salt/info) hex: " << bytesToHex(key2));
 }
 
+TEST(KeyProviderTest, SecureBufferMatchesVectorKey) {
+    SecureStorage::Crypto::KeyProvider kp("SecureBufferSerial");
+    std::vector<unsigned char> key;
+    ASSERT_EQ(kp.getEncryptionKey(key, 32), SecureStorage::Error::Errc::Success);
+
+    SecureStorage::Utils::SecureBytes secure_key;
+    ASSERT_EQ(kp.getEncryptionKey(secure_key, 32), SecureStorage::Error::Errc::Success);
+    ASSERT_EQ(secure_key.size(), 32u);
+    EXPECT_TRUE(std::equal(key.begin(), key.end(), secure_key.begin()));
+
+    ASSERT_EQ(kp.getEncryptionKey(secure_key, 0), SecureStorage::Error::Errc::InvalidArgument);
+    EXPECT_TRUE(secure_key.empty());
+}
+
+TEST(KeyProviderTest, KeyringCacheReturnsDerivedKey) {
+    const std::string serial = "KeyringCacheSerial";
+    // A salt of its own, so concurrent or earlier runs do not share the cached key.
+    const std::string salt = "KeyringCacheTest-" + std::to_string(getpid());
+    SecureStorage::Crypto::KeyProvider plain(serial, salt);
+    std::vector<unsigned char> derived;
+    ASSERT_EQ(plain.getEncryptionKey(derived, 32), SecureStorage::Error::Errc::Success);
+
+    SecureStorage::Crypto::KeyCacheOptions options;
+    options.keyring = SecureStorage::Crypto::KeyCacheKeyring::Session;
+    options.timeout = std::chrono::seconds(60);
+    SecureStorage::Crypto::KeyProvider first(serial, salt);
+    first.setKeyCache(options);
+    std::vector<unsigned char> key1;
+    ASSERT_EQ(first.getEncryptionKey(key1, 32), SecureStorage::Error::Errc::Success);
+    EXPECT_EQ(key1, derived);
+
+    SecureStorage::Crypto::KeyProvider second(serial, salt);
+    second.setKeyCache(options);
+    SecureStorage::Utils::SecureBytes key2;
+    ASSERT_EQ(second.getEncryptionKey(key2, 32), SecureStorage::Error::Errc::Success);
+    ASSERT_EQ(key2.size(), 32u);
+    EXPECT_TRUE(std::equal(derived.begin(), derived.end(), key2.begin()));
+
+    if (first.getKeyCacheStats().unavailable > 0) {
+        // No usable keyring here (e.g. a seccomp filter); keys were derived instead.
+        EXPECT_EQ(second.getKeyCacheStats().hits, 0u);
+        return;
+    }
+    EXPECT_EQ(first.getKeyCacheStats().misses, 1u);
+    EXPECT_EQ(second.getKeyCacheStats().hits, 1u);
+    EXPECT_EQ(second.getKeyCacheStats().misses, 0u);
+
+    // A key of another length is cached separately.
+    std::vector<unsigned char> short_key;
+    ASSERT_EQ(second.getEncryptionKey(short_key, 16), SecureStorage::Error::Errc::Success);
+    EXPECT_EQ(second.getKeyCacheStats().misses, 1u);
+    EXPECT_EQ(second.removeCachedKey(16), SecureStorage::Error::Errc::Success);
+
+    EXPECT_EQ(second.removeCachedKey(32), SecureStorage::Error::Errc::Success);
+    EXPECT_EQ(second.removeCachedKey(32), SecureStorage::Error::Errc::DataNotFound);
+    EXPECT_EQ(plain.removeCachedKey(32), SecureStorage::Error::Errc::OperationFailed);
+}
+
+// Finds the session keyring key whose payload is `payload`; returns its description.
+static bool findCachedKey(const std::vector<unsigned char>& payload, long& key, std::string& description) {
+    std::vector<int32_t> serials(256);
+    long size = syscall(SYS_keyctl, KEYCTL_READ, KEY_SPEC_SESSION_KEYRING, serials.data(),
+                        serials.size() * sizeof(int32_t));
+    if (size < 0) {
+        return false;
+    }
+    serials.resize(std::min<size_t>(serials.size(), static_cast<size_t>(size) / sizeof(int32_t)));
+    for (int32_t serial : serials) {
+        std::vector<unsigned char> content(payload.size() + 1);
+        if (syscall(SYS_keyctl, KEYCTL_READ, serial, content.data(), content.size()) !=
+                static_cast<long>(payload.size()) ||
+            !std::equal(payload.begin(), payload.end(), content.begin())) {
+            continue;
+        }
+        char text[256] = {};
+        if (syscall(SYS_keyctl, KEYCTL_DESCRIBE, serial, text, sizeof(text) - 1) < 0) {
+            return false;
+        }
+        const char* last = std::strrchr(text, ';');
+        key = serial;
+        description = last ? last + 1 : "";
+        return true;
+    }
+    return false;
+}
+
+TEST(KeyProviderTest, KeyringCacheRejectsKeysItCannotVouchFor) {
+    const std::string serial = "KeyringPlantSerial";
+    const std::string salt = "KeyringPlantTest-" + std::to_string(getpid());
+    const std::string check_file = "/tmp/ss_keycheck_" + std::to_string(getpid());
+    std::remove(check_file.c_str());
+    std::vector<unsigned char> derived;
+    ASSERT_EQ(SecureStorage::Crypto::KeyProvider(serial, salt).getEncryptionKey(derived, 32),
+              SecureStorage::Error::Errc::Success);
+
+    SecureStorage::Crypto::KeyCacheOptions options;
+    options.keyring = SecureStorage::Crypto::KeyCacheKeyring::Session;
+    options.timeout = std::chrono::seconds(60);
+    options.checkFile = check_file;
+    SecureStorage::Crypto::KeyProvider first(serial, salt);
+    first.setKeyCache(options);
+    std::vector<unsigned char> key;
+    ASSERT_EQ(first.getEncryptionKey(key, 32), SecureStorage::Error::Errc::Success);
+    long cached = -1;
+    std::string description;
+    if (first.getKeyCacheStats().unavailable > 0 || !findCachedKey(derived, cached, description)) {
+        std::remove(check_file.c_str());
+        GTEST_SKIP() << "No usable session keyring";
+    }
+
+    // Another process of the session replaces the key with one of its own.
+    const std::vector<unsigned char> planted(32, 0x66);
+    auto plant = [&](unsigned long perm) {
+        syscall(SYS_keyctl, KEYCTL_UNLINK, cached, KEY_SPEC_SESSION_KEYRING);
+        cached = syscall(SYS_add_key, "user", description.c_str(), planted.data(), planted.size(),
+                         KEY_SPEC_SESSION_KEYRING);
+        ASSERT_GE(cached, 0);
+        if (perm != 0) {
+            ASSERT_EQ(syscall(SYS_keyctl, KEYCTL_SETPERM, cached, perm), 0);
+        }
+    };
+
+    // With the kernel's default permissions: caught by KEYCTL_DESCRIBE.
+    plant(0);
+    SecureStorage::Crypto::KeyProvider second(serial, salt);
+    second.setKeyCache(options);
+    ASSERT_EQ(second.getEncryptionKey(key, 32), SecureStorage::Error::Errc::Success);
+    EXPECT_EQ(key, derived);
+    EXPECT_EQ(second.getKeyCacheStats().rejected, 1u);
+    EXPECT_EQ(second.getKeyCacheStats().hits, 0u);
+
+    // With the permissions we set: caught by the check value.
+    ASSERT_TRUE(findCachedKey(derived, cached, description)); // Our key is cached again
+    plant(0x3b000000);
+    SecureStorage::Crypto::KeyProvider third(serial, salt);
+    third.setKeyCache(options);
+    ASSERT_EQ(third.getEncryptionKey(key, 32), SecureStorage::Error::Errc::Success);
+    EXPECT_EQ(key, derived);
+    EXPECT_EQ(third.getKeyCacheStats().rejected, 1u);
+
+    // The replacement is ours and trusted again.
+    SecureStorage::Crypto::KeyProvider fourth(serial, salt);
+    fourth.setKeyCache(options);
+    ASSERT_EQ(fourth.getEncryptionKey(key, 32), SecureStorage::Error::Errc::Success);
+    EXPECT_EQ(key, derived);
+    EXPECT_EQ(fourth.getKeyCacheStats().hits, 1u);
+    EXPECT_EQ(fourth.removeCachedKey(32), SecureStorage::Error::Errc::Success);
+    std::remove(check_file.c_str());
+}
+
 TEST(KeyProviderTest, MoveSemantics) {
     std::string serial = "MoveSerial123";
     SecureStorage::Crypto::KeyProvider kp1(serial);
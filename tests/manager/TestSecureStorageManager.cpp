@@ -14,7 +14,9 @@
 #include <fstream>  // For creating dummy files if needed for setup
 #include <mutex>
 #include <condition_variable>
+#include <future>
 #include <algorithm>
+#include <atomic>
 
 // POSIX includes for directory manipulation if FileUtil's helpers aren't enough for test cleanup
 #include <sys/stat.h> // For S_ISDIR in recursiveDelete
@@ -209,6 +211,261 @@ TEST_F(SecureStorageManagerTest, ListDataIdsDelegation) {
     EXPECT_EQ(ids[1], "item2");
 }
 
+TEST_F(SecureStorageManagerTest, WriteBackModeReadsYourWritesAndFlushes) {
+    SecureStorageManager manager(currentTestRootDir, dummySerial, getTestEventCallback());
+    ASSERT_TRUE(manager.isInitialized());
+    EXPECT_EQ(manager.flush(), Error::Errc::Success); // No-op outside write-back mode
+
+    Storage::WriteBackOptions options;
+    options.maxDirtyAge = std::chrono::milliseconds(60000);
+    ASSERT_EQ(manager.enableWriteBack(options), Error::Errc::Success);
+    EXPECT_EQ(manager.enableWriteBack(options), Error::Errc::OperationFailed);
+
+    std::vector<unsigned char> retrieved;
+    for (unsigned char i = 0; i < 10; ++i) {
+        ASSERT_EQ(manager.storeData("wb_item", {i}), Error::Errc::Success);
+        ASSERT_EQ(manager.retrieveData("wb_item", retrieved), Error::Errc::Success);
+        EXPECT_EQ(retrieved, std::vector<unsigned char>{i});
+    }
+    EXPECT_TRUE(manager.dataExists("wb_item"));
+    EXPECT_EQ(manager.getWriteBackStats().dirtyIds, 1u);
+
+    ASSERT_EQ(manager.flush(), Error::Errc::Success);
+    Storage::WriteBackStats stats = manager.getWriteBackStats();
+    EXPECT_EQ(stats.dirtyIds, 0u);
+    EXPECT_EQ(stats.committedWrites, 1u);
+
+    // A fresh manager on the same root sees the committed value.
+    SecureStorageManager reader(currentTestRootDir, dummySerial, nullptr);
+    ASSERT_TRUE(reader.isInitialized());
+    ASSERT_EQ(reader.retrieveData("wb_item", retrieved), Error::Errc::Success);
+    EXPECT_EQ(retrieved, std::vector<unsigned char>{9});
+}
+
+TEST_F(SecureStorageManagerTest, WriteBackModeCommitsOnDestruction) {
+    {
+        SecureStorageManager manager(currentTestRootDir, dummySerial, nullptr);
+        ASSERT_TRUE(manager.isInitialized());
+        Storage::WriteBackOptions options;
+        options.maxDirtyAge = std::chrono::milliseconds(60000);
+        ASSERT_EQ(manager.enableWriteBack(options), Error::Errc::Success);
+        ASSERT_EQ(manager.storeData("wb_shutdown", {'x'}), Error::Errc::Success);
+    }
+    SecureStorageManager reader(currentTestRootDir, dummySerial, nullptr);
+    ASSERT_TRUE(reader.isInitialized());
+    std::vector<unsigned char> retrieved;
+    ASSERT_EQ(reader.retrieveData("wb_shutdown", retrieved), Error::Errc::Success);
+    EXPECT_EQ(retrieved, std::vector<unsigned char>{'x'});
+}
+
+TEST_F(SecureStorageManagerTest, DurabilityPerCallAndDefault) {
+    SecureStorageManager manager(currentTestRootDir, dummySerial, nullptr);
+    ASSERT_TRUE(manager.isInitialized());
+    ASSERT_EQ(manager.setDefaultDurability(Storage::Durability::DataSync), Error::Errc::Success);
+
+    std::vector<unsigned char> cache_data = {'c'};
+    std::vector<unsigned char> critical_data = {'k'};
+    ASSERT_EQ(manager.storeData("cache", cache_data, Storage::Durability::Deferred), Error::Errc::Success);
+    ASSERT_EQ(manager.storeData("critical", critical_data, Storage::Durability::Full), Error::Errc::Success);
+    ASSERT_EQ(manager.storeData("default", {'d'}), Error::Errc::Success);
+    ASSERT_EQ(manager.flush(), Error::Errc::Success); // Also flushes the deferred write
+
+    std::vector<unsigned char> out;
+    ASSERT_EQ(manager.retrieveData("cache", out), Error::Errc::Success);
+    EXPECT_EQ(out, cache_data);
+    ASSERT_EQ(manager.retrieveData("critical", out), Error::Errc::Success);
+    EXPECT_EQ(out, critical_data);
+}
+
+TEST_F(SecureStorageManagerTest, SynchronousInitIsReadyOnReturn) {
+    SecureStorageManager manager(currentTestRootDir, dummySerial, nullptr);
+    ASSERT_TRUE(manager.isInitialized());
+    std::shared_future<Error::Errc> ready = manager.getReadyFuture();
+    ASSERT_TRUE(ready.valid());
+    ASSERT_EQ(ready.wait_for(std::chrono::seconds(0)), std::future_status::ready);
+    EXPECT_EQ(ready.get(), Error::Errc::Success);
+
+    InitTimings timings = manager.getInitTimings();
+    EXPECT_GT(timings.total.count(), 0);
+    EXPECT_GE(timings.total, timings.directorySetup + timings.recovery + timings.cryptoSetup +
+                             timings.keyDerivation + timings.fileWatcher);
+}
+
+TEST_F(SecureStorageManagerTest, AsynchronousInitWaitsForReadiness) {
+    InitOptions options;
+    options.mode = InitMode::Asynchronous;
+    SecureStorageManager manager(currentTestRootDir, dummySerial, nullptr, options);
+
+    // With the default policy, operations block until initialization is done.
+    std::vector<unsigned char> data = {'a', 's', 'y', 'n', 'c'};
+    ASSERT_EQ(manager.storeData("async_id", data), Error::Errc::Success);
+    EXPECT_TRUE(manager.isInitialized());
+    EXPECT_EQ(manager.getReadyFuture().get(), Error::Errc::Success);
+    EXPECT_GT(manager.getInitTimings().total.count(), 0);
+
+    std::vector<unsigned char> out;
+    ASSERT_EQ(manager.retrieveData("async_id", out), Error::Errc::Success);
+    EXPECT_EQ(out, data);
+}
+
+TEST_F(SecureStorageManagerTest, AsynchronousInitFailFastReturnsNotReady) {
+    InitOptions options;
+    options.mode = InitMode::Asynchronous;
+    options.whileInitializing = NotReadyPolicy::FailFast;
+    SecureStorageManager manager(currentTestRootDir, dummySerial, nullptr, options);
+
+    // Either initialization already finished, or the call must not block.
+    std::vector<unsigned char> out = {'x'};
+    Error::Errc early = manager.retrieveData("missing", out);
+    EXPECT_TRUE(early == Error::Errc::NotReady || early == Error::Errc::DataNotFound);
+    EXPECT_TRUE(out.empty());
+
+    ASSERT_EQ(manager.getReadyFuture().get(), Error::Errc::Success);
+    ASSERT_TRUE(manager.isInitialized());
+    EXPECT_EQ(manager.storeData("later", {'l'}), Error::Errc::Success);
+    EXPECT_TRUE(manager.dataExists("later"));
+}
+
+TEST_F(SecureStorageManagerTest, AsynchronousInitFailureIsReported) {
+    InitOptions options;
+    options.mode = InitMode::Asynchronous;
+    SecureStorageManager manager(currentTestRootDir, "", nullptr, options); // Empty serial fails
+    EXPECT_EQ(manager.getReadyFuture().get(), Error::Errc::NotInitialized);
+    EXPECT_FALSE(manager.isInitialized());
+    EXPECT_EQ(manager.storeData("id", {'d'}), Error::Errc::NotInitialized);
+}
+
+TEST_F(SecureStorageManagerTest, DestroyingDuringAsynchronousInitIsSafe) {
+    InitOptions options;
+    options.mode = InitMode::Asynchronous;
+    for (int i = 0; i < 5; ++i) {
+        SecureStorageManager manager(currentTestRootDir, dummySerial, nullptr, options);
+    }
+    SecureStorageManager manager(currentTestRootDir, dummySerial, nullptr);
+    EXPECT_TRUE(manager.isInitialized());
+}
+
+TEST_F(SecureStorageManagerTest, HistoryDepthKeepsEarlierVersions) {
+    InitOptions options;
+    options.historyDepth = 2;
+    SecureStorageManager manager(currentTestRootDir, dummySerial, nullptr, options);
+    ASSERT_TRUE(manager.isInitialized());
+    ASSERT_EQ(manager.storeData("setting", {'a'}), Error::Errc::Success);
+    ASSERT_EQ(manager.storeData("setting", {'b'}), Error::Errc::Success);
+
+    std::vector<Storage::VersionInfo> versions;
+    ASSERT_EQ(manager.listVersions("setting", versions), Error::Errc::Success);
+    ASSERT_EQ(versions.size(), 2u);
+    std::vector<unsigned char> out;
+    ASSERT_EQ(manager.retrieveData("setting", versions[1].version, out), Error::Errc::Success);
+    EXPECT_EQ(out, std::vector<unsigned char>({'a'}));
+    EXPECT_EQ(manager.retrieveAsOf("setting", versions[1].storedAt - std::chrono::hours(1), out),
+              Error::Errc::DataNotFound);
+}
+
+TEST_F(SecureStorageManagerTest, WriteBackModeVersionedReadsSeeBufferedWrite) {
+    InitOptions options;
+    options.historyDepth = 2;
+    SecureStorageManager manager(currentTestRootDir, dummySerial, nullptr, options);
+    ASSERT_TRUE(manager.isInitialized());
+    ASSERT_EQ(manager.storeData("setting", {'a'}), Error::Errc::Success);
+
+    Storage::WriteBackOptions wb_options;
+    wb_options.maxDirtyAge = std::chrono::milliseconds(60000);
+    ASSERT_EQ(manager.enableWriteBack(wb_options), Error::Errc::Success);
+    ASSERT_EQ(manager.storeData("setting", {'b'}), Error::Errc::Success);
+
+    std::vector<Storage::VersionInfo> versions;
+    ASSERT_EQ(manager.listVersions("setting", versions), Error::Errc::Success);
+    ASSERT_EQ(versions.size(), 2u);
+    EXPECT_EQ(manager.getWriteBackStats().dirtyIds, 0u); // Committed by the versioned read
+    std::vector<unsigned char> out;
+    ASSERT_EQ(manager.retrieveData("setting", versions[0].version, out), Error::Errc::Success);
+    EXPECT_EQ(out, std::vector<unsigned char>({'b'}));
+
+    ASSERT_EQ(manager.storeData("setting", {'c'}), Error::Errc::Success);
+    ASSERT_EQ(manager.retrieveAsOf("setting", std::chrono::system_clock::now() + std::chrono::hours(1), out),
+              Error::Errc::Success);
+    EXPECT_EQ(out, std::vector<unsigned char>({'c'}));
+}
+
+TEST_F(SecureStorageManagerTest, WriteBackCanBeEnabledWhileOtherThreadsUseTheManager) {
+    SecureStorageManager manager(currentTestRootDir, dummySerial, nullptr);
+    ASSERT_TRUE(manager.isInitialized());
+    std::atomic<bool> stop(false);
+    std::atomic<int> failures(0);
+    std::thread user([&]() {
+        std::vector<unsigned char> out;
+        for (unsigned char i = 0; !stop.load(); ++i) {
+            if (manager.storeData("shared", {i}) != Error::Errc::Success ||
+                manager.retrieveData("shared", out) != Error::Errc::Success || out != std::vector<unsigned char>{i}) {
+                failures++;
+            }
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_EQ(manager.enableWriteBack(), Error::Errc::Success);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    stop = true;
+    user.join();
+    EXPECT_EQ(failures.load(), 0);
+    EXPECT_GT(manager.getWriteBackStats().bufferedWrites, 0u);
+}
+
+TEST_F(SecureStorageManagerTest, HotSetIsPrefetchedOnNextStart) {
+    std::vector<unsigned char> data = {'h', 'o', 't'};
+    {
+        SecureStorageManager manager(currentTestRootDir, dummySerial, nullptr);
+        ASSERT_TRUE(manager.isInitialized());
+        ASSERT_EQ(manager.storeData("hot_a", data), Error::Errc::Success);
+        ASSERT_EQ(manager.storeData("hot_b", data), Error::Errc::Success);
+        ASSERT_EQ(manager.storeData("cold", data), Error::Errc::Success);
+        EXPECT_EQ(manager.prefetch({"hot_a"}), Error::Errc::OperationFailed); // No cache yet
+        std::vector<unsigned char> out;
+        ASSERT_EQ(manager.retrieveData("hot_a", out), Error::Errc::Success);
+        ASSERT_EQ(manager.retrieveData("hot_b", out), Error::Errc::Success);
+    } // The hot set is saved on destruction
+
+    InitOptions options;
+    options.plaintextCacheBytes = 64 * 1024;
+    options.prefetchHotSet = true;
+    SecureStorageManager manager(currentTestRootDir, dummySerial, nullptr, options);
+    ASSERT_TRUE(manager.isInitialized());
+    Storage::PlaintextCacheStats stats = manager.getPlaintextCacheStats();
+    EXPECT_EQ(stats.prefetchedEntries, 2u);
+
+    std::vector<unsigned char> out;
+    ASSERT_EQ(manager.retrieveData("hot_a", out), Error::Errc::Success);
+    EXPECT_EQ(out, data);
+    ASSERT_EQ(manager.retrieveData("cold", out), Error::Errc::Success);
+    stats = manager.getPlaintextCacheStats();
+    EXPECT_EQ(stats.prefetchHits, 1u);
+    EXPECT_EQ(stats.misses, 1u);
+
+    Storage::PrefetchReport report;
+    ASSERT_EQ(manager.prefetch({"hot_a", "cold"}, report), Error::Errc::Success);
+    EXPECT_EQ(report.alreadyCached, 2u); // "cold" was cached by the read above
+}
+
+TEST_F(SecureStorageManagerTest, ScrubberRunsInBackground) {
+    SecureStorageManager manager(currentTestRootDir, dummySerial, nullptr);
+    ASSERT_TRUE(manager.isInitialized());
+    ASSERT_EQ(manager.storeData("scrubbed", {'o', 'k'}), Error::Errc::Success);
+
+    Storage::ScrubOptions options;
+    options.startDelay = std::chrono::milliseconds(0);
+    options.bytesPerSecond = 0;
+    ASSERT_EQ(manager.enableScrubber(options), Error::Errc::Success);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (manager.getScrubStats().passesCompleted == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    Storage::ScrubStats stats = manager.getScrubStats();
+    EXPECT_EQ(stats.passesCompleted, 1u);
+    EXPECT_EQ(stats.recordsVerified, 1u);
+    EXPECT_TRUE(stats.unrecoverableIds.empty());
+}
+
 TEST_F(SecureStorageManagerTest, MoveConstructor) {
     SecureStorageManager manager1(currentTestRootDir, dummySerial, getTestEventCallback());
     ASSERT_TRUE(manager1.isInitialized());
@@ -288,8 +545,8 @@ TEST_F(SecureStorageManagerTest, WatcherDetectsExternalFileCreation) {
     ofs.close();
 
     // Expect IN_CREATE and IN_CLOSE_WRITE (and possibly IN_MODIFY) for the new file
-    // Wait for at least 2, then check specifics. Let's be generous and wait for 3.
-    ASSERT_TRUE(waitForEvents(2, std::chrono::seconds(2))) << "Did not receive expected number of events for external creation.";
+    // IN_MODIFY arrives between them, so wait for 3 before checking specifics.
+    ASSERT_TRUE(waitForEvents(3, std::chrono::seconds(2))) << "Did not receive expected number of events for external creation.";
 
     const FileWatcher::WatchedEvent* createEvent = findEvent(IN_CREATE, "externally_created.txt");
     const FileWatcher::WatchedEvent* closeWriteEvent = findEvent(IN_CLOSE_WRITE, "externally_created.txt");
@@ -398,8 +655,8 @@ TEST_F(SecureStorageManagerTest, WatcherViaManagerDetectsExternalFileCreation) {
 
     // Expect IN_CREATE for the new file within the watched directory (currentTestRootDir)
     // and IN_CLOSE_WRITE when the ofstream is closed.
-    // Some systems might also generate IN_MODIFY. Wait for at least 2, check for the critical ones.
-    ASSERT_TRUE(waitForEvents(2, std::chrono::seconds(2))) 
+    // Writing content also generates IN_MODIFY before IN_CLOSE_WRITE, so wait for all 3.
+    ASSERT_TRUE(waitForEvents(3, std::chrono::seconds(2))) 
         << "Timed out waiting for events for external file creation. Received " << receivedEvents.size() << " events.";
 
     const FileWatcher::WatchedEvent* createEvent = findEvent(IN_CREATE, externallyCreatedFileName);
@@ -544,4 +801,49 @@ TEST_F(SecureStorageManagerTest, ManagerStopsWatcherOnDestruction) {
     // For now, successful completion of this test without hangs or crashes,
     // combined with logs, is the primary indicator.
     SUCCEED() << "Manager was destroyed. Check logs for FileWatcher stop messages.";
-}
\ No newline at end of file
+}
+TEST_F(SecureStorageManagerTest, TransactionIsOrderedAfterBufferedWrites) {
+    SecureStorageManager manager(currentTestRootDir, dummySerial, nullptr);
+    ASSERT_TRUE(manager.isInitialized());
+    Storage::WriteBackOptions options;
+    options.maxDirtyAge = std::chrono::milliseconds(60000);
+    ASSERT_EQ(manager.enableWriteBack(options), Error::Errc::Success);
+    ASSERT_EQ(manager.storeData("cfg_a", {'o', 'l', 'd'}), Error::Errc::Success); // Buffered
+
+    Storage::Transaction txn = manager.beginTransaction();
+    ASSERT_EQ(txn.put("cfg_a", {'n', 'e', 'w'}), Error::Errc::Success);
+    ASSERT_EQ(txn.put("cfg_b", {'n', 'e', 'w'}), Error::Errc::Success);
+    ASSERT_EQ(txn.commit(), Error::Errc::Success);
+    ASSERT_EQ(manager.flush(), Error::Errc::Success);
+
+    std::vector<unsigned char> out;
+    for (const char* id : {"cfg_a", "cfg_b"}) {
+        ASSERT_EQ(manager.retrieveData(id, out), Error::Errc::Success);
+        EXPECT_EQ(out, std::vector<unsigned char>({'n', 'e', 'w'})) << id;
+    }
+    Storage::TransactionStats stats = manager.getTransactionStats();
+    EXPECT_EQ(stats.committed, 1u);
+    EXPECT_EQ(stats.pending, 0u);
+}
+
+TEST_F(SecureStorageManagerTest, RetrieveManySeesBufferedWrites) {
+    SecureStorageManager manager(currentTestRootDir, dummySerial, nullptr);
+    ASSERT_TRUE(manager.isInitialized());
+    ASSERT_EQ(manager.storeData("on_disk", {'d'}), Error::Errc::Success);
+    ASSERT_EQ(manager.storeData("deleted", {'d'}), Error::Errc::Success);
+    Storage::WriteBackOptions options;
+    options.maxDirtyAge = std::chrono::milliseconds(60000);
+    ASSERT_EQ(manager.enableWriteBack(options), Error::Errc::Success);
+    ASSERT_EQ(manager.storeData("buffered", {'b'}), Error::Errc::Success);
+    ASSERT_EQ(manager.deleteData("deleted"), Error::Errc::Success);
+
+    std::vector<Storage::RetrieveResult> results;
+    ASSERT_EQ(manager.retrieveMany({"buffered", "on_disk", "deleted", "missing"}, results), Error::Errc::Success);
+    ASSERT_EQ(results.size(), 4u);
+    EXPECT_EQ(results[0].status, Error::Errc::Success);
+    EXPECT_EQ(results[0].data, std::vector<unsigned char>({'b'}));
+    EXPECT_EQ(results[1].status, Error::Errc::Success);
+    EXPECT_EQ(results[1].data, std::vector<unsigned char>({'d'}));
+    EXPECT_EQ(results[2].status, Error::Errc::DataNotFound);
+    EXPECT_EQ(results[3].status, Error::Errc::DataNotFound);
+}
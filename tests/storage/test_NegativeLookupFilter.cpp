@@ -0,0 +1,64 @@
+#include "gtest/gtest.h"
+
+#include "NegativeLookupFilter.h"
+
+#include <string>
+#include <unordered_set>
+
+using namespace SecureStorage::Storage;
+
+TEST(NegativeLookupFilterTest, NeverRejectsAnAddedId) {
+    NegativeLookupFilter filter;
+    EXPECT_FALSE(filter.mightContain("anything"));
+
+    std::unordered_set<std::string> ids;
+    for (int i = 0; i < 500; ++i) {
+        ids.insert("seed_" + std::to_string(i));
+    }
+    filter.rebuild(ids);
+    for (int i = 0; i < 700; ++i) {
+        filter.add("added_" + std::to_string(i));
+    }
+    for (const std::string& id : ids) {
+        EXPECT_TRUE(filter.mightContain(id)) << id;
+    }
+    for (int i = 0; i < 700; ++i) {
+        EXPECT_TRUE(filter.mightContain("added_" + std::to_string(i)));
+    }
+    EXPECT_TRUE(filter.needsRebuild()); // 1200 ids in a filter sized for 1024
+}
+
+TEST(NegativeLookupFilterTest, FalsePositiveRateStaysNearTarget) {
+    NegativeLookupFilter filter(0.01);
+    std::unordered_set<std::string> ids;
+    for (int i = 0; i < 5000; ++i) {
+        ids.insert("present_" + std::to_string(i));
+    }
+    filter.rebuild(ids); // Sized for 10000, so half full
+
+    int false_positives = 0;
+    const int probes = 20000;
+    for (int i = 0; i < probes; ++i) {
+        if (filter.mightContain("absent_" + std::to_string(i))) {
+            false_positives++;
+            filter.recordFalsePositive();
+        }
+    }
+    NegativeLookupStats stats = filter.getStats();
+    EXPECT_EQ(stats.capacity, 10000u);
+    EXPECT_EQ(stats.ids, 5000u);
+    EXPECT_EQ(stats.hashCount, 7u);
+    EXPECT_EQ(stats.lookups, static_cast<uint64_t>(probes));
+    EXPECT_EQ(stats.falsePositives, static_cast<uint64_t>(false_positives));
+    EXPECT_LT(stats.observedFalsePositiveRate, 0.01);
+    EXPECT_LT(stats.estimatedFalsePositiveRate, 0.01);
+    EXPECT_GT(stats.estimatedFalsePositiveRate, 0.0);
+
+    for (int i = 0; i < 5000; ++i) {
+        filter.remove();
+    }
+    EXPECT_TRUE(filter.needsRebuild()); // Stale ids are half the capacity
+    filter.rebuild(std::unordered_set<std::string>());
+    EXPECT_FALSE(filter.mightContain("present_0"));
+    EXPECT_EQ(filter.getStats().staleIds, 0u);
+}
@@ -0,0 +1,143 @@
+#include "gtest/gtest.h"
+
+#include "PlaintextCache.h"
+#include "HotSet.h"
+#include "DirFileUtil.h"
+#include "FileUtil.h"
+#include "Error.h"
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <chrono>
+#include <cstdio>     // For std::remove
+
+#include <unistd.h>   // For getpid
+
+using namespace SecureStorage::Storage;
+using namespace SecureStorage::Utils;
+using namespace SecureStorage::Error;
+
+namespace {
+
+FileIdentity identityFor(uint64_t inode, uint64_t size) {
+    FileIdentity identity;
+    identity.device = 1;
+    identity.inode = inode;
+    identity.size = size;
+    identity.changeTimeNs = 1000;
+    return identity;
+}
+
+} // namespace
+
+TEST(PlaintextCacheTest, HitOnlyWhileIdentityMatches) {
+    PlaintextCache cache;
+    std::vector<unsigned char> data = {1, 2, 3};
+    std::vector<unsigned char> out;
+
+    EXPECT_FALSE(cache.lookup("id", identityFor(10, 3), out));
+    cache.insert("id", identityFor(10, 3), data, false);
+    ASSERT_TRUE(cache.lookup("id", identityFor(10, 3), out));
+    EXPECT_EQ(out, data);
+
+    // Replaced on disk (new inode): the entry is dropped, not served.
+    EXPECT_FALSE(cache.lookup("id", identityFor(11, 3), out));
+    EXPECT_FALSE(cache.contains("id"));
+
+    PlaintextCacheStats stats = cache.getStats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 2u);
+    EXPECT_EQ(stats.staleDrops, 1u);
+    EXPECT_EQ(stats.entries, 0u);
+    EXPECT_EQ(stats.bytes, 0u);
+}
+
+TEST(PlaintextCacheTest, EvictsLeastRecentlyUsedWithinByteBudget) {
+    PlaintextCache cache(10);
+    std::vector<unsigned char> four(4, 'x');
+    std::vector<unsigned char> out;
+
+    cache.insert("a", identityFor(1, 4), four, false);
+    cache.insert("b", identityFor(2, 4), four, false);
+    ASSERT_TRUE(cache.lookup("a", identityFor(1, 4), out)); // "b" is now the oldest
+    cache.insert("c", identityFor(3, 4), four, false);
+
+    EXPECT_TRUE(cache.contains("a"));
+    EXPECT_FALSE(cache.contains("b"));
+    EXPECT_TRUE(cache.contains("c"));
+
+    // Larger than the whole budget, or of unknown identity: never cached.
+    cache.insert("big", identityFor(4, 11), std::vector<unsigned char>(11, 'y'), false);
+    cache.insert("unknown", FileIdentity(), four, false);
+    EXPECT_FALSE(cache.contains("big"));
+    EXPECT_FALSE(cache.contains("unknown"));
+
+    PlaintextCacheStats stats = cache.getStats();
+    EXPECT_EQ(stats.evictions, 1u);
+    EXPECT_EQ(stats.entries, 2u);
+    EXPECT_EQ(stats.bytes, 8u);
+}
+
+TEST(PlaintextCacheTest, CountsPrefetchHitsOncePerEntry) {
+    PlaintextCache cache;
+    std::vector<unsigned char> data = {9};
+    std::vector<unsigned char> out;
+
+    cache.insert("used", identityFor(1, 1), data, true);
+    cache.insert("unused", identityFor(2, 1), data, true);
+    ASSERT_TRUE(cache.lookup("used", identityFor(1, 1), out));
+    ASSERT_TRUE(cache.lookup("used", identityFor(1, 1), out));
+
+    PlaintextCacheStats stats = cache.getStats();
+    EXPECT_EQ(stats.prefetchedEntries, 2u);
+    EXPECT_EQ(stats.prefetchHits, 1u);
+    EXPECT_EQ(stats.hits, 2u);
+}
+
+class HotSetTest : public ::testing::Test {
+protected:
+    std::string rootDir;
+
+    void SetUp() override {
+        std::ostringstream oss;
+        oss << "HotSetTests_temp_" << getpid() << "_"
+            << std::chrono::steady_clock::now().time_since_epoch().count() << "/";
+        rootDir = oss.str();
+        ASSERT_EQ(FileUtil::createDirectories(rootDir), Errc::Success);
+    }
+
+    void TearDown() override {
+        std::remove((rootDir + HOT_SET_FILE_NAME).c_str());
+        std::remove(rootDir.c_str());
+    }
+};
+
+TEST_F(HotSetTest, RanksByAccessCountAndSurvivesSaveAndLoad) {
+    HotSetTracker tracker(2);
+    for (int i = 0; i < 3; ++i) tracker.recordAccess("warm");
+    for (int i = 0; i < 5; ++i) tracker.recordAccess("hot");
+    tracker.recordAccess("cold");
+    tracker.recordAccess("gone");
+    tracker.forget("gone");
+
+    std::vector<std::string> expected = {"hot", "warm", "cold"};
+    EXPECT_EQ(tracker.hottest(10), expected);
+
+    DirFileUtil dir(rootDir);
+    ASSERT_TRUE(dir.isOpen());
+    ASSERT_EQ(tracker.save(dir), Errc::Success);
+
+    // Only the `capacity` hottest ids are saved.
+    HotSetTracker reloaded(2);
+    ASSERT_EQ(reloaded.load(dir), Errc::Success);
+    std::vector<std::string> saved = {"hot", "warm"};
+    EXPECT_EQ(reloaded.hottest(10), saved);
+}
+
+TEST_F(HotSetTest, MissingFileLoadsEmpty) {
+    DirFileUtil dir(rootDir);
+    HotSetTracker tracker;
+    EXPECT_EQ(tracker.load(dir), Errc::Success);
+    EXPECT_TRUE(tracker.hottest(10).empty());
+}
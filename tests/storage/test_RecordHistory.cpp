@@ -0,0 +1,97 @@
+#include "gtest/gtest.h"
+
+#include "RecordHistory.h"
+
+#include <vector>
+
+using namespace SecureStorage::Storage;
+
+namespace {
+
+std::vector<unsigned char> pattern(size_t size, unsigned char seed) {
+    std::vector<unsigned char> data(size);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = static_cast<unsigned char>(seed + i * 7);
+    }
+    return data;
+}
+
+} // namespace
+
+TEST(RecordHistoryTest, DeltaKeepsOnlyChangedChunksAndRestoresOlderVersion) {
+    std::vector<unsigned char> older = pattern(10 * HISTORY_CHUNK_SIZE + 100, 1);
+    std::vector<unsigned char> newer = older;
+    newer[3 * HISTORY_CHUNK_SIZE + 5] ^= 0xff;
+
+    HistoryEntry entry;
+    RecordHistory::makeDelta(older, newer, entry);
+    ASSERT_EQ(entry.chunks.size(), 1u);
+    EXPECT_EQ(entry.chunks[0].index, 3u);
+    std::vector<unsigned char> restored = newer;
+    ASSERT_TRUE(RecordHistory::applyDelta(entry, restored));
+    EXPECT_EQ(restored, older);
+
+    // Growing and shrinking: the tail beyond the newer size, and the partial last chunk.
+    std::vector<unsigned char> shorter(older.begin(), older.begin() + 2 * HISTORY_CHUNK_SIZE + 10);
+    RecordHistory::makeDelta(older, shorter, entry);
+    EXPECT_EQ(entry.chunks.size(), 9u); // Chunks 2..10
+    restored = shorter;
+    ASSERT_TRUE(RecordHistory::applyDelta(entry, restored));
+    EXPECT_EQ(restored, older);
+
+    RecordHistory::makeDelta(shorter, older, entry);
+    EXPECT_TRUE(entry.chunks.empty()); // A prefix of the newer version costs nothing
+    restored = older;
+    ASSERT_TRUE(RecordHistory::applyDelta(entry, restored));
+    EXPECT_EQ(restored, shorter);
+
+    // Applied to the wrong base, the digest check catches it.
+    restored = pattern(older.size(), 9);
+    RecordHistory::makeDelta(older, newer, entry);
+    EXPECT_FALSE(RecordHistory::applyDelta(entry, restored));
+}
+
+TEST(RecordHistoryTest, EntriesRoundTripAndTornFramesAreDropped) {
+    HistoryEntry entry;
+    RecordHistory::makeDelta(pattern(5000, 1), pattern(5000, 2), entry);
+    entry.version = 7;
+    entry.storedAtNs = 1000;
+    entry.supersededAtNs = 2000;
+    std::vector<unsigned char> bytes;
+    RecordHistory::serializeEntry(entry, bytes);
+    HistoryEntry parsed;
+    ASSERT_TRUE(RecordHistory::parseEntry(bytes, parsed));
+    EXPECT_EQ(parsed.version, 7u);
+    EXPECT_EQ(parsed.supersededAtNs, 2000);
+    EXPECT_EQ(parsed.digest, entry.digest);
+    ASSERT_EQ(parsed.chunks.size(), 2u);
+    EXPECT_EQ(parsed.chunks[1].data, entry.chunks[1].data);
+    bytes.pop_back();
+    EXPECT_FALSE(RecordHistory::parseEntry(bytes, parsed));
+
+    std::vector<unsigned char> file;
+    RecordHistory::appendFrame({1, 2, 3}, file);
+    RecordHistory::appendFrame({4, 5}, file);
+    RecordHistory::appendFrame({6, 7, 8, 9}, file);
+    file.resize(file.size() - 2); // Crash during the last append
+    std::vector<std::vector<unsigned char>> frames;
+    RecordHistory::splitFrames(file, frames);
+    ASSERT_EQ(frames.size(), 2u);
+    EXPECT_EQ(frames[1], std::vector<unsigned char>({4, 5}));
+}
+
+TEST(RecordHistoryTest, ChainSkipsEntriesThatDoNotLinkToTheCurrentVersion) {
+    std::vector<unsigned char> v1 = pattern(100, 1), v2 = pattern(100, 2), v3 = pattern(100, 3);
+    std::vector<HistoryEntry> entries(3);
+    RecordHistory::makeDelta(v1, v2, entries[0]);
+    entries[0].version = 1;
+    RecordHistory::makeDelta(v2, v3, entries[1]);
+    entries[1].version = 2;
+    RecordHistory::makeDelta(v3, pattern(100, 4), entries[2]); // The write of v4 never landed
+    entries[2].version = 3;
+
+    std::vector<size_t> chain = RecordHistory::resolveChain(entries, RecordHistory::digest(v3));
+    EXPECT_EQ(chain, std::vector<size_t>({1, 0}));
+    chain = RecordHistory::resolveChain(entries, RecordHistory::digest(pattern(100, 9)));
+    EXPECT_TRUE(chain.empty());
+}
@@ -2,6 +2,8 @@
 
 #include "SecureStore.h" // Adjust path as per your include structure
 #include "FileUtil.h"    // For direct file manipulation in tests
+#include "FaultInjection.h" // For crash simulation
+#include "FileLock.h"       // For holding a shard like another process
 #include "Error.h"
 #include "Logger.h"      // For SS_LOG_ macros if needed in test logic
 
@@ -10,12 +12,52 @@
 #include <fstream>
 #include <algorithm> // For std::sort, std::find
 #include <thread>    // For std::this_thread::get_id for unique dir names
+#include <atomic>
 #include <chrono>    // For unique dir names
+#include <cerrno>    // For EIO
+
+#include <cstdlib>   // For malloc/free in the counting operator new
+#include <new>
 
 #include <dirent.h>
 #include <sys/stat.h>
+#include <sys/wait.h> // For waitpid
 #include <unistd.h> // For rmdir (though std::remove is used for files)
 
+// Counts the heap allocations of the calling thread while enabled, for the allocation-free
+// hot path test. Replacing operator new affects the whole test binary but only counts there.
+namespace {
+thread_local bool g_countAllocations = false;
+thread_local size_t g_allocationCount = 0;
+} // namespace
+
+// Not inlined, nor the deletes below: GCC would otherwise see free() applied to the result
+// of malloc() via operator new and warn (-Wmismatched-new-delete).
+#if defined(__GNUC__) || defined(__clang__)
+#define SS_TEST_NOINLINE __attribute__((noinline))
+#else
+#define SS_TEST_NOINLINE
+#endif
+
+SS_TEST_NOINLINE void* operator new(size_t size) {
+    if (g_countAllocations) {
+        ++g_allocationCount;
+    }
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+SS_TEST_NOINLINE void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+SS_TEST_NOINLINE void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
 // For SecureStorage::Crypto components if not fully pulled by SecureStore.h for tests
 // #include "Encryptor.h" // Included via SecureStore.h
 // #include "KeyProvider.h" // Included via SecureStore.h
@@ -93,6 +135,30 @@ protected:
     std::string getBackupFilePath(const std::string& data_id) const {
         return currentTestRootDir + "/" + data_id + DATA_FILE_EXTENSION + BACKUP_FILE_EXTENSION;
     }
+
+    // Flips the last byte of a file (part of the GCM tag) so the record no longer authenticates
+    void corruptFile(const std::string& path) {
+        std::vector<unsigned char> raw;
+        ASSERT_EQ(FileUtil::readFile(path, raw), Errc::Success);
+        ASSERT_FALSE(raw.empty());
+        raw.back() ^= 0xff;
+        ASSERT_EQ(FileUtil::atomicWriteFile(path, raw), Errc::Success);
+    }
+
+    // Decrypts a raw versioned record the same way SecureStore does (header + data_id as AAD,
+    // with the cipher the header names)
+    Errc decryptRecordForTest(SecureStorage::Crypto::Encryptor& encryptor, const std::vector<unsigned char>& key,
+                              const std::string& data_id, const std::vector<unsigned char>& record,
+                              std::vector<unsigned char>& out_plain) {
+        RecordHeader header;
+        size_t offset = RecordFormat::parseHeader(record.data(), record.size(), header);
+        SecureStorage::Crypto::CipherAlgorithm cipher;
+        if (header.version != RECORD_FORMAT_VERSION_CURRENT ||
+            !RecordFormat::cipherForAlgorithmId(header.algorithm, cipher)) return Errc::DeserializationFailed;
+        std::vector<unsigned char> aad;
+        RecordFormat::buildAad(header, data_id, aad);
+        return encryptor.decrypt(record.data() + offset, record.size() - offset, key, out_plain, aad, cipher);
+    }
 };
 
 TEST_F(SecureStoreTest, InitializationSuccess) {
@@ -213,6 +279,190 @@ TEST_F(SecureStoreTest, OverwriteData) {
     ASSERT_EQ(retrieved_data, data2); // Should get the new data
 }
 
+TEST_F(SecureStoreTest, RepeatedOverwritesRotateBackupWithoutLeftovers) {
+    SecureStorage::Crypto::Encryptor encryptor;
+    SecureStorage::Crypto::KeyProvider key_provider(dummySerial);
+    std::vector<unsigned char> key;
+    ASSERT_EQ(key_provider.getEncryptionKey(key, SecureStorage::Crypto::AES_GCM_KEY_SIZE_BYTES), Errc::Success);
+
+    // Both staging strategies must leave the same layout behind.
+    for (int anonymous = 1; anonymous >= 0; --anonymous) {
+        SecureStore store(currentTestRootDir, dummySerial);
+        ASSERT_TRUE(store.isInitialized());
+        store.setAnonymousTempFilesEnabled(anonymous != 0);
+        std::string id = anonymous ? "rotate_anonymous" : "rotate_named";
+
+        for (unsigned char version = 1; version <= 3; ++version) {
+            ASSERT_EQ(store.storeData(id, {version}), Errc::Success);
+        }
+
+        std::vector<unsigned char> record;
+        std::vector<unsigned char> plain;
+        ASSERT_EQ(FileUtil::readFile(getDataFilePath(id), record), Errc::Success);
+        ASSERT_EQ(decryptRecordForTest(encryptor, key, id, record, plain), Errc::Success);
+        EXPECT_EQ(plain, std::vector<unsigned char>{3});
+        ASSERT_EQ(FileUtil::readFile(getBackupFilePath(id), record), Errc::Success);
+        ASSERT_EQ(decryptRecordForTest(encryptor, key, id, record, plain), Errc::Success);
+        EXPECT_EQ(plain, std::vector<unsigned char>{2}); // Backup is always the previous version
+    }
+
+    std::vector<std::string> files;
+    ASSERT_EQ(FileUtil::listDirectory(currentTestRootDir, files), Errc::Success);
+    for (const std::string& name : files) {
+        EXPECT_EQ(name.find(TEMP_FILE_SUFFIX), std::string::npos) << "Leftover temp file: " << name;
+    }
+}
+
+TEST_F(SecureStoreTest, DurabilityLevelsControlFlushes) {
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    EXPECT_EQ(store.getDefaultDurability(), Durability::Full);
+    store.setDeferredSyncInterval(std::chrono::milliseconds(60000)); // Only explicit syncs flush
+
+    struct Case { Durability durability; uint64_t fsyncs; };
+    const Case cases[] = {
+        { Durability::None, 0 },
+        { Durability::Deferred, 0 },
+        { Durability::DataSync, 1 }, // fdatasync of the record
+        { Durability::Full, 2 },     // fsync of the record and of the directory
+    };
+    for (const Case& c : cases) {
+        std::string id = "durability_" + std::to_string(static_cast<int>(c.durability));
+        std::vector<unsigned char> data(32, static_cast<unsigned char>(c.durability));
+        for (int version = 0; version < 2; ++version) { // New id, then overwrite
+            FileIoStats before = store.getIoStats();
+            ASSERT_EQ(store.storeData(id, data, c.durability), Errc::Success);
+            EXPECT_EQ(store.getIoStats().fsyncs - before.fsyncs, c.fsyncs) << id << " version " << version;
+        }
+        std::vector<unsigned char> out;
+        ASSERT_EQ(store.retrieveData(id, out), Errc::Success);
+        EXPECT_EQ(out, data);
+    }
+
+    // The deferred writes are flushed by one syncfs, and only once.
+    FileIoStats before = store.getIoStats();
+    ASSERT_EQ(store.syncDeferred(), Errc::Success);
+    ASSERT_EQ(store.syncDeferred(), Errc::Success);
+    EXPECT_EQ(store.getIoStats().fsyncs - before.fsyncs, 1u);
+
+    // The default applies to calls without an explicit level.
+    store.setDefaultDurability(Durability::None);
+    before = store.getIoStats();
+    ASSERT_EQ(store.storeData("durability_default", {1}), Errc::Success);
+    EXPECT_EQ(store.getIoStats().fsyncs - before.fsyncs, 0u);
+}
+
+TEST_F(SecureStoreTest, DefaultDurabilityChangesWhileOtherThreadsStore) {
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    std::thread writer([&] {
+        for (unsigned char i = 0; i < 20; ++i) {
+            EXPECT_EQ(store.storeData("durability_live", {i}), Errc::Success);
+        }
+    });
+    for (int i = 0; i < 20; ++i) {
+        store.setDefaultDurability(i % 2 ? Durability::Full : Durability::None);
+    }
+    writer.join();
+    std::vector<unsigned char> out;
+    ASSERT_EQ(store.retrieveData("durability_live", out), Errc::Success);
+    EXPECT_EQ(out, std::vector<unsigned char>({19}));
+}
+
+TEST_F(SecureStoreTest, DeferredWritesAreFlushedWithinInterval) {
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    store.setDeferredSyncInterval(std::chrono::milliseconds(20));
+
+    FileIoStats before = store.getIoStats();
+    for (unsigned char i = 0; i < 10; ++i) {
+        ASSERT_EQ(store.storeData("deferred", {i}, Durability::Deferred), Errc::Success);
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (store.getIoStats().fsyncs == before.fsyncs && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    // Ten writes in well under an interval share a single background syncfs.
+    EXPECT_GE(store.getIoStats().fsyncs - before.fsyncs, 1u);
+    EXPECT_LE(store.getIoStats().fsyncs - before.fsyncs, 2u);
+}
+
+TEST_F(SecureStoreTest, CrashAtEveryStepOfStoreDataRecoversOldOrNew) {
+    FaultInjector& injector = FaultInjector::getInstance();
+    const std::vector<unsigned char> v1 = {'v', '1'};
+    const std::vector<unsigned char> v2 = {'v', '2'};
+    const std::vector<unsigned char> v3 = {'v', '3', '!'};
+
+    for (int anonymous = 1; anonymous >= 0; --anonymous) {
+        // Count the calls of one overwrite, so every step of it gets a crash.
+        uint64_t total = 0;
+        {
+            SecureStore store(currentTestRootDir, dummySerial);
+            ASSERT_TRUE(store.isInitialized());
+            store.setAnonymousTempFilesEnabled(anonymous != 0);
+            ASSERT_EQ(store.storeData("probe", v1), Errc::Success);
+            injector.startCounting();
+            ASSERT_EQ(store.storeData("probe", v2), Errc::Success);
+            total = injector.getStats().syscalls;
+            injector.disarm();
+        }
+        ASSERT_GT(total, 0u);
+
+        for (uint64_t n = 1; n <= total; ++n) {
+            std::string id = std::string(anonymous ? "anon_" : "named_") + std::to_string(n);
+            {
+                SecureStore store(currentTestRootDir, dummySerial);
+                ASSERT_TRUE(store.isInitialized());
+                store.setAnonymousTempFilesEnabled(anonymous != 0);
+                ASSERT_EQ(store.storeData(id, v1), Errc::Success);
+                ASSERT_EQ(store.storeData(id, v2), Errc::Success);
+
+                injector.armCrash(n);
+                store.storeData(id, v3);
+                EXPECT_TRUE(injector.crashed()) << id;
+                injector.disarm();
+            }
+
+            // "Reboot": a fresh store on the directory the crashed one left behind.
+            SecureStore recovered(currentTestRootDir, dummySerial);
+            ASSERT_TRUE(recovered.isInitialized());
+            std::vector<unsigned char> out;
+            ASSERT_EQ(recovered.retrieveData(id, out), Errc::Success) << "crash at call " << n << " of " << id;
+            EXPECT_TRUE(out == v2 || out == v3) << "crash at call " << n << " of " << id;
+        }
+    }
+}
+
+TEST_F(SecureStoreTest, InjectedFailureAtEveryStepOfStoreDataIsReported) {
+    FaultInjector& injector = FaultInjector::getInstance();
+    const std::vector<unsigned char> v1 = {'v', '1'};
+    const std::vector<unsigned char> v2 = {'v', '2', '!'};
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+
+    ASSERT_EQ(store.storeData("probe", v1), Errc::Success);
+    injector.startCounting();
+    ASSERT_EQ(store.storeData("probe", v2), Errc::Success);
+    uint64_t total = injector.getStats().syscalls;
+    injector.disarm();
+
+    for (uint64_t n = 1; n <= total; ++n) {
+        std::string id = "fail_" + std::to_string(n);
+        ASSERT_EQ(store.storeData(id, v1), Errc::Success);
+        injector.armFailure(n, EIO);
+        Errc err = store.storeData(id, v2);
+        injector.disarm();
+
+        std::vector<unsigned char> out;
+        ASSERT_EQ(store.retrieveData(id, out), Errc::Success) << "failure at call " << n;
+        if (err == Errc::Success) {
+            EXPECT_EQ(out, v2) << "failure at call " << n << " was absorbed but the write is missing";
+        } else {
+            EXPECT_TRUE(out == v1 || out == v2) << "failure at call " << n;
+        }
+    }
+}
+
 TEST_F(SecureStoreTest, InvalidDataId) {
     SecureStore store(currentTestRootDir, dummySerial);
     ASSERT_TRUE(store.isInitialized());
@@ -257,6 +507,495 @@ TEST_F(SecureStoreTest, ListDataIds) {
     ASSERT_EQ(ids[0], "id2");
 }
 
+TEST_F(SecureStoreTest, StartupRecoveryRemovesTempsAndPromotesOrphanBackups) {
+    {
+        SecureStore store(currentTestRootDir, dummySerial);
+        ASSERT_TRUE(store.isInitialized());
+        ASSERT_EQ(store.storeData("kept", {'k'}), Errc::Success);
+        ASSERT_EQ(store.storeData("orphan", {'o', '1'}), Errc::Success);
+        ASSERT_EQ(store.storeData("orphan", {'o', '2'}), Errc::Success);
+    }
+    // Leftovers of interrupted writes: main gone between the two renames, stale temp files.
+    ASSERT_EQ(std::remove(getDataFilePath("orphan").c_str()), 0);
+    std::ofstream(getDataFilePath("kept") + TEMP_FILE_SUFFIX).put('t');
+    std::ofstream(getDataFilePath("kept") + TEMP_FILE_SUFFIX + TEMP_FILE_SUFFIX).put('t');
+    std::ofstream(getDataFilePath("never_installed") + TEMP_FILE_SUFFIX).put('t');
+
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    RecoveryReport report = store.getRecoveryReport();
+    EXPECT_TRUE(report.ran);
+    EXPECT_EQ(report.entriesScanned, 6u); // Lock file, kept.enc, orphan.enc.bak, 3 temps
+    EXPECT_EQ(report.dataIds, 2u);
+    EXPECT_EQ(report.tempFilesRemoved, 3u);
+    EXPECT_EQ(report.backupsPromoted, 1u);
+    EXPECT_EQ(report.skippedBusy, 0u);
+    EXPECT_EQ(report.failures, 0u);
+
+    EXPECT_FALSE(FileUtil::pathExists(getDataFilePath("kept") + TEMP_FILE_SUFFIX));
+    EXPECT_FALSE(FileUtil::pathExists(getDataFilePath("kept") + TEMP_FILE_SUFFIX + TEMP_FILE_SUFFIX));
+    EXPECT_FALSE(FileUtil::pathExists(getDataFilePath("never_installed") + TEMP_FILE_SUFFIX));
+    EXPECT_FALSE(FileUtil::pathExists(getBackupFilePath("orphan")));
+    std::vector<unsigned char> out;
+    ASSERT_EQ(store.retrieveData("orphan", out), Errc::Success);
+    EXPECT_EQ(out, std::vector<unsigned char>({'o', '1'}));
+
+    std::vector<std::string> ids;
+    ASSERT_EQ(store.listIndexedIds(ids), Errc::Success);
+    EXPECT_EQ(ids, std::vector<std::string>({"kept", "orphan"}));
+}
+
+TEST_F(SecureStoreTest, StartupRecoveryRemovesTempOfInterruptedHistoryCompaction) {
+    const std::string history = getDataFilePath("doc") + HISTORY_FILE_EXTENSION;
+    {
+        SecureStore store(currentTestRootDir, dummySerial);
+        ASSERT_TRUE(store.isInitialized());
+        store.setHistoryDepth(2);
+        ASSERT_EQ(store.storeData("doc", {'1'}), Errc::Success);
+        ASSERT_EQ(store.storeData("doc", {'2'}), Errc::Success);
+    }
+    ASSERT_TRUE(FileUtil::pathExists(history));
+    std::ofstream(history + TEMP_FILE_SUFFIX).put('t'); // Crash before the compacted history was renamed
+
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    RecoveryReport report = store.getRecoveryReport();
+    EXPECT_EQ(report.tempFilesRemoved, 1u);
+    EXPECT_EQ(report.dataIds, 1u);
+    EXPECT_FALSE(FileUtil::pathExists(history + TEMP_FILE_SUFFIX));
+    EXPECT_TRUE(FileUtil::pathExists(history)); // Only the temp goes
+}
+
+TEST_F(SecureStoreTest, StartupRecoveryUsesWorkerPoolForManyRepairs) {
+    {
+        SecureStore store(currentTestRootDir, dummySerial);
+        ASSERT_TRUE(store.isInitialized());
+    }
+    const size_t count = 200;
+    for (size_t i = 0; i < count; ++i) {
+        std::ofstream(getDataFilePath("t" + std::to_string(i)) + TEMP_FILE_SUFFIX).put('t');
+    }
+    RecoveryOptions options;
+    options.workerThreads = 4;
+    SecureStore store(currentTestRootDir, dummySerial, options);
+    ASSERT_TRUE(store.isInitialized());
+    RecoveryReport report = store.getRecoveryReport();
+    EXPECT_EQ(report.workerThreads, 4u);
+    EXPECT_EQ(report.tempFilesRemoved, count);
+    EXPECT_EQ(report.failures, 0u);
+    std::vector<std::string> files;
+    ASSERT_EQ(FileUtil::listDirectory(currentTestRootDir, files), Errc::Success);
+    EXPECT_EQ(files, std::vector<std::string>({LOCK_FILE_NAME}));
+}
+
+TEST_F(SecureStoreTest, StartupRecoveryLeavesIdsOfLiveWritersAlone) {
+    {
+        SecureStore store(currentTestRootDir, dummySerial);
+        ASSERT_TRUE(store.isInitialized());
+    }
+    const std::string temp = getDataFilePath("busy") + TEMP_FILE_SUFFIX;
+    std::ofstream(temp).put('t');
+
+    // Another "process" is in the middle of writing the id.
+    FileLock writer(currentTestRootDir + "/" + LOCK_FILE_NAME);
+    ASSERT_TRUE(writer.isOpen());
+    ASSERT_EQ(writer.lock(FileLock::slotForKey("busy", LOCK_SHARD_COUNT)), Errc::Success);
+
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    EXPECT_EQ(store.getRecoveryReport().skippedBusy, 1u);
+    EXPECT_TRUE(FileUtil::pathExists(temp));
+}
+
+TEST_F(SecureStoreTest, StartupRecoveryCanBeDisabled) {
+    {
+        SecureStore store(currentTestRootDir, dummySerial);
+        ASSERT_TRUE(store.isInitialized());
+    }
+    const std::string temp = getDataFilePath("left") + TEMP_FILE_SUFFIX;
+    std::ofstream(temp).put('t');
+    RecoveryOptions options;
+    options.enabled = false;
+    SecureStore store(currentTestRootDir, dummySerial, options);
+    ASSERT_TRUE(store.isInitialized());
+    EXPECT_FALSE(store.getRecoveryReport().ran);
+    EXPECT_TRUE(FileUtil::pathExists(temp));
+}
+
+TEST_F(SecureStoreTest, IndexedIdsFollowThisStoresWrites) {
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    ASSERT_EQ(store.storeData("b", {'b'}), Errc::Success);
+    ASSERT_EQ(store.storeData("a", {'a'}), Errc::Success);
+    ASSERT_EQ(store.storeData("a", {'A'}), Errc::Success);
+    ASSERT_EQ(store.deleteData("b"), Errc::Success);
+    std::vector<std::string> ids;
+    ASSERT_EQ(store.listIndexedIds(ids), Errc::Success);
+    EXPECT_EQ(ids, std::vector<std::string>({"a"}));
+}
+
+TEST_F(SecureStoreTest, NegativeLookupFilterAnswersMissingIdsWithoutSyscalls) {
+    {
+        SecureStore seed(currentTestRootDir, dummySerial);
+        ASSERT_TRUE(seed.isInitialized());
+        ASSERT_EQ(seed.storeData("existing", {'e'}), Errc::Success);
+    }
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    EXPECT_FALSE(store.getNegativeLookupStats().enabled);
+    ASSERT_EQ(store.enableNegativeLookupFilter(), Errc::Success);
+
+    std::vector<unsigned char> out;
+    uint64_t syscalls_before = store.getIoStats().syscalls;
+    for (int i = 0; i < 200; ++i) {
+        std::string id = "optional_" + std::to_string(i);
+        EXPECT_EQ(store.retrieveData(id, out), Errc::DataNotFound);
+        EXPECT_FALSE(store.dataExists(id));
+    }
+    NegativeLookupStats stats = store.getNegativeLookupStats();
+    EXPECT_TRUE(stats.enabled);
+    EXPECT_EQ(stats.lookups, 400u);
+    EXPECT_EQ(stats.definitelyAbsent + stats.falsePositives, 400u);
+    EXPECT_LT(stats.observedFalsePositiveRate, 0.05);
+    EXPECT_LT(stats.estimatedFalsePositiveRate, 0.01);
+    // Only the false positives went to disk.
+    EXPECT_LE(store.getIoStats().syscalls - syscalls_before, stats.falsePositives * 4);
+
+    // Seeded from the startup scan, then kept up to date by this store's writes.
+    ASSERT_EQ(store.retrieveData("existing", out), Errc::Success);
+    ASSERT_EQ(store.storeData("new", {'n'}), Errc::Success);
+    EXPECT_TRUE(store.dataExists("new"));
+    ASSERT_EQ(store.retrieveData("new", out), Errc::Success);
+    EXPECT_EQ(out, std::vector<unsigned char>({'n'}));
+    ASSERT_EQ(store.deleteData("new"), Errc::Success);
+    EXPECT_EQ(store.retrieveData("new", out), Errc::DataNotFound);
+    EXPECT_EQ(store.getNegativeLookupStats().staleIds, 1u);
+
+    // Growing past the sizing rebuilds the filter without losing ids.
+    for (int i = 0; i < 1100; ++i) {
+        ASSERT_EQ(store.storeData("grow_" + std::to_string(i), {'g'}, Durability::None), Errc::Success);
+    }
+    stats = store.getNegativeLookupStats();
+    EXPECT_GE(stats.rebuilds, 2u);
+    EXPECT_GE(stats.capacity, 1101u);
+    EXPECT_TRUE(store.dataExists("grow_0"));
+    EXPECT_TRUE(store.dataExists("existing"));
+}
+
+TEST_F(SecureStoreTest, NegativeLookupFilterNeedsCompleteIndex) {
+    RecoveryOptions options;
+    options.enabled = false;
+    SecureStore store(currentTestRootDir, dummySerial, options);
+    ASSERT_TRUE(store.isInitialized());
+    EXPECT_EQ(store.enableNegativeLookupFilter(), Errc::OperationFailed);
+    EXPECT_FALSE(store.getNegativeLookupStats().enabled);
+}
+
+TEST_F(SecureStoreTest, HistoryKeepsChangedChunksOfTheLastVersions) {
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    store.setHistoryDepth(3);
+    EXPECT_EQ(store.getHistoryDepth(), 3u);
+
+    std::vector<std::vector<unsigned char>> contents;
+    std::vector<std::chrono::system_clock::time_point> after;
+    std::vector<unsigned char> data(64 * 1024, 'x');
+    for (int v = 0; v < 5; ++v) {
+        data[static_cast<size_t>(v) * 10000] = static_cast<unsigned char>('a' + v); // One chunk changes per write
+        contents.push_back(data);
+        ASSERT_EQ(store.storeData("doc", data), Errc::Success);
+        after.push_back(std::chrono::system_clock::now());
+    }
+
+    std::vector<VersionInfo> versions;
+    ASSERT_EQ(store.listVersions("doc", versions), Errc::Success);
+    ASSERT_EQ(versions.size(), 4u); // Current plus 3 old versions
+    EXPECT_TRUE(versions[0].current);
+    EXPECT_EQ(versions[0].version, 5u);
+    EXPECT_EQ(versions[3].version, 2u);
+    EXPECT_LE(versions[1].storedAt, versions[0].storedAt);
+
+    std::vector<unsigned char> out;
+    for (uint32_t v = 2; v <= 5; ++v) {
+        ASSERT_EQ(store.retrieveData("doc", v, out), Errc::Success) << v;
+        EXPECT_EQ(out, contents[v - 1]) << v;
+    }
+    EXPECT_EQ(store.retrieveData("doc", 1, out), Errc::DataNotFound);
+    ASSERT_EQ(store.retrieveAsOf("doc", after[2], out), Errc::Success);
+    EXPECT_EQ(out, contents[2]);
+    ASSERT_EQ(store.retrieveAsOf("doc", std::chrono::system_clock::now(), out), Errc::Success);
+    EXPECT_EQ(out, contents[4]);
+
+    // Only changed chunks are stored: far less than one full copy per version.
+    std::vector<unsigned char> history;
+    ASSERT_EQ(FileUtil::readFile(getDataFilePath("doc") + HISTORY_FILE_EXTENSION, history), Errc::Success);
+    EXPECT_LT(history.size(), 4 * (HISTORY_CHUNK_SIZE + 200));
+
+    ASSERT_EQ(store.deleteData("doc"), Errc::Success);
+    EXPECT_FALSE(FileUtil::pathExists(getDataFilePath("doc") + HISTORY_FILE_EXTENSION));
+    EXPECT_EQ(store.listVersions("doc", versions), Errc::DataNotFound);
+}
+
+TEST_F(SecureStoreTest, HistoryStaysConsistentWhenMainIsRestoredFromBackup) {
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    store.setHistoryDepth(4);
+    for (unsigned char c = '1'; c <= '4'; ++c) {
+        ASSERT_EQ(store.storeData("cfg", {c}), Errc::Success);
+    }
+    // Version 4 is lost; repair brings back version 3 from the backup.
+    ASSERT_EQ(FileUtil::deleteFile(getDataFilePath("cfg")), Errc::Success);
+    ScrubRecordResult result;
+    ASSERT_EQ(store.scrubRecord("cfg", result), Errc::Success);
+    ASSERT_TRUE(result.mainRepaired);
+
+    std::vector<VersionInfo> versions;
+    ASSERT_EQ(store.listVersions("cfg", versions), Errc::Success);
+    ASSERT_EQ(versions.size(), 3u);
+    EXPECT_EQ(versions[0].version, 3u);
+    std::vector<unsigned char> out;
+    ASSERT_EQ(store.retrieveData("cfg", 1, out), Errc::Success);
+    EXPECT_EQ(out, std::vector<unsigned char>({'1'}));
+
+    // The next write continues from the restored version.
+    ASSERT_EQ(store.storeData("cfg", {'5'}), Errc::Success);
+    ASSERT_EQ(store.listVersions("cfg", versions), Errc::Success);
+    ASSERT_EQ(versions.size(), 4u);
+    EXPECT_EQ(versions[0].version, 4u);
+    ASSERT_EQ(store.retrieveData("cfg", 3, out), Errc::Success);
+    EXPECT_EQ(out, std::vector<unsigned char>({'3'}));
+}
+
+TEST_F(SecureStoreTest, HistoryFrameCannotBeReplantedAsDataRecord) {
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    store.setHistoryDepth(2);
+    ASSERT_EQ(store.storeData("doc", {'o', 'l', 'd'}), Errc::Success);
+    ASSERT_EQ(store.storeData("doc", {'n', 'e', 'w'}), Errc::Success);
+
+    // The frame is sealed for the AAD id "doc.enc.hist", which is also a valid data id.
+    std::vector<unsigned char> history;
+    ASSERT_EQ(FileUtil::readFile(getDataFilePath("doc") + HISTORY_FILE_EXTENSION, history), Errc::Success);
+    ASSERT_GT(history.size(), 4u);
+    std::vector<unsigned char> frame(history.begin() + 4, history.end()); // One frame: skip its length
+    const std::string planted_id = "doc" + DATA_FILE_EXTENSION + HISTORY_FILE_EXTENSION;
+    ASSERT_EQ(FileUtil::atomicWriteFile(getDataFilePath(planted_id), frame), Errc::Success);
+
+    std::vector<unsigned char> out;
+    EXPECT_NE(store.retrieveData(planted_id, out), Errc::Success);
+    EXPECT_TRUE(out.empty());
+}
+
+TEST_F(SecureStoreTest, HistoryAppendDoesNotReadTheWholeHistory) {
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    store.setHistoryDepth(32);
+    for (unsigned char c = 0; c < 20; ++c) {
+        ASSERT_EQ(store.storeData("cfg", {c}), Errc::Success);
+    }
+    std::vector<unsigned char> history;
+    ASSERT_EQ(FileUtil::readFile(getDataFilePath("cfg") + HISTORY_FILE_EXTENSION, history), Errc::Success);
+
+    uint64_t bytes_read_before = store.getIoStats().bytesRead;
+    ASSERT_EQ(store.storeData("cfg", {20}), Errc::Success);
+    EXPECT_LT(store.getIoStats().bytesRead - bytes_read_before, history.size() / 2); // Only the main file
+
+    // A second store appending to the same history makes the first one's head stale.
+    SecureStore other(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(other.isInitialized());
+    other.setHistoryDepth(32);
+    ASSERT_EQ(other.storeData("cfg", {21}), Errc::Success);
+    ASSERT_EQ(store.storeData("cfg", {22}), Errc::Success);
+
+    std::vector<VersionInfo> versions;
+    ASSERT_EQ(store.listVersions("cfg", versions), Errc::Success);
+    ASSERT_EQ(versions.size(), 23u);
+    EXPECT_EQ(versions[0].version, 23u);
+    std::vector<unsigned char> out;
+    for (uint32_t v = 1; v <= 23; ++v) {
+        ASSERT_EQ(store.retrieveData("cfg", v, out), Errc::Success) << v;
+        EXPECT_EQ(out, std::vector<unsigned char>({static_cast<unsigned char>(v - 1)})) << v;
+    }
+}
+
+TEST_F(SecureStoreTest, PrefetchTurnsLaterReadsIntoCacheHits) {
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    std::vector<std::string> ids;
+    for (int i = 0; i < 40; ++i) {
+        ids.push_back("boot_" + std::to_string(i));
+        ASSERT_EQ(store.storeData(ids.back(), std::vector<unsigned char>(100, static_cast<unsigned char>(i))), Errc::Success);
+    }
+
+    PrefetchReport report;
+    ASSERT_EQ(store.prefetch(ids, report), Errc::OperationFailed); // Cache not enabled yet
+    ASSERT_EQ(store.enablePlaintextCache(), Errc::Success);
+
+    std::vector<std::string> request = ids;
+    request.push_back("boot_0");      // Duplicate
+    request.push_back("never_stored");
+    request.push_back("../escape");   // Invalid
+    ASSERT_EQ(store.prefetch(request, report, 4), Errc::Success);
+    EXPECT_EQ(report.requested, ids.size() + 1);
+    EXPECT_EQ(report.loaded, ids.size());
+    EXPECT_EQ(report.notFound, 1u);
+    EXPECT_EQ(report.failed, 1u);
+    EXPECT_EQ(report.workerThreads, 4u);
+
+    uint64_t bytes_read_before = store.getIoStats().bytesRead;
+    std::vector<unsigned char> out;
+    for (int i = 0; i < 40; ++i) {
+        ASSERT_EQ(store.retrieveData(ids[i], out), Errc::Success);
+        ASSERT_EQ(out, std::vector<unsigned char>(100, static_cast<unsigned char>(i)));
+    }
+    EXPECT_EQ(store.getIoStats().bytesRead, bytes_read_before); // Served from memory
+
+    PlaintextCacheStats stats = store.getPlaintextCacheStats();
+    EXPECT_EQ(stats.hits, ids.size());
+    EXPECT_EQ(stats.prefetchedEntries, ids.size());
+    EXPECT_EQ(stats.prefetchHits, ids.size());
+
+    // A second prefetch finds everything cached.
+    ASSERT_EQ(store.prefetch(ids, report), Errc::Success);
+    EXPECT_EQ(report.alreadyCached, ids.size());
+    EXPECT_EQ(report.loaded, 0u);
+}
+
+TEST_F(SecureStoreTest, PlaintextCacheDropsEntryChangedByAnotherStore) {
+    SecureStore reader(currentTestRootDir, dummySerial);
+    SecureStore writer(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(reader.isInitialized());
+    ASSERT_TRUE(writer.isInitialized());
+    ASSERT_EQ(reader.enablePlaintextCache(), Errc::Success);
+
+    ASSERT_EQ(writer.storeData("shared_id", {'o', 'l', 'd'}), Errc::Success);
+    std::vector<unsigned char> out;
+    ASSERT_EQ(reader.retrieveData("shared_id", out), Errc::Success); // Fills the cache
+    ASSERT_EQ(reader.retrieveData("shared_id", out), Errc::Success);
+    EXPECT_EQ(reader.getPlaintextCacheStats().hits, 1u);
+
+    // The writer cannot reach the reader's cache; the changed file identity must.
+    ASSERT_EQ(writer.storeData("shared_id", {'n', 'e', 'w'}), Errc::Success);
+    ASSERT_EQ(reader.retrieveData("shared_id", out), Errc::Success);
+    EXPECT_EQ(out, std::vector<unsigned char>({'n', 'e', 'w'}));
+    EXPECT_EQ(reader.getPlaintextCacheStats().staleDrops, 1u);
+
+    // Writes and deletes through the caching store drop its entry directly.
+    ASSERT_EQ(reader.deleteData("shared_id"), Errc::Success);
+    EXPECT_NE(reader.retrieveData("shared_id", out), Errc::Success);
+}
+
+TEST_F(SecureStoreTest, HotSetIsLearnedAndPersistedAcrossReopen) {
+    {
+        SecureStore store(currentTestRootDir, dummySerial);
+        ASSERT_TRUE(store.isInitialized());
+        ASSERT_EQ(store.storeData("often", {'1'}), Errc::Success);
+        ASSERT_EQ(store.storeData("sometimes", {'2'}), Errc::Success);
+        ASSERT_EQ(store.storeData("deleted", {'3'}), Errc::Success);
+        std::vector<unsigned char> out;
+        for (int i = 0; i < 5; ++i) ASSERT_EQ(store.retrieveData("often", out), Errc::Success);
+        for (int i = 0; i < 2; ++i) ASSERT_EQ(store.retrieveData("sometimes", out), Errc::Success);
+        ASSERT_EQ(store.retrieveData("deleted", out), Errc::Success);
+        ASSERT_EQ(store.deleteData("deleted"), Errc::Success);
+        ASSERT_EQ(store.saveHotSet(), Errc::Success);
+    }
+
+    SecureStore reopened(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(reopened.isInitialized());
+    std::vector<std::string> hot = reopened.getHotSet();
+    EXPECT_EQ(hot, std::vector<std::string>({"often", "sometimes"}));
+
+    // The hot set file is not mistaken for a record.
+    std::vector<std::string> ids;
+    ASSERT_EQ(reopened.listDataIds(ids), Errc::Success);
+    EXPECT_EQ(ids, std::vector<std::string>({"often", "sometimes"}));
+
+    ASSERT_EQ(reopened.enablePlaintextCache(), Errc::Success);
+    PrefetchReport report;
+    ASSERT_EQ(reopened.prefetch(hot, report), Errc::Success);
+    EXPECT_EQ(report.loaded, 2u);
+}
+
+TEST_F(SecureStoreTest, ScrubRecordRepairsWhicheverCopyIsDamaged) {
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    std::vector<unsigned char> v1 = {'v', '1'};
+    std::vector<unsigned char> v2 = {'v', '2'};
+    ASSERT_EQ(store.storeData("id", v1), Errc::Success);
+    ASSERT_EQ(store.storeData("id", v2), Errc::Success);
+
+    ScrubRecordResult result;
+    ASSERT_EQ(store.scrubRecord("id", result), Errc::Success);
+    EXPECT_TRUE(result.mainValid);
+    EXPECT_TRUE(result.backupValid);
+    EXPECT_FALSE(result.mainRepaired || result.backupRepaired || result.unrecoverable);
+    EXPECT_GT(result.bytesRead, 0u);
+
+    corruptFile(getBackupFilePath("id"));
+    ASSERT_EQ(store.scrubRecord("id", result), Errc::Success);
+    EXPECT_TRUE(result.backupRepaired);
+    ScrubRecordResult recheck;
+    ASSERT_EQ(store.scrubRecord("id", recheck), Errc::Success);
+    EXPECT_TRUE(recheck.backupValid);
+
+    corruptFile(getDataFilePath("id"));
+    ASSERT_EQ(store.scrubRecord("id", result), Errc::Success);
+    EXPECT_TRUE(result.mainRepaired);
+    std::vector<unsigned char> out;
+    ASSERT_EQ(store.retrieveData("id", out), Errc::Success);
+    EXPECT_EQ(out, v2); // The backup had been rewritten from the newest version
+
+    corruptFile(getDataFilePath("id"));
+    corruptFile(getBackupFilePath("id"));
+    ASSERT_EQ(store.scrubRecord("id", result), Errc::Success);
+    EXPECT_TRUE(result.unrecoverable);
+
+    EXPECT_EQ(store.scrubRecord("never_stored", result), Errc::DataNotFound);
+}
+
+TEST_F(SecureStoreTest, ScrubberPassRepairsInBackgroundWithinBudget) {
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    const int id_count = 10;
+    for (int i = 0; i < id_count; ++i) {
+        std::string id = "scrub_" + std::to_string(i);
+        ASSERT_EQ(store.storeData(id, std::vector<unsigned char>(1000, 'a')), Errc::Success);
+        ASSERT_EQ(store.storeData(id, std::vector<unsigned char>(1000, 'b')), Errc::Success);
+    }
+    corruptFile(getDataFilePath("scrub_3"));
+    corruptFile(getBackupFilePath("scrub_7"));
+
+    // About 20 KiB to read at 100 KiB/s: the pass must take at least ~0.2 s.
+    ScrubOptions options;
+    options.startDelay = std::chrono::milliseconds(0);
+    options.bytesPerSecond = 100 * 1024;
+    ASSERT_EQ(store.startScrubber(options), Errc::Success);
+    EXPECT_EQ(store.startScrubber(options), Errc::OperationFailed);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (store.getScrubStats().passesCompleted == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ScrubStats stats = store.getScrubStats();
+    ASSERT_EQ(stats.passesCompleted, 1u);
+    EXPECT_EQ(stats.passRecordsTotal, static_cast<size_t>(id_count));
+    EXPECT_EQ(stats.passRecordsDone, static_cast<size_t>(id_count));
+    EXPECT_EQ(stats.mainRepairs, 1u);
+    EXPECT_EQ(stats.backupRepairs, 1u);
+    EXPECT_EQ(stats.unrecoverable, 0u);
+    EXPECT_GE(stats.lastPassDuration.count(), 150);
+
+    // Stopping does not wait for the (24 h) interval.
+    auto stop_start = std::chrono::steady_clock::now();
+    store.stopScrubber();
+    EXPECT_LT(std::chrono::steady_clock::now() - stop_start, std::chrono::seconds(1));
+    EXPECT_EQ(store.getScrubStats().passesCompleted, 0u);
+
+    std::vector<unsigned char> out;
+    ASSERT_EQ(store.retrieveData("scrub_3", out), Errc::Success);
+    EXPECT_EQ(out, std::vector<unsigned char>(1000, 'a')); // Restored from the previous version
+}
+
 TEST_F(SecureStoreTest, RetrieveFromBackupAndRestore) {
     SecureStore store(currentTestRootDir, dummySerial);
     ASSERT_TRUE(store.isInitialized());
@@ -284,7 +1023,7 @@ TEST_F(SecureStoreTest, RetrieveFromBackupAndRestore) {
     std::unique_ptr<SecureStorage::Crypto::KeyProvider> temp_kp(new SecureStorage::Crypto::KeyProvider(dummySerial)); // Fully qualify namespace
     std::vector<unsigned char> master_key_for_test;
     ASSERT_EQ(temp_kp->getEncryptionKey(master_key_for_test, SecureStorage::Crypto::AES_GCM_KEY_SIZE_BYTES), Errc::Success); // Fully qualify namespace
-    ASSERT_EQ(temp_encryptor.decrypt(backup_encrypted_content, master_key_for_test, backup_decrypted_content), Errc::Success);
+    ASSERT_EQ(decryptRecordForTest(temp_encryptor, master_key_for_test, id, backup_encrypted_content, backup_decrypted_content), Errc::Success);
     ASSERT_EQ(backup_decrypted_content, data); // Backup has original data
 
     // Now corrupt the main file (which has data_v2)
@@ -294,18 +1033,64 @@ TEST_F(SecureStoreTest, RetrieveFromBackupAndRestore) {
     ofs.close();
 
     std::vector<unsigned char> retrieved_data;
-    // This retrieveData should fail on main, then read backup (original 'data'), decrypt it, and restore it to main.
+    // This retrieveData should fail on main, then read backup (original 'data'), decrypt it, and queue a restore to main.
     ASSERT_EQ(store.retrieveData(id, retrieved_data), Errc::Success);
     ASSERT_EQ(retrieved_data, data); // Should be original 'data' from backup
+    ASSERT_EQ(store.runPendingRepairs(), Errc::Success); // Don't wait for the repair thread
 
     // Verify main file was restored with backup's content
     std::vector<unsigned char> main_file_content_after_restore_encrypted;
     ASSERT_EQ(FileUtil::readFile(mainFile, main_file_content_after_restore_encrypted), Errc::Success);
     std::vector<unsigned char> main_file_content_after_restore_decrypted;
-    ASSERT_EQ(temp_encryptor.decrypt(main_file_content_after_restore_encrypted, master_key_for_test, main_file_content_after_restore_decrypted), Errc::Success);
+    ASSERT_EQ(decryptRecordForTest(temp_encryptor, master_key_for_test, id, main_file_content_after_restore_encrypted, main_file_content_after_restore_decrypted), Errc::Success);
     ASSERT_EQ(main_file_content_after_restore_decrypted, data);
 }
 
+TEST_F(SecureStoreTest, BackupReadsQueueOneRepairThatRetriesWhileBusy) {
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    const std::string id = "queued_repair";
+    std::vector<unsigned char> v1 = {'o', 'n', 'e'};
+    ASSERT_EQ(store.storeData(id, v1), Errc::Success);
+    ASSERT_EQ(store.storeData(id, {'t', 'w', 'o'}), Errc::Success);
+    corruptFile(getDataFilePath(id));
+    std::vector<unsigned char> corrupt_main;
+    ASSERT_EQ(FileUtil::readFile(getDataFilePath(id), corrupt_main), Errc::Success);
+
+    // A writer in "another process" holds the id, so the repair thread cannot restore it yet.
+    FileLock writer(currentTestRootDir + "/" + LOCK_FILE_NAME);
+    uint64_t slot = FileLock::slotForKey(id, LOCK_SHARD_COUNT);
+    ASSERT_EQ(writer.lock(slot), Errc::Success);
+
+    std::vector<unsigned char> out;
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_EQ(store.retrieveData(id, out), Errc::Success);
+        ASSERT_EQ(out, v1);
+    }
+    RepairStats stats = store.getRepairStats();
+    EXPECT_EQ(stats.enqueued, 1u);
+    EXPECT_EQ(stats.deduplicated, 4u);
+    EXPECT_EQ(stats.pending, 1u);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (store.getRepairStats().retries == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_GE(store.getRepairStats().retries, 1u);
+    std::vector<unsigned char> still_corrupt;
+    ASSERT_EQ(FileUtil::readFile(getDataFilePath(id), still_corrupt), Errc::Success);
+    EXPECT_EQ(still_corrupt, corrupt_main); // Nothing was written under the writer's lock
+
+    writer.unlock(slot);
+    ASSERT_EQ(store.runPendingRepairs(), Errc::Success);
+    stats = store.getRepairStats();
+    EXPECT_EQ(stats.repaired, 1u);
+    EXPECT_EQ(stats.pending, 0u);
+    ScrubRecordResult result;
+    ASSERT_EQ(store.scrubRecord(id, result), Errc::Success);
+    EXPECT_TRUE(result.mainValid);
+}
+
 TEST_F(SecureStoreTest, RetrieveFailsIfMainCorruptAndBackupMissing) {
     SecureStore store(currentTestRootDir, dummySerial);
     ASSERT_TRUE(store.isInitialized());
@@ -359,4 +1144,696 @@ TEST_F(SecureStoreTest, RetrieveFailsIfMainMissingAndBackupCorrupt) {
     ASSERT_TRUE(result == Errc::AuthenticationFailed || result == Errc::DecryptionFailed)
         << SecureStorageErrorCategory::get().message(static_cast<int>(result));
     ASSERT_TRUE(retrieved_data.empty());
-}
\ No newline at end of file
+}
+
+TEST_F(SecureStoreTest, StoredRecordHasVersionedHeader) {
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    std::vector<unsigned char> data = {'h', 'd', 'r'};
+    ASSERT_EQ(store.storeData("header_id", data), Errc::Success);
+
+    std::vector<unsigned char> raw;
+    ASSERT_EQ(FileUtil::readFile(getDataFilePath("header_id"), raw), Errc::Success);
+    RecordHeader header;
+    ASSERT_EQ(RecordFormat::parseHeader(raw.data(), raw.size(), header), RECORD_HEADER_SIZE);
+    ASSERT_EQ(header.version, RECORD_FORMAT_VERSION_CURRENT);
+    ASSERT_EQ(raw.size(), RECORD_HEADER_SIZE + SecureStorage::Crypto::AES_GCM_IV_SIZE_BYTES + data.size() +
+                          SecureStorage::Crypto::AES_GCM_TAG_SIZE_BYTES);
+}
+
+TEST_F(SecureStoreTest, SwappedRecordFailsAuthentication) {
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    ASSERT_EQ(store.storeData("id_a", {'a', 'a', 'a'}), Errc::Success);
+    ASSERT_EQ(store.storeData("id_b", {'b', 'b', 'b'}), Errc::Success);
+
+    // Copy a.enc over b.enc: the record is bound to "id_a" and must not authenticate as "id_b".
+    std::vector<unsigned char> record_a;
+    ASSERT_EQ(FileUtil::readFile(getDataFilePath("id_a"), record_a), Errc::Success);
+    ASSERT_EQ(FileUtil::atomicWriteFile(getDataFilePath("id_b"), record_a), Errc::Success);
+
+    // Main fails authentication and there is no backup for id_b, so nothing is returned.
+    std::vector<unsigned char> retrieved_data;
+    ASSERT_NE(store.retrieveData("id_b", retrieved_data), Errc::Success);
+    ASSERT_TRUE(retrieved_data.empty());
+}
+
+TEST_F(SecureStoreTest, LargeRecordIsSegmentedAndEverySegmentIsAuthenticated) {
+    SegmentOptions options;
+    options.threshold = 1000;
+    options.segmentSize = 256;
+    options.workers = 4;
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    store.setSegmentOptions(options);
+
+    std::vector<unsigned char> data(3000);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<unsigned char>(i * 7);
+    }
+    const std::vector<std::string> ids = {"seg_ok", "seg_flipped", "seg_swapped", "seg_truncated"};
+    for (const std::string& id : ids) {
+        ASSERT_EQ(store.storeData(id, data), Errc::Success);
+    }
+    ASSERT_EQ(store.storeData("small_id", {'s'}), Errc::Success);
+
+    std::vector<unsigned char> raw;
+    RecordHeader header;
+    ASSERT_EQ(FileUtil::readFile(getDataFilePath("seg_ok"), raw), Errc::Success);
+    ASSERT_EQ(RecordFormat::parseHeader(raw.data(), raw.size(), header), RECORD_HEADER_SIZE);
+    EXPECT_EQ(header.version, RECORD_FORMAT_VERSION_SEGMENTED);
+    // 12 segments: table head (16), base IV, one tag per segment and the table tag, then the ciphertext.
+    const size_t table_size = 16 + SecureStorage::Crypto::AES_GCM_IV_SIZE_BYTES + 13 * SecureStorage::Crypto::AES_GCM_TAG_SIZE_BYTES;
+    ASSERT_EQ(raw.size(), RECORD_HEADER_SIZE + table_size + data.size());
+    ASSERT_EQ(FileUtil::readFile(getDataFilePath("small_id"), raw), Errc::Success);
+    RecordFormat::parseHeader(raw.data(), raw.size(), header);
+    EXPECT_EQ(header.version, RECORD_FORMAT_VERSION_CURRENT);
+
+    // One flipped ciphertext byte in a middle segment.
+    ASSERT_EQ(FileUtil::readFile(getDataFilePath("seg_flipped"), raw), Errc::Success);
+    raw[RECORD_HEADER_SIZE + table_size + 5 * 256 + 3] ^= 0x01;
+    ASSERT_EQ(FileUtil::atomicWriteFile(getDataFilePath("seg_flipped"), raw), Errc::Success);
+    // Segments 2 and 3 exchanged, ciphertext and tags alike.
+    ASSERT_EQ(FileUtil::readFile(getDataFilePath("seg_swapped"), raw), Errc::Success);
+    const size_t tags = RECORD_HEADER_SIZE + 16 + SecureStorage::Crypto::AES_GCM_IV_SIZE_BYTES;
+    const size_t tag_size = SecureStorage::Crypto::AES_GCM_TAG_SIZE_BYTES;
+    std::swap_ranges(raw.begin() + tags + 2 * tag_size, raw.begin() + tags + 3 * tag_size, raw.begin() + tags + 3 * tag_size);
+    const size_t cipher = RECORD_HEADER_SIZE + table_size;
+    std::swap_ranges(raw.begin() + cipher + 2 * 256, raw.begin() + cipher + 3 * 256, raw.begin() + cipher + 3 * 256);
+    ASSERT_EQ(FileUtil::atomicWriteFile(getDataFilePath("seg_swapped"), raw), Errc::Success);
+    // The last segment dropped.
+    ASSERT_EQ(FileUtil::readFile(getDataFilePath("seg_truncated"), raw), Errc::Success);
+    raw.resize(raw.size() - (data.size() - 11 * 256));
+    ASSERT_EQ(FileUtil::atomicWriteFile(getDataFilePath("seg_truncated"), raw), Errc::Success);
+
+    // Readable whatever the reader's own options, including by a store that never segments.
+    SegmentOptions never;
+    never.threshold = 0;
+    SecureStore reader(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(reader.isInitialized());
+    reader.setSegmentOptions(never);
+    std::vector<unsigned char> retrieved;
+    ASSERT_EQ(reader.retrieveData("seg_ok", retrieved), Errc::Success);
+    EXPECT_EQ(retrieved, data);
+    for (size_t i = 1; i < ids.size(); ++i) {
+        EXPECT_NE(reader.retrieveData(ids[i], retrieved), Errc::Success) << ids[i];
+        EXPECT_TRUE(retrieved.empty()) << ids[i];
+    }
+}
+
+TEST_F(SecureStoreTest, RecordsOfEitherCipherStayReadable) {
+    using SecureStorage::Crypto::CipherAlgorithm;
+    SegmentOptions options;
+    options.threshold = 1000;
+    options.segmentSize = 256;
+    std::vector<unsigned char> large(2000, 0x6c);
+    {
+        SecureStore writer(currentTestRootDir, dummySerial);
+        ASSERT_TRUE(writer.isInitialized());
+        writer.setSegmentOptions(options);
+        writer.setCipherAlgorithm(CipherAlgorithm::Aes256Gcm);
+        ASSERT_EQ(writer.storeData("aes_id", {'a', 'e', 's'}), Errc::Success);
+        writer.setCipherAlgorithm(CipherAlgorithm::ChaCha20Poly1305);
+        ASSERT_EQ(writer.getCipherAlgorithm(), CipherAlgorithm::ChaCha20Poly1305);
+        ASSERT_EQ(writer.storeData("chacha_id", {'c', 'h', 'a'}), Errc::Success);
+        ASSERT_EQ(writer.storeData("chacha_large_id", large), Errc::Success);
+    }
+
+    const std::pair<std::string, uint8_t> expected[] = {
+        {"aes_id", RECORD_ALGORITHM_AES_256_GCM},
+        {"chacha_id", RECORD_ALGORITHM_CHACHA20_POLY1305},
+        {"chacha_large_id", RECORD_ALGORITHM_CHACHA20_POLY1305},
+    };
+    for (const auto& entry : expected) {
+        std::vector<unsigned char> raw;
+        ASSERT_EQ(FileUtil::readFile(getDataFilePath(entry.first), raw), Errc::Success);
+        RecordHeader header;
+        RecordFormat::parseHeader(raw.data(), raw.size(), header);
+        EXPECT_EQ(header.algorithm, entry.second) << entry.first;
+    }
+
+    // A reader whose own cipher is either one reads both.
+    for (CipherAlgorithm own : {CipherAlgorithm::Aes256Gcm, CipherAlgorithm::ChaCha20Poly1305}) {
+        SecureStore reader(currentTestRootDir, dummySerial);
+        ASSERT_TRUE(reader.isInitialized());
+        reader.setCipherAlgorithm(own);
+        std::vector<unsigned char> out;
+        ASSERT_EQ(reader.retrieveData("aes_id", out), Errc::Success);
+        EXPECT_EQ(out, std::vector<unsigned char>({'a', 'e', 's'}));
+        ASSERT_EQ(reader.retrieveData("chacha_id", out), Errc::Success);
+        EXPECT_EQ(out, std::vector<unsigned char>({'c', 'h', 'a'}));
+        ASSERT_EQ(reader.retrieveData("chacha_large_id", out), Errc::Success);
+        EXPECT_EQ(out, large);
+    }
+
+    // Relabelling a record with the other cipher's id fails: the header is part of the AAD.
+    std::vector<unsigned char> raw;
+    ASSERT_EQ(FileUtil::readFile(getDataFilePath("chacha_id"), raw), Errc::Success);
+    raw[RECORD_MAGIC_SIZE + 1] = RECORD_ALGORITHM_AES_256_GCM;
+    ASSERT_EQ(FileUtil::atomicWriteFile(getDataFilePath("chacha_id"), raw), Errc::Success);
+    SecureStore reader(currentTestRootDir, dummySerial);
+    std::vector<unsigned char> out;
+    EXPECT_NE(reader.retrieveData("chacha_id", out), Errc::Success);
+}
+
+TEST_F(SecureStoreTest, CallerBuffersStoreAndRetrieveWithSizeQuery) {
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    SegmentOptions options;
+    options.threshold = 1000;
+    options.segmentSize = 256;
+    store.setSegmentOptions(options);
+
+    const std::string small = "stored straight from a std::string";
+    const std::string large(3000, 'z'); // Segmented
+    for (const std::string* text : {&small, &large}) {
+        const std::string id = text == &small ? "span_small" : "span_large";
+        ASSERT_EQ(store.storeData(id, reinterpret_cast<const unsigned char*>(text->data()), text->size()), Errc::Success);
+
+        // The size query decrypts nothing; the vector API reads the same record.
+        size_t size = 0;
+        ASSERT_EQ(store.retrieveData(id, nullptr, 0, size), Errc::BufferTooSmall);
+        ASSERT_EQ(size, text->size());
+        std::vector<unsigned char> buffer(size + 8, 0xee);
+        ASSERT_EQ(store.retrieveData(id, buffer.data(), size - 1, size), Errc::BufferTooSmall);
+        EXPECT_EQ(buffer[0], 0xee);
+        ASSERT_EQ(store.retrieveData(id, buffer.data(), buffer.size(), size), Errc::Success);
+        ASSERT_EQ(size, text->size());
+        EXPECT_EQ(std::string(buffer.begin(), buffer.begin() + size), *text);
+        std::vector<unsigned char> out;
+        ASSERT_EQ(store.retrieveData(id, out), Errc::Success);
+        EXPECT_EQ(std::string(out.begin(), out.end()), *text);
+    }
+
+    // Plaintext cache hits and unknown ids report like file reads do.
+    ASSERT_EQ(store.enablePlaintextCache(1 << 20), Errc::Success);
+    std::vector<unsigned char> buffer(small.size());
+    size_t size = 0;
+    for (int pass = 0; pass < 2; ++pass) {
+        ASSERT_EQ(store.retrieveData("span_small", buffer.data(), buffer.size(), size), Errc::Success);
+        EXPECT_EQ(std::string(buffer.begin(), buffer.end()), small);
+        ASSERT_EQ(store.retrieveData("span_small", buffer.data(), 1, size), Errc::BufferTooSmall);
+        EXPECT_EQ(size, small.size());
+    }
+    EXPECT_EQ(store.retrieveData("span_missing", buffer.data(), buffer.size(), size), Errc::DataNotFound);
+    EXPECT_EQ(size, 0u);
+
+    // Empty data needs no buffer; a null pointer with a size is rejected.
+    ASSERT_EQ(store.storeData("span_empty", nullptr, 0), Errc::Success);
+    ASSERT_EQ(store.retrieveData("span_empty", nullptr, 0, size), Errc::Success);
+    EXPECT_EQ(size, 0u);
+    EXPECT_EQ(store.storeData("span_null", nullptr, 4), Errc::InvalidArgument);
+
+    // A tampered record fails to authenticate through the buffer API too.
+    corruptFile(getDataFilePath("span_large"));
+    std::vector<unsigned char> large_buffer(large.size());
+    EXPECT_NE(store.retrieveData("span_large", large_buffer.data(), large_buffer.size(), size), Errc::Success);
+}
+
+TEST_F(SecureStoreTest, RetrieveIntoSecureBytes) {
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    std::vector<unsigned char> small(40, 0x3C);
+    std::vector<unsigned char> large(5000, 0xC3);
+    ASSERT_EQ(store.storeData("secure_small", small), Errc::Success);
+    ASSERT_EQ(store.storeData("secure_large", large), Errc::Success);
+
+    SecureBytes out;
+    ASSERT_EQ(store.retrieveData("secure_small", out), Errc::Success);
+    EXPECT_TRUE(std::equal(small.begin(), small.end(), out.begin()));
+    EXPECT_EQ(out.size(), small.size());
+    ASSERT_EQ(store.retrieveData("secure_large", out), Errc::Success); // Grows after a size query
+    EXPECT_EQ(out.size(), large.size());
+    EXPECT_TRUE(std::equal(large.begin(), large.end(), out.begin()));
+    ASSERT_EQ(store.retrieveData("secure_small", out), Errc::Success); // Shrinks within its capacity
+    EXPECT_EQ(out.size(), small.size());
+
+    EXPECT_EQ(store.retrieveData("secure_missing", out), Errc::DataNotFound);
+    EXPECT_TRUE(out.empty());
+}
+
+TEST_F(SecureStoreTest, MovedInBufferIsEncryptedInPlace) {
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    SegmentOptions options;
+    options.threshold = 1000;
+    options.segmentSize = 256;
+    store.setSegmentOptions(options);
+
+    std::vector<unsigned char> buffer;
+    for (size_t size : {static_cast<size_t>(300), static_cast<size_t>(3000)}) { // Plain and segmented
+        const std::string id = "in_place_" + std::to_string(size);
+        std::vector<unsigned char> expected(size);
+        for (size_t i = 0; i < size; ++i) {
+            expected[i] = static_cast<unsigned char>(i * 7);
+        }
+        buffer.reserve(size + store.recordOverhead(size));
+        buffer.assign(expected.begin(), expected.end());
+        const unsigned char* storage = buffer.data();
+        const size_t capacity = buffer.capacity();
+
+        ASSERT_EQ(store.storeData(id, std::move(buffer)), Errc::Success);
+        // Encrypted where it was, and handed back empty for the next record.
+        EXPECT_TRUE(buffer.empty());
+        EXPECT_EQ(buffer.data(), storage);
+        EXPECT_EQ(buffer.capacity(), capacity);
+        EXPECT_TRUE(std::all_of(storage, storage + size, [](unsigned char c) { return c == 0; }));
+
+        std::vector<unsigned char> raw;
+        ASSERT_EQ(FileUtil::readFile(getDataFilePath(id), raw), Errc::Success);
+        EXPECT_EQ(raw.size(), size + store.recordOverhead(size));
+        std::vector<unsigned char> out;
+        ASSERT_EQ(store.retrieveData(id, out), Errc::Success);
+        EXPECT_EQ(out, expected);
+    }
+
+    // With a history, the new plaintext outlives encryption; the buffer is still emptied.
+    store.setHistoryDepth(2);
+    buffer.assign(500, 0x42);
+    ASSERT_EQ(store.storeData("in_place_300", std::move(buffer)), Errc::Success);
+    EXPECT_TRUE(buffer.empty());
+    std::vector<unsigned char> out;
+    ASSERT_EQ(store.retrieveData("in_place_300", out), Errc::Success);
+    EXPECT_EQ(out, std::vector<unsigned char>(500, 0x42));
+    std::vector<VersionInfo> versions;
+    ASSERT_EQ(store.listVersions("in_place_300", versions), Errc::Success);
+    EXPECT_EQ(versions.size(), 2u);
+
+    buffer.assign(10, 0x01);
+    EXPECT_EQ(store.storeData("bad/id", std::move(buffer)), Errc::InvalidArgument);
+    EXPECT_TRUE(buffer.empty());
+}
+
+TEST_F(SecureStoreTest, LegacyRecordIsReadAndUpgradedOnWrite) {
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    std::string id = "legacy_id";
+    std::vector<unsigned char> data = {'o', 'l', 'd', 'f', 'm', 't'};
+
+    // Write a headerless, AAD-less record as older library versions did.
+    SecureStorage::Crypto::Encryptor legacy_encryptor;
+    SecureStorage::Crypto::KeyProvider kp(dummySerial);
+    std::vector<unsigned char> key;
+    ASSERT_EQ(kp.getEncryptionKey(key, SecureStorage::Crypto::AES_GCM_KEY_SIZE_BYTES), Errc::Success);
+    std::vector<unsigned char> legacy_record;
+    ASSERT_EQ(legacy_encryptor.encrypt(data, key, legacy_record), Errc::Success);
+    ASSERT_EQ(FileUtil::atomicWriteFile(getDataFilePath(id), legacy_record), Errc::Success);
+
+    std::vector<unsigned char> retrieved_data;
+    ASSERT_EQ(store.retrieveData(id, retrieved_data), Errc::Success);
+    ASSERT_EQ(retrieved_data, data);
+
+    // Next write upgrades the record to the current format.
+    std::vector<unsigned char> data_v2 = {'n', 'e', 'w'};
+    ASSERT_EQ(store.storeData(id, data_v2), Errc::Success);
+    std::vector<unsigned char> raw;
+    ASSERT_EQ(FileUtil::readFile(getDataFilePath(id), raw), Errc::Success);
+    RecordHeader header;
+    RecordFormat::parseHeader(raw.data(), raw.size(), header);
+    ASSERT_EQ(header.version, RECORD_FORMAT_VERSION_CURRENT);
+    ASSERT_EQ(store.retrieveData(id, retrieved_data), Errc::Success);
+    ASSERT_EQ(retrieved_data, data_v2);
+}
+
+TEST_F(SecureStoreTest, ConcurrentWritersOnSharedRootKeepRecordConsistent) {
+    // Two stores on the same root behave like two processes: their writer locks are
+    // independent open file descriptions on the shared lock file.
+    SecureStore store_a(currentTestRootDir, dummySerial);
+    SecureStore store_b(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store_a.isInitialized());
+    ASSERT_TRUE(store_b.isInitialized());
+
+    const std::string id = "contended_id";
+    const int iterations = 50;
+    std::vector<unsigned char> value_a = {'A', 'A', 'A', 'A'};
+    std::vector<unsigned char> value_b = {'B', 'B', 'B', 'B', 'B'};
+    std::atomic<int> failures(0);
+
+    std::thread writer_a([&]() {
+        for (int i = 0; i < iterations; ++i) {
+            if (store_a.storeData(id, value_a) != Errc::Success) failures++;
+        }
+    });
+    std::thread writer_b([&]() {
+        for (int i = 0; i < iterations; ++i) {
+            if (store_b.storeData(id, value_b) != Errc::Success) failures++;
+        }
+    });
+    writer_a.join();
+    writer_b.join();
+
+    EXPECT_EQ(failures.load(), 0);
+    ASSERT_FALSE(FileUtil::pathExists(currentTestRootDir + "/" + id + DATA_FILE_EXTENSION + TEMP_FILE_SUFFIX));
+
+    std::vector<unsigned char> retrieved_data;
+    ASSERT_EQ(store_a.retrieveData(id, retrieved_data), Errc::Success);
+    ASSERT_TRUE(retrieved_data == value_a || retrieved_data == value_b);
+
+    // The backup must be a complete record as well.
+    SecureStorage::Crypto::Encryptor encryptor;
+    SecureStorage::Crypto::KeyProvider kp(dummySerial);
+    std::vector<unsigned char> key;
+    ASSERT_EQ(kp.getEncryptionKey(key, SecureStorage::Crypto::AES_GCM_KEY_SIZE_BYTES), Errc::Success);
+    std::vector<unsigned char> backup_raw, backup_plain;
+    ASSERT_EQ(FileUtil::readFile(getBackupFilePath(id), backup_raw), Errc::Success);
+    ASSERT_EQ(decryptRecordForTest(encryptor, key, id, backup_raw, backup_plain), Errc::Success);
+    ASSERT_TRUE(backup_plain == value_a || backup_plain == value_b);
+}
+
+TEST_F(SecureStoreTest, ThreadsOnOneStoreAndForkedChildKeepRecordConsistent) {
+    // Threads of one store share its lock descriptor; a forked child has its own. Both
+    // kinds of writer must be excluded from each other's installs of the same record.
+    const std::string id = "contended_shared_id";
+    const int iterations = 40;
+    std::vector<unsigned char> value_a = {'A', 'A', 'A', 'A'};
+    std::vector<unsigned char> value_b = {'B', 'B', 'B', 'B', 'B'};
+    std::vector<unsigned char> value_c = {'C', 'C', 'C', 'C', 'C', 'C'};
+
+    // Fork before this process starts any store threads so the child inherits no held locks.
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        int child_failures = 0;
+        {
+            SecureStore child_store(currentTestRootDir, dummySerial);
+            if (!child_store.isInitialized()) _exit(2);
+            for (int i = 0; i < iterations; ++i) {
+                if (child_store.storeData(id, value_c) != Errc::Success) child_failures++;
+            }
+        }
+        _exit(child_failures == 0 ? 0 : 1);
+    }
+
+    std::atomic<int> failures(0);
+    {
+        SecureStore store(currentTestRootDir, dummySerial);
+        ASSERT_TRUE(store.isInitialized());
+        std::thread writer_a([&]() {
+            for (int i = 0; i < iterations; ++i) {
+                if (store.storeData(id, value_a) != Errc::Success) failures++;
+            }
+        });
+        std::thread writer_b([&]() {
+            for (int i = 0; i < iterations; ++i) {
+                if (store.storeData(id, value_b) != Errc::Success) failures++;
+            }
+        });
+        writer_a.join();
+        writer_b.join();
+    }
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+    EXPECT_EQ(failures.load(), 0);
+    ASSERT_FALSE(FileUtil::pathExists(currentTestRootDir + "/" + id + DATA_FILE_EXTENSION + TEMP_FILE_SUFFIX));
+
+    SecureStore verifier(currentTestRootDir, dummySerial);
+    std::vector<unsigned char> retrieved_data;
+    ASSERT_EQ(verifier.retrieveData(id, retrieved_data), Errc::Success);
+    ASSERT_TRUE(retrieved_data == value_a || retrieved_data == value_b || retrieved_data == value_c);
+
+    SecureStorage::Crypto::Encryptor encryptor;
+    SecureStorage::Crypto::KeyProvider kp(dummySerial);
+    std::vector<unsigned char> key;
+    ASSERT_EQ(kp.getEncryptionKey(key, SecureStorage::Crypto::AES_GCM_KEY_SIZE_BYTES), Errc::Success);
+    std::vector<unsigned char> backup_raw, backup_plain;
+    ASSERT_EQ(FileUtil::readFile(getBackupFilePath(id), backup_raw), Errc::Success);
+    ASSERT_EQ(decryptRecordForTest(encryptor, key, id, backup_raw, backup_plain), Errc::Success);
+    ASSERT_TRUE(backup_plain == value_a || backup_plain == value_b || backup_plain == value_c);
+}
+
+TEST_F(SecureStoreTest, TransactionChangesBecomeVisibleTogether) {
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    ASSERT_EQ(store.storeData("txn_a", {'1'}), Errc::Success);
+    ASSERT_EQ(store.storeData("txn_b", {'1'}), Errc::Success);
+
+    Transaction txn = store.beginTransaction();
+    ASSERT_EQ(txn.put("txn_a", {'2'}), Errc::Success);
+    ASSERT_EQ(txn.put("txn_c", {'x'}), Errc::Success);
+    ASSERT_EQ(txn.put("txn_c", {'2'}), Errc::Success); // Replaces the earlier put
+    ASSERT_EQ(txn.remove("txn_b"), Errc::Success);
+    EXPECT_EQ(txn.size(), 3u);
+
+    std::vector<unsigned char> out;
+    ASSERT_EQ(store.retrieveData("txn_a", out), Errc::Success);
+    EXPECT_EQ(out, std::vector<unsigned char>({'1'})); // Staged only
+    EXPECT_FALSE(store.dataExists("txn_c"));
+
+    ASSERT_EQ(txn.commit(), Errc::Success);
+    EXPECT_EQ(txn.commit(), Errc::OperationFailed);
+    ASSERT_EQ(store.retrieveData("txn_a", out), Errc::Success);
+    EXPECT_EQ(out, std::vector<unsigned char>({'2'}));
+    EXPECT_EQ(store.retrieveData("txn_b", out), Errc::DataNotFound);
+    EXPECT_FALSE(store.dataExists("txn_b"));
+    ASSERT_EQ(store.retrieveData("txn_c", out), Errc::Success);
+    EXPECT_EQ(out, std::vector<unsigned char>({'2'}));
+    std::vector<std::string> ids;
+    ASSERT_EQ(store.listDataIds(ids), Errc::Success);
+    EXPECT_EQ(ids, std::vector<std::string>({"txn_a", "txn_c"}));
+
+    ASSERT_EQ(store.applyTransactions(), Errc::Success);
+    TransactionStats stats = store.getTransactionStats();
+    EXPECT_EQ(stats.committed, 1u);
+    EXPECT_EQ(stats.applied, 1u);
+    EXPECT_EQ(stats.pending, 0u);
+    EXPECT_GE(stats.checkpoints, 1u);
+    struct stat log_stat;
+    ASSERT_EQ(stat((currentTestRootDir + "/" + TRANSACTION_LOG_FILE_NAME).c_str(), &log_stat), 0);
+    EXPECT_EQ(log_stat.st_size, 0); // Checkpointed: truncated, kept for the next append
+    EXPECT_FALSE(FileUtil::pathExists(currentTestRootDir + "/txn_b.enc"));
+
+    // An invalid id fails the whole transaction, which stays staged.
+    Transaction bad = store.beginTransaction();
+    ASSERT_EQ(bad.put("txn_a", {'3'}), Errc::Success);
+    ASSERT_EQ(bad.put("bad/id", {'3'}), Errc::Success);
+    EXPECT_EQ(bad.commit(), Errc::InvalidArgument);
+    EXPECT_EQ(bad.size(), 2u);
+    bad.abort();
+    EXPECT_EQ(bad.put("txn_a", {'3'}), Errc::OperationFailed);
+    ASSERT_EQ(store.retrieveData("txn_a", out), Errc::Success);
+    EXPECT_EQ(out, std::vector<unsigned char>({'2'}));
+}
+
+TEST_F(SecureStoreTest, LaterStoreDataWinsOverPendingTransaction) {
+    {
+        SecureStore store(currentTestRootDir, dummySerial);
+        ASSERT_TRUE(store.isInitialized());
+        Transaction txn = store.beginTransaction();
+        ASSERT_EQ(txn.put("race", {'t'}), Errc::Success);
+        ASSERT_EQ(txn.put("other", {'t'}), Errc::Success);
+        ASSERT_EQ(txn.commit(), Errc::Success);
+        ASSERT_EQ(store.storeData("race", {'s'}), Errc::Success);
+        ASSERT_EQ(store.applyTransactions(), Errc::Success);
+        std::vector<unsigned char> out;
+        ASSERT_EQ(store.retrieveData("race", out), Errc::Success);
+        EXPECT_EQ(out, std::vector<unsigned char>({'s'}));
+    }
+    // Nothing is redone over the later write.
+    SecureStore reopened(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(reopened.isInitialized());
+    EXPECT_EQ(reopened.getTransactionStats().recovered, 0u);
+    std::vector<unsigned char> out;
+    ASSERT_EQ(reopened.retrieveData("race", out), Errc::Success);
+    EXPECT_EQ(out, std::vector<unsigned char>({'s'}));
+}
+
+TEST_F(SecureStoreTest, CrashAtEveryStepOfTransactionRecoversAllOrNothing) {
+    FaultInjector& injector = FaultInjector::getInstance();
+    const std::vector<unsigned char> v1 = {'v', '1'};
+    const std::vector<unsigned char> v2 = {'v', '2'};
+    // crash_at 0 counts the calls instead of crashing.
+    auto run = [&](const std::string& prefix, uint64_t crash_at) {
+        SecureStore store(currentTestRootDir, dummySerial);
+        EXPECT_TRUE(store.isInitialized());
+        if (crash_at == 0) {
+            injector.startCounting();
+        } else {
+            injector.armCrash(crash_at);
+        }
+        Transaction txn = store.beginTransaction();
+        txn.put(prefix + "a", v2);
+        txn.put(prefix + "c", v2);
+        txn.remove(prefix + "b");
+        Errc err = txn.commit();
+        if (!injector.crashed()) {
+            store.applyTransactions();
+        }
+        return err;
+    };
+    auto seed = [&](const std::string& prefix) {
+        SecureStore store(currentTestRootDir, dummySerial);
+        ASSERT_TRUE(store.isInitialized());
+        ASSERT_EQ(store.storeData(prefix + "a", v1), Errc::Success);
+        ASSERT_EQ(store.storeData(prefix + "b", v1), Errc::Success);
+    };
+
+    // Count the calls of committing and applying one transaction.
+    seed("probe_");
+    ASSERT_EQ(run("probe_", 0), Errc::Success);
+    uint64_t total = injector.getStats().syscalls;
+    injector.disarm();
+    ASSERT_GT(total, 0u);
+
+    bool redone = false;
+    for (uint64_t n = 1; n <= total; ++n) {
+        std::string prefix = "t" + std::to_string(n) + "_";
+        seed(prefix);
+        Errc commit_err = run(prefix, n); // The store's destructor cannot apply after the crash either
+        injector.disarm();
+
+        SecureStore recovered(currentTestRootDir, dummySerial);
+        ASSERT_TRUE(recovered.isInitialized());
+        std::vector<unsigned char> a;
+        ASSERT_EQ(recovered.retrieveData(prefix + "a", a), Errc::Success) << "crash at call " << n;
+        bool is_new = a == v2;
+        if (commit_err == Errc::Success) {
+            EXPECT_TRUE(is_new) << "crash at call " << n << " lost a committed transaction";
+        }
+        std::vector<unsigned char> out;
+        EXPECT_EQ(recovered.retrieveData(prefix + "b", out), is_new ? Errc::DataNotFound : Errc::Success)
+            << "crash at call " << n;
+        EXPECT_EQ(recovered.dataExists(prefix + "c"), is_new) << "crash at call " << n;
+        EXPECT_EQ(recovered.getTransactionStats().pending, 0u);
+        redone = redone || recovered.getTransactionStats().recovered > 0;
+    }
+    EXPECT_TRUE(redone); // Some crash fell between the commit and the checkpoint
+}
+
+TEST_F(SecureStoreTest, TransactionLogRecordCannotBeReplantedAsDataRecord) {
+    FaultInjector& injector = FaultInjector::getInstance();
+    // Crash at successive calls until a commit leaves its record in the log.
+    std::vector<std::vector<unsigned char>> frames;
+    for (uint64_t n = 1; frames.empty() && n < 200; ++n) {
+        {
+            SecureStore store(currentTestRootDir, dummySerial);
+            ASSERT_TRUE(store.isInitialized());
+            injector.armCrash(n);
+            Transaction txn = store.beginTransaction();
+            txn.put("wal_secret", {'s', 'e', 'c', 'r', 'e', 't'});
+            txn.commit();
+        }
+        injector.disarm();
+        std::vector<unsigned char> log;
+        if (FileUtil::readFile(currentTestRootDir + "/" + TRANSACTION_LOG_FILE_NAME, log) == Errc::Success) {
+            RecordHistory::splitFrames(log, frames);
+        }
+    }
+    ASSERT_EQ(frames.size(), 1u);
+
+    // The record is sealed for the AAD id ".securestore.wal", which is also a valid data id.
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    ASSERT_EQ(FileUtil::atomicWriteFile(getDataFilePath(TRANSACTION_LOG_FILE_NAME), frames[0]), Errc::Success);
+    std::vector<unsigned char> out;
+    EXPECT_NE(store.retrieveData(TRANSACTION_LOG_FILE_NAME, out), Errc::Success);
+    EXPECT_TRUE(out.empty());
+}
+
+TEST_F(SecureStoreTest, TransactionsCommitWhileOtherThreadsStoreData) {
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    constexpr int ROUNDS = 30;
+    // The applier thread, the committer and the writer all encrypt under the master key.
+    std::thread writer([&] {
+        for (int i = 0; i < ROUNDS; ++i) {
+            EXPECT_EQ(store.storeData("plain_" + std::to_string(i % 5), {static_cast<unsigned char>(i)}),
+                      Errc::Success);
+        }
+    });
+    for (int i = 0; i < ROUNDS; ++i) {
+        Transaction txn = store.beginTransaction();
+        ASSERT_EQ(txn.put("txn_a", {static_cast<unsigned char>(i)}), Errc::Success);
+        ASSERT_EQ(txn.put("txn_b", {static_cast<unsigned char>(i)}), Errc::Success);
+        ASSERT_EQ(txn.commit(), Errc::Success);
+    }
+    writer.join();
+    ASSERT_EQ(store.applyTransactions(), Errc::Success);
+
+    std::vector<unsigned char> out;
+    for (const char* id : {"txn_a", "txn_b"}) {
+        ASSERT_EQ(store.retrieveData(id, out), Errc::Success);
+        EXPECT_EQ(out, std::vector<unsigned char>({ROUNDS - 1}));
+    }
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_EQ(store.retrieveData("plain_" + std::to_string(i), out), Errc::Success);
+        EXPECT_EQ(out, std::vector<unsigned char>({static_cast<unsigned char>(ROUNDS - 5 + i)}));
+    }
+}
+
+TEST_F(SecureStoreTest, RetrieveManyAnswersEachIdLikeRetrieveData) {
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    std::vector<std::string> ids;
+    for (int i = 0; i < 40; ++i) {
+        ids.push_back("many_" + std::to_string(i));
+        ASSERT_EQ(store.storeData(ids.back(), std::vector<unsigned char>(100 + i, static_cast<unsigned char>(i))),
+                  Errc::Success);
+    }
+    // Main file gone: served from the backup, as by retrieveData().
+    ASSERT_EQ(store.storeData("many_0", std::vector<unsigned char>(100, 0)), Errc::Success);
+    ASSERT_EQ(std::remove((currentTestRootDir + "/many_0.enc").c_str()), 0);
+
+    std::vector<std::string> request = ids;
+    request.push_back("missing");
+    request.push_back("bad/id");
+    request.push_back("many_7"); // Duplicate
+
+    for (unsigned workers : {1u, 4u}) {
+        std::vector<RetrieveResult> results;
+        ASSERT_EQ(store.retrieveMany(request, results, workers), Errc::Success);
+        ASSERT_EQ(results.size(), request.size());
+        for (int i = 0; i < 40; ++i) {
+            ASSERT_EQ(results[i].status, Errc::Success) << ids[i];
+            EXPECT_EQ(results[i].data, std::vector<unsigned char>(100 + i, static_cast<unsigned char>(i))) << ids[i];
+        }
+        EXPECT_EQ(results[40].status, Errc::DataNotFound);
+        EXPECT_EQ(results[41].status, Errc::InvalidArgument);
+        EXPECT_EQ(results[42].status, Errc::Success);
+        EXPECT_EQ(results[42].data, results[7].data);
+    }
+}
+
+TEST_F(SecureStoreTest, SteadyStateStoreAndRetrieveDoNotAllocate) {
+    SecureStore store(currentTestRootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    // Filtered-out log messages are not formatted; enabled ones do allocate.
+    struct LogLevelRestorer {
+        LogLevel saved = Logger::getInstance().getLogLevel();
+        ~LogLevelRestorer() { Logger::getInstance().setLogLevel(saved); }
+    } restore_level;
+    Logger::getInstance().setLogLevel(LogLevel::WARNING);
+
+    const std::string id = "steady_state_record_with_a_long_id"; // Longer than any small-string buffer
+    std::vector<unsigned char> data(4096);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<unsigned char>(i);
+    }
+    std::vector<unsigned char> out(data.size());
+    size_t out_size = 0;
+    for (int i = 0; i < 3; ++i) { // Warm up the pools, the index and the hot set
+        ASSERT_EQ(store.storeData(id, data.data(), data.size()), Errc::Success);
+        ASSERT_EQ(store.retrieveData(id, out.data(), out.size(), out_size), Errc::Success);
+    }
+
+    g_allocationCount = 0;
+    g_countAllocations = true;
+    int* volatile probe = new int(1); // The counter itself must see allocations
+    delete probe;
+    ASSERT_EQ(g_allocationCount, 1u);
+    g_allocationCount = 0;
+    Errc store_err = Errc::Success;
+    Errc retrieve_err = Errc::Success;
+    for (int i = 0; i < 10 && store_err == Errc::Success && retrieve_err == Errc::Success; ++i) {
+        data[0] = static_cast<unsigned char>(i);
+        store_err = store.storeData(id, data.data(), data.size());
+        retrieve_err = store.retrieveData(id, out.data(), out.size(), out_size);
+    }
+    g_countAllocations = false;
+
+    EXPECT_EQ(store_err, Errc::Success);
+    EXPECT_EQ(retrieve_err, Errc::Success);
+    EXPECT_EQ(g_allocationCount, 0u);
+    EXPECT_EQ(out, data);
+}
@@ -0,0 +1,160 @@
+#include "gtest/gtest.h"
+
+#include "SharedRecordCache.h"
+#include "SecureStore.h"
+#include "FileUtil.h"
+#include "Error.h"
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <chrono>
+#include <cstdio>     // For std::remove
+
+#include <unistd.h>   // For fork, _exit, getpid
+#include <sys/wait.h> // For waitpid
+#include <dirent.h>
+#include <sys/stat.h>
+
+using namespace SecureStorage::Storage;
+using namespace SecureStorage::Utils;
+using namespace SecureStorage::Error;
+
+class SharedRecordCacheTest : public ::testing::Test {
+protected:
+    std::string rootDir;
+    std::string segmentPath;
+
+    void SetUp() override {
+        std::ostringstream oss;
+        oss << "SharedRecordCacheTests_temp/root_" << getpid() << "_"
+            << std::chrono::steady_clock::now().time_since_epoch().count() << "/";
+        rootDir = oss.str();
+        ASSERT_EQ(FileUtil::createDirectories(rootDir), Errc::Success);
+        segmentPath = SharedRecordCache::segmentPathForRoot(rootDir);
+    }
+
+    void TearDown() override {
+        std::remove(segmentPath.c_str());
+        DIR* dir = opendir(rootDir.c_str());
+        if (dir) {
+            struct dirent* entry;
+            while ((entry = readdir(dir)) != nullptr) {
+                std::string name = entry->d_name;
+                if (name != "." && name != "..") std::remove((rootDir + name).c_str());
+            }
+            closedir(dir);
+        }
+        std::remove(rootDir.c_str());
+    }
+};
+
+TEST_F(SharedRecordCacheTest, FillLookupAndInvalidate) {
+    SharedRecordCache cache(segmentPath, true, 16, 64);
+    ASSERT_TRUE(cache.isAttached());
+    std::vector<unsigned char> record = {1, 2, 3, 4, 5};
+    std::vector<unsigned char> out;
+
+    EXPECT_FALSE(cache.lookup("id", out));
+    ASSERT_TRUE(cache.fill("id", record, cache.sequenceFor("id")));
+    ASSERT_TRUE(cache.lookup("id", out));
+    EXPECT_EQ(out, record);
+    EXPECT_FALSE(cache.lookup("other_id_not_in_slot", out) && out == record);
+
+    cache.invalidate("id");
+    EXPECT_FALSE(cache.lookup("id", out));
+
+    SharedCacheStats stats = cache.getStats();
+    EXPECT_EQ(stats.fills, 1u);
+    EXPECT_GE(stats.hits, 1u);
+    EXPECT_EQ(stats.invalidations, 1u);
+}
+
+TEST_F(SharedRecordCacheTest, FillIsDroppedIfSlotChangedSinceObserved) {
+    SharedRecordCache cache(segmentPath, true, 16, 64);
+    ASSERT_TRUE(cache.isAttached());
+    uint64_t observed = cache.sequenceFor("id");
+    cache.invalidate("id"); // A writer changed the id after the reader looked at the slot
+    EXPECT_FALSE(cache.fill("id", {9, 9, 9}, observed));
+    std::vector<unsigned char> out;
+    EXPECT_FALSE(cache.lookup("id", out));
+}
+
+TEST_F(SharedRecordCacheTest, OversizedRecordsAreNotCached) {
+    SharedRecordCache cache(segmentPath, true, 16, 8);
+    ASSERT_TRUE(cache.isAttached());
+    std::vector<unsigned char> big(9, 0x42);
+    EXPECT_FALSE(cache.fill("id", big, cache.sequenceFor("id")));
+}
+
+TEST_F(SharedRecordCacheTest, EntriesAreVisibleToOtherProcesses) {
+    SharedRecordCache cache(segmentPath, true, 16, 64);
+    ASSERT_TRUE(cache.isAttached());
+    ASSERT_TRUE(cache.fill("shared", {7, 7, 7}, cache.sequenceFor("shared")));
+
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        SharedRecordCache child(segmentPath, false); // Attach only
+        std::vector<unsigned char> out;
+        bool ok = child.isAttached() && child.lookup("shared", out) && out == std::vector<unsigned char>{7, 7, 7};
+        child.invalidate("shared");
+        _exit(ok ? 0 : 1);
+    }
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+
+    std::vector<unsigned char> out;
+    EXPECT_FALSE(cache.lookup("shared", out)); // Child's invalidation is visible here
+}
+
+TEST_F(SharedRecordCacheTest, StoreServesHitsAndOtherWritersInvalidate) {
+    SecureStore reader(rootDir, "CacheSerial");
+    SecureStore writer(rootDir, "CacheSerial");
+    ASSERT_TRUE(reader.isInitialized());
+    ASSERT_TRUE(writer.isInitialized());
+    ASSERT_EQ(reader.enableSharedReadCache(16, 256), Errc::Success);
+
+    std::vector<unsigned char> v1 = {'v', '1'};
+    std::vector<unsigned char> v2 = {'v', '2', '!'};
+    ASSERT_EQ(writer.storeData("hot", v1), Errc::Success); // Writer attaches and writes through
+
+    std::vector<unsigned char> out;
+    ASSERT_EQ(reader.retrieveData("hot", out), Errc::Success);
+    EXPECT_EQ(out, v1);
+    EXPECT_EQ(reader.getSharedCacheStats().hits, 1u);
+
+    ASSERT_EQ(writer.storeData("hot", v2), Errc::Success);
+    ASSERT_EQ(reader.retrieveData("hot", out), Errc::Success);
+    EXPECT_EQ(out, v2);
+
+    ASSERT_EQ(writer.deleteData("hot"), Errc::Success);
+    EXPECT_EQ(reader.retrieveData("hot", out), Errc::DataNotFound);
+}
+
+TEST_F(SharedRecordCacheTest, OversizedWriteLeavesSlotInvalidated) {
+    SecureStore writer(rootDir, "CacheSerial");
+    ASSERT_TRUE(writer.isInitialized());
+    ASSERT_EQ(writer.enableSharedReadCache(16, 256), Errc::Success);
+    std::vector<unsigned char> small = {'s'};
+    ASSERT_EQ(writer.storeData("big", small), Errc::Success);
+
+    // A reader in another process that observed the slot after the writer's first
+    // invalidation, but read the replaced file, must not be able to publish it.
+    SharedRecordCache reader(segmentPath, false);
+    ASSERT_TRUE(reader.isAttached());
+    uint64_t observed_mid_store = reader.sequenceFor("big") + 2; // One invalidation precedes the install
+    std::vector<unsigned char> stale;
+    ASSERT_TRUE(reader.lookup("big", stale));
+
+    std::vector<unsigned char> large(1024, 0x42); // Does not fit a 256-byte slot
+    ASSERT_EQ(writer.storeData("big", large), Errc::Success);
+    EXPECT_FALSE(reader.fill("big", stale, observed_mid_store));
+
+    std::vector<unsigned char> out;
+    EXPECT_FALSE(reader.lookup("big", out));
+    ASSERT_EQ(writer.retrieveData("big", out), Errc::Success);
+    EXPECT_EQ(out, large);
+}
@@ -0,0 +1,187 @@
+#include "gtest/gtest.h"
+
+#include "WriteBackBuffer.h"
+#include "SecureStore.h"
+#include "FileUtil.h"
+#include "Error.h"
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <chrono>
+#include <thread>
+#include <cstdio>     // For std::remove
+
+#include <unistd.h>   // For getpid
+#include <dirent.h>
+
+using namespace SecureStorage::Storage;
+using namespace SecureStorage::Utils;
+using namespace SecureStorage::Error;
+
+class WriteBackBufferTest : public ::testing::Test {
+protected:
+    std::string rootDir;
+    std::string dummySerial = "WriteBackSerial42";
+
+    void SetUp() override {
+        std::ostringstream oss;
+        oss << "WriteBackBufferTests_temp/root_" << getpid() << "_"
+            << std::chrono::steady_clock::now().time_since_epoch().count() << "/";
+        rootDir = oss.str();
+        ASSERT_EQ(FileUtil::createDirectories(rootDir), Errc::Success);
+    }
+
+    void TearDown() override {
+        DIR* dir = opendir(rootDir.c_str());
+        if (dir) {
+            struct dirent* entry;
+            while ((entry = readdir(dir)) != nullptr) {
+                std::string name = entry->d_name;
+                if (name != "." && name != "..") std::remove((rootDir + name).c_str());
+            }
+            closedir(dir);
+        }
+        std::remove(rootDir.c_str());
+    }
+
+    static WriteBackOptions longWindow() {
+        WriteBackOptions options;
+        options.maxDirtyAge = std::chrono::milliseconds(60000); // Only explicit flushes commit
+        return options;
+    }
+};
+
+TEST_F(WriteBackBufferTest, ReadsSeeBufferedWritesBeforeCommit) {
+    SecureStore store(rootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    WriteBackBuffer buffer(store, longWindow());
+
+    std::vector<unsigned char> data = {'w', 'b'};
+    ASSERT_EQ(buffer.storeData("id", data), Errc::Success);
+    EXPECT_FALSE(store.dataExists("id")); // Nothing on disk yet
+
+    std::vector<unsigned char> out;
+    ASSERT_EQ(buffer.retrieveData("id", out), Errc::Success);
+    EXPECT_EQ(out, data);
+    EXPECT_TRUE(buffer.dataExists("id"));
+    std::vector<std::string> ids;
+    ASSERT_EQ(buffer.listDataIds(ids), Errc::Success);
+    ASSERT_EQ(ids.size(), 1u);
+    EXPECT_EQ(ids[0], "id");
+
+    ASSERT_EQ(buffer.flush(), Errc::Success);
+    ASSERT_EQ(store.retrieveData("id", out), Errc::Success);
+    EXPECT_EQ(out, data);
+}
+
+TEST_F(WriteBackBufferTest, FlushOfOneIdLeavesOthersBuffered) {
+    SecureStore store(rootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    WriteBackBuffer buffer(store, longWindow());
+
+    ASSERT_EQ(buffer.storeData("one", {'1'}), Errc::Success);
+    ASSERT_EQ(buffer.storeData("two", {'2'}), Errc::Success);
+    ASSERT_EQ(buffer.flush("one"), Errc::Success);
+    EXPECT_TRUE(store.dataExists("one"));
+    EXPECT_FALSE(store.dataExists("two"));
+    EXPECT_EQ(buffer.getStats().dirtyIds, 1u);
+    EXPECT_EQ(buffer.flush("missing"), Errc::Success); // Nothing buffered for it
+
+    std::vector<std::string> ids;
+    ASSERT_EQ(buffer.listDataIds(ids), Errc::Success);
+    ASSERT_EQ(ids.size(), 2u);
+}
+
+TEST_F(WriteBackBufferTest, RepeatedWritesCoalesceIntoOneCommit) {
+    SecureStore store(rootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    WriteBackBuffer buffer(store, longWindow());
+
+    for (unsigned char i = 0; i < 50; ++i) {
+        ASSERT_EQ(buffer.storeData("telemetry", {i}), Errc::Success);
+    }
+    ASSERT_EQ(buffer.flush(), Errc::Success);
+
+    WriteBackStats stats = buffer.getStats();
+    EXPECT_EQ(stats.bufferedWrites, 50u);
+    EXPECT_EQ(stats.coalescedWrites, 49u);
+    EXPECT_EQ(stats.committedWrites, 1u);
+    EXPECT_EQ(stats.dirtyIds, 0u);
+
+    std::vector<unsigned char> out;
+    ASSERT_EQ(store.retrieveData("telemetry", out), Errc::Success);
+    EXPECT_EQ(out, std::vector<unsigned char>{49});
+}
+
+TEST_F(WriteBackBufferTest, BufferedDeleteHidesCommittedData) {
+    SecureStore store(rootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    ASSERT_EQ(store.storeData("id", {1, 2, 3}), Errc::Success);
+    WriteBackBuffer buffer(store, longWindow());
+
+    ASSERT_EQ(buffer.deleteData("id"), Errc::Success);
+    std::vector<unsigned char> out;
+    EXPECT_EQ(buffer.retrieveData("id", out), Errc::DataNotFound);
+    EXPECT_FALSE(buffer.dataExists("id"));
+    std::vector<std::string> ids;
+    ASSERT_EQ(buffer.listDataIds(ids), Errc::Success);
+    EXPECT_TRUE(ids.empty());
+    EXPECT_TRUE(store.dataExists("id")); // Still on disk until committed
+
+    ASSERT_EQ(buffer.flush(), Errc::Success);
+    EXPECT_FALSE(store.dataExists("id"));
+}
+
+TEST_F(WriteBackBufferTest, InvalidIdIsRejectedImmediately) {
+    SecureStore store(rootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    WriteBackBuffer buffer(store, longWindow());
+    EXPECT_EQ(buffer.storeData("../escape", {1}), Errc::InvalidArgument);
+    EXPECT_EQ(buffer.deleteData(""), Errc::InvalidArgument);
+    EXPECT_EQ(buffer.getStats().bufferedWrites, 0u);
+}
+
+TEST_F(WriteBackBufferTest, CommitsWithinDurabilityWindowAndOnSizeTrigger) {
+    SecureStore store(rootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+
+    WriteBackOptions options;
+    options.maxDirtyAge = std::chrono::milliseconds(50);
+    options.maxDirtyIds = 3;
+    {
+        WriteBackBuffer buffer(store, options);
+        ASSERT_EQ(buffer.storeData("timed", {7}), Errc::Success);
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!store.dataExists("timed") && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        EXPECT_TRUE(store.dataExists("timed"));
+    }
+
+    options.maxDirtyAge = std::chrono::milliseconds(60000);
+    {
+        WriteBackBuffer buffer(store, options);
+        ASSERT_EQ(buffer.storeData("a", {1}), Errc::Success);
+        ASSERT_EQ(buffer.storeData("b", {2}), Errc::Success);
+        ASSERT_EQ(buffer.storeData("c", {3}), Errc::Success); // Reaches maxDirtyIds
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (buffer.getStats().committedWrites < 3 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        EXPECT_EQ(buffer.getStats().committedWrites, 3u);
+        EXPECT_EQ(buffer.getStats().groupCommits, 1u);
+    }
+}
+
+TEST_F(WriteBackBufferTest, DestructorCommitsBufferedWrites) {
+    SecureStore store(rootDir, dummySerial);
+    ASSERT_TRUE(store.isInitialized());
+    {
+        WriteBackBuffer buffer(store, longWindow());
+        ASSERT_EQ(buffer.storeData("late", {4, 2}), Errc::Success);
+    }
+    std::vector<unsigned char> out;
+    ASSERT_EQ(store.retrieveData("late", out), Errc::Success);
+    EXPECT_EQ(out, (std::vector<unsigned char>{4, 2}));
+}
@@ -0,0 +1,187 @@
+#include "gtest/gtest.h"
+#include "DirFileUtil.h"
+#include "FileUtil.h"
+#include "Error.h"
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>     // For std::remove
+
+#include <unistd.h>   // For getpid
+
+namespace SecureStorage {
+namespace Utils {
+namespace Test {
+
+class DirFileUtilTest : public ::testing::Test {
+protected:
+    std::string dirPath;
+
+    void SetUp() override {
+        std::ostringstream oss;
+        oss << "DirFileUtilTest_" << getpid() << "_"
+            << std::chrono::steady_clock::now().time_since_epoch().count();
+        dirPath = oss.str();
+        ASSERT_EQ(FileUtil::createDirectories(dirPath), Error::Errc::Success);
+    }
+
+    void TearDown() override {
+        std::vector<std::string> files;
+        FileUtil::listDirectory(dirPath, files);
+        for (const std::string& name : files) {
+            std::remove((dirPath + "/" + name).c_str());
+        }
+        std::remove(dirPath.c_str());
+    }
+};
+
+TEST_F(DirFileUtilTest, FailsToOpenMissingDirectory) {
+    DirFileUtil dir(dirPath + "/does_not_exist");
+    EXPECT_FALSE(dir.isOpen());
+    std::vector<unsigned char> data;
+    EXPECT_EQ(dir.readFile("x", data), Error::Errc::NotInitialized);
+}
+
+TEST_F(DirFileUtilTest, WriteReadExistsDelete) {
+    DirFileUtil dir(dirPath);
+    ASSERT_TRUE(dir.isOpen());
+    std::vector<unsigned char> data = {'d', 'i', 'r', 'f', 'd'};
+
+    ASSERT_EQ(dir.atomicWriteFile("file.bin", data), Error::Errc::Success);
+    EXPECT_TRUE(dir.pathExists("file.bin"));
+    EXPECT_FALSE(dir.pathExists("file.bin" + TEMP_FILE_UTIL_SUFFIX));
+    EXPECT_TRUE(FileUtil::pathExists(dirPath + "/file.bin")); // Same file through the path API
+
+    std::vector<unsigned char> read_back;
+    ASSERT_EQ(dir.readFile("file.bin", read_back), Error::Errc::Success);
+    EXPECT_EQ(read_back, data);
+    EXPECT_EQ(dir.readFile("missing.bin", read_back), Error::Errc::FileOpenFailed);
+
+    ASSERT_EQ(dir.deleteFile("file.bin"), Error::Errc::Success);
+    EXPECT_FALSE(dir.pathExists("file.bin"));
+    EXPECT_EQ(dir.deleteFile("file.bin"), Error::Errc::Success); // Missing file is not an error
+}
+
+TEST_F(DirFileUtilTest, OpenForReadHandsOutTheFile) {
+    DirFileUtil dir(dirPath);
+    ASSERT_TRUE(dir.isOpen());
+    std::vector<unsigned char> data = {'o', 'p', 'e', 'n'};
+    ASSERT_EQ(dir.atomicWriteFile("file.bin", data), Error::Errc::Success);
+
+    size_t size = 0;
+    FileIdentity opened;
+    int fd = dir.openForRead("file.bin", size, &opened);
+    ASSERT_GE(fd, 0);
+    EXPECT_EQ(size, data.size());
+    std::vector<unsigned char> read_back(data.size());
+    EXPECT_EQ(pread(fd, read_back.data(), read_back.size(), 0), static_cast<ssize_t>(data.size()));
+    EXPECT_EQ(read_back, data);
+    close(fd);
+    FileIdentity current;
+    ASSERT_EQ(dir.getFileIdentity("file.bin", current), Error::Errc::Success);
+    EXPECT_TRUE(opened == current);
+
+    EXPECT_EQ(dir.openForRead("missing.bin", size), -1);
+    EXPECT_EQ(size, 0u);
+}
+
+TEST_F(DirFileUtilTest, RenameAndList) {
+    DirFileUtil dir(dirPath);
+    ASSERT_TRUE(dir.isOpen());
+    ASSERT_EQ(dir.atomicWriteFile("a", {'1'}), Error::Errc::Success);
+    ASSERT_EQ(dir.atomicWriteFile("b", {'2'}), Error::Errc::Success);
+    ASSERT_EQ(dir.renameFile("a", "c"), Error::Errc::Success);
+    EXPECT_EQ(dir.renameFile("a", "d"), Error::Errc::FileRenameFailed);
+
+    std::vector<std::string> files;
+    ASSERT_EQ(dir.listDirectory(files), Error::Errc::Success);
+    std::sort(files.begin(), files.end());
+    ASSERT_EQ(files.size(), 2u);
+    EXPECT_EQ(files[0], "b");
+    EXPECT_EQ(files[1], "c");
+}
+
+TEST_F(DirFileUtilTest, ExchangeSwapsContentsAtomically) {
+    DirFileUtil dir(dirPath);
+    ASSERT_TRUE(dir.isOpen());
+    ASSERT_EQ(dir.atomicWriteFile("first", {'1'}), Error::Errc::Success);
+    ASSERT_EQ(dir.atomicWriteFile("second", {'2'}), Error::Errc::Success);
+
+    Error::Errc err = dir.exchangeFiles("first", "second");
+    if (err == Error::Errc::OperationFailed) {
+        GTEST_SKIP() << "renameat2(RENAME_EXCHANGE) is not supported here.";
+    }
+    ASSERT_EQ(err, Error::Errc::Success);
+    std::vector<unsigned char> content;
+    ASSERT_EQ(dir.readFile("first", content), Error::Errc::Success);
+    EXPECT_EQ(content, std::vector<unsigned char>{'2'});
+    ASSERT_EQ(dir.readFile("second", content), Error::Errc::Success);
+    EXPECT_EQ(content, std::vector<unsigned char>{'1'});
+
+    EXPECT_EQ(dir.exchangeFiles("first", "missing"), Error::Errc::PathNotFound);
+    EXPECT_EQ(dir.syncDirectory(), Error::Errc::Success);
+}
+
+TEST_F(DirFileUtilTest, LinkNewFilePublishesCompleteFileOnly) {
+    DirFileUtil dir(dirPath);
+    ASSERT_TRUE(dir.isOpen());
+    std::vector<unsigned char> data = {'a', 'n', 'o', 'n'};
+
+    Error::Errc err = dir.linkNewFile("anon", data);
+    if (err == Error::Errc::OperationFailed) {
+        GTEST_SKIP() << "O_TMPFILE is not supported here.";
+    }
+    ASSERT_EQ(err, Error::Errc::Success);
+    std::vector<unsigned char> content;
+    ASSERT_EQ(dir.readFile("anon", content), Error::Errc::Success);
+    EXPECT_EQ(content, data);
+
+    // Linking never replaces an existing file, and the failed attempt leaves nothing behind.
+    EXPECT_EQ(dir.linkNewFile("anon", {'x'}), Error::Errc::DataAlreadyExists);
+    ASSERT_EQ(dir.readFile("anon", content), Error::Errc::Success);
+    EXPECT_EQ(content, data);
+    std::vector<std::string> files;
+    ASSERT_EQ(dir.listDirectory(files), Error::Errc::Success);
+    EXPECT_EQ(files, std::vector<std::string>{"anon"});
+
+    dir.setAnonymousFilesEnabled(false);
+    EXPECT_EQ(dir.linkNewFile("other", data), Error::Errc::OperationFailed);
+    EXPECT_FALSE(dir.pathExists("other"));
+}
+
+TEST_F(DirFileUtilTest, CountsSyscallsAndFsyncs) {
+    DirFileUtil dir(dirPath);
+    ASSERT_TRUE(dir.isOpen());
+    FileIoStats before = dir.getIoStats();
+    ASSERT_EQ(dir.writeFile("counted", {1, 2, 3}), Error::Errc::Success);
+    ASSERT_EQ(dir.syncDirectory(), Error::Errc::Success);
+    FileIoStats after = dir.getIoStats();
+    EXPECT_EQ(after.syscalls - before.syscalls, 5u); // openat, write, fdatasync, close, fsync(dir)
+    EXPECT_EQ(after.fsyncs - before.fsyncs, 2u);
+    EXPECT_EQ(after.bytesWritten - before.bytesWritten, 3u);
+}
+
+TEST_F(DirFileUtilTest, FileSyncModeSelectsFlush) {
+    DirFileUtil dir(dirPath);
+    ASSERT_TRUE(dir.isOpen());
+    const FileSync modes[] = { FileSync::None, FileSync::Data, FileSync::Full };
+    for (FileSync mode : modes) {
+        FileIoStats before = dir.getIoStats();
+        ASSERT_EQ(dir.writeFile("synced", {1, 2, 3}, mode), Error::Errc::Success);
+        EXPECT_EQ(dir.getIoStats().fsyncs - before.fsyncs, mode == FileSync::None ? 0u : 1u);
+    }
+    std::vector<unsigned char> out;
+    ASSERT_EQ(dir.readFile("synced", out), Error::Errc::Success);
+    EXPECT_EQ(out, (std::vector<unsigned char>{1, 2, 3}));
+
+    FileIoStats before = dir.getIoStats();
+    ASSERT_EQ(dir.syncFilesystem(), Error::Errc::Success);
+    EXPECT_EQ(dir.getIoStats().fsyncs - before.fsyncs, 1u);
+}
+
+} // namespace Test
+} // namespace Utils
+} // namespace SecureStorage
@@ -0,0 +1,141 @@
+#include "gtest/gtest.h"
+#include "FaultInjection.h"
+#include "DirFileUtil.h"
+#include "FileUtil.h"
+#include "Error.h"
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <chrono>
+#include <cerrno>     // For EIO, ENOSPC
+#include <cstdio>     // For std::remove
+
+#include <unistd.h>   // For getpid
+
+namespace SecureStorage {
+namespace Utils {
+namespace Test {
+
+class FaultInjectionTest : public ::testing::Test {
+protected:
+    std::string dirPath;
+
+    void SetUp() override {
+        std::ostringstream oss;
+        oss << "FaultInjectionTest_" << getpid() << "_"
+            << std::chrono::steady_clock::now().time_since_epoch().count();
+        dirPath = oss.str();
+        ASSERT_EQ(FileUtil::createDirectories(dirPath), Error::Errc::Success);
+    }
+
+    void TearDown() override {
+        FaultInjector::getInstance().disarm();
+        std::vector<std::string> files;
+        FileUtil::listDirectory(dirPath, files);
+        for (const std::string& name : files) {
+            std::remove((dirPath + "/" + name).c_str());
+        }
+        std::remove(dirPath.c_str());
+    }
+
+    size_t fileCount() {
+        std::vector<std::string> files;
+        FileUtil::listDirectory(dirPath, files);
+        return files.size();
+    }
+};
+
+TEST_F(FaultInjectionTest, CountsAtomicWriteFileCost) {
+    FaultInjector& injector = FaultInjector::getInstance();
+    std::vector<unsigned char> data(100, 'x');
+
+    injector.startCounting();
+    ASSERT_EQ(FileUtil::atomicWriteFile(dirPath + "/file", data), Error::Errc::Success);
+    FileIoStats stats = injector.getStats();
+    injector.disarm();
+
+    // open, write, fsync, close, rename, open(dir), fsync(dir), close(dir)
+    const SyscallKind expected[] = {
+        SyscallKind::Open, SyscallKind::Write, SyscallKind::Fsync, SyscallKind::Close,
+        SyscallKind::Rename, SyscallKind::Open, SyscallKind::Fsync, SyscallKind::Close
+    };
+    EXPECT_EQ(stats.syscalls, 8u);
+    EXPECT_EQ(stats.fsyncs, 2u);
+    EXPECT_EQ(stats.bytesWritten, 100u);
+
+    injector.startCounting();
+    ASSERT_EQ(FileUtil::atomicWriteFile(dirPath + "/file", data), Error::Errc::Success);
+    std::vector<SyscallKind> trace = injector.getTrace();
+    EXPECT_EQ(trace, std::vector<SyscallKind>(expected, expected + 8));
+}
+
+TEST_F(FaultInjectionTest, AtomicWriteFileCrashAtEveryStepLeavesOldOrNew) {
+    FaultInjector& injector = FaultInjector::getInstance();
+    const std::vector<unsigned char> oldData = {'o', 'l', 'd'};
+    const std::vector<unsigned char> newData = {'n', 'e', 'w', '!'};
+    const std::string path = dirPath + "/record";
+
+    injector.startCounting();
+    ASSERT_EQ(FileUtil::atomicWriteFile(path, oldData), Error::Errc::Success);
+    uint64_t total = injector.getStats().syscalls;
+    injector.disarm();
+
+    for (uint64_t n = 1; n <= total + 1; ++n) {
+        ASSERT_EQ(FileUtil::atomicWriteFile(path, oldData), Error::Errc::Success);
+        injector.armCrash(n);
+        FileUtil::atomicWriteFile(path, newData);
+        bool crashed = injector.crashed();
+        injector.disarm(); // "Reboot"
+
+        std::vector<unsigned char> out;
+        ASSERT_EQ(FileUtil::readFile(path, out), Error::Errc::Success) << "crash at call " << n;
+        EXPECT_TRUE(out == oldData || out == newData) << "torn content after crash at call " << n;
+        EXPECT_EQ(crashed, n <= total);
+        if (!crashed) {
+            EXPECT_EQ(out, newData);
+        }
+        FileUtil::deleteFile(path + TEMP_FILE_UTIL_SUFFIX); // A crash may leave the temp file
+    }
+}
+
+TEST_F(FaultInjectionTest, InjectedFailureIsReportedAndLeavesOldValue) {
+    FaultInjector& injector = FaultInjector::getInstance();
+    const std::vector<unsigned char> oldData = {'o', 'l', 'd'};
+    const std::string path = dirPath + "/record";
+    ASSERT_EQ(FileUtil::atomicWriteFile(path, oldData), Error::Errc::Success);
+
+    injector.armFailure(3, ENOSPC); // The fsync of the temporary file
+    EXPECT_EQ(FileUtil::atomicWriteFile(path, {'n', 'e', 'w'}), Error::Errc::FileWriteFailed);
+    EXPECT_FALSE(injector.crashed());
+    injector.disarm();
+
+    std::vector<unsigned char> out;
+    ASSERT_EQ(FileUtil::readFile(path, out), Error::Errc::Success);
+    EXPECT_EQ(out, oldData);
+    EXPECT_EQ(fileCount(), 1u); // The temporary file was cleaned up
+}
+
+TEST_F(FaultInjectionTest, CrashSuppressesAllButStatsReadsAndCloses) {
+    FaultInjector& injector = FaultInjector::getInstance();
+    DirFileUtil dir(dirPath);
+    ASSERT_TRUE(dir.isOpen());
+    ASSERT_EQ(dir.writeFile("kept", {1}), Error::Errc::Success);
+
+    injector.armCrash(1);
+    EXPECT_EQ(dir.writeFile("lost", {2}), Error::Errc::FileOpenFailed);
+    EXPECT_EQ(dir.deleteFile("kept"), Error::Errc::FileRemoveFailed);
+    EXPECT_TRUE(dir.pathExists("kept")); // Stats still work in the "dead" process
+    std::vector<unsigned char> out;
+    EXPECT_EQ(dir.readFile("kept", out), Error::Errc::FileOpenFailed); // Opens do not
+    EXPECT_TRUE(injector.crashed());
+    injector.disarm();
+
+    EXPECT_FALSE(dir.pathExists("lost"));
+    ASSERT_EQ(dir.readFile("kept", out), Error::Errc::Success);
+    EXPECT_EQ(out, std::vector<unsigned char>{1});
+}
+
+} // namespace Test
+} // namespace Utils
+} // namespace SecureStorage
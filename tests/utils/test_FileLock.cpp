@@ -0,0 +1,125 @@
+#include "gtest/gtest.h"
+#include "FileLock.h"
+#include "FileUtil.h"
+#include "Error.h"
+
+#include <string>
+#include <sstream>
+#include <chrono>
+#include <cstdio>     // For std::remove
+#include <thread>
+#include <atomic>
+
+#include <unistd.h>   // For fork, _exit
+#include <sys/wait.h> // For waitpid
+
+namespace SecureStorage {
+namespace Utils {
+namespace Test {
+
+class FileLockTest : public ::testing::Test {
+protected:
+    std::string lockFilePath;
+
+    void SetUp() override {
+        const ::testing::TestInfo* const test_info =
+            ::testing::UnitTest::GetInstance()->current_test_info();
+        std::ostringstream oss;
+        oss << "FileLockTest_" << test_info->name() << "_" << getpid() << "_"
+            << std::chrono::steady_clock::now().time_since_epoch().count() << ".lock";
+        lockFilePath = oss.str();
+    }
+
+    void TearDown() override {
+        std::remove(lockFilePath.c_str());
+    }
+};
+
+TEST_F(FileLockTest, OpensAndCreatesLockFile) {
+    FileLock lock(lockFilePath);
+    ASSERT_TRUE(lock.isOpen());
+    ASSERT_TRUE(FileUtil::pathExists(lockFilePath));
+}
+
+TEST_F(FileLockTest, InstancesExcludeEachOtherPerSlot) {
+    FileLock first(lockFilePath);
+    FileLock second(lockFilePath);
+    ASSERT_TRUE(first.isOpen());
+    ASSERT_TRUE(second.isOpen());
+
+    ASSERT_EQ(first.lock(7), Error::Errc::Success);
+    EXPECT_FALSE(second.tryLock(7)); // Same slot is held by another open file description
+    EXPECT_TRUE(second.tryLock(8));  // Other slots are independent
+    second.unlock(8);
+
+    first.unlock(7);
+    EXPECT_TRUE(second.tryLock(7));
+    second.unlock(7);
+}
+
+TEST_F(FileLockTest, ThreadsSharingInstanceExcludeEachOther) {
+    // OFD locks taken through one descriptor never conflict, so threads sharing a
+    // FileLock must be serialized by the in-process slot table instead.
+    FileLock shared(lockFilePath);
+    ASSERT_TRUE(shared.isOpen());
+    ASSERT_EQ(shared.lock(5), Error::Errc::Success);
+
+    std::atomic<bool> acquired(false);
+    bool triedHeld = true;
+    std::thread other([&]() {
+        triedHeld = shared.tryLock(5);
+        if (shared.lock(5) == Error::Errc::Success) {
+            acquired = true;
+            shared.unlock(5);
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(acquired.load());
+
+    // While the slot is held on behalf of this thread, another process must still see it.
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        FileLock childLock(lockFilePath);
+        _exit(childLock.tryLock(5) ? 1 : 0);
+    }
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+
+    shared.unlock(5);
+    other.join();
+    EXPECT_FALSE(triedHeld);
+    EXPECT_TRUE(acquired.load());
+}
+
+TEST_F(FileLockTest, LockIsVisibleToOtherProcesses) {
+    FileLock lock(lockFilePath);
+    ASSERT_EQ(lock.lock(3), Error::Errc::Success);
+
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        FileLock childLock(lockFilePath);
+        bool gotHeld = childLock.tryLock(3);
+        bool gotFree = childLock.tryLock(4);
+        _exit((!gotHeld && gotFree) ? 0 : 1);
+    }
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+    lock.unlock(3);
+}
+
+TEST_F(FileLockTest, SlotForKeyIsStableAndInRange) {
+    uint64_t slot = FileLock::slotForKey("some_data_id", 1024);
+    EXPECT_LT(slot, 1024u);
+    EXPECT_EQ(slot, FileLock::slotForKey("some_data_id", 1024));
+    EXPECT_EQ(FileLock::slotForKey("", 1024), 14695981039346656037ULL % 1024); // FNV-1a offset basis
+}
+
+} // namespace Test
+} // namespace Utils
+} // namespace SecureStorage
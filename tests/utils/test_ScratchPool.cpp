@@ -0,0 +1,86 @@
+#include "gtest/gtest.h"
+#include "ScratchPool.h"
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <algorithm> // For std::all_of
+
+namespace SecureStorage {
+namespace Utils {
+namespace Test {
+
+TEST(ScratchPoolTest, BufferIsReusedAndWipedOnRelease) {
+    const unsigned char* storage = nullptr;
+    size_t capacity = 0;
+    {
+        ScratchBuffer scratch;
+        scratch.get().assign(200, 0xAB);
+        scratch.get().resize(50); // The tail past the size must be wiped as well
+        storage = scratch.get().data();
+        capacity = scratch.get().capacity();
+    }
+    {
+        ScratchBuffer scratch;
+        EXPECT_TRUE(scratch.get().empty());
+        EXPECT_EQ(scratch.get().data(), storage);
+        EXPECT_EQ(scratch.get().capacity(), capacity);
+        scratch.get().resize(200);
+        EXPECT_EQ(scratch.get().data(), storage);
+        EXPECT_TRUE(std::all_of(scratch.get().begin(), scratch.get().end(), [](unsigned char c) { return c == 0; }));
+    }
+}
+
+TEST(ScratchPoolTest, NestedLeasesGetDistinctBuffers) {
+    ScratchBuffer outer;
+    outer.get().assign(16, 0x01);
+    {
+        ScratchBuffer inner;
+        inner.get().assign(16, 0x02);
+        EXPECT_NE(inner.get().data(), outer.get().data());
+    }
+    EXPECT_EQ(outer.get(), std::vector<unsigned char>(16, 0x01));
+}
+
+TEST(ScratchPoolTest, OversizedBuffersAreNotRetained) {
+    {
+        ScratchBuffer scratch;
+        scratch.get().resize(SCRATCH_BUFFER_MAX_RETAINED_BYTES + 1);
+    }
+    ScratchBuffer scratch;
+    EXPECT_LE(scratch.get().capacity(), SCRATCH_BUFFER_MAX_RETAINED_BYTES);
+}
+
+TEST(ScratchPoolTest, PoolsArePerThread) {
+    const unsigned char* storage = nullptr;
+    {
+        ScratchBuffer scratch;
+        scratch.get().resize(64);
+        storage = scratch.get().data();
+    }
+    const unsigned char* other_storage = storage;
+    std::thread worker([&other_storage]() {
+        ScratchBuffer scratch;
+        other_storage = scratch.get().capacity() == 0 ? nullptr : scratch.get().data();
+    });
+    worker.join();
+    EXPECT_EQ(other_storage, nullptr); // A new thread starts with an empty pool
+}
+
+TEST(ScratchPoolTest, NamesAreReservedAndReused) {
+    const char* storage = nullptr;
+    {
+        ScratchName name;
+        EXPECT_TRUE(name.get().empty());
+        EXPECT_GE(name.get().capacity(), SCRATCH_NAME_CAPACITY);
+        name.get().assign("some_record_id.enc.bak");
+        storage = name.get().data();
+    }
+    ScratchName name;
+    EXPECT_TRUE(name.get().empty());
+    EXPECT_EQ(name.get().data(), storage);
+}
+
+} // namespace Test
+} // namespace Utils
+} // namespace SecureStorage
@@ -0,0 +1,68 @@
+#include "gtest/gtest.h"
+#include "SecureArena.h"
+
+#include <vector>
+#include <algorithm> // For std::all_of, std::fill
+
+namespace SecureStorage {
+namespace Utils {
+namespace Test {
+
+TEST(SecureArenaTest, RegionIsMapped) {
+    SecureArenaStats stats = SecureArena::instance().getStats();
+    EXPECT_GE(stats.capacity, SECURE_ARENA_DEFAULT_BYTES);
+    // Whether it is locked depends on RLIMIT_MEMLOCK; without a lock it is still usable.
+}
+
+TEST(SecureArenaTest, FreedBlocksAreZeroizedAndReused) {
+    SecureArena& arena = SecureArena::instance();
+    SecureArenaStats before = arena.getStats();
+
+    unsigned char* block = static_cast<unsigned char*>(arena.allocate(100));
+    ASSERT_NE(block, nullptr);
+    EXPECT_EQ(arena.getStats().bytesInUse, before.bytesInUse + 128); // Rounded up to its size class
+    std::fill(block, block + 100, 0xAA);
+    arena.deallocate(block, 100);
+    EXPECT_EQ(arena.getStats().bytesInUse, before.bytesInUse);
+
+    // Any request of the same size class gets the block back, zeroized.
+    unsigned char* again = static_cast<unsigned char*>(arena.allocate(120));
+    EXPECT_EQ(again, block);
+    EXPECT_TRUE(std::all_of(again, again + 120, [](unsigned char c) { return c == 0; }));
+    arena.deallocate(again, 120);
+    EXPECT_EQ(arena.getStats().heapFallbacks, before.heapFallbacks);
+}
+
+TEST(SecureArenaTest, LargeRequestsFallBackToTheHeap) {
+    SecureArena& arena = SecureArena::instance();
+    uint64_t fallbacks = arena.getStats().heapFallbacks;
+    const size_t size = SECURE_ARENA_MAX_BLOCK + 1;
+    unsigned char* block = static_cast<unsigned char*>(arena.allocate(size));
+    ASSERT_NE(block, nullptr);
+    std::fill(block, block + size, 0x5A);
+    EXPECT_EQ(arena.getStats().heapFallbacks, fallbacks + 1);
+    arena.deallocate(block, size); // Wiped, then returned to the heap
+}
+
+TEST(SecureArenaTest, SecureBytesWorksAsAVector) {
+    SecureArena& arena = SecureArena::instance();
+    size_t in_use = arena.getStats().bytesInUse;
+    {
+        SecureBytes key(32, 0x11);
+        EXPECT_GT(arena.getStats().bytesInUse, in_use);
+        key.push_back(0x22);
+        SecureBytes copy(key);
+        EXPECT_EQ(copy, key);
+        SecureBytes moved(std::move(copy));
+        EXPECT_EQ(moved.size(), 33u);
+        EXPECT_EQ(moved.back(), 0x22);
+
+        secureWipe(moved);
+        EXPECT_TRUE(moved.empty());
+    }
+    EXPECT_EQ(arena.getStats().bytesInUse, in_use);
+}
+
+} // namespace Test
+} // namespace Utils
+} // namespace SecureStorage